@@ -0,0 +1,51 @@
+/*
+Title: Object Loading
+File Name: fragmentBindless.glsl
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#version 430 core
+#extension GL_ARB_bindless_texture : require
+
+in vec2 uv;
+in vec3 normal;
+flat in uint textureIndex;
+
+out vec4 fragColor;
+
+// Handles of every texture in the table, bound by TextureTable.
+// A handle is 64 bits, stored as two 32 bit halves.
+layout(std430, binding = 0) readonly buffer TextureHandles
+{
+	uvec2 handles[];
+};
+
+void main(void)
+{
+	vec4 ambientLight = vec4(.1, .1, .1, 1);
+	vec4 lightColor = vec4(1, .9, .5, 1);
+	vec3 lightDir = vec3(-1, -1, -2);
+
+	// calculate diffuse lighting and clamp between 0 and 1
+	float ndotl = clamp(-dot(normalize(lightDir), normalize(normal)), 0, 1); 
+
+	// add diffuse lighting to ambient lighting and clamp a second time
+	vec4 lightValue = clamp(lightColor * ndotl + ambientLight, 0, 1);
+
+	// finally, turn the draw's handle into a sampler, sample from it and multiply in the light.
+	fragColor = texture(sampler2D(handles[textureIndex]), uv) * lightValue;
+}
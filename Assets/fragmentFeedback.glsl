@@ -0,0 +1,46 @@
+/*
+Title: Object Loading
+File Name: fragmentFeedback.glsl
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#version 400 core
+
+in vec2 uv;
+
+// Same as in fragmentVirtual.glsl. The level bias makes up for the feedback buffer being smaller than the screen.
+uniform vec4 vtPageTable;
+uniform vec4 vtPage;
+
+void main(void)
+{
+	// Pick the same page as fragmentVirtual.glsl.
+	vec2 virtualUv = fract(uv) * vtPageTable.zw;
+	vec2 texel = uv * vtPageTable.zw * vtPageTable.x * vtPage.x;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtPage.z;
+	float level = clamp(floor(lod), 0, vtPageTable.y - 1);
+
+	vec2 page = floor(virtualUv * (vtPageTable.x / exp2(level)));
+
+	// Write the page for PageTable::DecodeFeedback: the low 8 bits of x and y, their high 4 bits,
+	// and the level + 1, so the cleared background (alpha 0) isn't mistaken for a page.
+	vec2 low = mod(page, 256);
+	vec2 high = floor(page / 256);
+	gl_FragColor = vec4(low.x, low.y, high.x + high.y * 16, level + 1) / 255;
+}
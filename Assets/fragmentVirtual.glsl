@@ -0,0 +1,77 @@
+/*
+Title: Object Loading
+File Name: fragmentVirtual.glsl
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#version 400 core
+
+in vec2 uv;
+in vec3 normal;
+
+// Cache of resident pages, and the table that says where each virtual page is in it.
+uniform sampler2D physicalPages;
+uniform sampler2D pageTable;
+
+// x: pages along a side of level 0, y: number of levels,
+// zw: size of the image over the size of level 0, which is padded out to a square.
+uniform vec4 vtPageTable;
+// x: page size in texels, y: border around each page in the cache, z: level bias.
+uniform vec4 vtPage;
+
+void main(void)
+{
+	vec4 ambientLight = vec4(.1, .1, .1, 1);
+	vec4 lightColor = vec4(1, .9, .5, 1);
+	vec3 lightDir = vec3(-1, -1, -2);
+
+	// calculate diffuse lighting and clamp between 0 and 1
+	float ndotl = clamp(-dot(normalize(lightDir), normalize(normal)), 0, 1); 
+
+	// add diffuse lighting to ambient lighting and clamp a second time
+	vec4 lightValue = clamp(lightColor * ndotl + ambientLight, 0, 1);
+
+	// Facades repeat, so wrap the uvs, then scale them to the part of the padded square the image covers.
+	vec2 virtualUv = fract(uv) * vtPageTable.zw;
+
+	// Pick the mip level the way the hardware would, from how fast the texels change across the screen.
+	// The derivatives come from the unwrapped uvs, so there are no seams where they wrap.
+	vec2 texel = uv * vtPageTable.zw * vtPageTable.x * vtPage.x;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtPage.z;
+	float level = clamp(floor(lod), 0, vtPageTable.y - 1);
+
+	ivec2 page = ivec2(virtualUv * (vtPageTable.x / exp2(level)));
+	vec4 entry = floor(texelFetch(pageTable, page, int(level)) * 255 + 0.5);
+
+	// Nothing is resident until the last level has been uploaded.
+	if (entry.a == 0)
+	{
+		gl_FragColor = vec4(.5, .5, .5, 1) * lightValue;
+		return;
+	}
+
+	// The entry can point at a coarser page than we asked for, so find our spot within that page.
+	// Then skip over the slots before it, and the border of its own slot.
+	vec2 pageUv = fract(virtualUv * (vtPageTable.x / exp2(entry.b)));
+	float slotSize = vtPage.x + vtPage.y * 2;
+	vec2 physicalUv = (entry.rg * slotSize + vtPage.y + pageUv * vtPage.x) / vec2(textureSize(physicalPages, 0));
+
+	// The cache has no mip levels, the page table already picked one.
+	gl_FragColor = textureLod(physicalPages, physicalUv, 0) * lightValue;
+}
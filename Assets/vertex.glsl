@@ -35,6 +35,11 @@ layout(location = 2) in vec3 in_normal;
 uniform mat4 worldMatrix;
 uniform mat4 cameraView;
 
+// Scale and offset for the uvs, for textures packed into an atlas.
+// It starts out sampling the whole texture. Uniforms belong to the program, not the material,
+// so once one material sets it, every material sharing the program should set it too.
+uniform vec4 uvScaleOffset = vec4(1, 1, 0, 0);
+
 out vec2 uv;
 out vec3 normal;
 
@@ -47,5 +52,5 @@ void main(void)
 	// output the transformed vector
 	gl_Position = viewPosition;
 	normal = mat3(worldMatrix) * in_normal;
-	uv = in_uv;
+	uv = in_uv * uvScaleOffset.xy + uvScaleOffset.zw;
 }
\ No newline at end of file
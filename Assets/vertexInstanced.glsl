@@ -0,0 +1,52 @@
+/*
+Title: Object Loading
+File Name: vertexInstanced.glsl
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#version 400 core
+
+// Vertex attribute for position
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) in vec3 in_normal;
+
+// The world matrix comes from the instance buffer instead of a uniform.
+// A mat4 attribute uses locations 3, 4, 5 and 6.
+layout(location = 3) in mat4 in_worldMatrix;
+
+uniform mat4 cameraView;
+
+// Scale and offset for the uvs, for textures packed into an atlas.
+// It starts out sampling the whole texture. Uniforms belong to the program, not the material,
+// so once one material sets it, every material sharing the program should set it too.
+uniform vec4 uvScaleOffset = vec4(1, 1, 0, 0);
+
+out vec2 uv;
+out vec3 normal;
+
+void main(void)
+{
+	//transform the vector
+	vec4 worldPosition = in_worldMatrix * vec4(in_position, 1);
+	vec4 viewPosition = cameraView * worldPosition;
+
+	// output the transformed vector
+	gl_Position = viewPosition;
+	normal = mat3(in_worldMatrix) * in_normal;
+	uv = in_uv * uvScaleOffset.xy + uvScaleOffset.zw;
+}
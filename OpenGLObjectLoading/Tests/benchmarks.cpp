@@ -0,0 +1,114 @@
+/*
+Title: Object Loading
+File Name: benchmarks.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "textureCompressor.h"
+#include "mipmapGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+// Benchmarks for classes that have no tests file of their own.
+
+// Size of the image the texture compression benchmark works on.
+#define BENCHMARK_IMAGE_SIZE 1024
+
+// A BGRA image that is the same on every run and has a bit of everything an encoder has to deal with:
+// smooth gradients, hard edges, fine noise and an alpha channel that isn't flat.
+static std::vector<unsigned char> MakeBenchmarkImage(unsigned int size)
+{
+    std::vector<unsigned char> pixels((size_t)size * size * 4);
+    unsigned int state = 1;
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            // A small xorshift generator for the noise.
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            int noise = (int)(state & 15) - 8;
+
+            float u = (float)x / size;
+            float v = (float)y / size;
+            bool tile = ((x / 64) + (y / 64)) % 2 == 0;
+            float distance = sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f));
+
+            unsigned char* pixel = &pixels[((size_t)y * size + x) * 4];
+            pixel[0] = (unsigned char)std::min(std::max((int)(255 * v) + noise, 0), 255);
+            pixel[1] = (unsigned char)std::min(std::max((int)(127 + 127 * sinf(u * 20)) + noise, 0), 255);
+            pixel[2] = (unsigned char)(tile ? 200 : 40);
+            pixel[3] = (unsigned char)std::min((int)(255 * distance * 2), 255);
+        }
+    }
+    return pixels;
+}
+
+// Builds a full mip chain of a 4096 x 4096 image with each cpu filter.
+// The rate is in pixels of the source image, like the loader sees it.
+void MipmapGeneratorBenchmark()
+{
+    const unsigned int size = 4096;
+    std::vector<unsigned char> pixels = MakeBenchmarkImage(size);
+    double megapixels = (double)size * size / 1000000.0;
+
+    const MipmapFilter filters[] = { MipmapFilter::Box, MipmapFilter::Kaiser };
+    const char* filterNames[] = { "box", "Kaiser" };
+    for (int i = 0; i < 2; i++)
+    {
+        std::vector<unsigned char> chain;
+        auto start = std::chrono::high_resolution_clock::now();
+        unsigned int levelCount = MipmapGenerator::BuildChain(filters[i], pixels.data(), size, size, chain);
+        double milliseconds = Tests::MillisecondsSince(start);
+
+        std::cout << "Mipmap chain, " << filterNames[i] << " filter, " << size << "x" << size << ": " << levelCount << " levels in "
+            << milliseconds << "ms, " << megapixels * 1000.0 / milliseconds << " MPix/s" << std::endl;
+    }
+}
+
+// Encodes the same image to each block compressed format, with one thread and with a job system,
+// and measures how close the result is to the original.
+void TextureCompressorBenchmark()
+{
+    const unsigned int size = BENCHMARK_IMAGE_SIZE;
+    std::vector<unsigned char> pixels = MakeBenchmarkImage(size);
+    double megapixels = (double)size * size / 1000000.0;
+
+    const TextureCompression formats[] = { TextureCompression::BC1, TextureCompression::BC3, TextureCompression::BC7 };
+    const char* formatNames[] = { "BC1", "BC3", "BC7" };
+    JobSystem jobs;
+    for (int i = 0; i < 3; i++)
+    {
+        // Level 0 only, so the time is all encoding.
+        CompressedImage image;
+        auto start = std::chrono::high_resolution_clock::now();
+        TextureCompressor::Compress(formats[i], MipmapFilter::None, pixels.data(), size, size, image);
+        double milliseconds = Tests::MillisecondsSince(start);
+
+        CompressedImage imageWithJobs;
+        start = std::chrono::high_resolution_clock::now();
+        TextureCompressor::Compress(formats[i], MipmapFilter::None, pixels.data(), size, size, imageWithJobs, &jobs);
+        double jobsMilliseconds = Tests::MillisecondsSince(start);
+
+        std::cout << "Texture compression, " << formatNames[i] << ", " << size << "x" << size << ": "
+            << megapixels * 1000.0 / milliseconds << " MPix/s, with the job system " << megapixels * 1000.0 / jobsMilliseconds
+            << " MPix/s, " << size * size * 4 / image.m_data.size() << "x smaller, PSNR "
+            << TextureCompressor::MeasurePSNR(pixels.data(), image) << "dB" << std::endl;
+    }
+}
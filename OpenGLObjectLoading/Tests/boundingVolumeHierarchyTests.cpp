@@ -0,0 +1,252 @@
+/*
+Title: Object Loading
+File Name: boundingVolumeHierarchyTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "boundingVolumeHierarchy.h"
+#include "frustumCuller.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+// An object as the test sees it, to check the tree's answers against.
+struct BvhObject
+{
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
+    int m_proxy;
+    bool m_inTree;
+};
+
+static float Random(std::mt19937& random, float low, float high)
+{
+    return std::uniform_real_distribution<float>(low, high)(random);
+}
+
+static bool BoxTouchesSphere(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3 center, float radius)
+{
+    glm::vec3 offset = center - glm::clamp(center, boundsMin, boundsMax);
+    return glm::dot(offset, offset) <= radius * radius;
+}
+
+static bool BoxTouchesRay(glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3 origin, glm::vec3 direction, float maxDistance)
+{
+    glm::vec3 inverse = 1.0f / direction;
+    glm::vec3 t0 = (boundsMin - origin) * inverse;
+    glm::vec3 t1 = (boundsMax - origin) * inverse;
+    glm::vec3 near = glm::min(t0, t1);
+    glm::vec3 far = glm::max(t0, t1);
+    float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+    return enter <= exit;
+}
+
+static bool BoxTouchesFrustum(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::vec4* planes)
+{
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 halfSize = (boundsMax - boundsMin) * 0.5f;
+    for (int i = 0; i < 6; i++)
+    {
+        glm::vec3 normal = glm::vec3(planes[i]);
+        if (glm::dot(normal, center) + planes[i].w + glm::dot(glm::abs(normal), halfSize) < 0)
+            return false;
+    }
+    return true;
+}
+
+// Runs a random frustum, sphere and ray query, and compares them with testing every object's fat box.
+// Also checks that every fat box still contains its object.
+static void CheckQueries(BoundingVolumeHierarchy& tree, const std::vector<BvhObject>& objects, std::mt19937& random)
+{
+    glm::vec3 eye(Random(random, -50, 50), Random(random, -5, 5), Random(random, -50, 50));
+    glm::vec3 target(Random(random, -50, 50), 0, Random(random, -50, 50));
+    glm::mat4 viewProjection = glm::perspective(0.75f, 4.0f / 3.0f, 0.1f, 100.0f) * glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+    glm::vec4 planes[6];
+    FrustumCuller::ExtractPlanes(viewProjection, planes);
+
+    glm::vec3 center(Random(random, -50, 50), Random(random, -50, 50), Random(random, -50, 50));
+    float radius = Random(random, 1, 20);
+    glm::vec3 origin(Random(random, -60, 60), Random(random, -60, 60), Random(random, -60, 60));
+    glm::vec3 direction = glm::normalize(glm::vec3(Random(random, -1, 1), Random(random, -1, 1), Random(random, -1, 1)));
+    float maxDistance = Random(random, 10, 200);
+
+    std::vector<unsigned int> inFrustum, inSphere, onRay;
+    tree.QueryFrustum(viewProjection, inFrustum);
+    tree.QuerySphere(center, radius, inSphere);
+    tree.QueryRay(origin, direction, maxDistance, onRay);
+    std::sort(inFrustum.begin(), inFrustum.end());
+    std::sort(inSphere.begin(), inSphere.end());
+    std::sort(onRay.begin(), onRay.end());
+
+    std::vector<unsigned int> expectedFrustum, expectedSphere, expectedRay;
+    bool contained = true;
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        if (!objects[i].m_inTree)
+            continue;
+
+        count++;
+        glm::vec3 fatMin = tree.GetFatBoundsMin(objects[i].m_proxy);
+        glm::vec3 fatMax = tree.GetFatBoundsMax(objects[i].m_proxy);
+        contained = contained && tree.GetObject(objects[i].m_proxy) == i
+            && !glm::any(glm::lessThan(objects[i].m_boundsMin, fatMin)) && !glm::any(glm::greaterThan(objects[i].m_boundsMax, fatMax));
+
+        if (BoxTouchesFrustum(fatMin, fatMax, planes))
+            expectedFrustum.push_back(i);
+        if (BoxTouchesSphere(fatMin, fatMax, center, radius))
+            expectedSphere.push_back(i);
+        if (BoxTouchesRay(fatMin, fatMax, origin, direction, maxDistance))
+            expectedRay.push_back(i);
+    }
+
+    CHECK(contained);
+    CHECK(tree.GetObjectCount() == count);
+    CHECK(inFrustum == expectedFrustum);
+    CHECK(inSphere == expectedSphere);
+    CHECK(onRay == expectedRay);
+}
+
+// Queries stay exact through inserts, moves, removes, refits and rebuilds.
+static void QueriesMatchBruteForce()
+{
+    std::mt19937 random(7);
+    BoundingVolumeHierarchy tree(0.5f);
+    std::vector<BvhObject> objects;
+    for (unsigned int i = 0; i < 5000; i++)
+    {
+        glm::vec3 center(Random(random, -50, 50), Random(random, -50, 50), Random(random, -50, 50));
+        glm::vec3 halfSize(Random(random, 0.1f, 2), Random(random, 0.1f, 2), Random(random, 0.1f, 2));
+        BvhObject object = { center - halfSize, center + halfSize, 0, true };
+        object.m_proxy = tree.Insert(object.m_boundsMin, object.m_boundsMax, i);
+        objects.push_back(object);
+    }
+    CheckQueries(tree, objects, random);
+    float insertedCost = tree.GetCost();
+
+    // Objects wander off, and some leave the tree and come back.
+    for (int round = 0; round < 10; round++)
+    {
+        for (int i = 0; i < 500; i++)
+        {
+            BvhObject& object = objects[random() % objects.size()];
+            if (!object.m_inTree)
+                continue;
+            glm::vec3 displacement(Random(random, -2, 2), Random(random, -2, 2), Random(random, -2, 2));
+            object.m_boundsMin += displacement;
+            object.m_boundsMax += displacement;
+            tree.Move(object.m_proxy, object.m_boundsMin, object.m_boundsMax, displacement);
+        }
+        for (int i = 0; i < 50; i++)
+        {
+            unsigned int index = random() % objects.size();
+            BvhObject& object = objects[index];
+            if (object.m_inTree)
+                tree.Remove(object.m_proxy);
+            else
+                object.m_proxy = tree.Insert(object.m_boundsMin, object.m_boundsMax, index);
+            object.m_inTree = !object.m_inTree;
+        }
+        CheckQueries(tree, objects, random);
+    }
+
+    // Everything shifts a little in place.
+    for (BvhObject& object : objects)
+    {
+        if (!object.m_inTree)
+            continue;
+        glm::vec3 displacement(Random(random, -3, 3), Random(random, -3, 3), Random(random, -3, 3));
+        object.m_boundsMin += displacement;
+        object.m_boundsMax += displacement;
+        tree.SetBounds(object.m_proxy, object.m_boundsMin, object.m_boundsMax);
+    }
+    tree.Refit();
+    CheckQueries(tree, objects, random);
+
+    // A rebuild gives a tree at least as good as inserting one by one, with the same answers.
+    tree.Build();
+    CheckQueries(tree, objects, random);
+    CHECK(tree.GetCost() <= insertedCost);
+    // A balanced binary tree over ~5000 leaves is 13 deep, allow some slack for the surface area splits.
+    CHECK(tree.GetHeight() <= 26);
+}
+
+void BoundingVolumeHierarchyTests()
+{
+    QueriesMatchBruteForce();
+}
+
+// A city that grows from 1,000 to 1,000,000 buildings at the same density, so every query finds
+// about as many buildings. With a good tree, query time grows with log(count), not with count.
+void BoundingVolumeHierarchyBenchmark()
+{
+    std::mt19937 random(7);
+    const int queries = 2000;
+    std::vector<unsigned int> results;
+    for (unsigned int count = 1000; count <= 1000000; count *= 10)
+    {
+        BoundingVolumeHierarchy tree;
+        float side = sqrtf((float)count) * 4;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            glm::vec3 position(Random(random, 0, side), 0, Random(random, 0, side));
+            glm::vec3 halfSize(1, Random(random, 1, 8), 1);
+            tree.Insert(position - halfSize, position + halfSize, i);
+        }
+        double insertMilliseconds = Tests::MillisecondsSince(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        tree.Build();
+        double buildMilliseconds = Tests::MillisecondsSince(start);
+
+        // A camera on the street looking a random way, with a 60 unit view, a 10 unit sphere around it, and a ray ahead.
+        double frustumMicroseconds = 0, sphereMicroseconds = 0, rayMicroseconds = 0;
+        size_t frustumHits = 0, sphereHits = 0, rayHits = 0;
+        for (int query = 0; query < queries; query++)
+        {
+            glm::vec3 eye(Random(random, 0, side), 2, Random(random, 0, side));
+            float angle = Random(random, 0, 6.28f);
+            glm::vec3 forward(cosf(angle), 0, sinf(angle));
+            glm::mat4 viewProjection = glm::perspective(0.75f, 4.0f / 3.0f, 0.1f, 60.0f) * glm::lookAt(eye, eye + forward, glm::vec3(0, 1, 0));
+
+            start = std::chrono::high_resolution_clock::now();
+            tree.QueryFrustum(viewProjection, results);
+            frustumMicroseconds += Tests::MillisecondsSince(start) * 1000;
+            frustumHits += results.size();
+
+            start = std::chrono::high_resolution_clock::now();
+            tree.QuerySphere(eye, 10, results);
+            sphereMicroseconds += Tests::MillisecondsSince(start) * 1000;
+            sphereHits += results.size();
+
+            start = std::chrono::high_resolution_clock::now();
+            tree.QueryRay(eye, glm::vec3(forward.x, -0.02f, forward.z), 100, results);
+            rayMicroseconds += Tests::MillisecondsSince(start) * 1000;
+            rayHits += results.size();
+        }
+
+        std::cout << "Bounding volume hierarchy, " << count << " objects: insert " << insertMilliseconds << "ms, build "
+            << buildMilliseconds << "ms, height " << tree.GetHeight() << std::endl;
+        std::cout << "    frustum " << frustumMicroseconds / queries << "us (" << frustumHits / queries << " found), sphere "
+            << sphereMicroseconds / queries << "us (" << sphereHits / queries << " found), ray "
+            << rayMicroseconds / queries << "us (" << rayHits / queries << " found)" << std::endl;
+    }
+}
@@ -0,0 +1,195 @@
+/*
+Title: Object Loading
+File Name: frustumCullerTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "frustumCuller.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+// Random boxes and spheres (a third of them) spread through a cube around the camera.
+struct CullScene
+{
+    std::vector<glm::vec3> m_boundsMin;
+    std::vector<glm::vec3> m_boundsMax;
+    std::vector<float> m_radius;
+};
+
+static void MakeScene(FrustumCuller& culler, CullScene& scene, unsigned int count)
+{
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    culler.Clear();
+    culler.Reserve(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glm::vec3 center(position(random), position(random), position(random));
+        if (i % 3 == 0)
+        {
+            float radius = size(random);
+            culler.AddSphere(center, radius);
+            scene.m_boundsMin.push_back(center);
+            scene.m_boundsMax.push_back(center);
+            scene.m_radius.push_back(radius);
+        }
+        else
+        {
+            glm::vec3 halfSize(size(random), size(random), size(random));
+            culler.AddBox(center - halfSize, center + halfSize);
+            scene.m_boundsMin.push_back(center - halfSize);
+            scene.m_boundsMax.push_back(center + halfSize);
+            scene.m_radius.push_back(0);
+        }
+    }
+}
+
+static glm::mat4 MakeViewProjection()
+{
+    glm::mat4 projection = glm::perspective(0.75f, 4.0f / 3.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(3, 2, 10), glm::vec3(0, 0, -20), glm::vec3(0, 1, 0));
+    return projection * view;
+}
+
+// The same test as the SIMD loops, one object and one plane at a time.
+static std::vector<unsigned int> CullOneByOne(FrustumCuller& culler, const CullScene& scene)
+{
+    std::vector<unsigned int> visible;
+    for (unsigned int i = 0; i < scene.m_boundsMin.size(); i++)
+    {
+        glm::vec3 center = (scene.m_boundsMin[i] + scene.m_boundsMax[i]) * 0.5f;
+        glm::vec3 halfSize = (scene.m_boundsMax[i] - scene.m_boundsMin[i]) * 0.5f;
+        bool inside = true;
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            glm::vec4 plane = culler.GetPlane(p);
+            glm::vec3 normal = glm::vec3(plane);
+            inside = inside && glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), halfSize) + scene.m_radius[i] >= 0;
+        }
+        if (inside)
+            visible.push_back(i);
+    }
+    return visible;
+}
+
+// Points inside the clip volume are inside all six planes, and points outside it are outside one.
+static void PlanesMatchClipSpace()
+{
+    glm::mat4 viewProjection = MakeViewProjection();
+    glm::vec4 planes[6];
+    FrustumCuller::ExtractPlanes(viewProjection, planes);
+
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> across(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> depth(-50.0f, 50.0f);
+    unsigned int mismatches = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        glm::vec3 point(across(random), across(random), depth(random));
+        glm::vec4 clip = viewProjection * glm::vec4(point, 1);
+        bool insideClip = fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && fabsf(clip.z) <= clip.w;
+
+        // Planes aren't normalized exactly the same way as clip space, so leave a little room at the edges.
+        bool insidePlanes = true;
+        bool nearEdge = false;
+        for (int p = 0; p < 6; p++)
+        {
+            float distance = glm::dot(glm::vec3(planes[p]), point) + planes[p].w;
+            insidePlanes = insidePlanes && distance >= 0;
+            nearEdge = nearEdge || fabsf(distance) < 1e-4f;
+        }
+        if (insideClip != insidePlanes && !nearEdge)
+            mismatches++;
+    }
+    CHECK(mismatches == 0);
+}
+
+// SSE, AVX, and both with jobs, all keep exactly the objects the one by one test keeps.
+static void LoopsMatchOneByOne()
+{
+    FrustumCuller culler;
+    CullScene scene;
+    // Not a multiple of 8, so the padding at the end is tested too.
+    MakeScene(culler, scene, 3 * CULL_OBJECTS_PER_JOB + 5);
+    culler.SetFrustum(MakeViewProjection());
+
+    std::vector<unsigned int> expected = CullOneByOne(culler, scene);
+    CHECK(!expected.empty());
+    CHECK(expected.size() < scene.m_boundsMin.size());
+
+    JobSystem jobs(4);
+    bool useAvx = FrustumCuller::GetUseAvx();
+    for (int avx = 0; avx < 2; avx++)
+    {
+        FrustumCuller::SetUseAvx(avx == 1);
+        culler.Cull();
+        CHECK(culler.GetVisible() == expected);
+        culler.Cull(&jobs);
+        CHECK(culler.GetVisible() == expected);
+    }
+    FrustumCuller::SetUseAvx(useAvx);
+}
+
+void FrustumCullerTests()
+{
+    PlanesMatchClipSpace();
+    LoopsMatchOneByOne();
+}
+
+// 1,000,000 objects per frame, with the SSE and AVX loops, on one thread and across a job system.
+void FrustumCullerBenchmark()
+{
+    const unsigned int count = 1000000;
+    FrustumCuller culler;
+    CullScene scene;
+    MakeScene(culler, scene, count);
+    culler.SetFrustum(MakeViewProjection());
+
+    JobSystem jobs;
+    bool useAvx = FrustumCuller::GetUseAvx();
+    for (int avx = 0; avx < 2; avx++)
+    {
+        FrustumCuller::SetUseAvx(avx == 1);
+        if (avx == 1 && !FrustumCuller::GetUseAvx())
+        {
+            std::cout << "Frustum culling (AVX): skipped, the cpu doesn't have AVX" << std::endl;
+            break;
+        }
+
+        for (int threaded = 0; threaded < 2; threaded++)
+        {
+            // Best of a few frames, so one slow frame doesn't hide the loop's speed.
+            double best = 0;
+            for (int frame = 0; frame < 10; frame++)
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                culler.Cull(threaded ? &jobs : nullptr);
+                double milliseconds = Tests::MillisecondsSince(start);
+                best = frame == 0 ? milliseconds : std::min(best, milliseconds);
+            }
+
+            std::cout << "Frustum culling (" << (avx ? "AVX" : "SSE") << ", " << (threaded ? "job system" : "one thread") << "): "
+                << count << " objects in " << best << "ms, " << culler.GetVisible().size() << " visible" << std::endl;
+        }
+    }
+    FrustumCuller::SetUseAvx(useAvx);
+}
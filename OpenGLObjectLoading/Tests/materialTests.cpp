@@ -0,0 +1,171 @@
+/*
+Title: Object Loading
+File Name: materialTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "recordingGL.h"
+#include "material.h"
+
+// Number of opengl calls Material::Bind makes, from a clean state, for the values the material has.
+static unsigned int CountBindCalls(Material* material)
+{
+    GLState::Invalidate();
+    RecordingGL::ResetCallCount();
+    material->Bind();
+    return RecordingGL::GetCallCount();
+}
+
+// Each setter only takes uniforms of its own type. Before slots had types, SetTexture on a handle SetMatrix
+// had registered used the matrix's index in the texture list, and released whatever texture was there.
+static void SettersCheckUniformType()
+{
+    RecordingGL::SetProgramUniforms({ { "cameraView", GL_FLOAT_MAT4 }, { "tex", GL_SAMPLER_2D }, { "tint", GL_FLOAT_VEC4 } });
+    Material* material = new Material(new ShaderProgram());
+    char cameraViewName[] = "cameraView";
+    char texName[] = "tex";
+    char tintName[] = "tint";
+    int cameraViewHandle = material->GetUniformHandle(cameraViewName);
+    int texHandle = material->GetUniformHandle(texName);
+    int tintHandle = material->GetUniformHandle(tintName);
+
+    Texture* first = new Texture();
+    Texture* second = new Texture();
+    first->IncRefCount();
+    second->IncRefCount();
+
+    // Matching types are set, and setting a uniform again replaces its value.
+    material->SetMatrix(cameraViewHandle, glm::mat4(1.0f));
+    material->SetTexture(texHandle, first);
+    material->SetVector(tintHandle, glm::vec4(1.0f));
+    material->SetTexture(texName, second);
+    CHECK(first->GetRefCount() == 1);
+    CHECK(second->GetRefCount() == 2);
+    unsigned int bindCalls = CountBindCalls(material);
+
+    // Mismatched types are ignored, and don't touch the values already set.
+    material->SetTexture(cameraViewHandle, first);
+    material->SetTexture(tintName, first);
+    material->SetMatrix(texHandle, glm::mat4(2.0f));
+    material->SetMatrix(tintName, glm::mat4(2.0f));
+    material->SetVector(cameraViewHandle, glm::vec4(2.0f));
+    material->SetVector(texName, glm::vec4(2.0f));
+    CHECK(first->GetRefCount() == 1);
+    CHECK(second->GetRefCount() == 2);
+    CHECK(CountBindCalls(material) == bindCalls);
+
+    delete material;
+    CHECK(second->GetRefCount() == 1);
+    first->DecRefCount();
+    second->DecRefCount();
+}
+
+void MaterialTests()
+{
+    RecordingGL::Install();
+    SettersCheckUniformType();
+}
+
+// How Material set a matrix before the shader program reflected its uniforms:
+// use the program, ask the driver for the location of the name, then search the matrices set so far for it.
+class LookupMaterial
+{
+private:
+    GLuint m_program;
+    std::vector<GLint> m_matrixUniforms;
+    std::vector<glm::mat4> m_matrices;
+
+public:
+    LookupMaterial(GLuint program) : m_program(program) {}
+
+    void SetMatrix(const char* name, const glm::mat4& matrix)
+    {
+        glUseProgram(m_program);
+        GLint uniform = glGetUniformLocation(m_program, name);
+        if (uniform == -1)
+            return;
+
+        for (size_t i = 0; i < m_matrixUniforms.size(); i++)
+        {
+            if (m_matrixUniforms[i] == uniform)
+            {
+                m_matrices[i] = matrix;
+                return;
+            }
+        }
+        m_matrixUniforms.push_back(uniform);
+        m_matrices.push_back(matrix);
+    }
+};
+
+// 10,000 SetMatrix calls, alternating between the camera and world matrix like main does for each object,
+// by name lookup the old way, by name through the reflected uniforms, and through handles.
+// The recording driver stands in for opengl, so the calls are counted. Its glGetUniformLocation is a short
+// search, where a real driver does more work, so the old way is at least as slow as shown here.
+void MaterialBenchmark()
+{
+    const int calls = 10000;
+    RecordingGL::Install();
+    RecordingGL::SetProgramUniforms({ { "cameraView", GL_FLOAT_MAT4 }, { "worldMatrix", GL_FLOAT_MAT4 }, { "tex", GL_SAMPLER_2D } });
+
+    ShaderProgram* shaderProgram = new ShaderProgram();
+    Material* material = new Material(shaderProgram);
+    char cameraViewName[] = "cameraView";
+    char worldMatrixName[] = "worldMatrix";
+    char* names[] = { cameraViewName, worldMatrixName };
+    // Looking the handles up links the program, which isn't part of the timing.
+    int handles[] = { material->GetUniformHandle(cameraViewName), material->GetUniformHandle(worldMatrixName) };
+    glm::mat4 matrix(1.0f);
+
+    LookupMaterial lookupMaterial(shaderProgram->GetGLShaderProgram());
+    RecordingGL::ResetCallCount();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; i++)
+    {
+        matrix[3][0] = (float)i;
+        lookupMaterial.SetMatrix(names[i & 1], matrix);
+    }
+    double lookupMilliseconds = Tests::MillisecondsSince(start);
+    unsigned int lookupCalls = RecordingGL::GetCallCount();
+
+    RecordingGL::ResetCallCount();
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; i++)
+    {
+        matrix[3][0] = (float)i;
+        material->SetMatrix(names[i & 1], matrix);
+    }
+    double nameMilliseconds = Tests::MillisecondsSince(start);
+    unsigned int nameCalls = RecordingGL::GetCallCount();
+
+    RecordingGL::ResetCallCount();
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < calls; i++)
+    {
+        matrix[3][0] = (float)i;
+        material->SetMatrix(handles[i & 1], matrix);
+    }
+    double handleMilliseconds = Tests::MillisecondsSince(start);
+    unsigned int handleCalls = RecordingGL::GetCallCount();
+
+    std::cout << "Material::SetMatrix, " << calls << " calls: glGetUniformLocation each call " << lookupMilliseconds << "ms ("
+        << lookupCalls << " gl calls), by name " << nameMilliseconds << "ms (" << nameCalls << " gl calls), by handle "
+        << handleMilliseconds << "ms (" << handleCalls << " gl calls, " << lookupMilliseconds / handleMilliseconds << "x faster)" << std::endl;
+
+    delete material;
+}
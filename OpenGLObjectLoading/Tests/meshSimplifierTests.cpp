@@ -0,0 +1,269 @@
+/*
+Title: Object Loading
+File Name: meshSimplifierTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "meshSimplifier.h"
+#include <map>
+#include <tuple>
+#include <cmath>
+
+// A unit sphere with a texture seam where u goes from 1 back to 0, and a vertex per segment at each pole.
+static void MakeSphere(unsigned int segments, unsigned int rings, std::vector<Vertex3dUVNormal>& vertices, std::vector<unsigned int>& indices)
+{
+    for (unsigned int r = 0; r <= rings; r++)
+    {
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float theta = 3.14159265f * r / rings;
+            float phi = 6.28318531f * (s % segments) / segments;
+            float sinTheta = (r == 0 || r == rings) ? 0.0f : sinf(theta);
+            float cosTheta = r == 0 ? 1.0f : r == rings ? -1.0f : cosf(theta);
+            glm::vec3 position(sinTheta * cosf(phi), cosTheta, sinTheta * sinf(phi));
+            vertices.push_back(Vertex3dUVNormal(position, glm::vec2((float)s / segments, (float)r / rings), position));
+        }
+    }
+
+    for (unsigned int r = 0; r < rings; r++)
+    {
+        for (unsigned int s = 0; s < segments; s++)
+        {
+            unsigned int a = r * (segments + 1) + s;
+            unsigned int b = a + 1;
+            unsigned int c = a + segments + 1;
+            unsigned int d = c + 1;
+            if (r > 0)
+            {
+                indices.insert(indices.end(), { a, b, c });
+            }
+            if (r < rings - 1)
+            {
+                indices.insert(indices.end(), { b, d, c });
+            }
+        }
+    }
+}
+
+// A square of terrain with gentle hills, size x size quads.
+static void MakeTerrain(unsigned int size, std::vector<Vertex3dUVNormal>& vertices, std::vector<unsigned int>& indices)
+{
+    for (unsigned int y = 0; y <= size; y++)
+    {
+        for (unsigned int x = 0; x <= size; x++)
+        {
+            float u = (float)x / size;
+            float v = (float)y / size;
+            float height = 0.05f * sinf(u * 12) * cosf(v * 9);
+            vertices.push_back(Vertex3dUVNormal(glm::vec3(u, height, v), glm::vec2(u, v), glm::vec3(0, 1, 0)));
+        }
+    }
+
+    for (unsigned int y = 0; y < size; y++)
+    {
+        for (unsigned int x = 0; x < size; x++)
+        {
+            unsigned int a = y * (size + 1) + x;
+            unsigned int b = a + 1;
+            unsigned int c = a + size + 1;
+            unsigned int d = c + 1;
+            indices.insert(indices.end(), { a, c, b, b, c, d });
+        }
+    }
+}
+
+// A flat shaded box: 4 vertices per face, each with the face's normal, like the building models.
+static void MakeFlatBox(std::vector<Vertex3dUVNormal>& vertices, std::vector<unsigned int>& indices)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (int side = -1; side <= 1; side += 2)
+        {
+            glm::vec3 normal;
+            normal[axis] = (float)side;
+            glm::vec3 u;
+            u[(axis + 1) % 3] = 1;
+            glm::vec3 v = glm::cross(normal, u);
+
+            unsigned int first = (unsigned int)vertices.size();
+            vertices.push_back(Vertex3dUVNormal(normal - u - v, glm::vec2(0, 0), normal));
+            vertices.push_back(Vertex3dUVNormal(normal + u - v, glm::vec2(1, 0), normal));
+            vertices.push_back(Vertex3dUVNormal(normal + u + v, glm::vec2(1, 1), normal));
+            vertices.push_back(Vertex3dUVNormal(normal - u + v, glm::vec2(0, 1), normal));
+            indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+        }
+    }
+}
+
+// Edges, by position, that only one triangle uses. A crack along a seam shows up as these.
+static unsigned int CountOpenEdges(const std::vector<Vertex3dUVNormal>& vertices, const std::vector<unsigned int>& indices)
+{
+    typedef std::tuple<float, float, float> Position;
+    std::map<std::pair<Position, Position>, int> edges;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            glm::vec3 a = vertices[indices[i + corner]].m_position;
+            glm::vec3 b = vertices[indices[i + (corner + 1) % 3]].m_position;
+            edges[{ Position(a.x, a.y, a.z), Position(b.x, b.y, b.z) }]++;
+        }
+    }
+
+    unsigned int open = 0;
+    for (const auto& edge : edges)
+    {
+        auto reverse = edges.find({ edge.first.second, edge.first.first });
+        if (reverse == edges.end() || reverse->second != edge.second)
+            open += edge.second;
+    }
+    return open;
+}
+
+// A closed sphere halves level after level, without cracking along its texture seam.
+static void SphereHalvesWithoutCracks()
+{
+    std::vector<Vertex3dUVNormal> vertices;
+    std::vector<unsigned int> indices;
+    MakeSphere(64, 32, vertices, indices);
+    CHECK(CountOpenEdges(vertices, indices) == 0);
+
+    MeshSimplifier simplifier(vertices.data(), (unsigned int)vertices.size());
+    simplifier.SetIndices(indices.data(), indices.size());
+
+    size_t previousCount = indices.size();
+    float previousError = 0;
+    for (int level = 0; level < 4; level++)
+    {
+        size_t target = previousCount / 2 / 3 * 3;
+        float error = simplifier.Simplify(target, 1.0f);
+        const std::vector<unsigned int>& simplified = simplifier.GetIndices();
+
+        CHECK(simplified.size() <= target);
+        CHECK(simplified.size() > target * 9 / 10);
+        CHECK(CountOpenEdges(vertices, simplified) == 0);
+        // The error only grows, and stays small next to the sphere's size.
+        CHECK(error >= previousError);
+        CHECK(error < 0.2f);
+        CHECK(simplifier.GetError() == error);
+
+        previousCount = simplified.size();
+        previousError = error;
+    }
+}
+
+// Every corner of a flat shaded box is on three seams, so nothing can move.
+static void FlatBoxIsLocked()
+{
+    std::vector<Vertex3dUVNormal> vertices;
+    std::vector<unsigned int> indices;
+    MakeFlatBox(vertices, indices);
+
+    MeshSimplifier simplifier(vertices.data(), (unsigned int)vertices.size());
+    simplifier.SetIndices(indices.data(), indices.size());
+    simplifier.Simplify(indices.size() / 2, 1.0f);
+    CHECK(simplifier.GetIndices() == indices);
+    CHECK(simplifier.GetError() == 0);
+}
+
+// Terrain simplifies inside, but its outline stays where it was.
+static void TerrainKeepsItsBorder()
+{
+    std::vector<Vertex3dUVNormal> vertices;
+    std::vector<unsigned int> indices;
+    MakeTerrain(64, vertices, indices);
+
+    MeshSimplifier simplifier(vertices.data(), (unsigned int)vertices.size());
+    simplifier.SetIndices(indices.data(), indices.size());
+    simplifier.Simplify(indices.size() / 8 / 3 * 3, 1.0f);
+    const std::vector<unsigned int>& simplified = simplifier.GetIndices();
+    CHECK(simplified.size() <= indices.size() / 8);
+
+    // Seen from above it still covers the whole square, less a sliver along the border.
+    float area = 0;
+    for (size_t i = 0; i < simplified.size(); i += 3)
+    {
+        glm::vec3 a = vertices[simplified[i]].m_position;
+        glm::vec3 b = vertices[simplified[i + 1]].m_position;
+        glm::vec3 c = vertices[simplified[i + 2]].m_position;
+        area += fabsf((b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z)) * 0.5f;
+    }
+    CHECK(fabsf(area - 1) < 0.01f);
+
+    // With a tiny error limit, hardly anything can go.
+    MeshSimplifier strict(vertices.data(), (unsigned int)vertices.size());
+    strict.SetIndices(indices.data(), indices.size());
+    strict.Simplify(indices.size() / 8 / 3 * 3, 1e-6f);
+    CHECK(strict.GetIndices().size() > simplified.size());
+    CHECK(strict.GetError() <= 1e-6f);
+}
+
+void MeshSimplifierTests()
+{
+    SphereHalvesWithoutCracks();
+    FlatBoxIsLocked();
+    TerrainKeepsItsBorder();
+}
+
+// Builds a chain of levels the way Mesh::BuildLods does, and reports the triangles simplified per second.
+static void TimeLodChain(const char* name, const std::vector<Vertex3dUVNormal>& vertices, const std::vector<unsigned int>& indices)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    glm::vec3 boundsMin = vertices[0].m_position;
+    glm::vec3 boundsMax = boundsMin;
+    for (const Vertex3dUVNormal& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.m_position);
+        boundsMax = glm::max(boundsMax, vertex.m_position);
+    }
+    float maxError = glm::length(boundsMax - boundsMin) * MESH_LOD_MAX_ERROR;
+
+    MeshSimplifier simplifier(vertices.data(), (unsigned int)vertices.size());
+    simplifier.SetIndices(indices.data(), indices.size());
+
+    std::cout << "Simplifying " << name << ": " << indices.size() / 3 << " triangles";
+    size_t previousCount = indices.size();
+    for (unsigned int level = 1; level < MESH_MAX_LODS; level++)
+    {
+        size_t target = (size_t)(previousCount / 3 * MESH_LOD_REDUCTION) * 3;
+        simplifier.Simplify(target, maxError);
+        size_t count = simplifier.GetIndices().size();
+        if (count == 0 || count > previousCount * MESH_LOD_MIN_REDUCTION)
+            break;
+
+        std::cout << ", " << count / 3;
+        previousCount = count;
+    }
+
+    double milliseconds = Tests::MillisecondsSince(start);
+    std::cout << " in " << milliseconds << "ms (" << indices.size() / 3 / (milliseconds / 1000) / 1000000 << " million triangles/s)" << std::endl;
+}
+
+void MeshSimplifierBenchmark()
+{
+    // About a million triangles each.
+    std::vector<Vertex3dUVNormal> vertices;
+    std::vector<unsigned int> indices;
+    MakeSphere(1024, 512, vertices, indices);
+    TimeLodChain("sphere", vertices, indices);
+
+    vertices.clear();
+    indices.clear();
+    MakeTerrain(724, vertices, indices);
+    TimeLodChain("terrain", vertices, indices);
+}
@@ -0,0 +1,185 @@
+/*
+Title: Object Loading
+File Name: meshTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests.h"
+#include "recordingGL.h"
+#include "mesh.h"
+#include "glState.h"
+#include <cstring>
+#include <cstddef>
+
+// A triangle list over vertexCount vertices, that uses every vertex at least once.
+static std::vector<unsigned int> MakeIndices(unsigned int vertexCount)
+{
+    std::vector<unsigned int> indices;
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        indices.push_back(i);
+    }
+    while (indices.size() % 3 != 0)
+    {
+        indices.push_back(0);
+    }
+    return indices;
+}
+
+// Reads an index back out of uploaded index data.
+static unsigned int ReadIndex(const unsigned char* data, GLenum indexType, size_t index)
+{
+    if (indexType == GL_UNSIGNED_SHORT)
+    {
+        unsigned short value;
+        memcpy(&value, data + index * sizeof(value), sizeof(value));
+        return value;
+    }
+
+    unsigned int value;
+    memcpy(&value, data + index * sizeof(value), sizeof(value));
+    return value;
+}
+
+// The largest index decides the type. 65536 vertices still fit in 16 bits, since the last index is 65535.
+static void PackIndicesPicksType(unsigned int vertexCount, GLenum expectedType)
+{
+    std::vector<unsigned int> indices = MakeIndices(vertexCount);
+    std::vector<unsigned short> shortIndices;
+    GLenum indexType = 0;
+    const void* data = Mesh::PackIndices(indices, shortIndices, indexType);
+
+    CHECK(indexType == expectedType);
+    if (expectedType == GL_UNSIGNED_SHORT)
+    {
+        CHECK(data == shortIndices.data());
+        CHECK(shortIndices.size() == indices.size());
+    }
+    else
+    {
+        CHECK(data == indices.data());
+        CHECK(shortIndices.empty());
+    }
+
+    // Every index survives the packing.
+    bool same = true;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        same = same && ReadIndex((const unsigned char*)data, indexType, i) == indices[i];
+    }
+    CHECK(same);
+}
+
+// Builds a mesh with the recording driver, and reads back what it uploaded.
+static void MeshUploadRoundTrips(unsigned int vertexCount, GLenum expectedType)
+{
+    std::vector<Vertex3dUVNormal> vertices;
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        vertices.push_back(Vertex3dUVNormal(glm::vec3((float)i, 0, 0), glm::vec2(), glm::vec3(0, 1, 0)));
+    }
+    std::vector<unsigned int> indices = MakeIndices(vertexCount);
+
+    Mesh* mesh = new Mesh(vertices, indices);
+    CHECK(mesh->GetIndexType() == expectedType);
+
+    const RecordedVertexArray& vertexArray = RecordingGL::GetVertexArray(RecordingGL::GetVertexArrayCount());
+    const std::vector<unsigned char>& vertexData = RecordingGL::GetBufferData(vertexArray.m_vertexBuffer);
+    const std::vector<unsigned char>& indexData = RecordingGL::GetBufferData(vertexArray.m_indexBuffer);
+
+    // The buffers are exactly as big as the data, two or four bytes for each index.
+    CHECK(vertexData.size() == vertexCount * sizeof(Vertex3dUVNormal));
+    CHECK(indexData.size() == indices.size() * Mesh::GetIndexSize(expectedType));
+
+    if (indexData.size() == indices.size() * Mesh::GetIndexSize(expectedType))
+    {
+        bool same = true;
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            same = same && ReadIndex(indexData.data(), expectedType, i) == indices[i];
+        }
+        CHECK(same);
+    }
+
+    delete mesh;
+}
+
+// The draw Mesh made before it had a vertex array: bind both buffers, set up and enable the three attributes,
+// draw, then unbind and disable everything again. It drew with glDrawElements, which is part of opengl 1.1
+// rather than a glew function and can't be recorded, so glDrawElementsBaseVertex stands in for it. Both are one call.
+static void DrawWithoutVertexArray(GLuint vertexBuffer, GLuint indexBuffer, GLsizei indexCount)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)offsetof(Vertex3dUVNormal, m_position));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)offsetof(Vertex3dUVNormal, m_texCoord));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex3dUVNormal), (void*)offsetof(Vertex3dUVNormal, m_normal));
+    for (int i = 0; i < 3; i++)
+        glEnableVertexAttribArray(i);
+
+    glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, (void*)0, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    for (int i = 0; i < 3; i++)
+        glDisableVertexAttribArray(i);
+}
+
+// With its vertex array, a single submesh mesh draws in 2 calls instead of 14, and in 1 when it is still bound.
+static void DrawMakesTwoCalls()
+{
+    std::vector<Vertex3dUVNormal> vertices;
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(0, 0, 0), glm::vec2(0, 0), glm::vec3(0, 0, 1)));
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(1, 0, 0), glm::vec2(1, 0), glm::vec3(0, 0, 1)));
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(0, 1, 0), glm::vec2(0, 1), glm::vec3(0, 0, 1)));
+    std::vector<unsigned short> indices = { 0, 1, 2 };
+    Mesh* mesh = new Mesh(vertices, indices);
+    const RecordedVertexArray& vertexArray = RecordingGL::GetVertexArray(RecordingGL::GetVertexArrayCount());
+
+    RecordingGL::ResetCallCount();
+    DrawWithoutVertexArray(vertexArray.m_vertexBuffer, vertexArray.m_indexBuffer, (GLsizei)indices.size());
+    unsigned int callsBefore = RecordingGL::GetCallCount();
+    CHECK(callsBefore == 14);
+
+    // Forget what is bound, so the vertex array bind isn't skipped.
+    GLState::Invalidate();
+    RecordingGL::ResetCallCount();
+    mesh->Draw();
+    unsigned int callsAfter = RecordingGL::GetCallCount();
+    CHECK(callsAfter == 2);
+
+    RecordingGL::ResetCallCount();
+    mesh->Draw();
+    CHECK(RecordingGL::GetCallCount() == 1);
+
+    std::cout << "Mesh::Draw: " << callsBefore << " opengl calls without a vertex array, " << callsAfter << " with one" << std::endl;
+    delete mesh;
+}
+
+void MeshTests()
+{
+    PackIndicesPicksType(3, GL_UNSIGNED_SHORT);
+    PackIndicesPicksType(65535, GL_UNSIGNED_SHORT);
+    PackIndicesPicksType(65536, GL_UNSIGNED_SHORT);
+    PackIndicesPicksType(65537, GL_UNSIGNED_INT);
+
+    RecordingGL::Install();
+    MeshUploadRoundTrips(65535, GL_UNSIGNED_SHORT);
+    MeshUploadRoundTrips(65536, GL_UNSIGNED_SHORT);
+    MeshUploadRoundTrips(65537, GL_UNSIGNED_INT);
+    DrawMakesTwoCalls();
+}
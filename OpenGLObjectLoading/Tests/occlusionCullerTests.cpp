@@ -0,0 +1,220 @@
+/*
+Title: Object Loading
+File Name: occlusionCullerTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests.h"
+#include "occlusionCuller.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <random>
+#include <cmath>
+
+// Camera at the origin looking down -z, like the culler sees it in a frame.
+static glm::mat4 MakeViewProjection()
+{
+    glm::mat4 projection = glm::perspective(1.0f, 2.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+    return projection * view;
+}
+
+// A wall 10 units wide and tall, 10 units in front of the camera.
+static void AddWall(OcclusionCuller& culler)
+{
+    culler.AddBoxOccluder(glm::mat4(1.0f), glm::vec3(-5, -5, -11), glm::vec3(5, 5, -10));
+}
+
+// True if a box behind the wall is completely covered by it, seen from the origin.
+// Every corner is projected onto the front face of the wall, which is convex, so covering the corners covers the box.
+static bool IsBehindWall(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    if (boundsMax.z >= -11.0f)
+        return false;
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+        float scale = -10.0f / corner.z;
+        if (fabsf(corner.x * scale) > 5.0f || fabsf(corner.y * scale) > 5.0f)
+            return false;
+    }
+    return true;
+}
+
+static void WallHidesBoxBehindIt()
+{
+    OcclusionCuller culler(320, 160);
+    culler.Begin(MakeViewProjection());
+    AddWall(culler);
+    culler.Rasterize();
+
+    CHECK(culler.GetStats().m_occluderTriangles == 12);
+    CHECK(culler.GetStats().m_rasterizedTriangles > 0);
+
+    // Straight behind the wall.
+    CHECK(!culler.IsVisible(glm::vec3(-1, -1, -30), glm::vec3(1, 1, -28)));
+    // Between the camera and the wall.
+    CHECK(culler.IsVisible(glm::vec3(-1, -1, -8), glm::vec3(1, 1, -6)));
+    // Off to the side, at the same distance as the hidden box.
+    CHECK(culler.IsVisible(glm::vec3(20, -1, -30), glm::vec3(22, 1, -28)));
+    // Behind the wall, but poking out past its edge.
+    CHECK(culler.IsVisible(glm::vec3(9, -1, -20), glm::vec3(12, 1, -18)));
+    // Crossing the near plane.
+    CHECK(culler.IsVisible(glm::vec3(-1, -1, -30), glm::vec3(1, 1, 1)));
+}
+
+// With no occluders, nothing is hidden.
+static void EmptyFrameHidesNothing()
+{
+    OcclusionCuller culler(320, 160);
+    culler.Begin(MakeViewProjection());
+    culler.Rasterize();
+
+    CHECK(culler.IsVisible(glm::vec3(-1, -1, -30), glm::vec3(1, 1, -28)));
+    CHECK(culler.IsVisible(glm::vec3(-1, -1, -499), glm::vec3(1, 1, -498)));
+}
+
+// Random boxes around the wall. Some may be kept when they are hidden (the test is conservative),
+// but a visible box must never be culled.
+static void NeverCullsVisibleBoxes()
+{
+    OcclusionCuller culler(320, 160);
+    JobSystem jobs(4);
+    culler.Begin(MakeViewProjection());
+    AddWall(culler);
+    culler.Rasterize(&jobs);
+
+    const unsigned int count = 20000;
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> across(-25.0f, 25.0f);
+    std::uniform_real_distribution<float> depth(-60.0f, -12.0f);
+    std::vector<glm::vec3> boundsMin;
+    std::vector<glm::vec3> boundsMax;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glm::vec3 center(across(random), across(random) * 0.5f, depth(random));
+        boundsMin.push_back(center - glm::vec3(0.5f));
+        boundsMax.push_back(center + glm::vec3(0.5f));
+    }
+
+    unsigned int wronglyCulled = 0;
+    unsigned int culled = 0;
+    unsigned int hidden = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        bool behindWall = IsBehindWall(boundsMin[i], boundsMax[i]);
+        hidden += behindWall ? 1 : 0;
+        if (!culler.IsVisible(boundsMin[i], boundsMax[i]))
+        {
+            culled++;
+            wronglyCulled += behindWall ? 0 : 1;
+        }
+    }
+    CHECK(wronglyCulled == 0);
+    // Most of the hidden boxes should be found, or the culler isn't doing its job.
+    CHECK(culled > hidden * 9 / 10);
+
+    // Cull gives the same answers as IsVisible, with or without jobs.
+    std::vector<unsigned int> visible;
+    culler.Cull(boundsMin.data(), boundsMax.data(), count, visible);
+    CHECK(visible.size() == count - culled);
+    CHECK(culler.GetStats().m_testedBoxes == count);
+    CHECK(culler.GetStats().m_occludedBoxes == culled);
+
+    std::vector<unsigned int> visibleWithJobs;
+    culler.Cull(boundsMin.data(), boundsMax.data(), count, visibleWithJobs, &jobs);
+    CHECK(visibleWithJobs == visible);
+
+    bool allVisible = true;
+    for (unsigned int index : visible)
+    {
+        allVisible = allVisible && culler.IsVisible(boundsMin[index], boundsMax[index]);
+    }
+    CHECK(allVisible);
+}
+
+void OcclusionCullerTests()
+{
+    WallHidesBoxBehindIt();
+    EmptyFrameHidesNothing();
+    NeverCullsVisibleBoxes();
+}
+
+// A street of buildings with 100,000 small objects around them, timed with one thread and with a job system.
+void OcclusionCullerBenchmark()
+{
+    glm::mat4 viewProjection = glm::perspective(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f)
+        * glm::lookAt(glm::vec3(0, 2, 0), glm::vec3(0, 2, -1), glm::vec3(0, 1, 0));
+
+    // Two rows of buildings along the street, and a row across its end.
+    std::vector<glm::mat4> buildings;
+    for (int i = 0; i < 40; i++)
+    {
+        float z = -10.0f - i * 12.0f;
+        buildings.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(-14, 0, z)));
+        buildings.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(6, 0, z)));
+    }
+    for (int i = -10; i < 10; i++)
+    {
+        buildings.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(i * 10.0f, 0, -490.0f)));
+    }
+
+    const unsigned int count = 100000;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> across(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> up(0.0f, 10.0f);
+    std::uniform_real_distribution<float> depth(-600.0f, -5.0f);
+    std::vector<glm::vec3> boundsMin;
+    std::vector<glm::vec3> boundsMax;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glm::vec3 center(across(random), up(random), depth(random));
+        boundsMin.push_back(center - glm::vec3(0.5f));
+        boundsMax.push_back(center + glm::vec3(0.5f));
+    }
+
+    const int frames = 50;
+    JobSystem jobs;
+    std::vector<unsigned int> visible;
+    for (int threaded = 0; threaded < 2; threaded++)
+    {
+        OcclusionCuller culler;
+        JobSystem* frameJobs = threaded ? &jobs : nullptr;
+        double rasterizeMilliseconds = 0;
+        double cullMilliseconds = 0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            culler.Begin(viewProjection);
+            for (const glm::mat4& building : buildings)
+            {
+                culler.AddBoxOccluder(building, glm::vec3(0, 0, 0), glm::vec3(8, 20, 10));
+            }
+            culler.Rasterize(frameJobs);
+            visible.clear();
+            culler.Cull(boundsMin.data(), boundsMax.data(), count, visible, frameJobs);
+
+            rasterizeMilliseconds += culler.GetStats().m_rasterizeMilliseconds;
+            cullMilliseconds += culler.GetStats().m_cullMilliseconds;
+        }
+
+        const OcclusionStats& stats = culler.GetStats();
+        std::cout << "Occlusion culling (" << (threaded ? "job system" : "one thread") << "): "
+            << stats.m_rasterizedTriangles << " of " << stats.m_occluderTriangles << " occluder triangles rasterized in "
+            << rasterizeMilliseconds / frames << "ms, "
+            << count << " boxes tested in " << cullMilliseconds / frames << "ms, "
+            << 100.0 * stats.m_occludedBoxes / count << "% culled" << std::endl;
+    }
+}
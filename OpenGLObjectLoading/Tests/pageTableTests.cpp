@@ -0,0 +1,279 @@
+/*
+Title: Object Loading
+File Name: pageTableTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests.h"
+#include "pageTable.h"
+
+// Encodes a page the way the feedback shader writes it.
+static unsigned int EncodeFeedback(unsigned int level, unsigned int x, unsigned int y)
+{
+    unsigned int blue = ((x >> 8) & 0xF) | (((y >> 8) & 0xF) << 4);
+    return (x & 0xFF) | ((y & 0xFF) << 8) | (blue << 16) | ((level + 1) << 24);
+}
+
+// The slot and level an entry points at.
+static bool EntryIs(unsigned int entry, unsigned int slotX, unsigned int slotY, unsigned int level)
+{
+    return entry == (slotX | (slotY << 8) | (level << 16) | (255u << 24));
+}
+
+static void FeedbackDecodes()
+{
+    unsigned int page;
+    CHECK(PageTable::DecodeFeedback(EncodeFeedback(5, 0xABC, 0x123), page));
+    CHECK(PageTable::GetPageLevel(page) == 5);
+    CHECK(PageTable::GetPageX(page) == 0xABC);
+    CHECK(PageTable::GetPageY(page) == 0x123);
+
+    CHECK(PageTable::DecodeFeedback(EncodeFeedback(0, 0, 0), page));
+    CHECK(page == PageTable::MakePage(0, 0, 0));
+
+    // Background pixels have nothing in alpha, whatever the other channels hold.
+    CHECK(!PageTable::DecodeFeedback(0x00FFFFFF, page));
+}
+
+// Mapping a page points every entry under it at its slot, and unmapping falls back to the parent.
+static void EntriesFallBack()
+{
+    // 8x8 pages at level 0, so 4 levels, and a 2x2 cache.
+    PageTable table(8, 2, 2);
+    CHECK(table.GetLevelCount() == 4);
+    CHECK(table.GetEntry(0, 3, 3) == 0);
+
+    unsigned int slot;
+    unsigned int evicted;
+    CHECK(table.Map(PageTable::MakePage(3, 0, 0), slot, evicted));
+    CHECK(slot == 0);
+    CHECK(evicted == PageTable::c_noPage);
+    CHECK(EntryIs(table.GetEntry(3, 0, 0), 0, 0, 3));
+    CHECK(EntryIs(table.GetEntry(1, 2, 1), 0, 0, 3));
+    CHECK(EntryIs(table.GetEntry(0, 7, 7), 0, 0, 3));
+
+    // A level 1 page covers 2x2 level 0 entries.
+    CHECK(table.Map(PageTable::MakePage(1, 0, 0), slot, evicted));
+    CHECK(slot == 1);
+    CHECK(EntryIs(table.GetEntry(1, 0, 0), 1, 0, 1));
+    CHECK(EntryIs(table.GetEntry(0, 1, 1), 1, 0, 1));
+    CHECK(EntryIs(table.GetEntry(0, 2, 0), 0, 0, 3));
+
+    // A finer page wins over the level 1 page, only for its own entry.
+    CHECK(table.Map(PageTable::MakePage(0, 1, 1), slot, evicted));
+    CHECK(slot == 2);
+    CHECK(EntryIs(table.GetEntry(0, 1, 1), 0, 1, 0));
+    CHECK(EntryIs(table.GetEntry(0, 0, 0), 1, 0, 1));
+
+    // Mapping a coarser page afterwards doesn't cover the finer one.
+    table.Unmap(PageTable::MakePage(1, 0, 0));
+    CHECK(table.Map(PageTable::MakePage(1, 0, 0), slot, evicted));
+    CHECK(EntryIs(table.GetEntry(0, 1, 1), 0, 1, 0));
+
+    // Unmapping the level 1 page leaves the finer page alone, and the rest fall back to the last level.
+    table.Unmap(PageTable::MakePage(1, 0, 0));
+    CHECK(!table.IsResident(PageTable::MakePage(1, 0, 0)));
+    CHECK(EntryIs(table.GetEntry(1, 0, 0), 0, 0, 3));
+    CHECK(EntryIs(table.GetEntry(0, 0, 0), 0, 0, 3));
+    CHECK(EntryIs(table.GetEntry(0, 1, 1), 0, 1, 0));
+
+    table.Unmap(PageTable::MakePage(0, 1, 1));
+    CHECK(EntryIs(table.GetEntry(0, 1, 1), 0, 0, 3));
+    CHECK(table.GetResidentCount() == 1);
+
+    // Mapping a resident page again gives back its slot.
+    CHECK(table.Map(PageTable::MakePage(3, 0, 0), slot, evicted));
+    CHECK(slot == 0);
+    CHECK(evicted == PageTable::c_noPage);
+    CHECK(table.GetResidentCount() == 1);
+}
+
+// Least recently used pages go first, but never pages used this frame or the last level.
+static void EvictionKeepsUsedPages()
+{
+    // 4x4 pages, so 3 levels, and 3 slots.
+    PageTable table(4, 3, 1);
+    std::vector<PageRequest> requests;
+    unsigned int lastLevel = PageTable::MakePage(2, 0, 0);
+    unsigned int pageA = PageTable::MakePage(0, 0, 0);
+    unsigned int pageB = PageTable::MakePage(0, 3, 3);
+    unsigned int pageC = PageTable::MakePage(0, 1, 2);
+    unsigned int slot;
+    unsigned int evicted;
+
+    table.AnalyzeFeedback(nullptr, 0, requests);
+    CHECK(table.Map(lastLevel, slot, evicted));
+    CHECK(table.Map(pageA, slot, evicted));
+    CHECK(table.Map(pageB, slot, evicted));
+
+    // Everything was mapped this frame, so nothing can be evicted.
+    CHECK(!table.Map(pageC, slot, evicted));
+    CHECK(evicted == PageTable::c_noPage);
+    CHECK(!table.IsResident(pageC));
+
+    // Next frame only A is seen, so B is the least recently used page that can go.
+    unsigned int pixel = EncodeFeedback(0, 0, 0);
+    table.AnalyzeFeedback(&pixel, 1, requests);
+    CHECK(requests.size() == 1 && requests[0].m_page == PageTable::MakePage(1, 0, 0));
+    CHECK(table.Map(pageC, slot, evicted));
+    CHECK(evicted == pageB);
+    CHECK(table.IsResident(pageA));
+    CHECK(table.IsResident(pageC));
+    CHECK(!table.IsResident(pageB));
+
+    unsigned int slotPage;
+    CHECK(table.GetSlotPage(slot, slotPage));
+    CHECK(slotPage == pageC);
+
+    // With nothing seen, A is now the oldest, and the last level is still skipped.
+    table.AnalyzeFeedback(nullptr, 0, requests);
+    CHECK(table.Map(pageB, slot, evicted));
+    CHECK(evicted == pageA);
+    CHECK(table.IsResident(lastLevel));
+}
+
+// The last level is the fallback for every entry, so it stays even when it's the oldest page.
+static void LastLevelIsPinned()
+{
+    PageTable table(4, 1, 1);
+    std::vector<PageRequest> requests;
+    unsigned int slot;
+    unsigned int evicted;
+
+    CHECK(table.Map(PageTable::MakePage(2, 0, 0), slot, evicted));
+    for (int i = 0; i < 3; i++)
+    {
+        table.AnalyzeFeedback(nullptr, 0, requests);
+    }
+
+    CHECK(!table.Map(PageTable::MakePage(0, 1, 1), slot, evicted));
+    CHECK(evicted == PageTable::c_noPage);
+    CHECK(table.IsResident(PageTable::MakePage(2, 0, 0)));
+    CHECK(table.GetResidentCount() == 1);
+}
+
+// Dirty rectangles grow to cover every changed entry, per level, until cleared.
+static void DirtyRectsCoverChanges()
+{
+    PageTable table(8, 4, 4);
+    unsigned int slot;
+    unsigned int evicted;
+    unsigned int x, y, width, height;
+
+    for (unsigned int level = 0; level < table.GetLevelCount(); level++)
+    {
+        CHECK(!table.GetDirtyRect(level, x, y, width, height));
+    }
+
+    // A level 1 page changes its own entry and the 2x2 level 0 entries under it, but no coarser level.
+    CHECK(table.Map(PageTable::MakePage(1, 1, 0), slot, evicted));
+    CHECK(table.GetDirtyRect(1, x, y, width, height));
+    CHECK(x == 1 && y == 0 && width == 1 && height == 1);
+    CHECK(table.GetDirtyRect(0, x, y, width, height));
+    CHECK(x == 2 && y == 0 && width == 2 && height == 2);
+    CHECK(!table.GetDirtyRect(2, x, y, width, height));
+    CHECK(!table.GetDirtyRect(3, x, y, width, height));
+
+    // A second page grows the rectangle to cover both.
+    CHECK(table.Map(PageTable::MakePage(0, 6, 5), slot, evicted));
+    CHECK(table.GetDirtyRect(0, x, y, width, height));
+    CHECK(x == 2 && y == 0 && width == 5 && height == 6);
+    CHECK(table.GetDirtyRect(1, x, y, width, height));
+    CHECK(x == 1 && y == 0 && width == 1 && height == 1);
+
+    table.ClearDirty();
+    CHECK(!table.GetDirtyRect(0, x, y, width, height));
+    CHECK(!table.GetDirtyRect(1, x, y, width, height));
+
+    // Unmapping changes the entries too.
+    table.Unmap(PageTable::MakePage(0, 6, 5));
+    CHECK(table.GetDirtyRect(0, x, y, width, height));
+    CHECK(x == 6 && y == 5 && width == 1 && height == 1);
+    CHECK(!table.GetDirtyRect(1, x, y, width, height));
+}
+
+// Requests come coarsest level first, then by pixel count, and each page is requested once.
+static void FeedbackRequestsCoarseFirst()
+{
+    PageTable table(8, 4, 4);
+    std::vector<PageRequest> requests;
+
+    // Three pixels want (0, 1, 1), one wants (0, 6, 6), and one is out of range.
+    unsigned int pixels[] =
+    {
+        EncodeFeedback(0, 6, 6),
+        EncodeFeedback(0, 1, 1),
+        0,
+        EncodeFeedback(0, 1, 1),
+        EncodeFeedback(1, 9, 0),
+        EncodeFeedback(0, 1, 1),
+    };
+    table.AnalyzeFeedback(pixels, sizeof(pixels) / sizeof(pixels[0]), requests);
+
+    // Both pages and all their parents, with the last level shared.
+    CHECK(requests.size() == 7);
+    if (requests.size() == 7)
+    {
+        CHECK(requests[0].m_page == PageTable::MakePage(3, 0, 0));
+        CHECK(requests[1].m_page == PageTable::MakePage(2, 0, 0));
+        CHECK(requests[2].m_page == PageTable::MakePage(2, 1, 1));
+        CHECK(requests[3].m_page == PageTable::MakePage(1, 0, 0));
+        CHECK(requests[4].m_page == PageTable::MakePage(1, 3, 3));
+        CHECK(requests[5].m_page == PageTable::MakePage(0, 1, 1));
+        CHECK(requests[5].m_pixelCount == 3);
+        CHECK(requests[6].m_page == PageTable::MakePage(0, 6, 6));
+        CHECK(requests[6].m_pixelCount == 1);
+        for (int i = 0; i < 5; i++)
+        {
+            CHECK(requests[i].m_pixelCount == 0);
+        }
+    }
+
+    // Resident and loading pages aren't requested again, but the missing parents of a loading page are.
+    unsigned int slot;
+    unsigned int evicted;
+    CHECK(table.Map(PageTable::MakePage(3, 0, 0), slot, evicted));
+    CHECK(table.Map(PageTable::MakePage(2, 0, 0), slot, evicted));
+    table.SetLoading(PageTable::MakePage(0, 6, 6));
+    CHECK(table.IsLoading(PageTable::MakePage(0, 6, 6)));
+    table.AnalyzeFeedback(pixels, sizeof(pixels) / sizeof(pixels[0]), requests);
+
+    CHECK(requests.size() == 4);
+    if (requests.size() == 4)
+    {
+        CHECK(requests[0].m_page == PageTable::MakePage(2, 1, 1));
+        CHECK(requests[1].m_page == PageTable::MakePage(1, 0, 0));
+        CHECK(requests[2].m_page == PageTable::MakePage(1, 3, 3));
+        CHECK(requests[3].m_page == PageTable::MakePage(0, 1, 1));
+    }
+
+    // Dropping the load lets the page be requested again.
+    table.CancelLoading(PageTable::MakePage(0, 6, 6));
+    CHECK(!table.IsLoading(PageTable::MakePage(0, 6, 6)));
+    table.AnalyzeFeedback(pixels, sizeof(pixels) / sizeof(pixels[0]), requests);
+    CHECK(requests.size() == 5);
+    CHECK(!requests.empty() && requests.back().m_page == PageTable::MakePage(0, 6, 6));
+}
+
+void PageTableTests()
+{
+    FeedbackDecodes();
+    EntriesFallBack();
+    EvictionKeepsUsedPages();
+    LastLevelIsPinned();
+    DirtyRectsCoverChanges();
+    FeedbackRequestsCoarseFirst();
+}
@@ -0,0 +1,243 @@
+/*
+Title: Object Loading
+File Name: pixelConvertTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "pixelConvert.h"
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// A bitmap of the given type filled with random bytes, padding included.
+static FIBITMAP* MakeRandomBitmap(FREE_IMAGE_TYPE type, unsigned int width, unsigned int height, unsigned int bpp, unsigned int seed)
+{
+    FIBITMAP* bitmap = FreeImage_AllocateT(type, width, height, bpp);
+    if (bitmap == nullptr)
+        return nullptr;
+
+    std::mt19937 random(seed);
+    BYTE* bits = FreeImage_GetBits(bitmap);
+    size_t size = (size_t)FreeImage_GetPitch(bitmap) * height;
+    for (size_t i = 0; i < size; i++)
+    {
+        bits[i] = (BYTE)random();
+    }
+    return bitmap;
+}
+
+// What FreeImage makes of a bitmap: FreeImage_ConvertTo32Bits, copied out row by row like the texture loader used to.
+// Returns false if FreeImage can't convert it.
+static bool ConvertWithFreeImage(FIBITMAP* bitmap, std::vector<unsigned char>& pixels)
+{
+    FIBITMAP* bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
+    if (bitmap32 == nullptr)
+        return false;
+
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    pixels.resize((size_t)width * height * 4);
+    for (unsigned int y = 0; y < height; y++)
+    {
+        memcpy(pixels.data() + (size_t)y * width * 4, FreeImage_GetScanLine(bitmap32, y), (size_t)width * 4);
+    }
+    FreeImage_Unload(bitmap32);
+    return true;
+}
+
+// FreeImage keeps the top 8 bits of 16 bit channels. Used for 16 bit grayscale, which not every FreeImage converts.
+static void ConvertGray16ByHand(FIBITMAP* bitmap, std::vector<unsigned char>& pixels)
+{
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    pixels.resize((size_t)width * height * 4);
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const unsigned short* row = reinterpret_cast<const unsigned short*>(FreeImage_GetScanLine(bitmap, y));
+        for (unsigned int x = 0; x < width; x++)
+        {
+            unsigned char* out = pixels.data() + ((size_t)y * width + x) * 4;
+            out[0] = out[1] = out[2] = (unsigned char)(row[x] >> 8);
+            out[3] = 255;
+        }
+    }
+}
+
+// Every kernel the cpu supports gives exactly the pixels FreeImage_ConvertTo32Bits does.
+// The width is odd, so the vector loops leave pixels over and FreeImage pads its rows.
+static void MatchesFreeImage(const char* name, FREE_IMAGE_TYPE type, unsigned int bpp)
+{
+    const unsigned int width = 67;
+    const unsigned int height = 5;
+    FIBITMAP* bitmap = MakeRandomBitmap(type, width, height, bpp, bpp);
+    CHECK(bitmap != nullptr);
+    if (bitmap == nullptr)
+        return;
+
+    std::vector<unsigned char> expected;
+    if (!ConvertWithFreeImage(bitmap, expected))
+    {
+        CHECK(type == FIT_UINT16);
+        ConvertGray16ByHand(bitmap, expected);
+    }
+
+    SimdLevel supported = PixelConvert::GetSupportedLevel();
+    for (int level = (int)SimdLevel::Scalar; level <= (int)supported; level++)
+    {
+        PixelConvert::SetLevel((SimdLevel)level);
+
+        // One pixel past the end of the image has to stay untouched.
+        std::vector<unsigned char> pixels((size_t)width * height * 4 + 4, 0xCD);
+        bool converted = PixelConvert::Convert(bitmap, pixels.data());
+        CHECK(converted);
+        bool same = memcmp(pixels.data(), expected.data(), expected.size()) == 0;
+        if (!same)
+            std::cout << name << " differs from FreeImage at simd level " << level << std::endl;
+        CHECK(same);
+        CHECK(pixels[expected.size()] == 0xCD && pixels[expected.size() + 3] == 0xCD);
+    }
+    PixelConvert::SetLevel(supported);
+
+    FreeImage_Unload(bitmap);
+}
+
+// A paletted image with a transparency table gets its alpha from the table, like FreeImage does it.
+static void PaletteMatchesFreeImage()
+{
+    FIBITMAP* bitmap = MakeRandomBitmap(FIT_BITMAP, 67, 5, 8, 1);
+    CHECK(bitmap != nullptr);
+    if (bitmap == nullptr)
+        return;
+
+    std::mt19937 random(2);
+    RGBQUAD* palette = FreeImage_GetPalette(bitmap);
+    for (int i = 0; i < 256; i++)
+    {
+        palette[i].rgbBlue = (BYTE)random();
+        palette[i].rgbGreen = (BYTE)random();
+        palette[i].rgbRed = (BYTE)random();
+    }
+    // Only the first 100 entries get alpha, the rest are opaque.
+    BYTE transparency[100];
+    for (int i = 0; i < 100; i++)
+    {
+        transparency[i] = (BYTE)random();
+    }
+    FreeImage_SetTransparencyTable(bitmap, transparency, 100);
+
+    std::vector<unsigned char> expected;
+    CHECK(ConvertWithFreeImage(bitmap, expected));
+    std::vector<unsigned char> pixels;
+    CHECK(PixelConvert::Convert(bitmap, pixels));
+    CHECK(pixels == expected);
+
+    FreeImage_Unload(bitmap);
+}
+
+// Premultiplying gives what FreeImage_PreMultiplyWithAlpha does to FreeImage's own conversion.
+static void PremultiplyMatchesFreeImage()
+{
+    FIBITMAP* bitmap = MakeRandomBitmap(FIT_BITMAP, 67, 5, 32, 3);
+    CHECK(bitmap != nullptr);
+    if (bitmap == nullptr)
+        return;
+
+    FIBITMAP* premultiplied = FreeImage_Clone(bitmap);
+    CHECK(FreeImage_PreMultiplyWithAlpha(premultiplied));
+    std::vector<unsigned char> expected;
+    CHECK(ConvertWithFreeImage(premultiplied, expected));
+
+    SimdLevel supported = PixelConvert::GetSupportedLevel();
+    for (int level = (int)SimdLevel::Scalar; level <= (int)supported; level++)
+    {
+        PixelConvert::SetLevel((SimdLevel)level);
+        std::vector<unsigned char> pixels;
+        CHECK(PixelConvert::Convert(bitmap, pixels, true));
+        // Both round to the nearest value, so they should agree exactly. One step of difference is allowed in case
+        // a FreeImage build rounds differently, but nothing more.
+        int largestDifference = 0;
+        for (size_t i = 0; i < pixels.size() && pixels.size() == expected.size(); i++)
+        {
+            largestDifference = std::max(largestDifference, std::abs((int)pixels[i] - (int)expected[i]));
+        }
+        CHECK(pixels.size() == expected.size());
+        CHECK(largestDifference <= 1);
+    }
+    PixelConvert::SetLevel(supported);
+
+    FreeImage_Unload(premultiplied);
+    FreeImage_Unload(bitmap);
+}
+
+void PixelConvertTests()
+{
+    MatchesFreeImage("24 bit BGR", FIT_BITMAP, 24);
+    MatchesFreeImage("32 bit BGRA", FIT_BITMAP, 32);
+    MatchesFreeImage("8 bit gray", FIT_BITMAP, 8);
+    MatchesFreeImage("16 bit RGB", FIT_RGB16, 48);
+    MatchesFreeImage("16 bit RGBA", FIT_RGBA16, 64);
+    MatchesFreeImage("16 bit gray", FIT_UINT16, 16);
+    PaletteMatchesFreeImage();
+    PremultiplyMatchesFreeImage();
+}
+
+// A 4096 x 4096 image converted for upload: FreeImage_ConvertTo32Bits and a copy, against each kernel writing straight to the upload buffer.
+static void TimeConversion(const char* name, FREE_IMAGE_TYPE type, unsigned int bpp)
+{
+    const unsigned int size = 4096;
+    const int runs = 5;
+    FIBITMAP* bitmap = MakeRandomBitmap(type, size, size, bpp, 4);
+    if (bitmap == nullptr)
+        return;
+
+    std::vector<unsigned char> pixels((size_t)size * size * 4);
+    double freeImageMilliseconds = 0;
+    for (int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        ConvertWithFreeImage(bitmap, pixels);
+        freeImageMilliseconds += Tests::MillisecondsSince(start) / runs;
+    }
+    std::cout << "Converting " << name << ", " << size << "x" << size << ": FreeImage " << freeImageMilliseconds << "ms";
+
+    const char* levelNames[] = { "scalar", "SSSE3", "AVX2" };
+    SimdLevel supported = PixelConvert::GetSupportedLevel();
+    for (int level = (int)SimdLevel::Scalar; level <= (int)supported; level++)
+    {
+        PixelConvert::SetLevel((SimdLevel)level);
+        double milliseconds = 0;
+        for (int run = 0; run < runs; run++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            PixelConvert::Convert(bitmap, pixels.data());
+            milliseconds += Tests::MillisecondsSince(start) / runs;
+        }
+        std::cout << ", " << levelNames[level] << " " << milliseconds << "ms";
+    }
+    PixelConvert::SetLevel(supported);
+    std::cout << std::endl;
+
+    FreeImage_Unload(bitmap);
+}
+
+void PixelConvertBenchmark()
+{
+    TimeConversion("24 bit BGR", FIT_BITMAP, 24);
+    TimeConversion("16 bit RGBA", FIT_RGBA16, 64);
+}
@@ -0,0 +1,294 @@
+/*
+Title: Object Loading
+File Name: recordingGL.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "recordingGL.h"
+#include <cstring>
+
+std::vector<std::vector<unsigned char>> RecordingGL::s_buffers;
+std::vector<RecordedVertexArray> RecordingGL::s_vertexArrays;
+GLuint RecordingGL::s_arrayBuffer = 0;
+GLuint RecordingGL::s_elementArrayBuffer = 0;
+GLuint RecordingGL::s_vertexArray = 0;
+std::vector<RecordedUniform> RecordingGL::s_uniforms;
+GLuint RecordingGL::s_programCount = 0;
+unsigned int RecordingGL::s_calls = 0;
+
+void RecordingGL::Install()
+{
+    __glewGenBuffers = GenBuffers;
+    __glewDeleteBuffers = DeleteBuffers;
+    __glewBindBuffer = BindBuffer;
+    __glewBufferData = BufferData;
+    __glewGenVertexArrays = GenVertexArrays;
+    __glewDeleteVertexArrays = DeleteVertexArrays;
+    __glewBindVertexArray = BindVertexArray;
+    __glewVertexAttribPointer = VertexAttribPointer;
+    __glewEnableVertexAttribArray = EnableVertexAttribArray;
+    __glewDisableVertexAttribArray = DisableVertexAttribArray;
+    __glewDrawElementsBaseVertex = DrawElementsBaseVertex;
+    __glewDrawElementsInstancedBaseVertex = DrawElementsInstancedBaseVertex;
+    __glewCreateProgram = CreateProgram;
+    __glewDeleteProgram = DeleteProgram;
+    __glewLinkProgram = LinkProgram;
+    __glewUseProgram = UseProgram;
+    __glewGetProgramiv = GetProgramiv;
+    __glewGetActiveUniform = GetActiveUniform;
+    __glewGetUniformLocation = GetUniformLocation;
+    __glewUniform1i = Uniform1i;
+    __glewUniform4fv = Uniform4fv;
+    __glewUniformMatrix4fv = UniformMatrix4fv;
+    __glewActiveTexture = ActiveTexture;
+    __glewGenerateMipmap = GenerateMipmap;
+}
+
+const std::vector<unsigned char>& RecordingGL::GetBufferData(GLuint buffer)
+{
+    static const std::vector<unsigned char> empty;
+    if (buffer == 0 || buffer > s_buffers.size())
+        return empty;
+    return s_buffers[buffer - 1];
+}
+
+GLuint RecordingGL::GetVertexArrayCount()
+{
+    return (GLuint)s_vertexArrays.size();
+}
+
+const RecordedVertexArray& RecordingGL::GetVertexArray(GLuint vertexArray)
+{
+    static const RecordedVertexArray empty = {};
+    if (vertexArray == 0 || vertexArray > s_vertexArrays.size())
+        return empty;
+    return s_vertexArrays[vertexArray - 1];
+}
+
+void RecordingGL::SetProgramUniforms(const std::vector<RecordedUniform>& uniforms)
+{
+    s_uniforms = uniforms;
+}
+
+unsigned int RecordingGL::GetCallCount()
+{
+    return s_calls;
+}
+
+void RecordingGL::ResetCallCount()
+{
+    s_calls = 0;
+}
+
+GLuint& RecordingGL::GetBinding(GLenum target)
+{
+    return target == GL_ELEMENT_ARRAY_BUFFER ? s_elementArrayBuffer : s_arrayBuffer;
+}
+
+void GLAPIENTRY RecordingGL::GenBuffers(GLsizei count, GLuint* buffers)
+{
+    s_calls++;
+    for (GLsizei i = 0; i < count; i++)
+    {
+        s_buffers.push_back(std::vector<unsigned char>());
+        buffers[i] = (GLuint)s_buffers.size();
+    }
+}
+
+void GLAPIENTRY RecordingGL::DeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+    s_calls++;
+    // The contents are kept, so a test can still look at them after the mesh is gone.
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (s_arrayBuffer == buffers[i])
+            s_arrayBuffer = 0;
+        if (s_elementArrayBuffer == buffers[i])
+            s_elementArrayBuffer = 0;
+    }
+}
+
+void GLAPIENTRY RecordingGL::BindBuffer(GLenum target, GLuint buffer)
+{
+    s_calls++;
+    GetBinding(target) = buffer;
+    if (target == GL_ELEMENT_ARRAY_BUFFER && s_vertexArray != 0)
+        s_vertexArrays[s_vertexArray - 1].m_indexBuffer = buffer;
+}
+
+void GLAPIENTRY RecordingGL::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    s_calls++;
+    GLuint buffer = GetBinding(target);
+    if (buffer == 0 || buffer > s_buffers.size())
+        return;
+
+    std::vector<unsigned char>& contents = s_buffers[buffer - 1];
+    contents.assign((size_t)size, 0);
+    if (data != nullptr && size > 0)
+        memcpy(contents.data(), data, (size_t)size);
+}
+
+void GLAPIENTRY RecordingGL::GenVertexArrays(GLsizei count, GLuint* vertexArrays)
+{
+    s_calls++;
+    for (GLsizei i = 0; i < count; i++)
+    {
+        RecordedVertexArray vertexArray = {};
+        s_vertexArrays.push_back(vertexArray);
+        vertexArrays[i] = (GLuint)s_vertexArrays.size();
+    }
+}
+
+void GLAPIENTRY RecordingGL::DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+    s_calls++;
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (s_vertexArray == vertexArrays[i])
+        {
+            s_vertexArray = 0;
+            s_elementArrayBuffer = 0;
+        }
+    }
+}
+
+void GLAPIENTRY RecordingGL::BindVertexArray(GLuint vertexArray)
+{
+    s_calls++;
+    s_vertexArray = vertexArray;
+    s_elementArrayBuffer = vertexArray != 0 ? s_vertexArrays[vertexArray - 1].m_indexBuffer : 0;
+}
+
+void GLAPIENTRY RecordingGL::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+{
+    s_calls++;
+    if (s_vertexArray != 0)
+        s_vertexArrays[s_vertexArray - 1].m_vertexBuffer = s_arrayBuffer;
+}
+
+void GLAPIENTRY RecordingGL::EnableVertexAttribArray(GLuint index)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::DisableVertexAttribArray(GLuint index)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, void* indices, GLint baseVertex)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+    GLsizei instanceCount, GLint baseVertex)
+{
+    s_calls++;
+}
+
+GLuint GLAPIENTRY RecordingGL::CreateProgram()
+{
+    s_calls++;
+    return ++s_programCount;
+}
+
+void GLAPIENTRY RecordingGL::DeleteProgram(GLuint program)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::LinkProgram(GLuint program)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::UseProgram(GLuint program)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::GetProgramiv(GLuint program, GLenum name, GLint* value)
+{
+    s_calls++;
+    *value = 0;
+    if (name == GL_LINK_STATUS)
+    {
+        *value = GL_TRUE;
+    }
+    else if (name == GL_ACTIVE_UNIFORMS)
+    {
+        *value = (GLint)s_uniforms.size();
+    }
+    else if (name == GL_ACTIVE_UNIFORM_MAX_LENGTH)
+    {
+        // The length includes the terminating zero.
+        for (const RecordedUniform& uniform : s_uniforms)
+        {
+            if ((GLint)uniform.m_name.size() + 1 > *value)
+                *value = (GLint)uniform.m_name.size() + 1;
+        }
+    }
+}
+
+void GLAPIENTRY RecordingGL::GetActiveUniform(GLuint program, GLuint index, GLsizei maxLength, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    s_calls++;
+    const RecordedUniform& uniform = s_uniforms[index];
+    GLsizei copied = (GLsizei)uniform.m_name.size() < maxLength - 1 ? (GLsizei)uniform.m_name.size() : maxLength - 1;
+    memcpy(name, uniform.m_name.c_str(), (size_t)copied);
+    name[copied] = 0;
+    *length = copied;
+    *size = 1;
+    *type = uniform.m_type;
+}
+
+GLint GLAPIENTRY RecordingGL::GetUniformLocation(GLuint program, const GLchar* name)
+{
+    s_calls++;
+    for (size_t i = 0; i < s_uniforms.size(); i++)
+    {
+        if (s_uniforms[i].m_name == name)
+            return (GLint)i;
+    }
+    return -1;
+}
+
+void GLAPIENTRY RecordingGL::Uniform1i(GLint location, GLint value)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::ActiveTexture(GLenum unit)
+{
+    s_calls++;
+}
+
+void GLAPIENTRY RecordingGL::GenerateMipmap(GLenum target)
+{
+    s_calls++;
+}
@@ -0,0 +1,105 @@
+/*
+Title: Object Loading
+File Name: recordingGL.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+#include <vector>
+#include <string>
+
+// Buffers a vertex array object was set up with.
+struct RecordedVertexArray
+{
+    GLuint m_vertexBuffer;  // buffer bound to GL_ARRAY_BUFFER when the attributes were set
+    GLuint m_indexBuffer;   // buffer bound to GL_ELEMENT_ARRAY_BUFFER
+};
+
+// An active uniform of the programs the recording driver links.
+struct RecordedUniform
+{
+    std::string m_name;
+    GLenum m_type;          // as glGetActiveUniform reports it, like GL_FLOAT_MAT4 or GL_SAMPLER_2D
+};
+
+// Stands in for the opengl driver, so code that creates buffers can be tested without a context.
+// Install points glew's function pointers at functions that keep a copy of everything uploaded to a buffer,
+// and count every call made to them.
+// Only the buffer, vertex array, indexed draw, program, uniform and texture unit functions are replaced,
+// anything else still needs a real context.
+class RecordingGL
+{
+private:
+    // Contents of each buffer, by name. Names start at 1 and are never reused.
+    static std::vector<std::vector<unsigned char>> s_buffers;
+    // Vertex arrays, by name, which also start at 1.
+    static std::vector<RecordedVertexArray> s_vertexArrays;
+    // Current bindings. The element array buffer binding belongs to the bound vertex array.
+    static GLuint s_arrayBuffer;
+    static GLuint s_elementArrayBuffer;
+    static GLuint s_vertexArray;
+    // Every program links with these uniforms, at locations 0, 1, 2 and so on. Names also start at 1.
+    static std::vector<RecordedUniform> s_uniforms;
+    static GLuint s_programCount;
+    // Calls made to any of the functions below since the last ResetCallCount.
+    static unsigned int s_calls;
+
+    static GLuint& GetBinding(GLenum target);
+
+    static void GLAPIENTRY GenBuffers(GLsizei count, GLuint* buffers);
+    static void GLAPIENTRY DeleteBuffers(GLsizei count, const GLuint* buffers);
+    static void GLAPIENTRY BindBuffer(GLenum target, GLuint buffer);
+    static void GLAPIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    static void GLAPIENTRY GenVertexArrays(GLsizei count, GLuint* vertexArrays);
+    static void GLAPIENTRY DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+    static void GLAPIENTRY BindVertexArray(GLuint vertexArray);
+    static void GLAPIENTRY VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+    static void GLAPIENTRY EnableVertexAttribArray(GLuint index);
+    static void GLAPIENTRY DisableVertexAttribArray(GLuint index);
+    static void GLAPIENTRY DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, void* indices, GLint baseVertex);
+    static void GLAPIENTRY DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices,
+        GLsizei instanceCount, GLint baseVertex);
+    static GLuint GLAPIENTRY CreateProgram();
+    static void GLAPIENTRY DeleteProgram(GLuint program);
+    static void GLAPIENTRY LinkProgram(GLuint program);
+    static void GLAPIENTRY UseProgram(GLuint program);
+    static void GLAPIENTRY GetProgramiv(GLuint program, GLenum name, GLint* value);
+    static void GLAPIENTRY GetActiveUniform(GLuint program, GLuint index, GLsizei maxLength, GLsizei* length, GLint* size, GLenum* type, GLchar* name);
+    static GLint GLAPIENTRY GetUniformLocation(GLuint program, const GLchar* name);
+    static void GLAPIENTRY Uniform1i(GLint location, GLint value);
+    static void GLAPIENTRY Uniform4fv(GLint location, GLsizei count, const GLfloat* value);
+    static void GLAPIENTRY UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+    static void GLAPIENTRY ActiveTexture(GLenum unit);
+    static void GLAPIENTRY GenerateMipmap(GLenum target);
+
+public:
+    static void Install();
+
+    // Contents last uploaded to a buffer, empty for a name that was never created.
+    static const std::vector<unsigned char>& GetBufferData(GLuint buffer);
+
+    // Vertex arrays created so far. That is also the name of the newest one.
+    static GLuint GetVertexArrayCount();
+    static const RecordedVertexArray& GetVertexArray(GLuint vertexArray);
+
+    // Sets the uniforms programs linked from now on have.
+    static void SetProgramUniforms(const std::vector<RecordedUniform>& uniforms);
+
+    // Number of opengl calls made since the last reset.
+    static unsigned int GetCallCount();
+    static void ResetCallCount();
+};
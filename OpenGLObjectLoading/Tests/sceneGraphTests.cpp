@@ -0,0 +1,231 @@
+/*
+Title: Object Loading
+File Name: sceneGraphTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "sceneGraph.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <string>
+#include <cmath>
+
+// Small deterministic random numbers, so a failing run can be repeated.
+static unsigned int NextRandom(unsigned int& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static glm::mat4 RandomLocalMatrix(unsigned int& state)
+{
+    glm::vec3 position((float)(NextRandom(state) % 200) * 0.01f - 1.0f, (float)(NextRandom(state) % 200) * 0.01f - 1.0f, 0.5f);
+    float angle = (float)(NextRandom(state) % 628) * 0.01f;
+    float scale = 0.9f + (float)(NextRandom(state) % 20) * 0.01f;
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position);
+    matrix = glm::rotate(matrix, angle, glm::normalize(glm::vec3(1.0f, 2.0f, 3.0f)));
+    return glm::scale(matrix, glm::vec3(scale));
+}
+
+// The world matrix worked out the slow way, walking up to the root every time.
+static glm::mat4 NaiveWorldMatrix(SceneGraph& scene, unsigned int node)
+{
+    int parent = scene.GetParent(node);
+    if (parent < 0)
+        return scene.GetLocalMatrix(node);
+    return NaiveWorldMatrix(scene, (unsigned int)parent) * scene.GetLocalMatrix(node);
+}
+
+static bool MatricesMatch(SceneGraph& scene)
+{
+    for (unsigned int i = 0; i < scene.GetNodeCount(); i++)
+    {
+        glm::mat4 expected = NaiveWorldMatrix(scene, i);
+        const glm::mat4& actual = scene.GetWorldMatrix(i);
+        for (int c = 0; c < 4; c++)
+        {
+            for (int r = 0; r < 4; r++)
+            {
+                if (fabsf(expected[c][r] - actual[c][r]) > 1e-3f)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Parents come before their children, and a subtree is exactly the nodes with the root as an ancestor.
+static bool OrderIsDepthFirst(SceneGraph& scene)
+{
+    for (unsigned int i = 0; i < scene.GetNodeCount(); i++)
+    {
+        if (scene.GetParent(i) >= (int)i)
+            return false;
+
+        for (unsigned int j = i + 1; j < scene.GetNodeCount(); j++)
+        {
+            bool below = false;
+            for (int ancestor = scene.GetParent(j); ancestor >= (int)i && !below; ancestor = scene.GetParent(ancestor))
+            {
+                below = ancestor == (int)i;
+            }
+            if (below != (j < scene.GetSubtreeEnd(i)))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Adds a random forest of a few big trees, so Update has subtrees big enough to split across jobs.
+// Each node goes below the last node added or one of its ancestors, and now and then starts a new root.
+static void AddRandomTree(SceneGraph& scene, unsigned int nodeCount, unsigned int& state)
+{
+    int last = -1;
+    for (unsigned int i = 0; i < nodeCount; i++)
+    {
+        int parent = NextRandom(state) % 500 == 0 ? -1 : last;
+        for (unsigned int up = NextRandom(state) % 4; up > 0 && parent >= 0 && scene.GetParent(parent) >= 0; up--)
+        {
+            parent = scene.GetParent(parent);
+        }
+        last = (int)scene.AddNode(parent, RandomLocalMatrix(state), "node" + std::to_string(i));
+    }
+}
+
+// Changing local matrices marks subtrees dirty, and the next Update brings every world matrix below them up to date.
+static void DirtySubtreesUpdate(JobSystem* jobs)
+{
+    unsigned int state = 12345;
+    SceneGraph scene;
+    AddRandomTree(scene, 1500, state);
+    scene.Update(jobs);
+    CHECK(OrderIsDepthFirst(scene));
+    CHECK(MatricesMatch(scene));
+
+    for (int round = 0; round < 5; round++)
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            scene.SetLocalMatrix(NextRandom(state) % scene.GetNodeCount(), RandomLocalMatrix(state));
+        }
+        scene.Update(jobs);
+        CHECK(MatricesMatch(scene));
+    }
+
+    // The roots move everything at once.
+    for (unsigned int i = 0; i < scene.GetNodeCount(); i = scene.GetSubtreeEnd(i))
+    {
+        scene.SetLocalMatrix(i, RandomLocalMatrix(state));
+    }
+    scene.Update(jobs);
+    CHECK(MatricesMatch(scene));
+}
+
+// Moving subtrees around keeps the arrays depth first and the names with their nodes,
+// and the moved nodes pick up their new parent's world matrix.
+static void ReparentedNodesUpdate(JobSystem* jobs)
+{
+    unsigned int state = 54321;
+    SceneGraph scene;
+    AddRandomTree(scene, 1500, state);
+    scene.Update(jobs);
+
+    unsigned int moved = 0;
+    bool returnsNewIndex = true;
+    for (int i = 0; i < 60; i++)
+    {
+        unsigned int node = NextRandom(state) % scene.GetNodeCount();
+        int parent = NextRandom(state) % 8 == 0 ? -1 : (int)(NextRandom(state) % scene.GetNodeCount());
+        std::string name = scene.GetName(node);
+        glm::mat4 localMatrix = scene.GetLocalMatrix(node);
+        bool ownSubtree = parent >= (int)node && parent < (int)scene.GetSubtreeEnd(node);
+        std::string parentName = parent >= 0 ? scene.GetName(parent) : "";
+
+        unsigned int newNode = scene.SetParent(node, parent);
+        returnsNewIndex = returnsNewIndex && scene.GetName(newNode) == name && scene.GetLocalMatrix(newNode) == localMatrix;
+        if (ownSubtree)
+        {
+            returnsNewIndex = returnsNewIndex && newNode == node;
+        }
+        else
+        {
+            int newParent = scene.GetParent(newNode);
+            returnsNewIndex = returnsNewIndex && (parent < 0 ? newParent == -1 : scene.GetName(newParent) == parentName);
+            moved++;
+        }
+
+        // Some rounds also change local matrices before the update.
+        if (i % 3 == 0)
+            scene.SetLocalMatrix(NextRandom(state) % scene.GetNodeCount(), RandomLocalMatrix(state));
+        if (i % 2 == 0)
+            scene.Update(jobs);
+    }
+    scene.Update(jobs);
+
+    CHECK(moved > 0);
+    CHECK(returnsNewIndex);
+    CHECK(scene.GetNodeCount() == 1500);
+    CHECK(OrderIsDepthFirst(scene));
+    CHECK(MatricesMatch(scene));
+
+    // Every node is still there, once.
+    bool allFound = true;
+    for (unsigned int i = 0; i < 1500; i++)
+    {
+        int node = scene.FindNode("node" + std::to_string(i));
+        allFound = allFound && node >= 0 && scene.GetName(node) == "node" + std::to_string(i);
+    }
+    CHECK(allFound);
+}
+
+// Moving a node below its own child would make a loop, so it's refused.
+static void RefusesLoops()
+{
+    SceneGraph scene;
+    unsigned int root = scene.AddNode(-1, glm::mat4(1.0f), "root");
+    unsigned int child = scene.AddNode(root, glm::translate(glm::mat4(1.0f), glm::vec3(1, 0, 0)), "child");
+    unsigned int grandchild = scene.AddNode(child, glm::translate(glm::mat4(1.0f), glm::vec3(0, 1, 0)), "grandchild");
+    unsigned int other = scene.AddNode(-1, glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 5)), "other");
+    scene.Update();
+
+    CHECK(scene.SetParent(child, grandchild) == child);
+    CHECK(scene.SetParent(child, child) == child);
+    CHECK(scene.GetParent(grandchild) == (int)child);
+
+    // Moving the child below the other root takes the grandchild along, after the other root.
+    unsigned int movedChild = scene.SetParent(child, other);
+    CHECK(movedChild == 2);
+    CHECK(scene.FindNode("other") == 1);
+    CHECK(scene.GetParent(movedChild) == 1);
+    CHECK(scene.GetParent(3) == (int)movedChild);
+    CHECK(scene.GetSubtreeEnd(0) == 1);
+    CHECK(scene.GetSubtreeEnd(1) == 4);
+    scene.Update();
+    CHECK(glm::vec3(scene.GetWorldMatrix(3)[3]) == glm::vec3(1, 1, 5));
+}
+
+void SceneGraphTests()
+{
+    JobSystem jobs(4);
+    DirtySubtreesUpdate(nullptr);
+    DirtySubtreesUpdate(&jobs);
+    ReparentedNodesUpdate(nullptr);
+    ReparentedNodesUpdate(&jobs);
+    RefusesLoops();
+}
@@ -0,0 +1,126 @@
+/*
+Title: Object Loading
+File Name: skylinePackerTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "skylinePacker.h"
+#include <vector>
+
+struct PackedRect
+{
+    unsigned int m_x;
+    unsigned int m_y;
+    unsigned int m_width;
+    unsigned int m_height;
+};
+
+static bool Overlap(const PackedRect& a, const PackedRect& b)
+{
+    return a.m_x < b.m_x + b.m_width && b.m_x < a.m_x + a.m_width &&
+        a.m_y < b.m_y + b.m_height && b.m_y < a.m_y + a.m_height;
+}
+
+// Rectangles go in bottom left first, and fill the area exactly when they tile it.
+static void FillsBottomLeft()
+{
+    SkylinePacker packer(4, 4);
+    unsigned int x;
+    unsigned int y;
+    CHECK(packer.Insert(2, 2, x, y));
+    CHECK(x == 0 && y == 0);
+    CHECK(packer.Insert(2, 2, x, y));
+    CHECK(x == 2 && y == 0);
+    CHECK(packer.Insert(2, 2, x, y));
+    CHECK(x == 0 && y == 2);
+    CHECK(packer.Insert(2, 2, x, y));
+    CHECK(x == 2 && y == 2);
+    CHECK(packer.GetOccupancy() == 1.0f);
+
+    // Once full, even the smallest rectangle fails.
+    CHECK(!packer.Insert(1, 1, x, y));
+}
+
+// Rectangles that can never fit are turned down without using any space.
+static void RejectsWhatDoesntFit()
+{
+    SkylinePacker packer(8, 8);
+    unsigned int x;
+    unsigned int y;
+    CHECK(!packer.Insert(9, 1, x, y));
+    CHECK(!packer.Insert(1, 9, x, y));
+    CHECK(!packer.Insert(0, 4, x, y));
+    CHECK(!packer.Insert(4, 0, x, y));
+    CHECK(packer.GetOccupancy() == 0.0f);
+
+    // A tall one leaves a column that only narrow rectangles fit in.
+    CHECK(packer.Insert(6, 8, x, y));
+    CHECK(!packer.Insert(3, 1, x, y));
+    CHECK(packer.Insert(2, 8, x, y));
+    CHECK(x == 6 && y == 0);
+    CHECK(packer.GetOccupancy() == 1.0f);
+}
+
+// Many rectangles of mixed sizes, until the area is full: every one lands inside it, none overlap,
+// and the occupancy is the area they cover.
+static void PlacementsDontOverlap()
+{
+    const unsigned int size = 64;
+    SkylinePacker packer(size, size);
+    std::vector<PackedRect> placed;
+    unsigned long long area = 0;
+    unsigned int state = 1;
+    unsigned int failures = 0;
+
+    for (int i = 0; i < 500; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        PackedRect rect = { 0, 0, 1 + state % 12, 1 + (state >> 8) % 12 };
+        if (!packer.Insert(rect.m_width, rect.m_height, rect.m_x, rect.m_y))
+        {
+            failures++;
+            continue;
+        }
+        placed.push_back(rect);
+        area += (unsigned long long)rect.m_width * rect.m_height;
+    }
+
+    bool inside = true;
+    bool apart = true;
+    for (size_t i = 0; i < placed.size(); i++)
+    {
+        inside = inside && placed[i].m_x + placed[i].m_width <= size && placed[i].m_y + placed[i].m_height <= size;
+        for (size_t j = i + 1; j < placed.size(); j++)
+        {
+            apart = apart && !Overlap(placed[i], placed[j]);
+        }
+    }
+    CHECK(inside);
+    CHECK(apart);
+    CHECK(failures > 0);
+    CHECK(packer.GetOccupancy() == (float)((double)area / (size * size)));
+}
+
+void SkylinePackerTests()
+{
+    FillsBottomLeft();
+    RejectsWhatDoesntFit();
+    PlacementsDontOverlap();
+}
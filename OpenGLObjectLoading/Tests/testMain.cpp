@@ -0,0 +1,117 @@
+/*
+Title: Object Loading
+File Name: testMain.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests.h"
+#include <cstring>
+
+// A group of tests, usually for one class.
+struct TestSuite
+{
+    const char* m_name;
+    void (*m_tests)();          // nullptr for a suite that only has a benchmark
+    void (*m_benchmark)();
+};
+
+static const TestSuite c_suites[] =
+{
+    { "boundingVolumeHierarchy", BoundingVolumeHierarchyTests, BoundingVolumeHierarchyBenchmark },
+    { "frustumCuller", FrustumCullerTests, FrustumCullerBenchmark },
+    { "material", MaterialTests, MaterialBenchmark },
+    { "mesh", MeshTests, nullptr },
+    { "meshSimplifier", MeshSimplifierTests, MeshSimplifierBenchmark },
+    { "mipmapGenerator", nullptr, MipmapGeneratorBenchmark },
+    { "occlusionCuller", OcclusionCullerTests, OcclusionCullerBenchmark },
+    { "pageTable", PageTableTests, nullptr },
+    { "pixelConvert", PixelConvertTests, PixelConvertBenchmark },
+    { "sceneGraph", SceneGraphTests, nullptr },
+    { "skylinePacker", SkylinePackerTests, nullptr },
+    { "textureAtlas", TextureAtlasTests, nullptr },
+    { "textureCache", TextureCacheTests, nullptr },
+    { "textureCompressor", nullptr, TextureCompressorBenchmark },
+    { "transform3d", Transform3DTests, Transform3DBenchmark },
+    { "transformSystem", TransformSystemTests, TransformSystemBenchmark },
+};
+
+unsigned int Tests::s_checks = 0;
+unsigned int Tests::s_failedChecks = 0;
+
+void Tests::Check(bool passed, const char* condition, const char* file, int line)
+{
+    s_checks++;
+    if (!passed)
+    {
+        s_failedChecks++;
+        std::cout << file << "(" << line << "): check failed: " << condition << std::endl;
+    }
+}
+
+unsigned int Tests::GetCheckCount()
+{
+    return s_checks;
+}
+
+unsigned int Tests::GetFailedCheckCount()
+{
+    return s_failedChecks;
+}
+
+double Tests::MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// With no arguments, every suite's tests are run.
+// Naming suites runs only those, and "benchmark" runs their benchmarks as well.
+int main(int argc, char **argv)
+{
+    bool runBenchmarks = false;
+    int suiteNames = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "benchmark") == 0)
+            runBenchmarks = true;
+        else
+            suiteNames++;
+    }
+
+    for (const TestSuite& suite : c_suites)
+    {
+        bool named = suiteNames == 0;
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp(argv[i], suite.m_name) == 0)
+                named = true;
+        }
+        if (!named)
+            continue;
+
+        if (suite.m_tests != nullptr)
+        {
+            unsigned int failedBefore = Tests::GetFailedCheckCount();
+            suite.m_tests();
+            std::cout << suite.m_name << ": " << (Tests::GetFailedCheckCount() == failedBefore ? "passed" : "FAILED") << std::endl;
+        }
+
+        if (runBenchmarks && suite.m_benchmark != nullptr)
+            suite.m_benchmark();
+    }
+
+    std::cout << Tests::GetCheckCount() << " checks, " << Tests::GetFailedCheckCount() << " failed" << std::endl;
+    return Tests::GetFailedCheckCount() == 0 ? 0 : 1;
+}
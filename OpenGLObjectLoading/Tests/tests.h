@@ -0,0 +1,99 @@
+/*
+Title: Object Loading
+File Name: tests.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <iostream>
+#include <chrono>
+
+// Checks that a condition holds. A failed check prints where it is and fails the test run,
+// but the test carries on, so one run shows every failing check.
+#define CHECK(condition) Tests::Check((condition), #condition, __FILE__, __LINE__)
+
+// Runs the unit tests and benchmarks of the classes that don't need an opengl context.
+// Each tests file adds a suite to the table in testMain.cpp, with a function for its tests
+// and, if it has one, a function for its benchmark. Classes with only a benchmark have it in benchmarks.cpp.
+class Tests
+{
+private:
+    static unsigned int s_checks;
+    static unsigned int s_failedChecks;
+
+public:
+    static void Check(bool passed, const char* condition, const char* file, int line);
+
+    static unsigned int GetCheckCount();
+    static unsigned int GetFailedCheckCount();
+
+    // How many milliseconds have passed since start, for the benchmarks.
+    static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start);
+};
+
+// Benchmarks for classes without tests of their own, in benchmarks.cpp
+void MipmapGeneratorBenchmark();
+void TextureCompressorBenchmark();
+
+// BoundingVolumeHierarchy
+void BoundingVolumeHierarchyTests();
+void BoundingVolumeHierarchyBenchmark();
+
+// FrustumCuller
+void FrustumCullerTests();
+void FrustumCullerBenchmark();
+
+// Material
+void MaterialTests();
+void MaterialBenchmark();
+
+// Mesh
+void MeshTests();
+
+// MeshSimplifier
+void MeshSimplifierTests();
+void MeshSimplifierBenchmark();
+
+// OcclusionCuller
+void OcclusionCullerTests();
+void OcclusionCullerBenchmark();
+
+// PageTable
+void PageTableTests();
+
+// PixelConvert
+void PixelConvertTests();
+void PixelConvertBenchmark();
+
+// SceneGraph
+void SceneGraphTests();
+
+// SkylinePacker
+void SkylinePackerTests();
+
+// TextureAtlas
+void TextureAtlasTests();
+
+// TextureCache
+void TextureCacheTests();
+
+// Transform3D
+void Transform3DTests();
+void Transform3DBenchmark();
+
+// TransformSystem
+void TransformSystemTests();
+void TransformSystemBenchmark();
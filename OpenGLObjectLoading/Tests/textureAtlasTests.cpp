@@ -0,0 +1,159 @@
+/*
+Title: Object Loading
+File Name: textureAtlasTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "recordingGL.h"
+#include "textureAtlas.h"
+#include <vector>
+#include <string>
+#include <cmath>
+
+// A solid image, since the tests only look at where images go.
+static bool AddImage(TextureAtlas& atlas, const std::string& name, unsigned int width, unsigned int height)
+{
+    std::vector<unsigned char> pixels((size_t)width * height * 4, 255);
+    return atlas.Add(name, width, height, pixels.data());
+}
+
+static bool Near(float a, float b)
+{
+    return fabsf(a - b) < 1e-6f;
+}
+
+// The uvs of a region cover exactly its image, one gutter in from the corner of the spot it was packed in.
+// The gutter is rounded up to a power of two.
+static void RegionUVsCoverImage()
+{
+    TextureAtlas atlas(64, 32, 3);
+    CHECK(AddImage(atlas, "image", 10, 6));
+    atlas.Build();
+    CHECK(atlas.GetPageCount() == 1);
+
+    AtlasRegion region;
+    CHECK(atlas.GetRegion("image", region));
+    CHECK(region.m_page == atlas.GetPage(0));
+    CHECK(Near(region.m_uvScaleOffset.x, 10.0f / 64));
+    CHECK(Near(region.m_uvScaleOffset.y, 6.0f / 64));
+    CHECK(Near(region.m_uvScaleOffset.z, 4.0f / 64));
+    CHECK(Near(region.m_uvScaleOffset.w, 4.0f / 64));
+
+    CHECK(!atlas.GetRegion("missing", region));
+}
+
+// Images that are too big for the threshold, or for a page once the gutter is added, are turned down.
+static void RejectsBigImages()
+{
+    TextureAtlas atlas(64, 60, 4);
+    CHECK(!AddImage(atlas, "wide", 61, 8));
+    CHECK(!AddImage(atlas, "tall", 8, 61));
+    CHECK(!AddImage(atlas, "gutterWide", 57, 8));
+    CHECK(AddImage(atlas, "fits", 56, 56));
+    CHECK(!AddImage(atlas, "empty", 0, 8));
+}
+
+// Once a page is full, packing goes on in a new one.
+static void FullPageStartsAnother()
+{
+    // With the gutter, each image takes a quarter of a page.
+    TextureAtlas atlas(64, 32, 4);
+    for (int i = 0; i < 5; i++)
+    {
+        CHECK(AddImage(atlas, "image" + std::to_string(i), 24, 24));
+    }
+    atlas.Build();
+    CHECK(atlas.GetPageCount() == 2);
+
+    unsigned int onFirstPage = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        AtlasRegion region;
+        atlas.GetRegion("image" + std::to_string(i), region);
+        onFirstPage += region.m_page == atlas.GetPage(0) ? 1 : 0;
+    }
+    CHECK(onFirstPage == 4);
+}
+
+// Mixed sizes over a few pages: every image and its gutter lies inside its page, on the gutter grid,
+// and never over the image or gutter of another one on the same page.
+static void GuttersDontOverlap()
+{
+    const unsigned int pageSize = 128;
+    const unsigned int gutter = 4;
+    TextureAtlas atlas(pageSize, 64, gutter);
+    std::vector<std::string> names;
+    for (unsigned int i = 0; i < 40; i++)
+    {
+        names.push_back("image" + std::to_string(i));
+        CHECK(AddImage(atlas, names.back(), 3 + (i * 7) % 40, 5 + (i * 13) % 30));
+    }
+    atlas.Build();
+    CHECK(atlas.GetPageCount() > 1);
+
+    // Rectangles in pixels, with the gutter around them.
+    std::vector<AtlasRegion> regions(names.size());
+    std::vector<int> left(names.size()), bottom(names.size()), right(names.size()), top(names.size());
+    bool found = true;
+    bool sizes = true;
+    bool onGrid = true;
+    bool inside = true;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        found = found && atlas.GetRegion(names[i], regions[i]) && regions[i].m_page != nullptr;
+        sizes = sizes && Near(regions[i].m_uvScaleOffset.x, (3 + (i * 7) % 40) / (float)pageSize) &&
+            Near(regions[i].m_uvScaleOffset.y, (5 + (i * 13) % 30) / (float)pageSize);
+
+        int x = (int)lroundf(regions[i].m_uvScaleOffset.z * pageSize);
+        int y = (int)lroundf(regions[i].m_uvScaleOffset.w * pageSize);
+        int width = (int)lroundf(regions[i].m_uvScaleOffset.x * pageSize);
+        int height = (int)lroundf(regions[i].m_uvScaleOffset.y * pageSize);
+        left[i] = x - (int)gutter;
+        bottom[i] = y - (int)gutter;
+        right[i] = x + width + (int)gutter;
+        top[i] = y + height + (int)gutter;
+
+        onGrid = onGrid && left[i] % gutter == 0 && bottom[i] % gutter == 0;
+        inside = inside && left[i] >= 0 && bottom[i] >= 0 && right[i] <= (int)pageSize && top[i] <= (int)pageSize;
+    }
+    CHECK(found);
+    CHECK(sizes);
+    CHECK(onGrid);
+    CHECK(inside);
+
+    bool apart = true;
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        for (size_t j = i + 1; j < names.size(); j++)
+        {
+            bool overlap = left[i] < right[j] && left[j] < right[i] && bottom[i] < top[j] && bottom[j] < top[i];
+            apart = apart && !(regions[i].m_page == regions[j].m_page && overlap);
+        }
+    }
+    CHECK(apart);
+}
+
+void TextureAtlasTests()
+{
+    // Pages are textures, so uploads go to the recording driver.
+    RecordingGL::Install();
+    RegionUVsCoverImage();
+    RejectsBigImages();
+    FullPageStartsAnother();
+    GuttersDontOverlap();
+}
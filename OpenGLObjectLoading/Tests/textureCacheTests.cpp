@@ -0,0 +1,121 @@
+/*
+Title: Object Loading
+File Name: textureCacheTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "recordingGL.h"
+#include "textureCache.h"
+#include <string>
+#include <thread>
+
+// Files that don't exist, so every texture keeps its 1x1 placeholder and they are all the same size.
+static std::string GetTestPath(int index)
+{
+    return "textureCacheTest" + std::to_string(index) + ".png";
+}
+
+// Lets every load fail, so the loader drops its references and only the cache's are left.
+static void FinishLoads(TextureLoader* loader)
+{
+    while (loader->GetPendingCount() > 0)
+    {
+        loader->Update();
+        std::this_thread::yield();
+    }
+}
+
+// Whether a file is still cached. A miss starts a new load, so only ask about files that should be there,
+// or ones nothing is asked about afterwards.
+static bool IsCached(TextureCache* cache, int index)
+{
+    unsigned int count = cache->GetTextureCount();
+    cache->Get(GetTestPath(index).c_str());
+    return cache->GetTextureCount() == count;
+}
+
+// Over budget, the least recently used textures go first, and a texture that was used again moves to the back of the line.
+static void EvictsLeastRecentlyUsed(TextureLoader* loader)
+{
+    TextureCache* cache = new TextureCache(loader);
+    for (int i = 0; i < 5; i++)
+    {
+        cache->Get(GetTestPath(i).c_str());
+    }
+    FinishLoads(loader);
+    size_t textureSize = cache->GetByteSize() / 5;
+    CHECK(cache->GetTextureCount() == 5);
+
+    // Under budget, nothing goes.
+    cache->SetBudget(textureSize * 5);
+    CHECK(cache->Update() == 0);
+
+    // 0 is the oldest, but using it again leaves 1 and 2 as the least recently used.
+    cache->Get(GetTestPath(0).c_str());
+    cache->SetBudget(textureSize * 3);
+    CHECK(cache->Update() == 2);
+    CHECK(cache->GetTextureCount() == 3);
+    CHECK(cache->GetByteSize() == textureSize * 3);
+    CHECK(IsCached(cache, 0));
+    CHECK(IsCached(cache, 3));
+    CHECK(IsCached(cache, 4));
+    CHECK(!IsCached(cache, 1));
+
+    FinishLoads(loader);
+    delete cache;
+}
+
+// Textures something else holds a reference to are in use, and stay cached however far over budget it is.
+static void KeepsTexturesInUse(TextureLoader* loader)
+{
+    TextureCache* cache = new TextureCache(loader);
+    Texture* used = cache->Get(GetTestPath(0).c_str());
+    for (int i = 1; i < 4; i++)
+    {
+        cache->Get(GetTestPath(i).c_str());
+    }
+    used->IncRefCount();
+
+    // Until its load is done, the loader's reference keeps a texture in use too.
+    cache->SetBudget(0);
+    CHECK(cache->Update() == 0);
+    FinishLoads(loader);
+
+    // The used texture is the least recently used one, but it is skipped and the rest go.
+    CHECK(cache->Update() == 3);
+    CHECK(cache->GetTextureCount() == 1);
+    CHECK(used->GetRefCount() == 2);
+    CHECK(IsCached(cache, 0));
+
+    // Once it's released, it can go too.
+    used->DecRefCount();
+    CHECK(cache->Update() == 1);
+    CHECK(cache->GetTextureCount() == 0);
+    CHECK(cache->GetByteSize() == 0);
+
+    delete cache;
+}
+
+void TextureCacheTests()
+{
+    RecordingGL::Install();
+    TextureLoader* loader = new TextureLoader(1);
+    EvictsLeastRecentlyUsed(loader);
+    KeepsTexturesInUse(loader);
+    delete loader;
+}
@@ -0,0 +1,248 @@
+/*
+Title: Object Loading
+File Name: transform3dTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tests.h"
+#include "transform3d.h"
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+// The euler angle transform Transform3D used to be: a matrix per axis, rebuilt with trig whenever anything changed.
+// The quaternion version has to give the same matrices and basis vectors.
+class EulerTransform
+{
+private:
+    float m_scale = 1;
+    glm::vec3 m_rotation;
+    glm::vec3 m_position;
+    bool m_matrixDirty = true;
+    bool m_inverseDirty = true;
+    glm::mat4 m_rotationMatrix;
+    glm::mat4 m_matrix;
+    glm::mat4 m_inverseMatrix;
+
+    static glm::mat4 RotationX(float r)
+    {
+        return glm::mat4(1, 0, 0, 0, 0, cos(r), sin(r), 0, 0, -sin(r), cos(r), 0, 0, 0, 0, 1);
+    }
+    static glm::mat4 RotationY(float r)
+    {
+        return glm::mat4(cos(r), 0, sin(r), 0, 0, 1, 0, 0, -sin(r), 0, cos(r), 0, 0, 0, 0, 1);
+    }
+    static glm::mat4 RotationZ(float r)
+    {
+        return glm::mat4(cos(r), sin(r), 0, 0, -sin(r), cos(r), 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
+    }
+
+public:
+    glm::vec3 Rotation() { return m_rotation; }
+    void SetScale(float s) { m_scale = s; m_matrixDirty = m_inverseDirty = true; }
+    void SetRotation(glm::vec3 r) { m_rotation = r; m_matrixDirty = m_inverseDirty = true; }
+    void SetPosition(glm::vec3 v) { m_position = v; m_matrixDirty = m_inverseDirty = true; }
+    void Translate(glm::vec3 v) { m_position += v; m_matrixDirty = m_inverseDirty = true; }
+
+    glm::mat4 GetMatrix()
+    {
+        if (m_matrixDirty)
+        {
+            glm::mat4 s = glm::mat4(m_scale, 0, 0, 0, 0, m_scale, 0, 0, 0, 0, m_scale, 0, 0, 0, 0, 1);
+            glm::mat4 t = glm::mat4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, m_position.x, m_position.y, m_position.z, 1);
+            m_rotationMatrix = RotationY(m_rotation.y) * RotationX(m_rotation.x) * RotationZ(m_rotation.z);
+            m_matrix = t * m_rotationMatrix * s;
+            m_matrixDirty = false;
+        }
+        return m_matrix;
+    }
+
+    glm::mat4 GetInverseMatrix()
+    {
+        if (m_inverseDirty)
+        {
+            glm::mat4 s = glm::mat4(1 / m_scale, 0, 0, 0, 0, 1 / m_scale, 0, 0, 0, 0, 1 / m_scale, 0, 0, 0, 0, 1);
+            glm::mat4 t = glm::mat4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, -m_position.x, -m_position.y, -m_position.z, 1);
+            glm::mat4 r = RotationZ(-m_rotation.z) * RotationX(-m_rotation.x) * RotationY(-m_rotation.y);
+            m_inverseMatrix = s * r * t;
+            m_inverseDirty = false;
+        }
+        return m_inverseMatrix;
+    }
+
+    glm::vec3 GetUp() { GetMatrix(); return glm::vec3(m_rotationMatrix * glm::vec4(0, 1, 0, 1)); }
+    glm::vec3 GetForward() { GetMatrix(); return glm::vec3(m_rotationMatrix * glm::vec4(0, 0, -1, 1)); }
+    glm::vec3 GetRight() { GetMatrix(); return glm::vec3(m_rotationMatrix * glm::vec4(1, 0, 0, 1)); }
+};
+
+// Largest difference between two matrices.
+static float MatrixError(const glm::mat4& a, const glm::mat4& b)
+{
+    float error = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            error = std::max(error, fabsf(a[i][j] - b[i][j]));
+        }
+    }
+    return error;
+}
+
+static float VectorError(glm::vec3 a, glm::vec3 b)
+{
+    return glm::length(a - b);
+}
+
+static void DefaultIsIdentity()
+{
+    Transform3D transform;
+    CHECK(MatrixError(transform.GetMatrix(), glm::mat4(1.0f)) == 0);
+    CHECK(MatrixError(transform.GetInverseMatrix(), glm::mat4(1.0f)) == 0);
+    CHECK(VectorError(transform.GetForward(), glm::vec3(0, 0, -1)) == 0);
+}
+
+// Random angles, positions and scales give the same matrices and basis vectors as the euler transform.
+static void MatchesEulerTransform()
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+    std::uniform_real_distribution<float> offset(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> scale(0.1f, 3.0f);
+
+    float matrixError = 0;
+    float inverseError = 0;
+    float basisError = 0;
+    float roundTripError = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        glm::vec3 rotation(angle(random), angle(random), angle(random));
+        glm::vec3 position(offset(random), offset(random), offset(random));
+        float s = scale(random);
+
+        EulerTransform euler;
+        euler.SetRotation(rotation);
+        euler.SetPosition(position);
+        euler.SetScale(s);
+
+        Transform3D transform;
+        transform.SetRotation(rotation);
+        transform.SetPosition(position);
+        transform.SetScale(s);
+
+        matrixError = std::max(matrixError, MatrixError(transform.GetMatrix(), euler.GetMatrix()));
+        // The inverse grows with 1 / scale, so compare it relative to that.
+        inverseError = std::max(inverseError, MatrixError(transform.GetInverseMatrix(), euler.GetInverseMatrix()) * s);
+        basisError = std::max(basisError, VectorError(transform.GetUp(), euler.GetUp()));
+        basisError = std::max(basisError, VectorError(transform.GetForward(), euler.GetForward()));
+        basisError = std::max(basisError, VectorError(transform.GetRight(), euler.GetRight()));
+
+        // Setting a quaternion and reading the angles back gives angles for the same rotation.
+        Transform3D fromQuaternion;
+        fromQuaternion.SetOrientation(transform.Orientation());
+        Transform3D fromAngles;
+        fromAngles.SetRotation(fromQuaternion.Rotation());
+        roundTripError = std::max(roundTripError, MatrixError(fromAngles.GetMatrix(), fromQuaternion.GetMatrix()));
+    }
+
+    std::cout << "Transform3D against euler: matrix " << matrixError << ", inverse " << inverseError
+        << ", basis " << basisError << ", angles round trip " << roundTripError << std::endl;
+
+    // Floats only, so a few ulps of the largest entries (positions up to 30) are fine.
+    CHECK(matrixError < 1e-4f);
+    CHECK(inverseError < 1e-4f);
+    CHECK(basisError < 1e-5f);
+    // Close to straight up or down, yaw and roll are hard to tell apart, so the angles lose some accuracy.
+    CHECK(roundTripError < 1e-2f);
+}
+
+// Incremental rotations match adding to the euler angles, and compose the way the header says.
+static void RotationsCompose()
+{
+    // RotateX on a transform set from a quaternion still adds to the pitch.
+    Transform3D transform;
+    transform.SetOrientation(glm::angleAxis(0.5f, glm::vec3(0, 1, 0)));
+    transform.RotateX(0.3f);
+
+    EulerTransform euler;
+    // Positive yaw turns left, so a quaternion turning by 0.5 around +y is a yaw of -0.5.
+    euler.SetRotation(glm::vec3(0.3f, -0.5f, 0));
+    CHECK(MatrixError(transform.GetMatrix(), euler.GetMatrix()) < 1e-5f);
+
+    // World space rotations are applied after the current rotation, local ones before it.
+    glm::quat start = glm::angleAxis(0.7f, glm::normalize(glm::vec3(1, 2, 3)));
+    glm::quat turn = glm::angleAxis(0.4f, glm::vec3(0, 0, 1));
+
+    Transform3D world;
+    world.SetOrientation(start);
+    world.Rotate(glm::vec3(0, 0, 1), 0.4f);
+    CHECK(VectorError(world.GetForward(), (turn * start) * glm::vec3(0, 0, -1)) < 1e-5f);
+
+    Transform3D local;
+    local.SetOrientation(start);
+    local.RotateLocal(glm::vec3(0, 0, 1), 0.4f);
+    CHECK(VectorError(local.GetForward(), (start * turn) * glm::vec3(0, 0, -1)) < 1e-5f);
+
+    // Thousands of small turns stay a unit rotation.
+    Transform3D spinning;
+    for (int i = 0; i < 10000; i++)
+    {
+        spinning.Rotate(glm::vec3(0, 1, 0), 0.001f);
+        spinning.RotateLocal(glm::vec3(1, 0, 0), 0.0007f);
+    }
+    CHECK(fabsf(glm::length(spinning.Orientation()) - 1) < 1e-4f);
+    CHECK(fabsf(glm::length(spinning.GetForward()) - 1) < 1e-4f);
+}
+
+void Transform3DTests()
+{
+    DefaultIsIdentity();
+    MatchesEulerTransform();
+    RotationsCompose();
+}
+
+// What FPSController::Update and the camera do every frame: read the angles, set new ones,
+// move along the forward and right vectors, then build the view matrix.
+template<typename T>
+static double TimeCameraFrames(T& transform, int frames, glm::vec3& result)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        glm::vec3 rotation = transform.Rotation();
+        transform.SetRotation(glm::vec3(rotation.x + 0.0001f, rotation.y + 0.0003f, 0));
+        transform.Translate(transform.GetForward() * 0.01f);
+        transform.Translate(transform.GetRight() * 0.01f);
+        result += glm::vec3(transform.GetInverseMatrix()[3]);
+    }
+    return Tests::MillisecondsSince(start);
+}
+
+void Transform3DBenchmark()
+{
+    const int frames = 1000000;
+    glm::vec3 result;
+
+    EulerTransform euler;
+    double eulerMilliseconds = TimeCameraFrames(euler, frames, result);
+    Transform3D transform;
+    double quaternionMilliseconds = TimeCameraFrames(transform, frames, result);
+
+    std::cout << "Camera update, " << frames << " frames: euler " << eulerMilliseconds << "ms, quaternion "
+        << quaternionMilliseconds << "ms (" << eulerMilliseconds / quaternionMilliseconds << "x)" << std::endl;
+    // Keeps the work from being optimized away.
+    std::cout << "(" << result.x + result.y + result.z << ")" << std::endl;
+}
@@ -0,0 +1,217 @@
+/*
+Title: Object Loading
+File Name: transformSystemTests.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "tests.h"
+#include "transformSystem.h"
+#include "transform3d.h"
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+// Largest difference between two matrices.
+static float MatrixError(const glm::mat4& a, const glm::mat4& b)
+{
+    float error = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            error = std::max(error, fabsf(a[i][j] - b[i][j]));
+        }
+    }
+    return error;
+}
+
+// Random transforms give the same matrices as Transform3D, with and without jobs.
+// The count isn't a multiple of the group size, so the last group is only partly used.
+static void MatchesTransform3D()
+{
+    const unsigned int count = 10003;
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+    std::uniform_real_distribution<float> offset(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> scale(0.1f, 3.0f);
+
+    TransformSystem system;
+    TransformSystem systemWithJobs;
+    std::vector<Transform3D> transforms(count);
+    bool indicesInOrder = true;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        // Some angles well outside [-pi, pi], which the sine and cosine have to wrap.
+        float turns = (i % 7 == 0) ? 100.0f : 1.0f;
+        glm::vec3 rotation(angle(random) * turns, angle(random) * turns, angle(random) * turns);
+        glm::vec3 position(offset(random), offset(random), offset(random));
+        float s = scale(random);
+
+        indicesInOrder = indicesInOrder && system.Add(position, rotation, s) == i;
+        systemWithJobs.Add(position, rotation, s);
+        transforms[i].SetRotation(rotation);
+        transforms[i].SetPosition(position);
+        transforms[i].SetScale(s);
+    }
+    CHECK(indicesInOrder);
+    CHECK(system.GetCount() == count);
+
+    JobSystem jobs(4);
+    system.Update();
+    systemWithJobs.Update(&jobs);
+
+    float matrixError = 0;
+    float inverseError = 0;
+    bool sameWithJobs = true;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        matrixError = std::max(matrixError, MatrixError(system.GetMatrix(i), transforms[i].GetMatrix()));
+        // The inverse grows with 1 / scale, so compare it relative to that.
+        inverseError = std::max(inverseError, MatrixError(system.GetInverseMatrix(i), transforms[i].GetInverseMatrix()) * transforms[i].Scale());
+        sameWithJobs = sameWithJobs && system.GetMatrix(i) == systemWithJobs.GetMatrix(i)
+            && system.GetInverseMatrix(i) == systemWithJobs.GetInverseMatrix(i);
+    }
+    std::cout << "TransformSystem against Transform3D: matrix " << matrixError << ", inverse " << inverseError << std::endl;
+
+    CHECK(matrixError < 1e-4f);
+    CHECK(inverseError < 1e-4f);
+    CHECK(sameWithJobs);
+    CHECK(system.GetMatrices() == &system.GetMatrix(0));
+    CHECK(system.GetInverseMatrices() == &system.GetInverseMatrix(0));
+}
+
+// Changes show up after the next Update, and objects that didn't change keep their matrices.
+static void UpdateRebuildsChanges()
+{
+    TransformSystem system;
+    std::vector<Transform3D> transforms(9);
+    for (unsigned int i = 0; i < 9; i++)
+    {
+        glm::vec3 position(i * 2.0f, 0, -(float)i);
+        glm::vec3 rotation(0.1f * i, 0.2f * i, 0.3f * i);
+        system.Add(position, rotation);
+        transforms[i].SetPosition(position);
+        transforms[i].SetRotation(rotation);
+    }
+    system.Update();
+    glm::mat4 untouched = system.GetMatrix(4);
+
+    system.SetPosition(1, glm::vec3(1, 2, 3));
+    transforms[1].SetPosition(glm::vec3(1, 2, 3));
+    system.Translate(2, glm::vec3(0, 5, 0));
+    transforms[2].Translate(glm::vec3(0, 5, 0));
+    system.Rotate(7, glm::vec3(0.1f, 0.2f, 0.3f));
+    transforms[7].SetRotation(transforms[7].Rotation() + glm::vec3(0.1f, 0.2f, 0.3f));
+    system.SetScale(8, 2.5f);
+    transforms[8].SetScale(2.5f);
+
+    // Nothing moves until Update.
+    CHECK(MatrixError(system.GetMatrix(1), transforms[1].GetMatrix()) > 1.0f);
+    system.Update();
+
+    for (unsigned int i = 0; i < 9; i++)
+    {
+        CHECK(MatrixError(system.GetMatrix(i), transforms[i].GetMatrix()) < 1e-5f);
+        CHECK(MatrixError(system.GetInverseMatrix(i), transforms[i].GetInverseMatrix()) < 1e-4f);
+    }
+    CHECK(system.GetMatrix(4) == untouched);
+    CHECK(system.GetPosition(2) == glm::vec3(4, 5, -2));
+    CHECK(system.GetScale(8) == 2.5f);
+
+    system.Clear();
+    CHECK(system.GetCount() == 0);
+    CHECK(system.Add() == 0);
+    system.Update();
+    CHECK(system.GetMatrix(0) == glm::mat4(1.0f));
+}
+
+void TransformSystemTests()
+{
+    MatchesTransform3D();
+    UpdateRebuildsChanges();
+}
+
+// 100,000 spinning objects, all of them changing every frame. Transform3D rebuilds each matrix on its own,
+// TransformSystem builds them 4 at a time, once with one thread and once with a job system.
+void TransformSystemBenchmark()
+{
+    const unsigned int count = 100000;
+    const int frames = 100;
+    const glm::vec3 spin(0.001f, 0.002f, 0.0005f);
+
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+    std::uniform_real_distribution<float> offset(-100.0f, 100.0f);
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> rotations;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        positions.push_back(glm::vec3(offset(random), offset(random), offset(random)));
+        rotations.push_back(glm::vec3(angle(random), angle(random), angle(random)));
+    }
+
+    // Keeps the work from being optimized away.
+    float result = 0;
+
+    std::vector<Transform3D> transforms(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        transforms[i].SetPosition(positions[i]);
+        transforms[i].SetRotation(rotations[i]);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        for (Transform3D& transform : transforms)
+        {
+            transform.SetRotation(transform.Rotation() + spin);
+            result += transform.GetMatrix()[3][0] + transform.GetInverseMatrix()[3][0];
+        }
+    }
+    double transform3dMilliseconds = Tests::MillisecondsSince(start) / frames;
+
+    JobSystem jobs;
+    double systemMilliseconds[2];
+    for (int threaded = 0; threaded < 2; threaded++)
+    {
+        TransformSystem system;
+        system.Reserve(count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            system.Add(positions[i], rotations[i]);
+        }
+        system.Update();
+
+        start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (unsigned int i = 0; i < count; i++)
+            {
+                system.Rotate(i, spin);
+            }
+            system.Update(threaded ? &jobs : nullptr);
+            result += system.GetMatrix(frame)[3][0] + system.GetInverseMatrix(frame)[3][0];
+        }
+        systemMilliseconds[threaded] = Tests::MillisecondsSince(start) / frames;
+    }
+
+    std::cout << "Transform update, " << count << " objects per frame: Transform3D " << transform3dMilliseconds
+        << "ms, TransformSystem " << systemMilliseconds[0] << "ms (" << transform3dMilliseconds / systemMilliseconds[0]
+        << "x), with the job system " << systemMilliseconds[1] << "ms (" << transform3dMilliseconds / systemMilliseconds[1]
+        << "x)" << std::endl;
+    std::cout << "(" << result << ")" << std::endl;
+}
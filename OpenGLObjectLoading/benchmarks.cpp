@@ -0,0 +1,426 @@
+/*
+Title: Object Loading
+File Name: benchmarks.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "benchmarks.h"
+#include "mesh.h"
+#include "meshCache.h"
+#include "textureLoader.h"
+#include "textureUploader.h"
+#include "textureTable.h"
+#include "material.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// How many milliseconds have passed since start.
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Triangles at full detail, over every submesh.
+static unsigned int CountTriangles(Mesh* mesh)
+{
+    unsigned int indices = 0;
+    for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++)
+    {
+        indices += mesh->GetSubmesh(i).m_indexCount;
+    }
+    return indices / 3;
+}
+
+// Triangles in the coarsest level of detail of every submesh.
+static unsigned int CountCoarsestTriangles(Mesh* mesh)
+{
+    unsigned int indices = 0;
+    for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++)
+    {
+        indices += mesh->GetLod(i, mesh->GetLodCount(i) - 1).m_indexCount;
+    }
+    return indices / 3;
+}
+
+bool Benchmarks::WriteGridMesh(const char* filePath, unsigned int gridSize)
+{
+    FILE* file = fopen(filePath, "w");
+    if (file == nullptr)
+        return false;
+
+    for (unsigned int z = 0; z <= gridSize; z++)
+    {
+        for (unsigned int x = 0; x <= gridSize; x++)
+        {
+            fprintf(file, "v %f 0 %f\n", (float)x / gridSize, (float)z / gridSize);
+        }
+    }
+
+    // obj indices start at 1
+    unsigned int rowLength = gridSize + 1;
+    for (unsigned int z = 0; z < gridSize; z++)
+    {
+        for (unsigned int x = 0; x < gridSize; x++)
+        {
+            unsigned int corner = z * rowLength + x + 1;
+            fprintf(file, "f %u %u %u %u\n", corner, corner + rowLength, corner + rowLength + 1, corner + 1);
+        }
+    }
+
+    return fclose(file) == 0;
+}
+
+void Benchmarks::MeshLoading()
+{
+    const char* gridPath = "../Assets/benchmarkGrid.obj";
+    if (!WriteGridMesh(gridPath, BENCHMARK_GRID_SIZE))
+    {
+        std::cout << "Can't write benchmark mesh: " << gridPath << std::endl;
+        return;
+    }
+
+    const char* filePaths[] = { "../Assets/buildingOBJ.obj", "../Assets/buildingFBX.fbx", gridPath };
+    for (int i = 0; i < 3; i++)
+    {
+        // Without its cache, the model goes through assimp, the level of detail builder and the cache writer.
+        remove(MeshCache::GetCachePath(filePaths[i], Mesh::GetImportFlags(false)).c_str());
+
+        // glFinish waits for the buffers to reach the graphics card, so the upload is part of the time.
+        auto start = std::chrono::high_resolution_clock::now();
+        Mesh* mesh = new Mesh(filePaths[i]);
+        glFinish();
+        double cold = MillisecondsSince(start);
+        unsigned int triangles = CountTriangles(mesh);
+        unsigned int lodCount = mesh->GetLodCount();
+        unsigned int coarsestTriangles = CountCoarsestTriangles(mesh);
+        delete mesh;
+
+        start = std::chrono::high_resolution_clock::now();
+        mesh = new Mesh(filePaths[i]);
+        glFinish();
+        double warm = MillisecondsSince(start);
+        delete mesh;
+
+        std::cout << "Mesh loading: " << filePaths[i] << " (" << triangles << " triangles) cold import "
+            << cold << "ms, warm cache " << warm << "ms, " << cold / warm << "x faster" << std::endl;
+
+        // The building models are boxes with a normal per face, so every corner is on more than two seams and can't move.
+        // They get no simplified levels, and only the grid shows what level of detail saves.
+        std::cout << "    " << lodCount - 1 << " simplified levels of detail, the coarsest has " << coarsestTriangles
+            << " triangles (" << 100.0 * coarsestTriangles / triangles << "% of full detail)" << std::endl;
+    }
+
+    remove(gridPath);
+    remove(MeshCache::GetCachePath(gridPath, Mesh::GetImportFlags(false)).c_str());
+}
+
+bool Benchmarks::WriteNoiseImage(const char* filePath, unsigned int size, unsigned int seed)
+{
+    FIBITMAP* bitmap = FreeImage_Allocate(size, size, 24);
+    if (bitmap == nullptr)
+        return false;
+
+    // A small xorshift generator, so every run writes the same images.
+    unsigned int state = seed * 2654435761u + 1;
+    for (unsigned int y = 0; y < size; y++)
+    {
+        BYTE* row = FreeImage_GetScanLine(bitmap, y);
+        for (unsigned int x = 0; x < size * 3; x++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            row[x] = (BYTE)state;
+        }
+    }
+
+    bool saved = FreeImage_Save(FIF_PNG, bitmap, filePath) != 0;
+    FreeImage_Unload(bitmap);
+    return saved;
+}
+
+void Benchmarks::TextureLoading()
+{
+    std::vector<std::string> filePaths;
+    for (unsigned int i = 0; i < BENCHMARK_TEXTURE_COUNT; i++)
+    {
+        filePaths.push_back("../Assets/benchmarkTexture" + std::to_string(i) + ".png");
+        if (!WriteNoiseImage(filePaths[i].c_str(), BENCHMARK_TEXTURE_SIZE, i))
+        {
+            std::cout << "Can't write benchmark texture: " << filePaths[i] << std::endl;
+            return;
+        }
+    }
+
+    // 1, 2, 4 and so on, and last one thread per core.
+    unsigned int cores = std::thread::hardware_concurrency();
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(cores > 0 ? cores : 1);
+
+    double singleThreaded = 0;
+    for (unsigned int threads : threadCounts)
+    {
+        // No upload budget, so the time is how long the images take to get through the loader.
+        TextureLoader* loader = new TextureLoader(threads, (size_t)-1);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < filePaths.size(); i++)
+        {
+            loader->Load(filePaths[i].c_str(), MipmapFilter::Box);
+        }
+        while (loader->GetPendingCount() > 0)
+        {
+            loader->Update();
+            std::this_thread::yield();
+        }
+        glFinish();
+        double milliseconds = MillisecondsSince(start);
+        delete loader;
+
+        if (threads == 1)
+            singleThreaded = milliseconds;
+        std::cout << "Texture loading: " << BENCHMARK_TEXTURE_COUNT << " textures with " << threads << " threads in "
+            << milliseconds << "ms, " << singleThreaded / milliseconds << "x the single thread speed" << std::endl;
+    }
+
+    for (size_t i = 0; i < filePaths.size(); i++)
+    {
+        remove(filePaths[i].c_str());
+    }
+}
+
+void Benchmarks::TextureStreaming()
+{
+    unsigned int size = BENCHMARK_STREAM_TEXTURE_SIZE;
+    size_t textureBytes = (size_t)size * size * 4;
+    unsigned int textureCount = (unsigned int)(((size_t)BENCHMARK_STREAM_MEGABYTES * 1024 * 1024) / textureBytes);
+
+    TextureUploader uploader;
+    std::vector<Texture*> textures;
+    std::vector<GLuint> placeholders;
+    unsigned int earlySwaps = 0;
+    unsigned int frames = 0;
+    double longestFrame = 0;
+    double totalTime = 0;
+
+    while (textures.size() < textureCount || uploader.GetPendingCount() > 0)
+    {
+        // Keep a few textures queued, like the loader does as images finish decoding.
+        // Making them isn't part of the frame time, that's the workers' job.
+        while (textures.size() < textureCount && uploader.GetPendingCount() < 4)
+        {
+            Texture* texture = new Texture();
+            texture->IncRefCount();
+            textures.push_back(texture);
+            placeholders.push_back(texture->GetGLTexture());
+
+            std::vector<unsigned char> pixels(textureBytes, (unsigned char)textures.size());
+            uploader.Queue(texture, pixels, size, size, 1, MipmapFilter::Gpu);
+        }
+
+        // glFinish stands in for the buffer swap, which waits for the frame's gpu work too.
+        auto start = std::chrono::high_resolution_clock::now();
+        uploader.Update();
+        glFinish();
+        double milliseconds = MillisecondsSince(start);
+
+        frames++;
+        totalTime += milliseconds;
+        if (milliseconds > longestFrame)
+            longestFrame = milliseconds;
+
+        // Uploads finish in order, so the last GetPendingCount textures are still streaming.
+        for (size_t i = textures.size() - uploader.GetPendingCount(); i < textures.size(); i++)
+        {
+            if (textures[i]->GetGLTexture() != placeholders[i])
+                earlySwaps++;
+        }
+    }
+
+    for (size_t i = 0; i < textures.size(); i++)
+    {
+        textures[i]->DecRefCount();
+    }
+
+    std::cout << "Texture streaming: " << textureCount * textureBytes / (1024 * 1024) << "MB in " << textureCount << " textures over "
+        << frames << " frames, " << totalTime / frames << "ms average, " << longestFrame << "ms longest frame, "
+        << earlySwaps << " placeholders replaced early" << std::endl;
+}
+
+bool Benchmarks::WriteSolidImage(const char* filePath, unsigned int size, unsigned int color)
+{
+    FIBITMAP* bitmap = FreeImage_Allocate(size, size, 24);
+    if (bitmap == nullptr)
+        return false;
+
+    for (unsigned int y = 0; y < size; y++)
+    {
+        BYTE* row = FreeImage_GetScanLine(bitmap, y);
+        for (unsigned int x = 0; x < size; x++)
+        {
+            row[x * 3 + FI_RGBA_RED] = (BYTE)(color >> 16);
+            row[x * 3 + FI_RGBA_GREEN] = (BYTE)(color >> 8);
+            row[x * 3 + FI_RGBA_BLUE] = (BYTE)color;
+        }
+    }
+
+    bool saved = FreeImage_Save(FIF_PNG, bitmap, filePath) != 0;
+    FreeImage_Unload(bitmap);
+    return saved;
+}
+
+void Benchmarks::MultiDrawIndirect()
+{
+    std::vector<std::string> filePaths;
+    std::vector<unsigned int> colors;
+    for (unsigned int i = 0; i < BENCHMARK_TABLE_TEXTURES; i++)
+    {
+        filePaths.push_back("../Assets/benchmarkTable" + std::to_string(i) + ".png");
+        colors.push_back((i * 0x3F1D5B + 0x402010) & 0xFFFFFF);
+        if (!WriteSolidImage(filePaths[i].c_str(), 64, colors[i]))
+        {
+            std::cout << "Can't write benchmark texture: " << filePaths[i] << std::endl;
+            return;
+        }
+    }
+
+    MultiDrawTable(false, filePaths, colors);
+    if (Texture::IsBindlessSupported())
+        MultiDrawTable(true, filePaths, colors);
+    else
+        std::cout << "Multi draw indirect (bindless): skipped, the driver doesn't have ARB_bindless_texture" << std::endl;
+
+    for (size_t i = 0; i < filePaths.size(); i++)
+    {
+        remove(filePaths[i].c_str());
+    }
+}
+
+void Benchmarks::MultiDrawTable(bool bindless, const std::vector<std::string>& filePaths, const std::vector<unsigned int>& colors)
+{
+    const char* mode = bindless ? "bindless" : "texture array";
+    unsigned int grid = BENCHMARK_MULTI_DRAW_GRID;
+    unsigned int size = BENCHMARK_FRAMEBUFFER_SIZE;
+
+    // Draw into a framebuffer of our own, so the result can be read back at a known size.
+    GLuint framebuffer, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    glViewport(0, 0, size, size);
+
+    // A quad facing the camera.
+    std::vector<Vertex3dUVNormal> vertices;
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(-0.5f, -0.5f, 0), glm::vec2(0, 0), glm::vec3(0, 0, 1)));
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(0.5f, -0.5f, 0), glm::vec2(1, 0), glm::vec3(0, 0, 1)));
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(0.5f, 0.5f, 0), glm::vec2(1, 1), glm::vec3(0, 0, 1)));
+    vertices.push_back(Vertex3dUVNormal(glm::vec3(-0.5f, 0.5f, 0), glm::vec2(0, 1), glm::vec3(0, 0, 1)));
+    std::vector<unsigned short> indices = { 0, 1, 2, 0, 2, 3 };
+    Mesh* quad = new Mesh(vertices, indices);
+
+    ShaderProgram* shaderProgram = new ShaderProgram();
+    shaderProgram->AttachShader(new Shader("../Assets/vertexMultiDraw.glsl", GL_VERTEX_SHADER));
+    shaderProgram->AttachShader(new Shader(bindless ? "../Assets/fragmentBindless.glsl" : "../Assets/fragmentTextureArray.glsl", GL_FRAGMENT_SHADER));
+    Material* material = new Material(shaderProgram);
+
+    TextureTable* table = new TextureTable(64, 64, (unsigned int)filePaths.size(), bindless);
+    for (size_t i = 0; i < filePaths.size(); i++)
+    {
+        table->Add(filePaths[i].c_str());
+    }
+    char textureArrayName[] = "texArray";
+    material->SetTextureTable(textureArrayName, table);
+
+    // One unit of the grid for each quad, with a gap between them.
+    char cameraViewName[] = "cameraView";
+    material->SetMatrix(cameraViewName, glm::ortho(0.0f, (float)grid, 0.0f, (float)grid, -1.0f, 1.0f));
+
+    std::vector<DrawInstance> instances(grid * grid);
+    for (unsigned int y = 0; y < grid; y++)
+    {
+        for (unsigned int x = 0; x < grid; x++)
+        {
+            DrawInstance& instance = instances[y * grid + x];
+            instance.m_worldMatrix = glm::scale(glm::translate(glm::mat4(), glm::vec3(x + 0.5f, y + 0.5f, 0)), glm::vec3(0.8f));
+            instance.m_textureIndex = (x + y * 3) % filePaths.size();
+        }
+    }
+
+    // The first frame makes the mipmaps and uploads the handles, so it isn't timed.
+    const unsigned int frames = 100;
+    double totalTime = 0;
+    glEnable(GL_DEPTH_TEST);
+    for (unsigned int i = 0; i <= frames; i++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        glClearColor(0, 0, 0, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        material->Bind();
+        quad->DrawMultiIndirect(instances.data(), (unsigned int)instances.size());
+        glFinish();
+        if (i > 0)
+            totalTime += MillisecondsSince(start);
+    }
+
+    // Each quad is lit the same way as in the fragment shaders, so its color is the texture's times that light.
+    glm::vec3 lightDirection = glm::normalize(glm::vec3(-1, -1, -2));
+    float ndotl = glm::clamp(-glm::dot(lightDirection, glm::vec3(0, 0, 1)), 0.0f, 1.0f);
+    glm::vec3 light = glm::clamp(glm::vec3(1, .9f, .5f) * ndotl + glm::vec3(.1f), 0.0f, 1.0f);
+
+    std::vector<unsigned char> pixels((size_t)size * size * 4);
+    glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    unsigned int correct = 0;
+    for (unsigned int y = 0; y < grid; y++)
+    {
+        for (unsigned int x = 0; x < grid; x++)
+        {
+            unsigned int color = colors[instances[y * grid + x].m_textureIndex];
+            glm::vec3 expected = glm::vec3((color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF) * light;
+
+            // Look at the pixel in the middle of the quad.
+            size_t pixelX = (size_t)((x + 0.5f) * size / grid);
+            size_t pixelY = (size_t)((y + 0.5f) * size / grid);
+            const unsigned char* pixel = &pixels[(pixelY * size + pixelX) * 4];
+            glm::vec3 difference = glm::abs(glm::vec3(pixel[0], pixel[1], pixel[2]) - expected);
+            if (difference.x <= 2 && difference.y <= 2 && difference.z <= 2)
+                correct++;
+        }
+    }
+
+    std::cout << "Multi draw indirect (" << mode << "): " << grid * grid << " instances from " << filePaths.size() << " textures, "
+        << totalTime / frames << "ms per frame, " << correct << " of " << grid * grid << " show the right texture" << std::endl;
+
+    delete material;
+    delete quad;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+}
@@ -0,0 +1,77 @@
+/*
+Title: Object Loading
+File Name: benchmarks.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+
+// Rows and columns of quads in the synthetic mesh of the loading benchmark.
+// 1024 makes a grid of 2 million triangles.
+#define BENCHMARK_GRID_SIZE 1024
+
+// Number and size of the generated images the texture loading benchmark loads.
+#define BENCHMARK_TEXTURE_COUNT 500
+#define BENCHMARK_TEXTURE_SIZE 256
+
+// Megabytes of texture data the streaming benchmark sends through the uploader,
+// in textures of this size.
+#define BENCHMARK_STREAM_MEGABYTES 1024
+#define BENCHMARK_STREAM_TEXTURE_SIZE 2048
+
+// The multi draw benchmark draws a grid of this many by this many quads, each picking one of
+// BENCHMARK_TABLE_TEXTURES textures from a texture table, into a framebuffer of BENCHMARK_FRAMEBUFFER_SIZE pixels.
+#define BENCHMARK_MULTI_DRAW_GRID 64
+#define BENCHMARK_TABLE_TEXTURES 16
+#define BENCHMARK_FRAMEBUFFER_SIZE 512
+
+// Benchmarks for the parts of the program that need an opengl context.
+// main runs them when RUN_BENCHMARKS is set, and each one prints its results.
+class Benchmarks
+{
+private:
+    // Writes a flat grid of quads to an obj file, a stand in for a very large model.
+    static bool WriteGridMesh(const char* filePath, unsigned int gridSize);
+    // Writes a png of noise, which takes about as long to decode as a photo of the same size.
+    static bool WriteNoiseImage(const char* filePath, unsigned int size, unsigned int seed);
+    // Writes a png of a single color, given as 0xRRGGBB.
+    static bool WriteSolidImage(const char* filePath, unsigned int size, unsigned int color);
+
+    // Draws the quad grid of the multi draw benchmark with one texture table mode, and prints the results.
+    static void MultiDrawTable(bool bindless, const std::vector<std::string>& filePaths, const std::vector<unsigned int>& colors);
+
+public:
+    // Loads each model twice, first with its mesh cache deleted so assimp has to import it,
+    // then again from the cache the first load wrote.
+    static void MeshLoading();
+
+    // Loads the same set of images with 1, 2, 4 and so on worker threads, up to one per core.
+    // Decoding and the mipmaps run on the workers, so the time should drop as threads are added,
+    // until the uploads on the main thread are all that's left.
+    static void TextureLoading();
+
+    // Streams textures through a TextureUploader with its default budget, a frame at a time,
+    // and prints the average and longest frame. Also counts textures that stopped showing
+    // their placeholder before their upload was done, which should never happen.
+    static void TextureStreaming();
+
+    // Draws a grid of quads with Mesh::DrawMultiIndirect, each with a texture picked by its instance,
+    // once from a texture array table and once from a bindless one, if the driver has bindless textures.
+    // Prints the time per frame, and reads the framebuffer back to count the quads showing the right texture.
+    static void MultiDrawIndirect();
+};
@@ -0,0 +1,678 @@
+/*
+Title: Object Loading
+File Name: boundingVolumeHierarchy.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "boundingVolumeHierarchy.h"
+#include "frustumCuller.h"
+#include <algorithm>
+#include <cfloat>
+
+// Half the surface area of a box. Only ever compared, so the factor of 2 is left out.
+static inline float Area(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    glm::vec3 size = boundsMax - boundsMin;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// Area of the box around two boxes.
+static inline float UnionArea(glm::vec3 minA, glm::vec3 maxA, glm::vec3 minB, glm::vec3 maxB)
+{
+    return Area(glm::min(minA, minB), glm::max(maxA, maxB));
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float margin)
+{
+    m_margin = margin;
+}
+
+int BoundingVolumeHierarchy::AllocateNode()
+{
+    int node;
+    if (m_freeList != c_noNode)
+    {
+        node = m_freeList;
+        m_freeList = m_nodes[node].m_parent;
+    }
+    else
+    {
+        node = (int)m_nodes.size();
+        m_nodes.push_back(Node());
+    }
+
+    Node& n = m_nodes[node];
+    n.m_parent = c_noNode;
+    n.m_children[0] = n.m_children[1] = c_noNode;
+    n.m_height = 0;
+    n.m_object = 0;
+    return node;
+}
+
+void BoundingVolumeHierarchy::FreeNode(int node)
+{
+    m_nodes[node].m_parent = m_freeList;
+    m_nodes[node].m_height = -1;
+    m_freeList = node;
+}
+
+int BoundingVolumeHierarchy::Insert(glm::vec3 boundsMin, glm::vec3 boundsMax, unsigned int object)
+{
+    int leaf = AllocateNode();
+    Node& n = m_nodes[leaf];
+    n.m_boundsMin = boundsMin - glm::vec3(m_margin);
+    n.m_boundsMax = boundsMax + glm::vec3(m_margin);
+    n.m_object = object;
+
+    InsertLeaf(leaf);
+    m_leafCount++;
+    return leaf;
+}
+
+void BoundingVolumeHierarchy::Remove(int proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    m_leafCount--;
+}
+
+bool BoundingVolumeHierarchy::Move(int proxy, glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3 displacement)
+{
+    Node& n = m_nodes[proxy];
+
+    // Still inside its fat box, the tree doesn't need to know.
+    if (glm::all(glm::greaterThanEqual(boundsMin, n.m_boundsMin)) && glm::all(glm::lessThanEqual(boundsMax, n.m_boundsMax)))
+        return false;
+
+    RemoveLeaf(proxy);
+
+    // Stretch the box towards where the object is moving, so it stays inside for longer.
+    glm::vec3 fatMin = boundsMin - glm::vec3(m_margin);
+    glm::vec3 fatMax = boundsMax + glm::vec3(m_margin);
+    fatMin += glm::min(displacement, glm::vec3());
+    fatMax += glm::max(displacement, glm::vec3());
+
+    m_nodes[proxy].m_boundsMin = fatMin;
+    m_nodes[proxy].m_boundsMax = fatMax;
+    InsertLeaf(proxy);
+    return true;
+}
+
+void BoundingVolumeHierarchy::SetBounds(int proxy, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    m_nodes[proxy].m_boundsMin = boundsMin - glm::vec3(m_margin);
+    m_nodes[proxy].m_boundsMax = boundsMax + glm::vec3(m_margin);
+}
+
+void BoundingVolumeHierarchy::Refit()
+{
+    if (m_root == c_noNode)
+        return;
+
+    // Visit nodes depth first, then refit them in reverse, so children are always done before their parent.
+    m_stack.clear();
+    m_buildLeaves.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        int node = m_stack.back();
+        m_stack.pop_back();
+
+        if (m_nodes[node].m_height > 0)
+        {
+            m_buildLeaves.push_back(node);
+            m_stack.push_back(m_nodes[node].m_children[0]);
+            m_stack.push_back(m_nodes[node].m_children[1]);
+        }
+    }
+
+    for (size_t i = m_buildLeaves.size(); i > 0; i--)
+    {
+        UpdateNode(m_buildLeaves[i - 1]);
+    }
+}
+
+void BoundingVolumeHierarchy::InsertLeaf(int leaf)
+{
+    if (m_root == c_noNode)
+    {
+        m_root = leaf;
+        m_nodes[leaf].m_parent = c_noNode;
+        return;
+    }
+
+    glm::vec3 boundsMin = m_nodes[leaf].m_boundsMin;
+    glm::vec3 boundsMax = m_nodes[leaf].m_boundsMax;
+    int sibling = FindBestSibling(boundsMin, boundsMax);
+
+    // The new parent takes the sibling's place, with the sibling and the leaf below it.
+    int oldParent = m_nodes[sibling].m_parent;
+    int parent = AllocateNode();
+
+    Node& p = m_nodes[parent];
+    p.m_parent = oldParent;
+    p.m_children[0] = sibling;
+    p.m_children[1] = leaf;
+    m_nodes[sibling].m_parent = parent;
+    m_nodes[leaf].m_parent = parent;
+
+    if (oldParent == c_noNode)
+    {
+        m_root = parent;
+    }
+    else
+    {
+        Node& o = m_nodes[oldParent];
+        o.m_children[o.m_children[0] == sibling ? 0 : 1] = parent;
+    }
+
+    RefitAncestors(parent);
+}
+
+void BoundingVolumeHierarchy::RemoveLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = c_noNode;
+        return;
+    }
+
+    int parent = m_nodes[leaf].m_parent;
+    int grandParent = m_nodes[parent].m_parent;
+    int sibling = m_nodes[parent].m_children[0] == leaf ? m_nodes[parent].m_children[1] : m_nodes[parent].m_children[0];
+
+    m_nodes[sibling].m_parent = grandParent;
+    FreeNode(parent);
+
+    if (grandParent == c_noNode)
+    {
+        m_root = sibling;
+        return;
+    }
+
+    Node& g = m_nodes[grandParent];
+    g.m_children[g.m_children[0] == parent ? 0 : 1] = sibling;
+    RefitAncestors(grandParent);
+}
+
+int BoundingVolumeHierarchy::FindBestSibling(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    // Pairing the leaf with a node costs the area of their new parent, plus the area every ancestor grows by.
+    // Walk down from the root, always into the child that could still give the cheapest pairing,
+    // and stop once neither child can beat the best node found so far.
+    float leafArea = Area(boundsMin, boundsMax);
+
+    int best = m_root;
+    float bestCost = UnionArea(boundsMin, boundsMax, m_nodes[m_root].m_boundsMin, m_nodes[m_root].m_boundsMax);
+    float inherited = 0;
+
+    int node = m_root;
+    while (m_nodes[node].m_height > 0)
+    {
+        const Node& n = m_nodes[node];
+
+        // Anything paired below this node makes it grow to cover the leaf.
+        inherited += UnionArea(boundsMin, boundsMax, n.m_boundsMin, n.m_boundsMax) - Area(n.m_boundsMin, n.m_boundsMax);
+
+        float lowerBound[2];
+        for (int i = 0; i < 2; i++)
+        {
+            const Node& child = m_nodes[n.m_children[i]];
+            float unionArea = UnionArea(boundsMin, boundsMax, child.m_boundsMin, child.m_boundsMax);
+
+            float cost = unionArea + inherited;
+            if (cost < bestCost)
+            {
+                best = n.m_children[i];
+                bestCost = cost;
+            }
+
+            // Going below the child, it grows too, and the new parent is at least as big as the leaf.
+            if (child.m_height > 0)
+                lowerBound[i] = inherited + unionArea - Area(child.m_boundsMin, child.m_boundsMax) + leafArea;
+            else
+                lowerBound[i] = FLT_MAX;
+        }
+
+        if (bestCost <= lowerBound[0] && bestCost <= lowerBound[1])
+            break;
+
+        node = n.m_children[lowerBound[0] <= lowerBound[1] ? 0 : 1];
+    }
+
+    return best;
+}
+
+void BoundingVolumeHierarchy::UpdateNode(int node)
+{
+    Node& n = m_nodes[node];
+    const Node& a = m_nodes[n.m_children[0]];
+    const Node& b = m_nodes[n.m_children[1]];
+    n.m_boundsMin = glm::min(a.m_boundsMin, b.m_boundsMin);
+    n.m_boundsMax = glm::max(a.m_boundsMax, b.m_boundsMax);
+    n.m_height = 1 + std::max(a.m_height, b.m_height);
+}
+
+void BoundingVolumeHierarchy::RotateNode(int node)
+{
+    int b = m_nodes[node].m_children[0];
+    int c = m_nodes[node].m_children[1];
+    const Node& nodeB = m_nodes[b];
+    const Node& nodeC = m_nodes[c];
+
+    // Moving a child into the other side's subtree and pulling a grandchild up doesn't change this node's box,
+    // only the box of the side that was changed. Pick the swap that shrinks it the most, if any.
+    float bestChange = 0;
+    int swapChild = c_noNode;
+    int swapGrandChild = c_noNode;
+
+    if (nodeC.m_height > 0)
+    {
+        float areaC = Area(nodeC.m_boundsMin, nodeC.m_boundsMax);
+        for (int i = 0; i < 2; i++)
+        {
+            // b swaps with one child of c, and stays next to the other
+            const Node& stays = m_nodes[nodeC.m_children[1 - i]];
+            float change = UnionArea(nodeB.m_boundsMin, nodeB.m_boundsMax, stays.m_boundsMin, stays.m_boundsMax) - areaC;
+            if (change < bestChange)
+            {
+                bestChange = change;
+                swapChild = b;
+                swapGrandChild = nodeC.m_children[i];
+            }
+        }
+    }
+
+    if (nodeB.m_height > 0)
+    {
+        float areaB = Area(nodeB.m_boundsMin, nodeB.m_boundsMax);
+        for (int i = 0; i < 2; i++)
+        {
+            const Node& stays = m_nodes[nodeB.m_children[1 - i]];
+            float change = UnionArea(nodeC.m_boundsMin, nodeC.m_boundsMax, stays.m_boundsMin, stays.m_boundsMax) - areaB;
+            if (change < bestChange)
+            {
+                bestChange = change;
+                swapChild = c;
+                swapGrandChild = nodeB.m_children[i];
+            }
+        }
+    }
+
+    if (swapChild == c_noNode)
+        return;
+
+    // The grandchild moves up next to swapChild's sibling, and swapChild moves down in its place.
+    int side = m_nodes[swapGrandChild].m_parent;
+    Node& n = m_nodes[node];
+    n.m_children[n.m_children[0] == swapChild ? 0 : 1] = swapGrandChild;
+    m_nodes[swapGrandChild].m_parent = node;
+
+    Node& s = m_nodes[side];
+    s.m_children[s.m_children[0] == swapGrandChild ? 0 : 1] = swapChild;
+    m_nodes[swapChild].m_parent = side;
+
+    UpdateNode(side);
+    UpdateNode(node);
+}
+
+void BoundingVolumeHierarchy::RefitAncestors(int node)
+{
+    while (node != c_noNode)
+    {
+        UpdateNode(node);
+        RotateNode(node);
+        node = m_nodes[node].m_parent;
+    }
+}
+
+void BoundingVolumeHierarchy::Build()
+{
+    if (m_root == c_noNode)
+        return;
+
+    // Keep the leaves, free everything else.
+    m_buildLeaves.clear();
+    for (size_t i = 0; i < m_nodes.size(); i++)
+    {
+        if (m_nodes[i].m_height == 0)
+            m_buildLeaves.push_back((int)i);
+        else if (m_nodes[i].m_height > 0)
+            FreeNode((int)i);
+    }
+
+    m_root = BuildRange(0, (unsigned int)m_buildLeaves.size());
+    m_nodes[m_root].m_parent = c_noNode;
+}
+
+int BoundingVolumeHierarchy::BuildRange(unsigned int first, unsigned int count)
+{
+    int* leaves = &m_buildLeaves[first];
+    if (count == 1)
+        return leaves[0];
+
+    // Bounds of the leaf centers. The split is made along the axis they spread out the most on.
+    glm::vec3 centerMin = (m_nodes[leaves[0]].m_boundsMin + m_nodes[leaves[0]].m_boundsMax) * 0.5f;
+    glm::vec3 centerMax = centerMin;
+    for (unsigned int i = 1; i < count; i++)
+    {
+        glm::vec3 center = (m_nodes[leaves[i]].m_boundsMin + m_nodes[leaves[i]].m_boundsMax) * 0.5f;
+        centerMin = glm::min(centerMin, center);
+        centerMax = glm::max(centerMax, center);
+    }
+
+    glm::vec3 extent = centerMax - centerMin;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+    unsigned int split = count / 2;
+    if (extent[axis] > 0)
+    {
+        // Sort the leaves into bins by center, then try a split between every pair of bins.
+        // A split costs the area of each side times the number of leaves on it.
+        unsigned int binCount[BVH_BUILD_BINS] = {};
+        glm::vec3 binMin[BVH_BUILD_BINS];
+        glm::vec3 binMax[BVH_BUILD_BINS];
+        float binScale = BVH_BUILD_BINS / extent[axis];
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const Node& n = m_nodes[leaves[i]];
+            float center = (n.m_boundsMin[axis] + n.m_boundsMax[axis]) * 0.5f;
+            int bin = std::min((int)((center - centerMin[axis]) * binScale), BVH_BUILD_BINS - 1);
+            if (binCount[bin]++ == 0)
+            {
+                binMin[bin] = n.m_boundsMin;
+                binMax[bin] = n.m_boundsMax;
+            }
+            else
+            {
+                binMin[bin] = glm::min(binMin[bin], n.m_boundsMin);
+                binMax[bin] = glm::max(binMax[bin], n.m_boundsMax);
+            }
+        }
+
+        // Area and count of everything right of each split, swept from the right.
+        float rightCost[BVH_BUILD_BINS];
+        unsigned int rightCount = 0;
+        glm::vec3 sweepMin, sweepMax;
+        for (int bin = BVH_BUILD_BINS - 1; bin > 0; bin--)
+        {
+            if (binCount[bin] > 0)
+            {
+                sweepMin = rightCount == 0 ? binMin[bin] : glm::min(sweepMin, binMin[bin]);
+                sweepMax = rightCount == 0 ? binMax[bin] : glm::max(sweepMax, binMax[bin]);
+                rightCount += binCount[bin];
+            }
+            rightCost[bin] = rightCount == 0 ? 0 : Area(sweepMin, sweepMax) * rightCount;
+        }
+
+        // Then sweep from the left, and keep the cheapest split.
+        float bestCost = 0;
+        int bestBin = 0;
+        unsigned int leftCount = 0;
+        for (int bin = 0; bin < BVH_BUILD_BINS - 1; bin++)
+        {
+            if (binCount[bin] > 0)
+            {
+                sweepMin = leftCount == 0 ? binMin[bin] : glm::min(sweepMin, binMin[bin]);
+                sweepMax = leftCount == 0 ? binMax[bin] : glm::max(sweepMax, binMax[bin]);
+                leftCount += binCount[bin];
+            }
+            if (leftCount == 0 || leftCount == count)
+                continue;
+
+            float cost = Area(sweepMin, sweepMax) * leftCount + rightCost[bin + 1];
+            if (bestBin == 0 || cost < bestCost)
+            {
+                bestCost = cost;
+                bestBin = bin + 1;
+            }
+        }
+
+        if (bestBin > 0)
+        {
+            float splitPosition = centerMin[axis] + bestBin / binScale;
+            int* middle = std::partition(leaves, leaves + count, [this, axis, splitPosition, centerMin, binScale, bestBin](int leaf)
+            {
+                const Node& n = m_nodes[leaf];
+                float center = (n.m_boundsMin[axis] + n.m_boundsMax[axis]) * 0.5f;
+                return std::min((int)((center - centerMin[axis]) * binScale), BVH_BUILD_BINS - 1) < bestBin;
+            });
+            split = (unsigned int)(middle - leaves);
+        }
+    }
+
+    // Leaves that all sit in the same place, or that didn't split, are just cut in half.
+    if (split == 0 || split == count)
+        split = count / 2;
+
+    int left = BuildRange(first, split);
+    int right = BuildRange(first + split, count - split);
+
+    int node = AllocateNode();
+    Node& n = m_nodes[node];
+    n.m_children[0] = left;
+    n.m_children[1] = right;
+    m_nodes[left].m_parent = node;
+    m_nodes[right].m_parent = node;
+    UpdateNode(node);
+    return node;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_nodes.clear();
+    m_root = c_noNode;
+    m_freeList = c_noNode;
+    m_leafCount = 0;
+}
+
+void BoundingVolumeHierarchy::AddSubtree(int node, std::vector<unsigned int>& objects)
+{
+    size_t base = m_stack.size();
+    m_stack.push_back(node);
+    while (m_stack.size() > base)
+    {
+        const Node& n = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        if (n.m_height == 0)
+        {
+            objects.push_back(n.m_object);
+        }
+        else
+        {
+            m_stack.push_back(n.m_children[0]);
+            m_stack.push_back(n.m_children[1]);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const glm::mat4& viewProjection, std::vector<unsigned int>& objects)
+{
+    objects.clear();
+    if (m_root == c_noNode)
+        return;
+
+    glm::vec4 planes[6];
+    FrustumCuller::ExtractPlanes(viewProjection, planes);
+
+    // The stack holds pairs of a node and the planes it still has to be tested against.
+    // Once a box is fully in front of a plane, so is everything below it, and that plane is dropped.
+    // With no planes left the whole subtree is inside.
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    m_stack.push_back(0x3F);
+    while (!m_stack.empty())
+    {
+        int planeMask = m_stack.back();
+        m_stack.pop_back();
+        int node = m_stack.back();
+        m_stack.pop_back();
+
+        const Node& n = m_nodes[node];
+        glm::vec3 center = (n.m_boundsMin + n.m_boundsMax) * 0.5f;
+        glm::vec3 halfSize = (n.m_boundsMax - n.m_boundsMin) * 0.5f;
+
+        bool outside = false;
+        for (int p = 0; p < 6; p++)
+        {
+            if ((planeMask & (1 << p)) == 0)
+                continue;
+
+            glm::vec3 normal = glm::vec3(planes[p]);
+            float distance = glm::dot(normal, center) + planes[p].w;
+            float reach = glm::dot(glm::abs(normal), halfSize);
+            if (distance + reach < 0)
+            {
+                outside = true;
+                break;
+            }
+            if (distance - reach >= 0)
+                planeMask &= ~(1 << p);
+        }
+
+        if (outside)
+            continue;
+
+        if (planeMask == 0)
+        {
+            AddSubtree(node, objects);
+        }
+        else if (n.m_height == 0)
+        {
+            objects.push_back(n.m_object);
+        }
+        else
+        {
+            m_stack.push_back(n.m_children[0]);
+            m_stack.push_back(planeMask);
+            m_stack.push_back(n.m_children[1]);
+            m_stack.push_back(planeMask);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::QuerySphere(glm::vec3 center, float radius, std::vector<unsigned int>& objects)
+{
+    objects.clear();
+    if (m_root == c_noNode)
+        return;
+
+    float radiusSquared = radius * radius;
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        const Node& n = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        // Distance from the center to the closest point of the box.
+        glm::vec3 offset = center - glm::clamp(center, n.m_boundsMin, n.m_boundsMax);
+        if (glm::dot(offset, offset) > radiusSquared)
+            continue;
+
+        if (n.m_height == 0)
+        {
+            objects.push_back(n.m_object);
+        }
+        else
+        {
+            m_stack.push_back(n.m_children[0]);
+            m_stack.push_back(n.m_children[1]);
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::QueryRay(glm::vec3 origin, glm::vec3 direction, float maxDistance, std::vector<unsigned int>& objects)
+{
+    objects.clear();
+    if (m_root == c_noNode)
+        return;
+
+    // Slab test: the ray is inside the box between the last time it enters a pair of planes
+    // and the first time it leaves one. Dividing by a zero direction gives infinities, which still work.
+    glm::vec3 inverseDirection = 1.0f / direction;
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while (!m_stack.empty())
+    {
+        const Node& n = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        glm::vec3 t0 = (n.m_boundsMin - origin) * inverseDirection;
+        glm::vec3 t1 = (n.m_boundsMax - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        if (enter > exit)
+            continue;
+
+        if (n.m_height == 0)
+        {
+            objects.push_back(n.m_object);
+        }
+        else
+        {
+            m_stack.push_back(n.m_children[0]);
+            m_stack.push_back(n.m_children[1]);
+        }
+    }
+}
+
+unsigned int BoundingVolumeHierarchy::GetObject(int proxy)
+{
+    return m_nodes[proxy].m_object;
+}
+
+glm::vec3 BoundingVolumeHierarchy::GetFatBoundsMin(int proxy)
+{
+    return m_nodes[proxy].m_boundsMin;
+}
+
+glm::vec3 BoundingVolumeHierarchy::GetFatBoundsMax(int proxy)
+{
+    return m_nodes[proxy].m_boundsMax;
+}
+
+unsigned int BoundingVolumeHierarchy::GetObjectCount()
+{
+    return m_leafCount;
+}
+
+int BoundingVolumeHierarchy::GetHeight()
+{
+    return m_root == c_noNode ? 0 : m_nodes[m_root].m_height;
+}
+
+float BoundingVolumeHierarchy::GetCost()
+{
+    if (m_root == c_noNode)
+        return 0;
+
+    float total = 0;
+    for (size_t i = 0; i < m_nodes.size(); i++)
+    {
+        if (m_nodes[i].m_height > 0)
+            total += Area(m_nodes[i].m_boundsMin, m_nodes[i].m_boundsMax);
+    }
+
+    float rootArea = Area(m_nodes[m_root].m_boundsMin, m_nodes[m_root].m_boundsMax);
+    return rootArea > 0 ? total / rootArea : 0;
+}
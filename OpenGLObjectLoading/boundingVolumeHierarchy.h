@@ -0,0 +1,128 @@
+/*
+Title: Object Loading
+File Name: boundingVolumeHierarchy.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "glm/glm.hpp"
+#include <vector>
+
+// Bins used to find the best split when building the tree from scratch.
+#define BVH_BUILD_BINS 12
+
+// A tree of bounding boxes over objects, for finding the objects in a frustum, along a ray or near a point
+// without testing every one of them.
+// Each leaf holds one object, inside a "fat" box that is a little bigger than the object. An object can
+// move around inside its fat box without the tree changing. When it leaves it, the leaf is taken out
+// and inserted again where it adds the least surface area, and the nodes above it are rotated
+// to keep the tree's surface area (the cost of walking it) low.
+// Build rebuilds the whole tree from scratch with the surface area heuristic, which gives the best tree
+// for static objects. Objects that are moved with SetBounds keep their place in the tree and
+// only grow their ancestors' boxes, once Refit is called.
+// Queries reuse an internal stack, so only one query can run at a time.
+class BoundingVolumeHierarchy
+{
+public:
+    static const int c_noNode = -1;
+
+private:
+    struct Node
+    {
+        glm::vec3 m_boundsMin;
+        glm::vec3 m_boundsMax;
+        int m_parent;           // also the next free node, for nodes in the free list
+        int m_children[2];      // c_noNode for leaves
+        int m_height;           // 0 for leaves, -1 for free nodes
+        unsigned int m_object;  // object of a leaf
+    };
+
+    std::vector<Node> m_nodes;
+    int m_root = c_noNode;
+    int m_freeList = c_noNode;
+    unsigned int m_leafCount = 0;
+
+    // How much bigger than its object a leaf's box is made.
+    float m_margin;
+
+    std::vector<int> m_stack;
+    std::vector<int> m_buildLeaves;
+
+    int AllocateNode();
+    void FreeNode(int node);
+
+    // Links a leaf into the tree next to the node it adds the least surface area with.
+    void InsertLeaf(int leaf);
+    // Unlinks a leaf, its sibling takes the place of their parent.
+    void RemoveLeaf(int leaf);
+    // Finds the node a new leaf with these bounds is cheapest to pair with, walking down from the root.
+    int FindBestSibling(glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+    // Recalculates a node's box and height from its children.
+    void UpdateNode(int node);
+    // Swaps a child of the node with a grandchild from its other side, if that makes the tree cheaper.
+    void RotateNode(int node);
+    // Refits and rotates node and each of its ancestors, up to the root.
+    void RefitAncestors(int node);
+
+    // Builds a subtree over leaves [first, first + count) with the surface area heuristic. Returns its root.
+    int BuildRange(unsigned int first, unsigned int count);
+
+    // Adds every object below node to objects.
+    void AddSubtree(int node, std::vector<unsigned int>& objects);
+
+public:
+    BoundingVolumeHierarchy(float margin = 0.1f);
+
+    // Adds an object with the given bounds. Returns its proxy, which stays the same until it is removed.
+    int Insert(glm::vec3 boundsMin, glm::vec3 boundsMax, unsigned int object);
+    void Remove(int proxy);
+
+    // Moves an object. Nothing changes while the new bounds still fit in its fat box.
+    // Otherwise it is inserted again, with its fat box also stretched by displacement, to cover where it is heading.
+    // Returns true if the tree changed.
+    bool Move(int proxy, glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3 displacement = glm::vec3());
+
+    // Sets an object's bounds without changing the shape of the tree. Call Refit afterwards.
+    // Cheaper than Move when many objects move a little, but the tree gets worse if they move far.
+    void SetBounds(int proxy, glm::vec3 boundsMin, glm::vec3 boundsMax);
+    // Recalculates every node's box from the leaves up.
+    void Refit();
+
+    // Rebuilds the whole tree with the surface area heuristic. Proxies stay the same.
+    void Build();
+
+    void Clear();
+
+    // Each query clears objects, then adds the objects whose fat box passes.
+    // Objects in a projection * view frustum.
+    void QueryFrustum(const glm::mat4& viewProjection, std::vector<unsigned int>& objects);
+    // Objects within radius of center.
+    void QuerySphere(glm::vec3 center, float radius, std::vector<unsigned int>& objects);
+    // Objects hit by a ray, up to maxDistance along direction (in multiples of its length).
+    void QueryRay(glm::vec3 origin, glm::vec3 direction, float maxDistance, std::vector<unsigned int>& objects);
+
+    unsigned int GetObject(int proxy);
+    glm::vec3 GetFatBoundsMin(int proxy);
+    glm::vec3 GetFatBoundsMax(int proxy);
+
+    unsigned int GetObjectCount();
+    // Longest path from the root to a leaf, 0 for a single leaf.
+    int GetHeight();
+    // Sum of the surface areas of the internal nodes, divided by the root's.
+    // The expected number of nodes a random ray visits, lower is better.
+    float GetCost();
+};
@@ -0,0 +1,74 @@
+/*
+Title: Object Loading
+File Name: cpuFeatures.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cpuFeatures.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+CpuFeatures::Features CpuFeatures::Detect()
+{
+    Features features = {};
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    features.m_ssse3 = (info[2] & (1 << 9)) != 0;
+    bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    features.m_avx = osSavesAvx && (info[2] & (1 << 28)) != 0;
+
+    if (maxLeaf >= 7 && features.m_avx)
+    {
+        __cpuidex(info, 7, 0);
+        features.m_avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    // These also check that the operating system saves the avx registers.
+    __builtin_cpu_init();
+    features.m_ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    features.m_avx = __builtin_cpu_supports("avx") != 0;
+    features.m_avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+    return features;
+}
+
+const CpuFeatures::Features& CpuFeatures::Get()
+{
+    // A local static is set up on first use, so this works even from other files' static initializers.
+    static Features features = Detect();
+    return features;
+}
+
+bool CpuFeatures::HasSSSE3()
+{
+    return Get().m_ssse3;
+}
+
+bool CpuFeatures::HasAVX()
+{
+    return Get().m_avx;
+}
+
+bool CpuFeatures::HasAVX2()
+{
+    return Get().m_avx2;
+}
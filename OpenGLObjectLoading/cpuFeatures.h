@@ -0,0 +1,44 @@
+/*
+Title: Object Loading
+File Name: cpuFeatures.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+// What the cpu (and the operating system) can run, for code with SIMD paths to pick a loop from.
+// The cpu is only asked once, the first time any of these is called.
+class CpuFeatures
+{
+private:
+    struct Features
+    {
+        bool m_ssse3;
+        bool m_avx;
+        bool m_avx2;
+    };
+
+    // Asks the cpu which instruction sets it has.
+    static Features Detect();
+    static const Features& Get();
+
+public:
+    static bool HasSSSE3();
+    // AVX and AVX2 are also false if the operating system doesn't save the 256 bit registers.
+    static bool HasAVX();
+    static bool HasAVX2();
+};
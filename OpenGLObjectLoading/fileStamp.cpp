@@ -0,0 +1,78 @@
+/*
+Title: Object Loading
+File Name: fileStamp.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "fileStamp.h"
+#include <sys/stat.h>
+
+#define FNV_PRIME 1099511628211ull
+
+bool FileStamp::Make(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return false;
+    }
+
+    m_modifiedTime = (long long)info.st_mtime;
+    m_size = (unsigned long long)info.st_size;
+    m_pathHash = HashPath(path);
+    return true;
+}
+
+void FileStamp::Pack(unsigned int* words) const
+{
+    words[0] = (unsigned int)m_modifiedTime;
+    words[1] = (unsigned int)((unsigned long long)m_modifiedTime >> 32);
+    words[2] = (unsigned int)m_size;
+    words[3] = (unsigned int)(m_size >> 32);
+    words[4] = (unsigned int)m_pathHash;
+    words[5] = (unsigned int)(m_pathHash >> 32);
+}
+
+void FileStamp::Hash(unsigned long long& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+}
+
+void FileStamp::HashString(unsigned long long& hash, const char* string)
+{
+    if (string != nullptr)
+    {
+        for (; *string != 0; string++)
+        {
+            hash ^= (unsigned char)*string;
+            hash *= FNV_PRIME;
+        }
+    }
+    hash *= FNV_PRIME;
+}
+
+unsigned long long FileStamp::HashPath(const std::string& path)
+{
+    unsigned long long hash = FILE_STAMP_HASH_START;
+    Hash(hash, path.data(), path.size());
+    return hash;
+}
@@ -0,0 +1,49 @@
+/*
+Title: Object Loading
+File Name: fileStamp.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <string>
+
+// Starting value of a 64 bit FNV-1a hash.
+#define FILE_STAMP_HASH_START 14695981039346656037ull
+// Number of unsigned ints Pack writes.
+#define FILE_STAMP_WORDS 6
+
+// What a cache file remembers about the source it was made from, so edits to the source are noticed.
+// The mesh, texture, page and program binary caches all stamp and hash the same way.
+class FileStamp
+{
+public:
+    long long m_modifiedTime;
+    unsigned long long m_size;
+    // Tells caches of different source paths apart.
+    unsigned long long m_pathHash;
+
+    // Stamps a file. Returns false if it doesn't exist.
+    bool Make(const std::string& path);
+    // Writes the stamp as FILE_STAMP_WORDS unsigned ints, for headers made of 32 bit words.
+    void Pack(unsigned int* words) const;
+
+    // Adds bytes to a 64 bit FNV-1a hash started at FILE_STAMP_HASH_START.
+    static void Hash(unsigned long long& hash, const void* data, size_t size);
+    // Adds a string and a terminator, so "ab" + "c" hashes differently from "a" + "bc". Null strings hash like empty ones.
+    static void HashString(unsigned long long& hash, const char* string);
+    static unsigned long long HashPath(const std::string& path);
+};
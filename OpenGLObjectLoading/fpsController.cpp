@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 FPSController::FPSController()
 {
     m_transform = Transform3D();
+    m_fieldOfView = .75f;
 }
 
 FPSController::~FPSController()
@@ -38,6 +39,18 @@ Transform3D FPSController::GetTransform()
     return m_transform;
 }
 
+float FPSController::GetFieldOfView()
+{
+    return m_fieldOfView;
+}
+
+float FPSController::GetLodScale(float viewportHeight)
+{
+    // The vertical field of view spans the viewport's height in pixels.
+    // One unit away, that's 2 * tan(fov / 2) units tall.
+    return viewportHeight / (2 * tanf(m_fieldOfView * 0.5f));
+}
+
 void FPSController::Update(GLFWwindow* window, glm::vec2 viewportDimensions, glm::vec2 mousePosition, float deltaTime)
 {
     // Get the distance from the center of the screen that the mouse has moved
@@ -31,11 +31,18 @@ class FPSController {
 
 private:
     Transform3D m_transform;
+    // Vertical field of view of the camera, in radians.
+    float m_fieldOfView;
 
 public:
     FPSController();
     ~FPSController();
     Transform3D GetTransform();
+    float GetFieldOfView();
+
+    // How many pixels one unit covers on screen, one unit in front of the camera, with this camera's field of view.
+    // Dividing by the distance gives the size on screen of something further away, which is used to pick levels of detail.
+    float GetLodScale(float viewportHeight);
     void Update(GLFWwindow* window, glm::vec2 viewportDimensions, glm::vec2 mousePosition, float deltaTime);
 
 
@@ -0,0 +1,335 @@
+/*
+Title: Object Loading
+File Name: frustumCuller.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "frustumCuller.h"
+#include "cpuFeatures.h"
+#include <immintrin.h>
+
+// Lets the AVX loop be compiled for AVX on its own, the rest of the file stays SSE2.
+// MSVC allows AVX intrinsics anywhere, gcc and clang need the function marked.
+#ifdef _MSC_VER
+#define TARGET_AVX
+#else
+#define TARGET_AVX __attribute__((target("avx")))
+#endif
+
+bool FrustumCuller::s_useAvx = CpuFeatures::HasAVX();
+
+FrustumCuller::FrustumCuller()
+{
+    for (int i = 0; i < 6; i++)
+    {
+        m_planes[i] = glm::vec4();
+    }
+}
+
+void FrustumCuller::SetFrustum(const glm::mat4& viewProjection)
+{
+    ExtractPlanes(viewProjection, m_planes);
+}
+
+void FrustumCuller::ExtractPlanes(const glm::mat4& viewProjection, glm::vec4* planes)
+{
+    // A point is inside the frustum if -w <= x, y, z <= w after projection.
+    // Each of those is a dot product of the point with a sum or difference of two matrix rows,
+    // which makes that sum or difference the plane (Gribb and Hartmann).
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+    {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    planes[0] = row[3] + row[0];  // left
+    planes[1] = row[3] - row[0];  // right
+    planes[2] = row[3] + row[1];  // bottom
+    planes[3] = row[3] - row[1];  // top
+    planes[4] = row[3] + row[2];  // near
+    planes[5] = row[3] - row[2];  // far
+
+    // Normalized planes give real distances, so sphere radii can be compared with them.
+    for (int i = 0; i < 6; i++)
+    {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+const glm::vec4& FrustumCuller::GetPlane(unsigned int index)
+{
+    return m_planes[index];
+}
+
+void FrustumCuller::Set(unsigned int index, glm::vec3 center, glm::vec3 halfSize, float radius)
+{
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_halfSizeX[index] = halfSize.x;
+    m_halfSizeY[index] = halfSize.y;
+    m_halfSizeZ[index] = halfSize.z;
+    m_radius[index] = radius;
+}
+
+unsigned int FrustumCuller::AddBox(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    return AddBox(glm::mat4(), boundsMin, boundsMax);
+}
+
+unsigned int FrustumCuller::AddBox(const glm::mat4& matrix, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    // Start a new block of 8 when the last one is full.
+    if (m_count % 8 == 0)
+    {
+        size_t size = m_count + 8;
+        m_centerX.resize(size, 0);
+        m_centerY.resize(size, 0);
+        m_centerZ.resize(size, 0);
+        m_halfSizeX.resize(size, 0);
+        m_halfSizeY.resize(size, 0);
+        m_halfSizeZ.resize(size, 0);
+        m_radius.resize(size, 0);
+    }
+
+    unsigned int index = m_count++;
+    SetBox(index, matrix, boundsMin, boundsMax);
+    return index;
+}
+
+unsigned int FrustumCuller::AddSphere(glm::vec3 center, float radius)
+{
+    unsigned int index = AddBox(center, center);
+    SetSphere(index, center, radius);
+    return index;
+}
+
+void FrustumCuller::SetBox(unsigned int index, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    Set(index, (boundsMin + boundsMax) * 0.5f, (boundsMax - boundsMin) * 0.5f, 0);
+}
+
+void FrustumCuller::SetBox(unsigned int index, const glm::mat4& matrix, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    glm::vec3 movedMin, movedMax;
+    TransformBounds(matrix, boundsMin, boundsMax, movedMin, movedMax);
+    SetBox(index, movedMin, movedMax);
+}
+
+void FrustumCuller::TransformBounds(const glm::mat4& matrix, glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3& movedMin, glm::vec3& movedMax)
+{
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    glm::vec3 halfSize = (boundsMax - boundsMin) * 0.5f;
+
+    // The moved box reaches as far along each axis as its rotated and scaled half size does (Arvo).
+    glm::vec3 movedCenter = glm::vec3(matrix * glm::vec4(center, 1));
+    glm::vec3 movedHalfSize = glm::abs(glm::vec3(matrix[0])) * halfSize.x
+        + glm::abs(glm::vec3(matrix[1])) * halfSize.y
+        + glm::abs(glm::vec3(matrix[2])) * halfSize.z;
+
+    movedMin = movedCenter - movedHalfSize;
+    movedMax = movedCenter + movedHalfSize;
+}
+
+void FrustumCuller::SetSphere(unsigned int index, glm::vec3 center, float radius)
+{
+    Set(index, center, glm::vec3(), radius);
+}
+
+void FrustumCuller::Clear()
+{
+    m_count = 0;
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_halfSizeX.clear();
+    m_halfSizeY.clear();
+    m_halfSizeZ.clear();
+    m_radius.clear();
+    m_visible.clear();
+}
+
+void FrustumCuller::Reserve(unsigned int count)
+{
+    size_t size = (count + 7) / 8 * 8;
+    m_centerX.reserve(size);
+    m_centerY.reserve(size);
+    m_centerZ.reserve(size);
+    m_halfSizeX.reserve(size);
+    m_halfSizeY.reserve(size);
+    m_halfSizeZ.reserve(size);
+    m_radius.reserve(size);
+    m_visible.reserve(count);
+}
+
+unsigned int FrustumCuller::GetCount()
+{
+    return m_count;
+}
+
+void FrustumCuller::Cull(JobSystem* jobs)
+{
+    m_visible.clear();
+
+    if (jobs == nullptr || m_count <= CULL_OBJECTS_PER_JOB)
+    {
+        CullRange(0, m_count, m_visible);
+        return;
+    }
+
+    // Each job fills its own list, and the lists are joined in order at the end.
+    unsigned int jobCount = (m_count + CULL_OBJECTS_PER_JOB - 1) / CULL_OBJECTS_PER_JOB;
+    m_jobVisible.resize(jobCount);
+
+    jobs->ParallelFor(jobCount, 1, [this](unsigned int begin, unsigned int end)
+    {
+        for (unsigned int job = begin; job < end; job++)
+        {
+            unsigned int first = job * CULL_OBJECTS_PER_JOB;
+            unsigned int last = glm::min(first + CULL_OBJECTS_PER_JOB, m_count);
+            m_jobVisible[job].clear();
+            CullRange(first, last, m_jobVisible[job]);
+        }
+    });
+
+    for (unsigned int job = 0; job < jobCount; job++)
+    {
+        m_visible.insert(m_visible.end(), m_jobVisible[job].begin(), m_jobVisible[job].end());
+    }
+}
+
+void FrustumCuller::CullRange(unsigned int begin, unsigned int end, std::vector<unsigned int>& visible)
+{
+    if (s_useAvx)
+        CullRangeAVX(begin, end, visible);
+    else
+        CullRangeSSE(begin, end, visible);
+}
+
+void FrustumCuller::CullRangeSSE(unsigned int begin, unsigned int end, std::vector<unsigned int>& visible)
+{
+    // Every lane gets the same plane, so the planes are spread out once up front.
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm_set1_ps(m_planes[p].x);
+        planeY[p] = _mm_set1_ps(m_planes[p].y);
+        planeZ[p] = _mm_set1_ps(m_planes[p].z);
+        planeW[p] = _mm_set1_ps(m_planes[p].w);
+        absX[p] = _mm_set1_ps(fabs(m_planes[p].x));
+        absY[p] = _mm_set1_ps(fabs(m_planes[p].y));
+        absZ[p] = _mm_set1_ps(fabs(m_planes[p].z));
+    }
+
+    for (unsigned int i = begin; i < end; i += 4)
+    {
+        __m128 centerX = _mm_loadu_ps(&m_centerX[i]);
+        __m128 centerY = _mm_loadu_ps(&m_centerY[i]);
+        __m128 centerZ = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 halfSizeX = _mm_loadu_ps(&m_halfSizeX[i]);
+        __m128 halfSizeY = _mm_loadu_ps(&m_halfSizeY[i]);
+        __m128 halfSizeZ = _mm_loadu_ps(&m_halfSizeZ[i]);
+        __m128 radius = _mm_loadu_ps(&m_radius[i]);
+
+        // Lanes that end up negative are behind at least one plane.
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            // Distance of the center, plus how far the box reaches towards the plane.
+            __m128 distance = _mm_add_ps(_mm_mul_ps(centerX, planeX[p]), planeW[p]);
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerY, planeY[p]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, planeZ[p]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(halfSizeX, absX[p]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(halfSizeY, absY[p]));
+            distance = _mm_add_ps(distance, _mm_mul_ps(halfSizeZ, absZ[p]));
+            distance = _mm_add_ps(distance, radius);
+
+            outside = _mm_or_ps(outside, distance);
+        }
+
+        // The sign bits of the lanes that are inside every plane are clear.
+        int mask = ~_mm_movemask_ps(outside) & 0xF;
+        for (unsigned int lane = 0; mask != 0; lane++, mask >>= 1)
+        {
+            if ((mask & 1) && i + lane < end)
+                visible.push_back(i + lane);
+        }
+    }
+}
+
+TARGET_AVX void FrustumCuller::CullRangeAVX(unsigned int begin, unsigned int end, std::vector<unsigned int>& visible)
+{
+    // Every lane gets the same plane, so the planes are spread out once up front.
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++)
+    {
+        planeX[p] = _mm256_set1_ps(m_planes[p].x);
+        planeY[p] = _mm256_set1_ps(m_planes[p].y);
+        planeZ[p] = _mm256_set1_ps(m_planes[p].z);
+        planeW[p] = _mm256_set1_ps(m_planes[p].w);
+        absX[p] = _mm256_set1_ps(fabs(m_planes[p].x));
+        absY[p] = _mm256_set1_ps(fabs(m_planes[p].y));
+        absZ[p] = _mm256_set1_ps(fabs(m_planes[p].z));
+    }
+
+    for (unsigned int i = begin; i < end; i += 8)
+    {
+        __m256 centerX = _mm256_loadu_ps(&m_centerX[i]);
+        __m256 centerY = _mm256_loadu_ps(&m_centerY[i]);
+        __m256 centerZ = _mm256_loadu_ps(&m_centerZ[i]);
+        __m256 halfSizeX = _mm256_loadu_ps(&m_halfSizeX[i]);
+        __m256 halfSizeY = _mm256_loadu_ps(&m_halfSizeY[i]);
+        __m256 halfSizeZ = _mm256_loadu_ps(&m_halfSizeZ[i]);
+        __m256 radius = _mm256_loadu_ps(&m_radius[i]);
+
+        // Same as the SSE loop, 8 objects at a time.
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(centerX, planeX[p]), planeW[p]);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerY, planeY[p]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerZ, planeZ[p]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(halfSizeX, absX[p]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(halfSizeY, absY[p]));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(halfSizeZ, absZ[p]));
+            distance = _mm256_add_ps(distance, radius);
+
+            outside = _mm256_or_ps(outside, distance);
+        }
+
+        int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+        for (unsigned int lane = 0; mask != 0; lane++, mask >>= 1)
+        {
+            if ((mask & 1) && i + lane < end)
+                visible.push_back(i + lane);
+        }
+    }
+}
+
+const std::vector<unsigned int>& FrustumCuller::GetVisible()
+{
+    return m_visible;
+}
+
+void FrustumCuller::SetUseAvx(bool useAvx)
+{
+    s_useAvx = useAvx && CpuFeatures::HasAVX();
+}
+
+bool FrustumCuller::GetUseAvx()
+{
+    return s_useAvx;
+}
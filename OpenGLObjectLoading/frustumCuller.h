@@ -0,0 +1,103 @@
+/*
+Title: Object Loading
+File Name: frustumCuller.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "glm/glm.hpp"
+#include "jobSystem.h"
+#include <vector>
+
+// Objects handed to each job by Cull. Must be a multiple of 8.
+#define CULL_OBJECTS_PER_JOB 16384
+
+// Tests bounding boxes and spheres against the six planes of a camera's view frustum,
+// and makes a list of the ones that are at least partly inside.
+// Bounds are kept as a structure of arrays, so 4 objects (8 with AVX) are tested at once.
+// Every object is a box (center and half size) grown by a radius, which covers boxes and spheres
+// with the same test: an object is outside a plane if center + |normal| . halfSize + radius is behind it.
+class FrustumCuller
+{
+private:
+    // Use the 8 wide AVX loop, picked at startup from what the cpu supports.
+    static bool s_useAvx;
+
+    // Planes as (normal, distance), with normals pointing into the frustum.
+    glm::vec4 m_planes[6];
+
+    unsigned int m_count = 0;
+
+    // One float per object, padded to a multiple of 8 with empty bounds.
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_halfSizeX;
+    std::vector<float> m_halfSizeY;
+    std::vector<float> m_halfSizeZ;
+    std::vector<float> m_radius;
+
+    // Visible objects from the last Cull, and each job's part of them.
+    std::vector<unsigned int> m_visible;
+    std::vector<std::vector<unsigned int>> m_jobVisible;
+
+    // Adds the visible objects in [begin, end) to visible. begin must be a multiple of 8.
+    void CullRange(unsigned int begin, unsigned int end, std::vector<unsigned int>& visible);
+    void CullRangeSSE(unsigned int begin, unsigned int end, std::vector<unsigned int>& visible);
+    void CullRangeAVX(unsigned int begin, unsigned int end, std::vector<unsigned int>& visible);
+
+    void Set(unsigned int index, glm::vec3 center, glm::vec3 halfSize, float radius);
+
+public:
+    FrustumCuller();
+
+    // Extracts the frustum planes from a projection * view matrix.
+    // Bounds are then tested in world space. With projection * view * world, they are tested in that model's space.
+    void SetFrustum(const glm::mat4& viewProjection);
+    const glm::vec4& GetPlane(unsigned int index);
+
+    // Writes the 6 planes of a projection * view matrix to planes, as (normal, distance) with normals pointing in.
+    // Order is left, right, bottom, top, near, far.
+    static void ExtractPlanes(const glm::mat4& viewProjection, glm::vec4* planes);
+
+    // Finds the axis aligned box around a box that is moved by a matrix.
+    static void TransformBounds(const glm::mat4& matrix, glm::vec3 boundsMin, glm::vec3 boundsMax, glm::vec3& movedMin, glm::vec3& movedMax);
+
+    // Adds an object and returns its index. Indices stay the same until Clear.
+    unsigned int AddBox(glm::vec3 boundsMin, glm::vec3 boundsMax);
+    // Adds a box that is moved by a matrix, as the axis aligned box that contains it.
+    unsigned int AddBox(const glm::mat4& matrix, glm::vec3 boundsMin, glm::vec3 boundsMax);
+    unsigned int AddSphere(glm::vec3 center, float radius);
+
+    void SetBox(unsigned int index, glm::vec3 boundsMin, glm::vec3 boundsMax);
+    void SetBox(unsigned int index, const glm::mat4& matrix, glm::vec3 boundsMin, glm::vec3 boundsMax);
+    void SetSphere(unsigned int index, glm::vec3 center, float radius);
+
+    void Clear();
+    // Makes room for this many objects, so adding them doesn't reallocate.
+    void Reserve(unsigned int count);
+    unsigned int GetCount();
+
+    // Tests every object against the frustum. With a job system, the objects are split across its threads.
+    void Cull(JobSystem* jobs = nullptr);
+
+    // Indices of the objects that passed the last Cull, in increasing order.
+    const std::vector<unsigned int>& GetVisible();
+
+    // Picks the SSE or AVX loop, for comparing them. AVX is only used if the cpu supports it.
+    static void SetUseAvx(bool useAvx);
+    static bool GetUseAvx();
+};
@@ -0,0 +1,215 @@
+/*
+Title: Object Loading
+File Name: glState.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "glState.h"
+
+// Marks a binding we don't know about. No real object has this name.
+static const GLuint c_unknown = 0xFFFFFFFF;
+
+GLuint GLState::s_program = c_unknown;
+GLuint GLState::s_vertexArray = c_unknown;
+GLuint GLState::s_activeTexture = c_unknown;
+GLuint GLState::s_textures[c_textureUnits][c_textureTargets];
+GLuint GLState::s_buffers[c_bufferTargets];
+unsigned int GLState::s_issuedCalls = 0;
+unsigned int GLState::s_elidedCalls = 0;
+
+// Static arrays can't be filled with c_unknown in their definition, so this does it before main runs.
+static struct GLStateInitializer
+{
+    GLStateInitializer() { GLState::Invalidate(); }
+} s_initializer;
+
+int GLState::GetTextureTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+        case GL_TEXTURE_2D:
+            return 0;
+        case GL_TEXTURE_2D_ARRAY:
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+int GLState::GetBufferTargetIndex(GLenum target)
+{
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER:
+            return 0;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return 1;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return 2;
+        case GL_UNIFORM_BUFFER:
+            return 3;
+        case GL_DRAW_INDIRECT_BUFFER:
+            return 4;
+        default:
+            return -1;
+    }
+}
+
+void GLState::UseProgram(GLuint program)
+{
+    if (s_program == program)
+    {
+        s_elidedCalls++;
+        return;
+    }
+
+    glUseProgram(program);
+    s_program = program;
+    s_issuedCalls++;
+}
+
+void GLState::BindVertexArray(GLuint vertexArray)
+{
+    if (s_vertexArray == vertexArray)
+    {
+        s_elidedCalls++;
+        return;
+    }
+
+    glBindVertexArray(vertexArray);
+    s_vertexArray = vertexArray;
+    s_issuedCalls++;
+
+    // The element array buffer binding belongs to the vertex array, so it changed too.
+    s_buffers[GetBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = c_unknown;
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+    int index = GetBufferTargetIndex(target);
+    if (index != -1 && s_buffers[index] == buffer)
+    {
+        s_elidedCalls++;
+        return;
+    }
+
+    glBindBuffer(target, buffer);
+    if (index != -1)
+        s_buffers[index] = buffer;
+    s_issuedCalls++;
+}
+
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int index = GetTextureTargetIndex(target);
+    bool tracked = index != -1 && unit < (GLuint)c_textureUnits;
+    if (tracked && s_textures[unit][index] == texture)
+    {
+        s_elidedCalls++;
+        return;
+    }
+
+    // Textures are bound to the active unit, so switch units first if needed.
+    if (s_activeTexture != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        s_activeTexture = unit;
+        s_issuedCalls++;
+    }
+
+    glBindTexture(target, texture);
+    if (tracked)
+        s_textures[unit][index] = texture;
+    s_issuedCalls++;
+}
+
+void GLState::ForgetProgram(GLuint program)
+{
+    if (s_program == program)
+        s_program = c_unknown;
+}
+
+void GLState::ForgetVertexArray(GLuint vertexArray)
+{
+    if (s_vertexArray == vertexArray)
+    {
+        s_vertexArray = c_unknown;
+        s_buffers[GetBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = c_unknown;
+    }
+}
+
+void GLState::ForgetBuffer(GLuint buffer)
+{
+    for (int i = 0; i < c_bufferTargets; i++)
+    {
+        if (s_buffers[i] == buffer)
+            s_buffers[i] = c_unknown;
+    }
+}
+
+void GLState::ForgetTexture(GLuint texture)
+{
+    for (int unit = 0; unit < c_textureUnits; unit++)
+    {
+        for (int i = 0; i < c_textureTargets; i++)
+        {
+            if (s_textures[unit][i] == texture)
+                s_textures[unit][i] = c_unknown;
+        }
+    }
+}
+
+void GLState::Invalidate()
+{
+    s_program = c_unknown;
+    s_vertexArray = c_unknown;
+    s_activeTexture = c_unknown;
+
+    for (int unit = 0; unit < c_textureUnits; unit++)
+    {
+        for (int i = 0; i < c_textureTargets; i++)
+            s_textures[unit][i] = c_unknown;
+    }
+
+    for (int i = 0; i < c_bufferTargets; i++)
+        s_buffers[i] = c_unknown;
+}
+
+void GLState::CountIssued()
+{
+    s_issuedCalls++;
+}
+
+void GLState::CountElided()
+{
+    s_elidedCalls++;
+}
+
+unsigned int GLState::GetIssuedCalls()
+{
+    return s_issuedCalls;
+}
+
+unsigned int GLState::GetElidedCalls()
+{
+    return s_elidedCalls;
+}
+
+void GLState::ResetStats()
+{
+    s_issuedCalls = 0;
+    s_elidedCalls = 0;
+}
@@ -0,0 +1,74 @@
+/*
+Title: Object Loading
+File Name: glState.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+
+// Shadow copy of the opengl binding state.
+// Every bind in the program goes through here, so calls that wouldn't change anything can be skipped.
+// If some other code binds objects directly, call Invalidate afterwards.
+class GLState
+{
+private:
+    // Number of texture units we keep track of. Units above this are always bound for real.
+    static const int c_textureUnits = 32;
+    // Texture targets we keep track of per unit.
+    static const int c_textureTargets = 2;
+    // Buffer targets we keep track of.
+    static const int c_bufferTargets = 5;
+
+    static GLuint s_program;
+    static GLuint s_vertexArray;
+    static GLuint s_activeTexture;
+    static GLuint s_textures[c_textureUnits][c_textureTargets];
+    static GLuint s_buffers[c_bufferTargets];
+
+    // Calls made and calls skipped since the last ResetStats.
+    static unsigned int s_issuedCalls;
+    static unsigned int s_elidedCalls;
+
+    static int GetTextureTargetIndex(GLenum target);
+    static int GetBufferTargetIndex(GLenum target);
+
+public:
+    // Binds objects, unless they are already bound.
+    static void UseProgram(GLuint program);
+    static void BindVertexArray(GLuint vertexArray);
+    static void BindBuffer(GLenum target, GLuint buffer);
+    static void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    // Deleting an object unbinds it, and its name may be handed out again.
+    // These must be called when an object is deleted, so we don't think it's still bound.
+    static void ForgetProgram(GLuint program);
+    static void ForgetVertexArray(GLuint vertexArray);
+    static void ForgetBuffer(GLuint buffer);
+    static void ForgetTexture(GLuint texture);
+
+    // Forgets everything, the next bind of each kind is always made.
+    static void Invalidate();
+
+    // Lets other state caches (like uniform values) add to the counters.
+    static void CountIssued();
+    static void CountElided();
+
+    // Counters for calls made and skipped, usually reset once per frame.
+    static unsigned int GetIssuedCalls();
+    static unsigned int GetElidedCalls();
+    static void ResetStats();
+};
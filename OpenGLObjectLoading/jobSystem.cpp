@@ -0,0 +1,140 @@
+/*
+Title: Object Loading
+File Name: jobSystem.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "jobSystem.h"
+#include <atomic>
+
+JobSystem::JobSystem(unsigned int threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0)
+        threadCount = 1;
+
+    for (unsigned int i = 0; i < threadCount; i++)
+        m_threads.push_back(std::thread(&JobSystem::WorkerLoop, this));
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); i++)
+        m_threads[i].join();
+}
+
+void JobSystem::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+
+            // Only stop once the queue is empty, so no job is lost.
+            if (m_jobs.empty())
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_unfinishedJobs--;
+            if (m_unfinishedJobs == 0)
+                m_jobsDone.notify_all();
+        }
+    }
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+        m_unfinishedJobs++;
+    }
+    m_jobAvailable.notify_one();
+}
+
+void JobSystem::ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int begin, unsigned int end)>& job)
+{
+    if (count == 0)
+        return;
+    if (batchSize == 0)
+        batchSize = 1;
+
+    // Every thread, including this one, keeps taking the next batch until there are none left.
+    std::atomic<unsigned int> nextBatch(0);
+    unsigned int batchCount = (count + batchSize - 1) / batchSize;
+
+    std::function<void()> takeBatches = [&]()
+    {
+        unsigned int batch;
+        while ((batch = nextBatch++) < batchCount)
+        {
+            unsigned int begin = batch * batchSize;
+            unsigned int end = begin + batchSize < count ? begin + batchSize : count;
+            job(begin, end);
+        }
+    };
+
+    // One helper per worker is enough, more would just find no batches left.
+    std::atomic<unsigned int> helpersLeft(0);
+    std::mutex doneMutex;
+    std::condition_variable done;
+
+    unsigned int helperCount = batchCount - 1 < (unsigned int)m_threads.size() ? batchCount - 1 : (unsigned int)m_threads.size();
+    helpersLeft = helperCount;
+    for (unsigned int i = 0; i < helperCount; i++)
+    {
+        Submit([&]()
+        {
+            takeBatches();
+            std::lock_guard<std::mutex> lock(doneMutex);
+            if (--helpersLeft == 0)
+                done.notify_all();
+        });
+    }
+
+    takeBatches();
+
+    // The helpers reference locals of this function, so wait for all of them.
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&] { return helpersLeft == 0; });
+}
+
+void JobSystem::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_jobsDone.wait(lock, [this] { return m_unfinishedJobs == 0; });
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+    return (unsigned int)m_threads.size();
+}
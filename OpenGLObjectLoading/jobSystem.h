@@ -0,0 +1,70 @@
+/*
+Title: Object Loading
+File Name: jobSystem.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A pool of worker threads that run jobs from a shared queue.
+// Jobs must not touch opengl, the context only belongs to the main thread.
+class JobSystem
+{
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+
+    std::mutex m_mutex;
+    // Signalled when a job is added, or when the pool shuts down.
+    std::condition_variable m_jobAvailable;
+    // Signalled when the last running job finishes.
+    std::condition_variable m_jobsDone;
+
+    // Jobs that are queued or running.
+    unsigned int m_unfinishedJobs = 0;
+    bool m_stopping = false;
+
+    // Loop run by every worker thread.
+    void WorkerLoop();
+
+public:
+    // Starts the worker threads. 0 starts one thread per core.
+    JobSystem(unsigned int threadCount = 0);
+    // Finishes all queued jobs, then stops the threads.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Adds a job to the queue.
+    void Submit(std::function<void()> job);
+
+    // Runs job(i) for every i from 0 to count - 1, split into batches across the workers.
+    // The calling thread helps, and this returns when every batch is done.
+    // Don't call this from inside a job, the workers could end up waiting on each other.
+    void ParallelFor(unsigned int count, unsigned int batchSize, const std::function<void(unsigned int begin, unsigned int end)>& job);
+
+    // Blocks until every submitted job has finished.
+    void Wait();
+
+    unsigned int GetThreadCount();
+};
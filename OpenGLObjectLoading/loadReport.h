@@ -0,0 +1,25 @@
+/*
+Title: Object Loading
+File Name: loadReport.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Set this to 1 to print how long each loading step takes:
+// mesh imports and cache loads, level of detail builds and shader program links.
+// Comparing a first launch against a second one shows what the caches save.
+#define LOAD_TIME_REPORT 0
@@ -32,11 +32,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mesh.h"
 #include "fpsController.h"
 #include "transform3d.h"
+#include "transformSystem.h"
 #include "material.h"
 #include "texture.h"
+#include "glState.h"
+#include "renderQueue.h"
+#include "sceneGraph.h"
+#include "frustumCuller.h"
+#include "boundingVolumeHierarchy.h"
+#include "textureLoader.h"
+#include "textureCache.h"
+#include "benchmarks.h"
 #include <iostream>
 
 
+// Set this above zero to draw the model on a grid of this many by this many copies,
+// all in a single instanced draw. 100 gives a benchmark scene of 10000 instances.
+#define INSTANCE_GRID_SIZE 0
+
+// Set this to 1 to cook the texture into every compressed format at startup, so each one has its cache ready.
+// The speed and quality of the encoders are measured by the textureCompressor benchmark in the test project.
+#define TEXTURE_COOK 0
+
+// Set this to 1 to run the benchmarks at startup and print their results, then exit.
+#define RUN_BENCHMARKS 0
 
 
 // Store the current dimensions of the viewport.
@@ -74,8 +93,19 @@ int main(int argc, char **argv)
 	// Initialize glew
 	glewInit();
 
+#if RUN_BENCHMARKS
+    Benchmarks::MeshLoading();
+    Benchmarks::TextureLoading();
+    Benchmarks::TextureStreaming();
+    Benchmarks::MultiDrawIndirect();
+    glfwTerminate();
+    return 0;
+#endif
+
     // Instead of coding our vertices, we just load them in from this file in the mesh constructor!
-    Mesh* model = new Mesh("../assets/kitten.obj");
+    // The node hierarchy is kept for the scene graph. Instanced draws don't go through the nodes,
+    // so the instanced grid loads the model with the node transforms baked in instead.
+    Mesh* model = new Mesh("../assets/kitten.obj", INSTANCE_GRID_SIZE == 0);
 
     // The transform being used to draw our second shape.
     Transform3D transform;
@@ -86,6 +116,9 @@ int main(int argc, char **argv)
     // Make a first person controller for the camera.
     FPSController controller = FPSController();
 
+	// Save linked shader programs next to the assets, so later launches don't compile them again.
+	ShaderProgram::SetBinaryCacheDirectory("../Assets/");
+
 	// Create Shaders
     Shader* vertexShader = new Shader("../Assets/vertex.glsl", GL_VERTEX_SHADER);
     Shader* fragmentShader = new Shader("../Assets/fragment.glsl", GL_FRAGMENT_SHADER);
@@ -105,9 +138,90 @@ int main(int argc, char **argv)
     shaderProgram->AttachShader(fragmentShader);
 
 
+    // Textures are decoded in the background, and show up once they are uploaded.
+    TextureLoader* textureLoader = new TextureLoader();
+    // The cache shares textures loaded from the same file, and frees unused ones when over its budget.
+    TextureCache* textureCache = new TextureCache(textureLoader);
+
+#if TEXTURE_COOK
+    {
+        JobSystem cookJobs;
+        TextureCompressor::Cook(textureFile1, TextureCompression::BC1, MipmapFilter::Kaiser, &cookJobs);
+        TextureCompressor::Cook(textureFile1, TextureCompression::BC3, MipmapFilter::Kaiser, &cookJobs);
+        TextureCompressor::Cook(textureFile1, TextureCompression::BC7, MipmapFilter::Kaiser, &cookJobs);
+    }
+#endif
+
+    // Sample textures with 8x anisotropy, so surfaces seen at a low angle stay sharp.
+    Texture::SetAnisotropy(8.0f);
+
     // Create a material using a texture for our model
+    // Its mipmaps are built on the loader's worker thread with the sharper Kaiser filter,
+    // then compressed to BC7 and cooked into a cache, so later runs upload it straight from disk.
+    Texture* texture = textureCache->Get(textureFile1, MipmapFilter::Kaiser, TextureCompression::BC7);
     Material* material = new Material(shaderProgram);
-    material->SetTexture(textureFS, new Texture(textureFile1));
+    material->SetTexture(textureFS, texture);
+
+    // Look up the camera uniform once, so setting it every frame doesn't search by name.
+    int cameraViewHandle = material->GetUniformHandle(cameraViewVS);
+
+    // Draws are submitted to this queue, which sorts them to keep state changes low.
+    // It writes the world matrix of each draw to the worldMatrix uniform.
+    RenderQueue renderQueue(worldMatrixVS);
+
+    // The model's nodes hang below a node that places it in the world.
+    // Moving that node moves every node of the model with it.
+    SceneGraph scene;
+    unsigned int modelNode = scene.AddNode(-1, transform.GetMatrix(), "model");
+    scene.AddModel(model, material, modelNode);
+
+    // Skips the scene's draws that are outside the camera's view.
+    FrustumCuller sceneCuller;
+
+#if INSTANCE_GRID_SIZE > 0
+    // The instanced shader reads the world matrix from a vertex attribute instead of a uniform.
+    // It needs its own shader program and material, but shares the fragment shader and texture.
+    Shader* instancedVertexShader = new Shader("../Assets/vertexInstanced.glsl", GL_VERTEX_SHADER);
+    ShaderProgram* instancedShaderProgram = new ShaderProgram();
+    instancedShaderProgram->AttachShader(instancedVertexShader);
+    instancedShaderProgram->AttachShader(fragmentShader);
+
+    Material* instancedMaterial = new Material(instancedShaderProgram);
+    // Asking the cache for the same file again hands back the same texture, without loading it twice.
+    instancedMaterial->SetTexture(textureFS, textureCache->Get(textureFile1, MipmapFilter::Kaiser, TextureCompression::BC7));
+    int instancedCameraViewHandle = instancedMaterial->GetUniformHandle(cameraViewVS);
+
+    // Lay the copies out on a grid, spaced by the size of the model.
+    float spacing = (model->GetBoundsMax().x - model->GetBoundsMin().x) * 1.5f;
+    // The transform system keeps the matrices in one array, which DrawInstanced can use as is.
+    TransformSystem instanceTransforms;
+    instanceTransforms.Reserve(INSTANCE_GRID_SIZE * INSTANCE_GRID_SIZE);
+    for (int x = 0; x < INSTANCE_GRID_SIZE; x++)
+    {
+        for (int z = 0; z < INSTANCE_GRID_SIZE; z++)
+        {
+            instanceTransforms.Add(glm::vec3(x * spacing, 0, -2 - z * spacing));
+        }
+    }
+    instanceTransforms.Update();
+
+    // The copies go into a bounding volume hierarchy, so culling the grid only visits the parts of it near the view.
+    // They don't move, so the tree is built once, and only the matrices of the copies in view go to the instanced draw.
+    BoundingVolumeHierarchy instanceTree;
+    for (unsigned int i = 0; i < instanceTransforms.GetCount(); i++)
+    {
+        glm::vec3 boundsMin, boundsMax;
+        FrustumCuller::TransformBounds(instanceTransforms.GetMatrix(i), model->GetBoundsMin(), model->GetBoundsMax(), boundsMin, boundsMax);
+        instanceTree.Insert(boundsMin, boundsMax, i);
+    }
+    instanceTree.Build();
+    std::vector<unsigned int> visible;
+    // The visible copies, split up by the level of detail they are drawn at.
+    std::vector<glm::mat4> visibleInstances[MESH_MAX_LODS];
+#endif
+
+    // Timer for printing the state change counters.
+    float statsTimer = 0;
 
     // Print instructions to the console.
     std::cout << "Use WASD to move, and the mouse to look around." << std::endl;
@@ -125,20 +239,28 @@ int main(int argc, char **argv)
         float dt = glfwGetTime();
         // Reset the timer.
         glfwSetTime(0);
-        
+
+        // Count state changes for this frame only.
+        GLState::ResetStats();
+
+        // Upload any textures that finished decoding.
+        textureLoader->Update();
+        textureCache->Update();
 
         // Update the player controller
         controller.Update(window, viewportDimensions, mousePosition, dt);
 
         // rotate cube transform
         //transform.RotateY(1.0f * dt);
+        scene.SetLocalMatrix(modelNode, transform.GetMatrix());
+        scene.Update();
 
 
 
         // View matrix.
         glm::mat4 view = controller.GetTransform().GetInverseMatrix();
         // Projection matrix.
-        glm::mat4 projection = glm::perspective(.75f, viewportDimensions.x / viewportDimensions.y, .1f, 100.f);
+        glm::mat4 projection = glm::perspective(controller.GetFieldOfView(), viewportDimensions.x / viewportDimensions.y, .1f, 100.f);
         // Compose view and projection.
         glm::mat4 viewProjection = projection * view;
 
@@ -149,16 +271,52 @@ int main(int argc, char **argv)
         glClearColor(0.0, 0.0, 0.0, 0.0);
 
 
-        // Set the camera and world matrices to the shader
-        // The string names correspond directly to the uniform names within the shader.
-        material->SetMatrix(cameraViewVS, viewProjection);
-        material->SetMatrix(worldMatrixVS, transform.GetMatrix());
-        // Bind the material
-        material->Bind();
-        model->Draw();
-
-		// Stop using the shader program.
-        material->Unbind();
+        // Set the camera matrix to the shader
+        // The handle was looked up from the uniform name within the shader.
+        material->SetMatrix(cameraViewHandle, viewProjection);
+
+        // Submit everything we want to draw, then draw it sorted by state.
+        // There is no need to unbind materials, the next bind skips everything that is already set.
+        // Things far enough away are drawn with fewer triangles, as long as the difference stays under a pixel.
+        float lodScale = controller.GetLodScale(viewportDimensions.y);
+        renderQueue.Begin(controller.GetTransform().Position(), 100.f, lodScale);
+        sceneCuller.SetFrustum(viewProjection);
+        scene.Submit(renderQueue, 0, &sceneCuller);
+        renderQueue.Execute();
+
+#if INSTANCE_GRID_SIZE > 0
+        // Cull the grid, then draw the visible copies with one call for each level of detail.
+        // Each copy picks its own level, so copies further away draw fewer triangles.
+        instanceTree.QueryFrustum(viewProjection, visible);
+        for (unsigned int lod = 0; lod < MESH_MAX_LODS; lod++)
+        {
+            visibleInstances[lod].clear();
+        }
+        for (size_t i = 0; i < visible.size(); i++)
+        {
+            const glm::mat4& worldMatrix = instanceTransforms.GetMatrix(visible[i]);
+            unsigned int lod = model->SelectLod(worldMatrix, controller.GetTransform().Position(), lodScale);
+            visibleInstances[lod].push_back(worldMatrix);
+        }
+
+        if (!visible.empty())
+        {
+            instancedMaterial->SetMatrix(instancedCameraViewHandle, viewProjection);
+            instancedMaterial->Bind();
+            for (unsigned int lod = 0; lod < MESH_MAX_LODS; lod++)
+            {
+                model->DrawInstanced(visibleInstances[lod].data(), (unsigned int)visibleInstances[lod].size(), lod);
+            }
+        }
+#endif
+
+        // Once a second, print how many state changes were made this frame, and how many were skipped.
+        statsTimer += dt;
+        if (statsTimer > 1)
+        {
+            std::cout << "Frame: " << dt * 1000 << "ms GL calls issued: " << GLState::GetIssuedCalls() << " elided: " << GLState::GetElidedCalls() << std::endl;
+            statsTimer = 0;
+        }
 
 		// Swap the backbuffer to the front.
 		glfwSwapBuffers(window);
@@ -169,6 +327,11 @@ int main(int argc, char **argv)
 
     // Free material should free all objects used by material
     delete material;
+#if INSTANCE_GRID_SIZE > 0
+    delete instancedMaterial;
+#endif
+    delete textureCache;
+    delete textureLoader;
 
 	// Free GLFW memory.
 	glfwTerminate();
@@ -0,0 +1,56 @@
+/*
+Title: Object Loading
+File Name: mappedFile.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file.
+// The operating system pages the file in on demand, so the contents can be handed
+// straight to opengl without copying them into our own buffers first.
+class MappedFile
+{
+private:
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    // Windows needs both the file handle and the mapping handle.
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // A mapping owns operating system handles, so it can't be copied.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps the file at the given path. Returns false if it can't be opened.
+    bool Open(const std::string& filePath);
+    // Unmaps the file. Pointers returned by GetData are invalid after this.
+    void Close();
+
+    const unsigned char* GetData();
+    size_t GetSize();
+};
@@ -42,71 +42,167 @@ Material::~Material()
     {
         m_textures[i]->DecRefCount();
     }
+
+    if (m_textureTable != nullptr)
+        m_textureTable->DecRefCount();
 }
 
-void Material::SetTexture(char* name, Texture* texture)
+ShaderProgram* Material::GetShaderProgram()
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    return m_shaderProgram;
+}
 
-    // Request uniform from shader.
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+unsigned int Material::GetTextureSetKey()
+{
+    // Mix the texture names together, in unit order.
+    unsigned int key = 2166136261u;
+    for (size_t i = 0; i < m_textures.size(); i++)
+    {
+        key ^= m_textures[i]->GetGLTexture();
+        key *= 16777619u;
+    }
+    if (m_textureTable != nullptr)
+    {
+        key ^= m_textureTable->GetKey();
+        key *= 16777619u;
+    }
+    return key;
+}
+
+int Material::GetUniformHandle(char* name)
+{
+    int handle = m_shaderProgram->GetUniformHandle(name);
 
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
+    // If there was no uniform, print an error.
+    if (handle == -1)
     {
         std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
-        return;
     }
+    return handle;
+}
+
+MaterialUniformSlot* Material::GetSlot(int handle, GLenum type, const char* setter)
+{
+    // The slot table grows to fit the largest handle used so far.
+    if (handle >= (int)m_uniformSlots.size())
+    {
+        MaterialUniformSlot empty = { 0, -1 };
+        m_uniformSlots.resize(handle + 1, empty);
+    }
+
+    // The first time a uniform is set, its type comes from the shader program.
+    MaterialUniformSlot& slot = m_uniformSlots[handle];
+    if (slot.m_index == -1)
+    {
+        slot.m_type = m_shaderProgram->GetUniformType(handle);
+    }
+
+    // The value lists are per type, so an index from one of them means nothing in another.
+    if (slot.m_type != type)
+    {
+        std::cout << "Uniform: " << m_shaderProgram->GetUniformName(handle) << " can't be set with " << setter << ", it has type 0x" << std::hex << slot.m_type
+            << std::dec << " in the shader program." << std::endl;
+        return nullptr;
+    }
+    return &slot;
+}
+
+void Material::SetTexture(char* name, Texture* texture)
+{
+    SetTexture(GetUniformHandle(name), texture);
+}
+
+void Material::SetTexture(int handle, Texture* texture)
+{
+    // Ignore uniforms that aren't in the shader program.
+    if (handle < 0)
+        return;
+
+    MaterialUniformSlot* slot = GetSlot(handle, GL_SAMPLER_2D, "SetTexture");
+    if (slot == nullptr)
+        return;
 
     texture->IncRefCount();
 
-    // Search through current texture uniforms to find a match.
-    for (int i = 0; i < m_textureUniforms.size(); i++)
+    // If the uniform already has a texture, replace it.
+    if (slot->m_index != -1)
     {
-        // If there's a match replace the texture.
-        if (m_textureUniforms[i] == uniform)
-        {
-            m_textures[i]->DecRefCount();
-            m_textures[i] = texture;
-            return;
-        }
+        m_textures[slot->m_index]->DecRefCount();
+        m_textures[slot->m_index] = texture;
+        return;
     }
 
-    // There is no match, add the new texture.
-    m_textureUniforms.push_back(uniform);
+    // There is no texture yet, add the new texture.
+    slot->m_index = (int)m_textures.size();
+    m_textureHandles.push_back(handle);
     m_textures.push_back(texture);
 }
 
+void Material::SetTextureTable(char* name, TextureTable* table)
+{
+    table->IncRefCount();
+    if (m_textureTable != nullptr)
+        m_textureTable->DecRefCount();
+    m_textureTable = table;
+
+    // Bindless shaders have no sampler uniform, so don't complain if it's missing.
+    m_textureTableHandle = table->IsBindless() ? -1 : GetUniformHandle(name);
+}
+
 void Material::SetMatrix(char* name, glm::mat4 matrix)
 {
-    // Bind shader program
-    m_shaderProgram->Bind();
+    SetMatrix(GetUniformHandle(name), matrix);
+}
 
-    // Request uniform for matrix
-    GLint uniform = glGetUniformLocation(m_shaderProgram->GetGLShaderProgram(), name);
+void Material::SetMatrix(int handle, const glm::mat4& matrix)
+{
+    // Ignore uniforms that aren't in the shader program.
+    if (handle < 0)
+        return;
 
-    // If there was no uniform location, print an error and return from the function.
-    if (uniform == -1)
+    MaterialUniformSlot* slot = GetSlot(handle, GL_FLOAT_MAT4, "SetMatrix");
+    if (slot == nullptr)
+        return;
+
+    // If the uniform already has a matrix, replace it.
+    if (slot->m_index != -1)
     {
-        std::cout << "Uniform: " << name << " not found in shader program." << std::endl;
+        m_matrices[slot->m_index] = matrix;
         return;
     }
 
-    // Search through current matrix uniforms to find a match.
-    for (int i = 0; i < m_matrixUniforms.size(); i++)
+    // There is no matrix yet, add the new matrix.
+    slot->m_index = (int)m_matrices.size();
+    m_matrixHandles.push_back(handle);
+    m_matrices.push_back(matrix);
+}
+
+void Material::SetVector(char* name, glm::vec4 vector)
+{
+    SetVector(GetUniformHandle(name), vector);
+}
+
+void Material::SetVector(int handle, const glm::vec4& vector)
+{
+    // Ignore uniforms that aren't in the shader program.
+    if (handle < 0)
+        return;
+
+    MaterialUniformSlot* slot = GetSlot(handle, GL_FLOAT_VEC4, "SetVector");
+    if (slot == nullptr)
+        return;
+
+    // If the uniform already has a vector, replace it.
+    if (slot->m_index != -1)
     {
-        // If there's a match replace the matrix.
-        if (m_matrixUniforms[i] == uniform)
-        {
-            m_matrices[i] = matrix;
-            return;
-        }
+        m_vectors[slot->m_index] = vector;
+        return;
     }
 
-    // There is no match, add the new matrix.
-    m_matrixUniforms.push_back(uniform);
-    m_matrices.push_back(matrix);
+    // There is no vector yet, add the new vector.
+    slot->m_index = (int)m_vectors.size();
+    m_vectorHandles.push_back(handle);
+    m_vectors.push_back(vector);
 }
 
 
@@ -115,32 +211,49 @@ void Material::Bind()
     m_shaderProgram->Bind();
 
     // Bind all textures
-    for (int i = 0; i < m_textureUniforms.size(); i++)
+    // Textures that are already bound to their unit are skipped by GLState.
+    for (int i = 0; i < m_textureHandles.size(); i++)
     {
-        // This enum value can be incremented to bind to different texture locations
-        glActiveTexture(GL_TEXTURE0 + i);
-
-        // Bind the texture
-        glBindTexture(GL_TEXTURE_2D, m_textures[i]->GetGLTexture());
+        // Bind the texture to texture unit i
+        GLState::BindTexture(i, GL_TEXTURE_2D, m_textures[i]->GetGLTexture());
 
         // Use the the texture from GL_TEXTURE0 + i at the given texture uniform location.
-        glUniform1i(m_textureUniforms[i], i);
+        m_shaderProgram->SetInt(m_textureHandles[i], i);
+    }
+
+    // The texture table goes on the next unit after the textures.
+    if (m_textureTable != nullptr)
+    {
+        GLuint unit = (GLuint)m_textureHandles.size();
+        m_textureTable->Bind(unit);
+        if (m_textureTableHandle >= 0)
+            m_shaderProgram->SetInt(m_textureTableHandle, unit);
     }
 
     // Set all matrix data
-    for (int i = 0; i < m_matrixUniforms.size(); i++)
+    for (int i = 0; i < m_matrixHandles.size(); i++)
+    {
+        glUniformMatrix4fv(m_shaderProgram->GetUniformLocation(m_matrixHandles[i]), 1, GL_FALSE, &(m_matrices[i][0][0]));
+    }
+
+    // Set all vector data
+    for (int i = 0; i < m_vectorHandles.size(); i++)
     {
-        glUniformMatrix4fv(m_matrixUniforms[i], 1, GL_FALSE, &(m_matrices[i][0][0]));
+        glUniform4fv(m_shaderProgram->GetUniformLocation(m_vectorHandles[i]), 1, &(m_vectors[i][0]));
     }
 }
 
 void Material::Unbind()
 {
     // Unbind all owned objects.
-    for (int i = 0; i < m_textureUniforms.size(); i++)
+    // This isn't needed before binding another material, only to leave opengl clean.
+    for (int i = 0; i < m_textureHandles.size(); i++)
+    {
+        GLState::BindTexture(i, GL_TEXTURE_2D, 0);
+    }
+    if (m_textureTable != nullptr && !m_textureTable->IsBindless())
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLState::BindTexture((GLuint)m_textureHandles.size(), GL_TEXTURE_2D_ARRAY, 0);
     }
 
     m_shaderProgram->Unbind();
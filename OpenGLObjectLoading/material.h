@@ -24,9 +24,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #pragma once
 #include "shaderProgram.h"
 #include "texture.h"
+#include "textureTable.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include <vector>
 
+// Where a material keeps the value of one uniform.
+struct MaterialUniformSlot
+{
+    // Type of the uniform in the shader program, like GL_FLOAT_MAT4. 0 until the material sets it.
+    GLenum m_type;
+    // Index of the value in the texture, matrix or vector lists, whichever the type uses.
+    int m_index;
+};
+
 class Material
 {
 
@@ -34,25 +44,64 @@ private:
     // Shader program
     ShaderProgram* m_shaderProgram = nullptr;
 
-    // Texture uniforms in use.
-    std::vector<GLuint> m_textureUniforms;
+    // Texture uniform handles in use.
+    std::vector<int> m_textureHandles;
     // Texture objects.
     std::vector<Texture*> m_textures;
 
-    // Uniform for matrix.
-    std::vector<GLuint> m_matrixUniforms;
+    // Uniform handles for matrices.
+    std::vector<int> m_matrixHandles;
     // Matrices to bind with material.
     std::vector<glm::mat4> m_matrices;
 
+    // Table of textures picked per draw, and the handle of its texture array sampler (-1 for bindless).
+    TextureTable* m_textureTable = nullptr;
+    int m_textureTableHandle = -1;
+
+    // Uniform handles for vectors.
+    std::vector<int> m_vectorHandles;
+    // Vectors to bind with material.
+    std::vector<glm::vec4> m_vectors;
+
+    // For each uniform handle of the shader program, where its value is.
+    // An index of -1 means the material doesn't set that uniform yet.
+    std::vector<MaterialUniformSlot> m_uniformSlots;
+
+    // Returns the slot for a uniform handle, with the uniform's type filled in.
+    // Returns nullptr, and prints an error, if the uniform isn't of the type the setter asks for.
+    MaterialUniformSlot* GetSlot(int handle, GLenum type, const char* setter);
+
 
 public:
     // Create a material using a given shader program.
     // If you want to use a different shader program, create a new material.
     Material(ShaderProgram* shaderProgram);
     ~Material();
+
+    ShaderProgram* GetShaderProgram();
+
+    // Returns a number that is the same for materials that use the same textures in the same units.
+    unsigned int GetTextureSetKey();
+
+    // Returns the handle of a uniform in this material's shader program, or -1 if there is none.
+    // Setting values through a handle skips the name lookup, so use these for anything set every frame.
+    int GetUniformHandle(char* name);
+
+    // Setters only accept uniforms of their type: sampler2D for textures, mat4 for matrices and vec4 for vectors.
+    // Anything else is ignored with an error.
     void SetTexture(char* name, Texture* texture);
+    void SetTexture(int handle, Texture* texture);
+    // Uses a texture table for textures picked per draw, with Mesh::DrawMultiIndirect.
+    // name is the sampler2DArray uniform in texture array mode. Bindless shaders don't have one.
+    void SetTextureTable(char* name, TextureTable* table);
     void SetMatrix(char* name, glm::mat4 matrix);
+    void SetMatrix(int handle, const glm::mat4& matrix);
+    void SetVector(char* name, glm::vec4 vector);
+    void SetVector(int handle, const glm::vec4& vector);
 
+    // Binds the shader program, textures and uniforms.
+    // Anything already bound by the previous material is not bound again.
     void Bind();
+    // Optional, binding the next material works without it.
     void Unbind();
 };
\ No newline at end of file
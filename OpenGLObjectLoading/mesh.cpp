@@ -23,6 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "mesh.h"
+#include "meshCache.h"
+#include "meshSimplifier.h"
+#include "glState.h"
+#include "loadReport.h"
+#include <chrono>
 
 // assimp include files. These three are usually needed.
 #include "assimp/Importer.hpp"	//OO version Header!
@@ -31,26 +36,109 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "assimp/DefaultLogger.hpp"
 #include "assimp/LogStream.hpp"
 
+unsigned int Mesh::s_nextId = 0;
+
+// Indices are relative to their submesh, so only the largest submesh has to fit.
+const void* Mesh::PackIndices(const std::vector<unsigned int>& indices, std::vector<unsigned short>& shortIndices, GLenum& indexType)
+{
+	unsigned int maxIndex = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (indices[i] > maxIndex)
+			maxIndex = indices[i];
+	}
+
+	if (maxIndex > 0xFFFF)
+	{
+		indexType = GL_UNSIGNED_INT;
+		return indices.data();
+	}
+
+	indexType = GL_UNSIGNED_SHORT;
+	shortIndices.assign(indices.begin(), indices.end());
+	return shortIndices.data();
+}
+
+// Adds a node and all of its children to the node table, depth first.
+// Each node's mesh indices are also its submesh indices, since every mesh becomes one submesh.
+static void FlattenNodes(const aiNode* node, int parent, std::vector<MeshNode>& nodes, std::vector<unsigned int>& nodeSubmeshes)
+{
+	MeshNode flat;
+
+	// assimp matrices are row major, glm matrices are column major
+	const aiMatrix4x4& m = node->mTransformation;
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			flat.m_localMatrix[column][row] = m[row][column];
+		}
+	}
+
+	flat.m_parent = parent;
+	flat.m_firstSubmesh = (unsigned int)nodeSubmeshes.size();
+	flat.m_submeshCount = node->mNumMeshes;
+	memset(flat.m_name, 0, sizeof(flat.m_name));
+	strncpy(flat.m_name, node->mName.C_Str(), sizeof(flat.m_name) - 1);
+
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+	{
+		nodeSubmeshes.push_back(node->mMeshes[i]);
+	}
+
+	int index = (int)nodes.size();
+	nodes.push_back(flat);
+
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+	{
+		FlattenNodes(node->mChildren[i], index, nodes, nodeSubmeshes);
+	}
+}
+
 Mesh::Mesh(std::vector<Vertex3dUVNormal> vertices, std::vector<unsigned short> indices)
 {
-	m_vertices = vertices;
-	m_indices = indices;
+	// The whole shape is a single submesh
+	Submesh submesh;
+	submesh.m_baseVertex = 0;
+	submesh.m_firstIndex = 0;
+	submesh.m_indexCount = (unsigned int)indices.size();
+	submesh.m_materialIndex = 0;
+	CalculateBounds(vertices.data(), vertices.size());
+	submesh.m_boundsMin = m_boundsMin;
+	submesh.m_boundsMax = m_boundsMax;
+	m_submeshes.push_back(submesh);
+	CreateRootNode();
+	CreateFullDetailLods();
+
 	// Create the shape by setting up buffers
+	Upload(vertices.data(), vertices.size(), indices.data(), indices.size(), GL_UNSIGNED_SHORT);
+}
 
-	// Set up vertex buffer
-	glGenBuffers(1, &m_vertexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex3dUVNormal), &m_vertices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+Mesh::Mesh(std::vector<Vertex3dUVNormal> vertices, std::vector<unsigned int> indices)
+{
+	// The whole shape is a single submesh
+	Submesh submesh;
+	submesh.m_baseVertex = 0;
+	submesh.m_firstIndex = 0;
+	submesh.m_indexCount = (unsigned int)indices.size();
+	submesh.m_materialIndex = 0;
+	CalculateBounds(vertices.data(), vertices.size());
+	submesh.m_boundsMin = m_boundsMin;
+	submesh.m_boundsMax = m_boundsMax;
+	m_submeshes.push_back(submesh);
+	CreateRootNode();
+	CreateFullDetailLods();
 
-	// Set up index buffer
-	glGenBuffers(1, &m_indexBuffer);
-	glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int), &m_indices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// Only use 32 bit indices if the shape is too big for 16 bits
+	GLenum indexType;
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = PackIndices(indices, shortIndices, indexType);
+
+	// Create the shape by setting up buffers
+	Upload(vertices.data(), vertices.size(), indexData, indices.size(), indexType);
 }
 
-Mesh::Mesh(std::string filePath)
+Mesh::Mesh(std::string filePath, bool keepHierarchy)
 {
     // before we do anything, lets first check if the file even exists:
     std::ifstream file(filePath);
@@ -62,75 +150,163 @@ Mesh::Mesh(std::string filePath)
         return;
     }
 
+	unsigned int flags = GetImportFlags(keepHierarchy);
+
+	// If the model was loaded before, there is a binary copy of the final buffers next to it.
+	// The cache is memory mapped and uploaded straight to opengl, skipping assimp completely.
+#if LOAD_TIME_REPORT
+	auto start = std::chrono::high_resolution_clock::now();
+#endif
+	MeshCache cache;
+	if (cache.Open(filePath, flags))
+	{
+		m_boundsMin = cache.GetBoundsMin();
+		m_boundsMax = cache.GetBoundsMax();
+		m_submeshes.assign(cache.GetSubmeshes(), cache.GetSubmeshes() + cache.GetSubmeshCount());
+		m_lods.assign(cache.GetLods(), cache.GetLods() + cache.GetLodCount());
+		m_nodes.assign(cache.GetNodes(), cache.GetNodes() + cache.GetNodeCount());
+		m_nodeSubmeshes.assign(cache.GetNodeSubmeshes(), cache.GetNodeSubmeshes() + cache.GetNodeSubmeshCount());
+		Upload(cache.GetVertices(), cache.GetVertexCount(), cache.GetIndices(), cache.GetIndexCount(), cache.GetIndexType());
+#if LOAD_TIME_REPORT
+		std::cout << "Mesh " << filePath << " loaded from cache in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << "ms" << std::endl;
+#endif
+		return;
+	}
+
 	// create variables
 	Assimp::Importer importer;
 	const aiScene* scene = NULL;
 	unsigned int n = 0, t;
+	std::vector<Vertex3dUVNormal> vertices;
+	std::vector<unsigned int> indices;
 	
 	// Load the file into a "scene"
-	for(int k = 0; k < 1; k++)
-	scene = importer.ReadFile(filePath, aiProcessPreset_TargetRealtime_Quality | aiProcess_PreTransformVertices);
+	scene = importer.ReadFile(filePath, flags);
 
-	// only one mesh in the file, because its a simple tutorial
-	const struct aiMesh* mesh = scene->mMeshes[0];
+	if (scene == NULL)
+	{
+		std::cout << "Can't import file: " << filePath << " " << importer.GetErrorString() << std::endl;
+		return;
+	}
 
-	// make the vertex buffer
-	for (t = 0; t < mesh->mNumVertices; ++t)
+	// Every mesh in the scene goes into the same vertex and index buffer.
+	// Each one remembers where its part of the buffers starts in the submesh table.
+	for (n = 0; n < scene->mNumMeshes; ++n)
 	{
-		// make a vertex
-		Vertex3dUVNormal v;
-		
-		// copy from arrays to each vertex
-		memcpy(&v.m_position, 	&mesh->mVertices[t], 		sizeof(glm::vec3));
-		memcpy(&v.m_normal, 	&mesh->mNormals[t], 		sizeof(glm::vec3));
-		memcpy(&v.m_texCoord, 	&mesh->mTextureCoords[0][t],sizeof(glm::vec2));
+		const struct aiMesh* mesh = scene->mMeshes[n];
+
+		Submesh submesh;
+		submesh.m_baseVertex = (unsigned int)vertices.size();
+		submesh.m_firstIndex = (unsigned int)indices.size();
+		submesh.m_materialIndex = mesh->mMaterialIndex;
+
+		// Each submesh gets its own bounds, so it can be culled on its own.
+		submesh.m_boundsMin = submesh.m_boundsMax = glm::vec3();
+		if (mesh->mNumVertices > 0)
+			submesh.m_boundsMin = glm::vec3(mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z);
+		submesh.m_boundsMax = submesh.m_boundsMin;
+
+		// make the vertex buffer
+		for (t = 0; t < mesh->mNumVertices; ++t)
+		{
+			// make a vertex
+			Vertex3dUVNormal v;
+			
+			// copy from arrays to each vertex
+			// not every mesh has normals and uvs, so those default to zero
+			memcpy(&v.m_position, 	&mesh->mVertices[t], 		sizeof(glm::vec3));
+			submesh.m_boundsMin = glm::min(submesh.m_boundsMin, v.m_position);
+			submesh.m_boundsMax = glm::max(submesh.m_boundsMax, v.m_position);
+			v.m_normal = glm::vec3();
+			v.m_texCoord = glm::vec2();
+			if (mesh->HasNormals())
+				memcpy(&v.m_normal, 	&mesh->mNormals[t], 		sizeof(glm::vec3));
+			if (mesh->HasTextureCoords(0))
+				memcpy(&v.m_texCoord, 	&mesh->mTextureCoords[0][t],sizeof(glm::vec2));
+			
+			// add to vertex buffer
+			vertices.push_back(v);
+		}
+
+		// make the index buffer
+		// indices stay relative to the submesh, the base vertex is added when drawing
+		for (t = 0; t < mesh->mNumFaces; ++t) 
+		{
+			const struct aiFace* face = &mesh->mFaces[t];
+
+			 // points and lines can't be drawn as triangles, skip them
+			 if (face->mNumIndices < 3)
+				 continue;
 		
-		// add to vertex buffer
-		m_vertices.push_back(v);
+			 // add the first 3 indices of the face to our index collection to form a triangle
+			 for (int i = 0; i < 3; i++)
+			 {
+				 indices.push_back(face->mIndices[i]);
+			 }
+			 
+			 // the face is a quad, add 3 more vertices to form a triangle
+			 if (face->mNumIndices == 4)
+			 {
+				 indices.push_back(face->mIndices[0]);
+				 indices.push_back(face->mIndices[2]);
+				 indices.push_back(face->mIndices[3]);
+			 }
+		}
+
+		submesh.m_indexCount = (unsigned int)indices.size() - submesh.m_firstIndex;
+		m_submeshes.push_back(submesh);
 	}
 
-	// make the index buffer
-	for (t = 0; t < mesh->mNumFaces; ++t) 
-	{
-		const struct aiFace* face = &mesh->mFaces[t];
-	
-		 // add the first 3 indices of the face to our index collection to form a triangle
-		 for (int i = 0; i < 3; i++)
-		 {
-			 m_indices.push_back(face->mIndices[i]);
-		 }
-		 
-		 // the face is a quad, add 3 more vertices to form a triangle
-		 if (face->mNumIndices == 4)
-		 {
-			 m_indices.push_back(face->mIndices[0]);
-			 m_indices.push_back(face->mIndices[2]);
-			 m_indices.push_back(face->mIndices[3]);
-		 }
-	}
-
-	printf("%d %d\n", (int)m_vertices.size(), (int)m_indices.size());
+	// With the transforms baked in, this is just the root node holding every mesh.
+	FlattenNodes(scene->mRootNode, -1, m_nodes, m_nodeSubmeshes);
 
-    // create buffers for opengl just like normal
+	// The vertices of a kept hierarchy are relative to their nodes, so the bounds have to go through the nodes.
+	if (keepHierarchy)
+		CalculateNodeBounds(vertices.data(), vertices.size());
+	else
+		CalculateBounds(vertices.data(), vertices.size());
 
-	// Set up vertex buffer
-    glGenBuffers(1, &m_vertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex3dUVNormal), &m_vertices[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// The levels of detail go after the full detail indices, so the cache saves them with everything else.
+	BuildLods(vertices, indices);
+
+	// Small models keep 16 bit indices, which halves the size of the index buffer.
+	// Models with a submesh over 65536 vertices get 32 bit indices, so they don't wrap around.
+	GLenum indexType;
+	std::vector<unsigned short> shortIndices;
+	const void* indexData = PackIndices(indices, shortIndices, indexType);
 
-    // Set up index buffer
-    glGenBuffers(1, &m_indexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned short), &m_indices[0], GL_STATIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// Save the buffers so the next launch doesn't need assimp.
+	if (!MeshCache::Write(filePath, flags, vertices, indexData, (unsigned int)indices.size(), indexType, m_submeshes, m_lods, m_nodes, m_nodeSubmeshes, m_boundsMin, m_boundsMax))
+	{
+		std::cout << "Can't write mesh cache: " << MeshCache::GetCachePath(filePath, flags) << std::endl;
+	}
+
+    // create buffers for opengl just like normal
+	Upload(vertices.data(), vertices.size(), indexData, indices.size(), indexType);
+#if LOAD_TIME_REPORT
+	std::cout << "Mesh " << filePath << " imported in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() << "ms" << std::endl;
+#endif
 }
 
 Mesh::~Mesh()
 {
 	// Clear buffers for the shape object when done using them.
+	glDeleteVertexArrays(1, &m_vertexArray);
 	glDeleteBuffers(1, &m_vertexBuffer);
 	glDeleteBuffers(1, &m_indexBuffer);
+	glDeleteBuffers(1, &m_instanceBuffer);
+	glDeleteVertexArrays(1, &m_multiDrawArray);
+	glDeleteBuffers(1, &m_drawInstanceBuffer);
+	glDeleteBuffers(1, &m_indirectBuffer);
+	GLState::ForgetVertexArray(m_vertexArray);
+	GLState::ForgetBuffer(m_vertexBuffer);
+	GLState::ForgetBuffer(m_indexBuffer);
+	GLState::ForgetBuffer(m_instanceBuffer);
+	GLState::ForgetVertexArray(m_multiDrawArray);
+	GLState::ForgetBuffer(m_drawInstanceBuffer);
+	GLState::ForgetBuffer(m_indirectBuffer);
 }
 
 // This macro will help us make the attribute pointers
@@ -138,13 +314,41 @@ Mesh::~Mesh()
 #define SetupAttribute(index, size, type, structure, element) \
 	glVertexAttribPointer(index, size, type, 0, sizeof(structure), (void*)offsetof(structure, element)); \
 
-void Mesh::Draw()
+void Mesh::Upload(const Vertex3dUVNormal* vertices, size_t vertexCount, const void* indices, size_t indexCount, GLenum indexType)
 {
-	// Previously, we multiplied each vertex one by one, but now we just have to send the world matrix to the gpu.
+	m_indexCount = (GLsizei)indexCount;
+	m_indexType = indexType;
+
+	// Set up vertex buffer
+	glGenBuffers(1, &m_vertexBuffer);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex3dUVNormal), vertices, GL_STATIC_DRAW);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Set up index buffer
+	glGenBuffers(1, &m_indexBuffer);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, indexCount * GetIndexSize(indexType), indices, GL_STATIC_DRAW);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Set up the vertex array object
+	// It remembers the buffers and attribute layout, so drawing only has to bind it.
+	glGenVertexArrays(1, &m_vertexArray);
+	GLState::BindVertexArray(m_vertexArray);
+	SetupVertexAttributes();
+
+	// Unbind the vertex array first, so unbinding the buffers doesn't change it.
+	GLState::BindVertexArray(0);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
+void Mesh::SetupVertexAttributes()
+{
 	// Bind Vertex Buffer and Index Buffer
-	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	// The index buffer binding is stored in the vertex array.
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
 
 	// Setup Vertex Attributes
 	SetupAttribute(0, 3, GL_FLOAT, Vertex3dUVNormal, m_position);
@@ -154,16 +358,424 @@ void Mesh::Draw()
 	// Enable all attrubutes
 	for (int i = 0; i < 3; i++)
 		glEnableVertexAttribArray(i);
+}
 
-	// Draw all indices in the index buffer
-	glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_SHORT, (void*)0);
+void Mesh::CalculateBounds(const Vertex3dUVNormal* vertices, size_t vertexCount)
+{
+	// An empty mesh just gets empty bounds at the origin.
+	m_boundsMin = m_boundsMax = glm::vec3();
+	if (vertexCount == 0)
+		return;
 
-	// Unbind Vertex Buffer and Index Buffer
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	m_boundsMin = m_boundsMax = vertices[0].m_position;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		m_boundsMin = glm::min(m_boundsMin, vertices[i].m_position);
+		m_boundsMax = glm::max(m_boundsMax, vertices[i].m_position);
+	}
+}
 
-	// Disable all attributes (enabled in the macro)
-	for (int i = 0; i < 3; i++)
-		glDisableVertexAttribArray(i);
+void Mesh::CalculateNodeBounds(const Vertex3dUVNormal* vertices, size_t vertexCount)
+{
+	m_boundsMin = m_boundsMax = glm::vec3();
+	bool empty = true;
+
+	// Parents come first, so their model matrix is ready by the time a child needs it.
+	std::vector<glm::mat4> modelMatrices(m_nodes.size());
+	for (size_t n = 0; n < m_nodes.size(); n++)
+	{
+		const MeshNode& node = m_nodes[n];
+		modelMatrices[n] = node.m_parent < 0 ? node.m_localMatrix : modelMatrices[node.m_parent] * node.m_localMatrix;
+
+		for (unsigned int i = 0; i < node.m_submeshCount; i++)
+		{
+			// A submesh's vertices end where the next submesh's begin
+			unsigned int index = m_nodeSubmeshes[node.m_firstSubmesh + i];
+			size_t first = m_submeshes[index].m_baseVertex;
+			size_t end = index + 1 < m_submeshes.size() ? m_submeshes[index + 1].m_baseVertex : vertexCount;
+
+			for (size_t v = first; v < end; v++)
+			{
+				glm::vec3 position = glm::vec3(modelMatrices[n] * glm::vec4(vertices[v].m_position, 1.0f));
+				if (empty)
+				{
+					m_boundsMin = m_boundsMax = position;
+					empty = false;
+				}
+				m_boundsMin = glm::min(m_boundsMin, position);
+				m_boundsMax = glm::max(m_boundsMax, position);
+			}
+		}
+	}
+}
+
+unsigned int Mesh::GetId()
+{
+	return m_id;
+}
+
+unsigned int Mesh::GetIndexSize(GLenum indexType)
+{
+	return indexType == GL_UNSIGNED_INT ? sizeof(unsigned int) : sizeof(unsigned short);
+}
+
+GLenum Mesh::GetIndexType()
+{
+	return m_indexType;
+}
+
+glm::vec3 Mesh::GetBoundsMin()
+{
+	return m_boundsMin;
+}
+
+glm::vec3 Mesh::GetBoundsMax()
+{
+	return m_boundsMax;
+}
+
+void Mesh::Draw(unsigned int lod)
+{
+	// Previously, we multiplied each vertex one by one, but now we just have to send the world matrix to the gpu.
+
+	// Bind the vertex array, which brings the buffers and attribute setup with it.
+	// It is left bound, the next mesh just binds its own.
+	GLState::BindVertexArray(m_vertexArray);
+
+	// Draw every submesh out of the shared buffers
+	for (size_t i = 0; i < m_submeshes.size(); i++)
+		DrawSubmeshElements(m_submeshes[i], 1, lod);
+}
+
+void Mesh::DrawSubmesh(unsigned int index, unsigned int lod)
+{
+	GLState::BindVertexArray(m_vertexArray);
+	DrawSubmeshElements(m_submeshes[index], 1, lod);
+}
 
+void Mesh::CreateInstanceBuffer()
+{
+	glGenBuffers(1, &m_instanceBuffer);
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+
+	// A mat4 attribute takes up 4 attribute locations, one for each column.
+	// The divisor makes each column advance once per instance instead of once per vertex.
+	for (int i = 0; i < 4; i++)
+	{
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, 0, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * i));
+		glVertexAttribDivisor(3 + i, 1);
+		glEnableVertexAttribArray(3 + i);
+	}
+}
+
+void Mesh::DrawInstanced(const glm::mat4* worldMatrices, unsigned int count, unsigned int lod)
+{
+	if (count == 0)
+		return;
+
+	GLState::BindVertexArray(m_vertexArray);
+
+	if (m_instanceBuffer == 0)
+		CreateInstanceBuffer();
+
+	// Stream the matrices into the instance buffer.
+	// Respecifying the storage first lets the driver hand us fresh memory,
+	// instead of waiting for draws that still read last frame's matrices.
+	size_t size = count * sizeof(glm::mat4);
+	if (size > m_instanceBufferSize)
+		m_instanceBufferSize = size;
+
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_instanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, worldMatrices);
+
+	// One draw call per submesh draws every instance.
+	for (size_t i = 0; i < m_submeshes.size(); i++)
+		DrawSubmeshElements(m_submeshes[i], count, lod);
+}
+
+void Mesh::CreateMultiDrawArray()
+{
+	glGenBuffers(1, &m_drawInstanceBuffer);
+	glGenBuffers(1, &m_indirectBuffer);
+
+	glGenVertexArrays(1, &m_multiDrawArray);
+	GLState::BindVertexArray(m_multiDrawArray);
+	SetupVertexAttributes();
+
+	// The world matrix takes attributes 3 to 6, like the instanced vertex array.
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_drawInstanceBuffer);
+	for (int i = 0; i < 4; i++)
+	{
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, 0, sizeof(DrawInstance), (void*)(offsetof(DrawInstance, m_worldMatrix) + sizeof(glm::vec4) * i));
+		glVertexAttribDivisor(3 + i, 1);
+		glEnableVertexAttribArray(3 + i);
+	}
+
+	// The texture index is an integer attribute, so it needs the I version to not be turned into a float.
+	glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(DrawInstance), (void*)offsetof(DrawInstance, m_textureIndex));
+	glVertexAttribDivisor(7, 1);
+	glEnableVertexAttribArray(7);
+}
+
+void Mesh::DrawMultiIndirect(const DrawInstance* instances, unsigned int count)
+{
+	if (count == 0)
+		return;
+
+	if (m_multiDrawArray == 0)
+		CreateMultiDrawArray();
+
+	GLState::BindVertexArray(m_multiDrawArray);
+
+	// One draw for each submesh of each instance.
+	// The base instance picks the instance's data, since instanced attributes start reading at it.
+	m_commands.clear();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		for (size_t j = 0; j < m_submeshes.size(); j++)
+		{
+			DrawElementsIndirectCommand command;
+			command.m_count = m_submeshes[j].m_indexCount;
+			command.m_instanceCount = 1;
+			command.m_firstIndex = m_submeshes[j].m_firstIndex;
+			command.m_baseVertex = m_submeshes[j].m_baseVertex;
+			command.m_baseInstance = i;
+			m_commands.push_back(command);
+		}
+	}
+
+	// Stream the instances and commands, respecifying the storage like DrawInstanced does.
+	size_t instanceSize = count * sizeof(DrawInstance);
+	if (instanceSize > m_drawInstanceBufferSize)
+		m_drawInstanceBufferSize = instanceSize;
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_drawInstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_drawInstanceBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceSize, instances);
+
+	size_t commandSize = m_commands.size() * sizeof(DrawElementsIndirectCommand);
+	if (commandSize > m_indirectBufferSize)
+		m_indirectBufferSize = commandSize;
+	GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_indirectBufferSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandSize, m_commands.data());
+
+	if (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect)
+	{
+		glMultiDrawElementsIndirect(GL_TRIANGLES, m_indexType, NULL, (GLsizei)m_commands.size(), 0);
+	}
+	else
+	{
+		// Without multi draw, issue the same draws one at a time.
+		for (size_t i = 0; i < m_commands.size(); i++)
+		{
+			const DrawElementsIndirectCommand& command = m_commands[i];
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.m_count, m_indexType,
+				(void*)((size_t)command.m_firstIndex * GetIndexSize(m_indexType)), 1, command.m_baseVertex, command.m_baseInstance);
+		}
+	}
+}
+
+void Mesh::DrawSubmeshElements(const Submesh& submesh, GLsizei instanceCount, unsigned int lod)
+{
+	// Every level of detail uses the same vertices, so only the index range changes.
+	const MeshLod& level = m_lods[submesh.m_firstLod + glm::min(lod, submesh.m_lodCount - 1)];
+
+	// The indices of each submesh start at zero, so the base vertex moves them to the right part of the vertex buffer.
+	// This also keeps the indices small enough for 16 bits, even when the whole buffer isn't.
+	void* offset = (void*)((size_t)level.m_firstIndex * GetIndexSize(m_indexType));
+
+	if (instanceCount == 1)
+		glDrawElementsBaseVertex(GL_TRIANGLES, level.m_indexCount, m_indexType, offset, submesh.m_baseVertex);
+	else
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, level.m_indexCount, m_indexType, offset, instanceCount, submesh.m_baseVertex);
+}
+
+unsigned int Mesh::GetImportFlags(bool keepHierarchy)
+{
+	// The post processing flags change what assimp gives us, so they are part of the cache key.
+	// Baking the node transforms into the vertices flattens the model, so it is skipped to keep the hierarchy.
+	unsigned int flags = aiProcessPreset_TargetRealtime_Quality;
+	if (!keepHierarchy)
+		flags |= aiProcess_PreTransformVertices;
+	return flags;
+}
+
+unsigned int Mesh::GetSubmeshCount()
+{
+	return (unsigned int)m_submeshes.size();
+}
+
+const Submesh& Mesh::GetSubmesh(unsigned int index)
+{
+	return m_submeshes[index];
+}
+
+void Mesh::CreateRootNode()
+{
+	MeshNode root;
+	root.m_localMatrix = glm::mat4();
+	root.m_parent = -1;
+	root.m_firstSubmesh = 0;
+	root.m_submeshCount = (unsigned int)m_submeshes.size();
+	memset(root.m_name, 0, sizeof(root.m_name));
+	m_nodes.push_back(root);
+
+	for (unsigned int i = 0; i < m_submeshes.size(); i++)
+	{
+		m_nodeSubmeshes.push_back(i);
+	}
+}
+
+void Mesh::CreateFullDetailLods()
+{
+	for (size_t i = 0; i < m_submeshes.size(); i++)
+	{
+		MeshLod lod;
+		lod.m_firstIndex = m_submeshes[i].m_firstIndex;
+		lod.m_indexCount = m_submeshes[i].m_indexCount;
+		lod.m_error = 0;
+
+		m_submeshes[i].m_firstLod = (unsigned int)m_lods.size();
+		m_submeshes[i].m_lodCount = 1;
+		m_lods.push_back(lod);
+	}
+}
+
+void Mesh::BuildLods(const std::vector<Vertex3dUVNormal>& vertices, std::vector<unsigned int>& indices)
+{
+#if LOAD_TIME_REPORT
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t fullIndexCount = indices.size();
+#endif
+
+	for (size_t i = 0; i < m_submeshes.size(); i++)
+	{
+		Submesh& submesh = m_submeshes[i];
+
+		// Level 0 is the submesh itself.
+		MeshLod full;
+		full.m_firstIndex = submesh.m_firstIndex;
+		full.m_indexCount = submesh.m_indexCount;
+		full.m_error = 0;
+		submesh.m_firstLod = (unsigned int)m_lods.size();
+		submesh.m_lodCount = 1;
+		m_lods.push_back(full);
+
+		// The simplifier only needs the submesh's own vertices, since its indices are relative to them.
+		size_t firstVertex = submesh.m_baseVertex;
+		size_t endVertex = i + 1 < m_submeshes.size() ? m_submeshes[i + 1].m_baseVertex : vertices.size();
+		if (submesh.m_indexCount == 0 || endVertex == firstVertex)
+			continue;
+
+		MeshSimplifier simplifier(&vertices[firstVertex], (unsigned int)(endVertex - firstVertex));
+		simplifier.SetIndices(&indices[submesh.m_firstIndex], submesh.m_indexCount);
+		float maxError = glm::length(submesh.m_boundsMax - submesh.m_boundsMin) * MESH_LOD_MAX_ERROR;
+
+		// Each level carries on simplifying from the one before, until it stops getting much smaller.
+		size_t previousCount = submesh.m_indexCount;
+		while (submesh.m_lodCount < MESH_MAX_LODS)
+		{
+			size_t target = (size_t)(previousCount / 3 * MESH_LOD_REDUCTION) * 3;
+			float error = simplifier.Simplify(target, maxError);
+			const std::vector<unsigned int>& simplified = simplifier.GetIndices();
+			if (simplified.empty() || simplified.size() > previousCount * MESH_LOD_MIN_REDUCTION)
+				break;
+
+			MeshLod lod;
+			lod.m_firstIndex = (unsigned int)indices.size();
+			lod.m_indexCount = (unsigned int)simplified.size();
+			lod.m_error = error;
+			m_lods.push_back(lod);
+			submesh.m_lodCount++;
+
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			previousCount = simplified.size();
+		}
+	}
+
+#if LOAD_TIME_REPORT
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	double trianglesPerSecond = milliseconds > 0 ? fullIndexCount / 3 / (milliseconds / 1000) : 0;
+	std::cout << "Built levels of detail: " << fullIndexCount / 3 << " triangles, "
+		<< (indices.size() - fullIndexCount) / 3 << " more in the simplified levels, "
+		<< milliseconds << "ms (" << trianglesPerSecond << " triangles/s)" << std::endl;
+#endif
+}
+
+unsigned int Mesh::GetLodCount()
+{
+	unsigned int count = 0;
+	for (size_t i = 0; i < m_submeshes.size(); i++)
+	{
+		count = glm::max(count, m_submeshes[i].m_lodCount);
+	}
+	return count;
+}
+
+unsigned int Mesh::GetLodCount(unsigned int submesh)
+{
+	return m_submeshes[submesh].m_lodCount;
+}
+
+const MeshLod& Mesh::GetLod(unsigned int submesh, unsigned int level)
+{
+	return m_lods[m_submeshes[submesh].m_firstLod + level];
+}
+
+unsigned int Mesh::SelectLod(const glm::mat4& worldMatrix, glm::vec3 cameraPosition, float lodScale, int submesh)
+{
+	if (lodScale <= 0)
+		return 0;
+
+	// Errors grow with the largest scale of the world matrix.
+	float scale = glm::max(glm::max(glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1]))), glm::length(glm::vec3(worldMatrix[2])));
+
+	// The distance to the nearest point of the bounding sphere, so big meshes don't drop detail right in front of the camera.
+	glm::vec3 boundsMin = submesh < 0 ? m_boundsMin : m_submeshes[submesh].m_boundsMin;
+	glm::vec3 boundsMax = submesh < 0 ? m_boundsMax : m_submeshes[submesh].m_boundsMax;
+	glm::vec3 center = glm::vec3(worldMatrix * glm::vec4((boundsMin + boundsMax) * 0.5f, 1));
+	float radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+	float distance = glm::length(center - cameraPosition) - radius;
+	if (distance <= 0)
+		return 0;
+
+	// An error of one unit covers this many pixels.
+	float pixels = lodScale * scale / distance;
+
+	// Levels only get coarser, so stop at the first one that shows too much error.
+	unsigned int first = submesh < 0 ? 0 : (unsigned int)submesh;
+	unsigned int end = submesh < 0 ? (unsigned int)m_submeshes.size() : first + 1;
+	unsigned int lodCount = submesh < 0 ? GetLodCount() : m_submeshes[submesh].m_lodCount;
+	unsigned int level = 0;
+	while (level + 1 < lodCount)
+	{
+		bool fits = true;
+		for (unsigned int i = first; i < end; i++)
+		{
+			const Submesh& part = m_submeshes[i];
+			float error = m_lods[part.m_firstLod + glm::min(level + 1, part.m_lodCount - 1)].m_error;
+			if (error * pixels > MESH_LOD_PIXEL_ERROR)
+				fits = false;
+		}
+		if (!fits)
+			break;
+		level++;
+	}
+	return level;
+}
+
+unsigned int Mesh::GetNodeCount()
+{
+	return (unsigned int)m_nodes.size();
+}
+
+const MeshNode& Mesh::GetNode(unsigned int index)
+{
+	return m_nodes[index];
+}
+
+unsigned int Mesh::GetNodeSubmesh(unsigned int index)
+{
+	return m_nodeSubmeshes[index];
 }
@@ -32,6 +32,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <iostream>
 #include <fstream>
 
+// Most levels of detail a submesh can have, counting the full detail one.
+#define MESH_MAX_LODS 5
+// Each level of detail aims for this fraction of the triangles of the one before it.
+#define MESH_LOD_REDUCTION 0.5f
+// A level that can't get below this fraction of the one before it is not worth keeping, and ends the chain.
+#define MESH_LOD_MIN_REDUCTION 0.9f
+// Largest error a level of detail may have, as a fraction of the size of its submesh.
+#define MESH_LOD_MAX_ERROR 0.05f
+// Largest error, in pixels, that a level of detail may show on screen before a finer one is picked.
+#define MESH_LOD_PIXEL_ERROR 1.0f
 
 //struct for vertex with uv
 struct Vertex3dUVNormal
@@ -51,30 +61,218 @@ struct Vertex3dUVNormal
 	Vertex3dUVNormal() {}
 };
 
+// A range of the shared vertex and index buffers.
+// Each mesh inside a model file becomes one submesh.
+struct Submesh
+{
+	unsigned int m_baseVertex;		// first vertex of the submesh, added to every index
+	unsigned int m_firstIndex;		// first index of the submesh in the index buffer
+	unsigned int m_indexCount;		// number of indices to draw
+	unsigned int m_materialIndex;	// material index from the model file
+	glm::vec3 m_boundsMin;			// axis aligned bounds of the submesh's vertices,
+	glm::vec3 m_boundsMax;			// relative to its node when the hierarchy is kept
+	unsigned int m_firstLod;		// first level of detail of the submesh in the level of detail table
+	unsigned int m_lodCount;		// number of levels of detail, including the full detail one
+};
+
+// A level of detail of a submesh. Its indices are in the same index buffer, after the full detail ones,
+// and use the same vertices, so only the range of indices drawn changes.
+struct MeshLod
+{
+	unsigned int m_firstIndex;		// first index of the level in the index buffer
+	unsigned int m_indexCount;		// number of indices to draw
+	float m_error;					// how far the simplified surface may be from the full detail one
+};
+
+// A node of the model file's hierarchy.
+// Nodes are stored in depth first order, so a parent always comes before its children.
+struct MeshNode
+{
+	glm::mat4 m_localMatrix;		// transform relative to the parent node
+	int m_parent;					// index of the parent node, -1 for the root
+	unsigned int m_firstSubmesh;	// first entry of the node's submeshes in the node submesh table
+	unsigned int m_submeshCount;	// number of submeshes drawn with this node's transform
+	char m_name[64];				// name from the model file, cut short if it doesn't fit
+};
+
+// Per instance data for Mesh::DrawMultiIndirect.
+// The world matrix is read from attributes 3 to 6, and the texture index from attribute 7 (see vertexMultiDraw.glsl).
+struct DrawInstance
+{
+	glm::mat4 m_worldMatrix;
+	unsigned int m_textureIndex;	// layer of a texture array, or index into a table of bindless handles
+	unsigned int m_padding[3];		// keeps each instance 16 byte aligned
+};
+
 class Mesh {
 
 
 private:
-	// Vectors of shape information
-	std::vector<Vertex3dUVNormal> m_vertices;
-	std::vector<unsigned short> m_indices;
+	// Every mesh gets a unique id, used to group draws of the same mesh together.
+	static unsigned int s_nextId;
+	unsigned int m_id = s_nextId++;
+
+	// Number of indices in the index buffer
+	GLsizei m_indexCount = 0;
+	// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, picked per mesh when it is created
+	GLenum m_indexType = GL_UNSIGNED_SHORT;
+
+	// Axis aligned bounds of the vertices
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+
+	// Table of the parts of the model in the shared buffers
+	std::vector<Submesh> m_submeshes;
+
+	// Levels of detail of every submesh, finest first (see Submesh::m_firstLod).
+	std::vector<MeshLod> m_lods;
+
+	// The node hierarchy, and the submesh indices each node draws.
+	// A model loaded with its transforms baked in has a single root node with every submesh.
+	std::vector<MeshNode> m_nodes;
+	std::vector<unsigned int> m_nodeSubmeshes;
 
 	// Buffered shape info
-	GLuint m_vertexBuffer;
-	GLuint m_indexBuffer;
+	GLuint m_vertexBuffer = 0;
+	GLuint m_indexBuffer = 0;
+	// Vertex array with the attribute layout, built once when the buffers are created
+	GLuint m_vertexArray = 0;
+
+	// Per instance world matrices for instanced drawing.
+	// Only created the first time the mesh is drawn instanced.
+	GLuint m_instanceBuffer = 0;
+	size_t m_instanceBufferSize = 0;
+
+	// The layout glMultiDrawElementsIndirect reads its draws in.
+	struct DrawElementsIndirectCommand
+	{
+		GLuint m_count;
+		GLuint m_instanceCount;
+		GLuint m_firstIndex;
+		GLint m_baseVertex;
+		GLuint m_baseInstance;
+	};
+
+	// A second vertex array for multi draws, sharing the vertex and index buffers,
+	// with per instance attributes read from the draw instance buffer.
+	// Only created the first time the mesh is drawn with DrawMultiIndirect.
+	GLuint m_multiDrawArray = 0;
+	GLuint m_drawInstanceBuffer = 0;
+	GLuint m_indirectBuffer = 0;
+	size_t m_drawInstanceBufferSize = 0;
+	size_t m_indirectBufferSize = 0;
+	std::vector<DrawElementsIndirectCommand> m_commands;
+
+	// Creates the opengl buffers from vertex and index data.
+	// The data can live anywhere, including a memory mapped cache file.
+	// indices points at indexCount indices of the given type.
+	void Upload(const Vertex3dUVNormal* vertices, size_t vertexCount, const void* indices, size_t indexCount, GLenum indexType);
+
+	// Issues the draw call for one submesh. Buffers must already be bound.
+	// Submeshes with fewer levels of detail than asked for draw their coarsest one.
+	void DrawSubmeshElements(const Submesh& submesh, GLsizei instanceCount, unsigned int lod);
+
+	// Binds the vertex and index buffers to the bound vertex array, and sets up attributes 0 to 2.
+	void SetupVertexAttributes();
+
+	// Creates the instance buffer and adds its attributes to the vertex array.
+	// The vertex array must be bound.
+	void CreateInstanceBuffer();
+
+	// Creates the multi draw vertex array and its buffers.
+	void CreateMultiDrawArray();
+
+	// Calculates the bounds of a set of vertices.
+	void CalculateBounds(const Vertex3dUVNormal* vertices, size_t vertexCount);
+
+	// Calculates the bounds of the submeshes, moved into model space by their nodes.
+	void CalculateNodeBounds(const Vertex3dUVNormal* vertices, size_t vertexCount);
+
+	// Makes a single root node that draws every submesh.
+	void CreateRootNode();
+
+	// Gives every submesh a single level of detail, its full detail indices.
+	void CreateFullDetailLods();
+
+	// Simplifies every submesh into a chain of levels of detail.
+	// The simplified indices are added to the end of indices.
+	// This only helps dense meshes. Corners where more than two seams meet never move, so models made of
+	// flat shaded boxes, like the building assets (46 triangles), get no simplified levels at all.
+	void BuildLods(const std::vector<Vertex3dUVNormal>& vertices, std::vector<unsigned int>& indices);
 
 
 public:
 	// Constructor for a shape, takes a vector for vertices and indices
 	Mesh(std::vector<Vertex3dUVNormal> vertices, std::vector<unsigned short> indices);
+	// Same, but for shapes that may have more than 65536 vertices.
+	// The indices are still stored as 16 bit if they fit.
+	Mesh(std::vector<Vertex3dUVNormal> vertices, std::vector<unsigned int> indices);
 
     // Constructor for a mesh. reads in an obj file.
-    Mesh(std::string filePath);
+    // Every mesh in the file is packed into the same buffers, with one submesh each.
+    // If there is an up to date binary cache next to the file, that is loaded instead.
+    // Normally the node transforms are baked into the vertices. With keepHierarchy they are not,
+    // and the nodes are kept so they can be moved on their own (see SceneGraph).
+    Mesh(std::string filePath, bool keepHierarchy = false);
 
 	// Shape destructor to clean up buffers
 	~Mesh();
 
+	// Bounds of the mesh in model space
+	glm::vec3 GetBoundsMin();
+	glm::vec3 GetBoundsMax();
+
+	// Unique id of this mesh
+	unsigned int GetId();
+
+	// Size in bytes of a single index of the given type
+	static unsigned int GetIndexSize(GLenum indexType);
+	// Type of the indices in the index buffer
+	GLenum GetIndexType();
+	// Picks the smallest index type that can address every vertex, and returns the index data to upload.
+	// If the indices fit in 16 bits, they are narrowed into shortIndices and that data is returned.
+	static const void* PackIndices(const std::vector<unsigned int>& indices, std::vector<unsigned short>& shortIndices, GLenum& indexType);
+
+	// Assimp post processing flags a model file is imported with, which depend on keeping the hierarchy.
+	// The mesh cache is kept per set of flags.
+	static unsigned int GetImportFlags(bool keepHierarchy);
+
+	// Submesh table
+	unsigned int GetSubmeshCount();
+	const Submesh& GetSubmesh(unsigned int index);
+
+	// Levels of detail. Level 0 is the full detail submesh.
+	// Without a submesh, the count is the most levels any submesh has.
+	unsigned int GetLodCount();
+	unsigned int GetLodCount(unsigned int submesh);
+	const MeshLod& GetLod(unsigned int submesh, unsigned int level);
+
+	// Picks the coarsest level of detail whose error covers at most MESH_LOD_PIXEL_ERROR pixels on screen,
+	// seen from cameraPosition with the mesh placed by worldMatrix.
+	// lodScale is how many pixels one unit covers one unit in front of the camera (see FPSController::GetLodScale),
+	// and 0 always picks full detail.
+	// Pass a submesh index to pick for that submesh only, or -1 to pick one level for the whole mesh.
+	unsigned int SelectLod(const glm::mat4& worldMatrix, glm::vec3 cameraPosition, float lodScale, int submesh = -1);
+
+	// Node hierarchy, in depth first order
+	unsigned int GetNodeCount();
+	const MeshNode& GetNode(unsigned int index);
+	// Submesh index for an entry of a node's range (MeshNode::m_firstSubmesh)
+	unsigned int GetNodeSubmesh(unsigned int index);
 
 	// Draws the shape using a given world matrix
-	void Draw();
+	// A level of detail above 0 draws a simplified version of it (see SelectLod).
+	void Draw(unsigned int lod = 0);
+
+	// Draws a single submesh, for example to use a different material for it
+	void DrawSubmesh(unsigned int index, unsigned int lod = 0);
+
+	// Draws count copies of the shape in one draw call, one for each world matrix.
+	// The matrices are read by the vertex shader from attributes 3 to 6 (see vertexInstanced.glsl).
+	void DrawInstanced(const glm::mat4* worldMatrices, unsigned int count, unsigned int lod = 0);
+
+	// Draws every submesh once for each instance, all in a single glMultiDrawElementsIndirect call.
+	// Each instance has its own world matrix and texture index, so instances with different textures
+	// can share a draw, as long as their textures come from the same texture array or bindless table.
+	void DrawMultiIndirect(const DrawInstance* instances, unsigned int count);
 };
\ No newline at end of file
@@ -0,0 +1,208 @@
+/*
+Title: Object Loading
+File Name: meshCache.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "meshCache.h"
+#include "fileStamp.h"
+#include <cstring>
+#include <cstdio>
+
+// Identifies a mesh cache file.
+static const char c_meshCacheMagic[4] = { 'M', 'S', 'H', 'C' };
+
+std::string MeshCache::GetCachePath(std::string sourcePath, unsigned int postProcessFlags)
+{
+    char flags[16];
+    snprintf(flags, sizeof(flags), ".%08x", postProcessFlags);
+    return sourcePath + flags + ".meshcache";
+}
+
+bool MeshCache::Write(std::string sourcePath, unsigned int postProcessFlags,
+    const std::vector<Vertex3dUVNormal>& vertices, const void* indices, unsigned int indexCount, GLenum indexType,
+    const std::vector<Submesh>& submeshes, const std::vector<MeshLod>& lods,
+    const std::vector<MeshNode>& nodes, const std::vector<unsigned int>& nodeSubmeshes,
+    glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    MeshCacheHeader header = {};
+
+    FileStamp stamp;
+    if (!stamp.Make(sourcePath))
+    {
+        return false;
+    }
+
+    memcpy(header.m_magic, c_meshCacheMagic, sizeof(c_meshCacheMagic));
+    header.m_version = MESH_CACHE_VERSION;
+    header.m_sourcePathHash = stamp.m_pathHash;
+    header.m_sourceModifiedTime = stamp.m_modifiedTime;
+    header.m_sourceSize = stamp.m_size;
+    header.m_postProcessFlags = postProcessFlags;
+    header.m_vertexCount = (unsigned int)vertices.size();
+    header.m_indexCount = indexCount;
+    header.m_indexType = indexType;
+    header.m_submeshCount = (unsigned int)submeshes.size();
+    header.m_lodCount = (unsigned int)lods.size();
+    header.m_nodeCount = (unsigned int)nodes.size();
+    header.m_nodeSubmeshCount = (unsigned int)nodeSubmeshes.size();
+    header.m_boundsMin = boundsMin;
+    header.m_boundsMax = boundsMax;
+
+    std::ofstream file(GetCachePath(sourcePath, postProcessFlags), std::ios::binary | std::ios::trunc);
+    if (!file.good())
+    {
+        return false;
+    }
+
+    // Header, then the submesh, level of detail and node tables, then the vertex block, then the index block.
+    // The index block goes last because 16 bit indices may leave it without 4 byte alignment.
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(submeshes.data()), submeshes.size() * sizeof(Submesh));
+    file.write(reinterpret_cast<const char*>(lods.data()), lods.size() * sizeof(MeshLod));
+    file.write(reinterpret_cast<const char*>(nodes.data()), nodes.size() * sizeof(MeshNode));
+    file.write(reinterpret_cast<const char*>(nodeSubmeshes.data()), nodeSubmeshes.size() * sizeof(unsigned int));
+    file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex3dUVNormal));
+    file.write(reinterpret_cast<const char*>(indices), (size_t)indexCount * Mesh::GetIndexSize(indexType));
+
+    return file.good();
+}
+
+bool MeshCache::Open(std::string sourcePath, unsigned int postProcessFlags)
+{
+    m_header = nullptr;
+
+    if (!m_file.Open(GetCachePath(sourcePath, postProcessFlags)))
+    {
+        return false;
+    }
+
+    // The file has to at least fit a header.
+    if (m_file.GetSize() < sizeof(MeshCacheHeader))
+    {
+        m_file.Close();
+        return false;
+    }
+
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(m_file.GetData());
+
+    // Compare the header against the source file, reject the cache on any mismatch.
+    FileStamp stamp;
+    if (memcmp(header->m_magic, c_meshCacheMagic, sizeof(c_meshCacheMagic)) != 0 ||
+        header->m_version != MESH_CACHE_VERSION ||
+        (header->m_indexType != GL_UNSIGNED_SHORT && header->m_indexType != GL_UNSIGNED_INT) ||
+        header->m_postProcessFlags != postProcessFlags ||
+        !stamp.Make(sourcePath) ||
+        header->m_sourcePathHash != stamp.m_pathHash ||
+        header->m_sourceModifiedTime != stamp.m_modifiedTime ||
+        header->m_sourceSize != stamp.m_size)
+    {
+        m_file.Close();
+        return false;
+    }
+
+    // A cache that was only partly written is also rejected.
+    size_t expectedSize = sizeof(MeshCacheHeader)
+        + header->m_submeshCount * sizeof(Submesh)
+        + header->m_lodCount * sizeof(MeshLod)
+        + header->m_nodeCount * sizeof(MeshNode)
+        + header->m_nodeSubmeshCount * sizeof(unsigned int)
+        + header->m_vertexCount * sizeof(Vertex3dUVNormal)
+        + (size_t)header->m_indexCount * Mesh::GetIndexSize(header->m_indexType);
+    if (m_file.GetSize() != expectedSize)
+    {
+        m_file.Close();
+        return false;
+    }
+
+    m_header = header;
+    return true;
+}
+
+const Vertex3dUVNormal* MeshCache::GetVertices()
+{
+    return reinterpret_cast<const Vertex3dUVNormal*>(GetNodeSubmeshes() + m_header->m_nodeSubmeshCount);
+}
+
+unsigned int MeshCache::GetVertexCount()
+{
+    return m_header->m_vertexCount;
+}
+
+const void* MeshCache::GetIndices()
+{
+    return GetVertices() + m_header->m_vertexCount;
+}
+
+unsigned int MeshCache::GetIndexCount()
+{
+    return m_header->m_indexCount;
+}
+
+GLenum MeshCache::GetIndexType()
+{
+    return m_header->m_indexType;
+}
+
+const Submesh* MeshCache::GetSubmeshes()
+{
+    return reinterpret_cast<const Submesh*>(m_file.GetData() + sizeof(MeshCacheHeader));
+}
+
+unsigned int MeshCache::GetSubmeshCount()
+{
+    return m_header->m_submeshCount;
+}
+
+const MeshLod* MeshCache::GetLods()
+{
+    return reinterpret_cast<const MeshLod*>(GetSubmeshes() + m_header->m_submeshCount);
+}
+
+unsigned int MeshCache::GetLodCount()
+{
+    return m_header->m_lodCount;
+}
+
+const MeshNode* MeshCache::GetNodes()
+{
+    return reinterpret_cast<const MeshNode*>(GetLods() + m_header->m_lodCount);
+}
+
+unsigned int MeshCache::GetNodeCount()
+{
+    return m_header->m_nodeCount;
+}
+
+const unsigned int* MeshCache::GetNodeSubmeshes()
+{
+    return reinterpret_cast<const unsigned int*>(GetNodes() + m_header->m_nodeCount);
+}
+
+unsigned int MeshCache::GetNodeSubmeshCount()
+{
+    return m_header->m_nodeSubmeshCount;
+}
+
+glm::vec3 MeshCache::GetBoundsMin()
+{
+    return m_header->m_boundsMin;
+}
+
+glm::vec3 MeshCache::GetBoundsMax()
+{
+    return m_header->m_boundsMax;
+}
@@ -0,0 +1,98 @@
+/*
+Title: Object Loading
+File Name: meshCache.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "mesh.h"
+#include "mappedFile.h"
+#include <vector>
+#include <string>
+
+// Bump this whenever the layout of the cache file changes, so old caches get rebuilt.
+#define MESH_CACHE_VERSION 6
+
+// Every cache file starts with this header.
+// It is followed by the submesh table, the level of detail table, the node table, the node submesh table,
+// the interleaved vertex block, and then the index block.
+struct MeshCacheHeader
+{
+    char m_magic[4];
+    unsigned int m_version;
+
+    // These describe the source file the cache was built from.
+    // If any of them change, the cache is stale and the model is imported again.
+    unsigned long long m_sourcePathHash;
+    long long m_sourceModifiedTime;
+    unsigned long long m_sourceSize;
+    unsigned int m_postProcessFlags;
+
+    unsigned int m_vertexCount;
+    unsigned int m_indexCount;
+    unsigned int m_indexType;
+    unsigned int m_submeshCount;
+    unsigned int m_nodeCount;
+    unsigned int m_nodeSubmeshCount;
+
+    // Axis aligned bounds of all vertices.
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
+    unsigned int m_lodCount;
+};
+
+// Reads and writes the binary mesh cache that sits next to a model file.
+// A warm load maps the cache into memory and never touches assimp.
+class MeshCache
+{
+private:
+    MappedFile m_file;
+    const MeshCacheHeader* m_header = nullptr;
+
+public:
+    // Returns the path of the cache file for a given model file and import flags, "<source>.<flags in hex>.meshcache".
+    // Each set of flags has its own file, so loading a model with and without its hierarchy keeps both caches.
+    static std::string GetCachePath(std::string sourcePath, unsigned int postProcessFlags);
+
+    // Writes a cache file for the given model. Returns false if the file can't be written.
+    static bool Write(std::string sourcePath, unsigned int postProcessFlags,
+        const std::vector<Vertex3dUVNormal>& vertices, const void* indices, unsigned int indexCount, GLenum indexType,
+        const std::vector<Submesh>& submeshes, const std::vector<MeshLod>& lods,
+        const std::vector<MeshNode>& nodes, const std::vector<unsigned int>& nodeSubmeshes,
+        glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+    // Maps the cache for a model file.
+    // Returns false if there is no cache, or it doesn't match the source file and flags.
+    bool Open(std::string sourcePath, unsigned int postProcessFlags);
+
+    // These point into the mapped file and are only valid while the cache is open.
+    const Vertex3dUVNormal* GetVertices();
+    unsigned int GetVertexCount();
+    const void* GetIndices();
+    unsigned int GetIndexCount();
+    GLenum GetIndexType();
+    const Submesh* GetSubmeshes();
+    unsigned int GetSubmeshCount();
+    const MeshLod* GetLods();
+    unsigned int GetLodCount();
+    const MeshNode* GetNodes();
+    unsigned int GetNodeCount();
+    const unsigned int* GetNodeSubmeshes();
+    unsigned int GetNodeSubmeshCount();
+
+    glm::vec3 GetBoundsMin();
+    glm::vec3 GetBoundsMax();
+};
@@ -0,0 +1,530 @@
+/*
+Title: Object Loading
+File Name: meshSimplifier.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "meshSimplifier.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+MeshSimplifier::MeshSimplifier(const Vertex3dUVNormal* vertices, unsigned int vertexCount)
+{
+    m_vertices = vertices;
+    m_vertexCount = vertexCount;
+
+    // Scale the positions into a unit cube.
+    glm::vec3 boundsMin = glm::vec3();
+    glm::vec3 boundsMax = glm::vec3();
+    if (vertexCount > 0)
+        boundsMin = boundsMax = vertices[0].m_position;
+    for (unsigned int i = 1; i < vertexCount; i++)
+    {
+        boundsMin = glm::min(boundsMin, vertices[i].m_position);
+        boundsMax = glm::max(boundsMax, vertices[i].m_position);
+    }
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    m_scale = std::max(std::max(extent.x, extent.y), extent.z);
+    if (m_scale <= 0)
+        m_scale = 1;
+
+    m_positions.resize(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; i++)
+    {
+        m_positions[i] = (vertices[i].m_position - boundsMin) / m_scale;
+    }
+
+    BuildRemap();
+}
+
+void MeshSimplifier::SetWeights(float texCoordWeight, float normalWeight, float seamWeight)
+{
+    m_texCoordWeight = texCoordWeight;
+    m_normalWeight = normalWeight;
+    m_seamWeight = seamWeight;
+}
+
+void MeshSimplifier::BuildRemap()
+{
+    // Sorting the vertices by position puts the ones that share a position next to each other.
+    std::vector<unsigned int> order(m_vertexCount);
+    for (unsigned int i = 0; i < m_vertexCount; i++)
+        order[i] = i;
+
+    const Vertex3dUVNormal* vertices = m_vertices;
+    std::sort(order.begin(), order.end(), [vertices](unsigned int a, unsigned int b)
+    {
+        const glm::vec3& pa = vertices[a].m_position;
+        const glm::vec3& pb = vertices[b].m_position;
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        if (pa.z != pb.z) return pa.z < pb.z;
+        return a < b;
+    });
+
+    m_remap.resize(m_vertexCount);
+    m_wedge.resize(m_vertexCount);
+    size_t first = 0;
+    while (first < order.size())
+    {
+        size_t end = first + 1;
+        while (end < order.size() && vertices[order[end]].m_position == vertices[order[first]].m_position)
+            end++;
+
+        // Link the group into a ring, and point all of it at its first vertex.
+        for (size_t i = first; i < end; i++)
+        {
+            m_remap[order[i]] = order[first];
+            m_wedge[order[i]] = order[i + 1 < end ? i + 1 : first];
+        }
+        first = end;
+    }
+}
+
+void MeshSimplifier::BuildAdjacency(const std::vector<unsigned int>& indices)
+{
+    // Count the triangles of each vertex, turn the counts into offsets, then fill in the triangles.
+    m_adjacencyOffsets.assign(m_vertexCount + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++)
+        m_adjacencyOffsets[indices[i] + 1]++;
+    for (unsigned int i = 0; i < m_vertexCount; i++)
+        m_adjacencyOffsets[i + 1] += m_adjacencyOffsets[i];
+
+    m_adjacency.resize(indices.size());
+    std::vector<unsigned int> fill(m_adjacencyOffsets.begin(), m_adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        m_adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+    // An edge is open if no triangle uses it in the other direction.
+    // -1 means a vertex has no open edge that way, -2 that it has more than one.
+    m_openNext.assign(m_vertexCount, -1);
+    m_openPrevious.assign(m_vertexCount, -1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int from = indices[i];
+        unsigned int to = indices[i % 3 == 2 ? i - 2 : i + 1];
+
+        bool open = true;
+        for (unsigned int k = m_adjacencyOffsets[to]; k < m_adjacencyOffsets[to + 1] && open; k++)
+        {
+            const unsigned int* triangle = &indices[m_adjacency[k] * 3];
+            for (int c = 0; c < 3; c++)
+            {
+                if (triangle[c] == to && triangle[(c + 1) % 3] == from)
+                    open = false;
+            }
+        }
+
+        if (open)
+        {
+            m_openNext[from] = m_openNext[from] == -1 ? (int)to : -2;
+            m_openPrevious[to] = m_openPrevious[to] == -1 ? (int)from : -2;
+        }
+    }
+}
+
+void MeshSimplifier::ClassifyVertices()
+{
+    m_kinds.assign(m_vertexCount, VertexKind::Locked);
+    for (unsigned int v = 0; v < m_vertexCount; v++)
+    {
+        if (m_adjacencyOffsets[v] == m_adjacencyOffsets[v + 1])
+            continue;
+
+        unsigned int ringSize = 1;
+        for (unsigned int w = m_wedge[v]; w != v; w = m_wedge[w])
+            ringSize++;
+
+        int next = m_openNext[v];
+        int previous = m_openPrevious[v];
+        if (ringSize == 1)
+        {
+            // A vertex of its own is either inside the surface, or on a single open edge loop.
+            if (next == -1 && previous == -1)
+                m_kinds[v] = VertexKind::Manifold;
+            else if (next >= 0 && previous >= 0)
+                m_kinds[v] = VertexKind::Border;
+        }
+        else if (ringSize == 2)
+        {
+            // Two vertices at one position are a seam, if the open edges of one follow the open edges of the other backwards.
+            // If they don't, the seam ends here or runs into an open edge of the model.
+            unsigned int twin = m_wedge[v];
+            int twinNext = m_openNext[twin];
+            int twinPrevious = m_openPrevious[twin];
+            if (next >= 0 && previous >= 0 && twinNext >= 0 && twinPrevious >= 0 &&
+                m_remap[next] == m_remap[twinPrevious] && m_remap[previous] == m_remap[twinNext])
+            {
+                m_kinds[v] = VertexKind::Seam;
+            }
+        }
+    }
+}
+
+void MeshSimplifier::BuildQuadrics(const std::vector<unsigned int>& indices)
+{
+    Quadric empty;
+    memset(&empty, 0, sizeof(empty));
+    m_quadrics.assign(m_vertexCount, empty);
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = m_positions[indices[i]];
+        const glm::vec3& p1 = m_positions[indices[i + 1]];
+        const glm::vec3& p2 = m_positions[indices[i + 2]];
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length <= 0)
+            continue;
+        normal /= length;
+        float area = length * 0.5f;
+
+        // Each corner gets the plane of the triangle, weighted by its area.
+        for (int c = 0; c < 3; c++)
+        {
+            Quadric& quadric = m_quadrics[m_remap[indices[i + c]]];
+            AddPlane(quadric, normal, -glm::dot(normal, p0), area);
+        }
+
+        // Open edges also get a plane standing up from the triangle through the edge,
+        // which keeps their ends from sliding off the outline.
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int from = indices[i + c];
+            unsigned int to = indices[i + (c + 1) % 3];
+            if (m_openNext[from] != (int)to)
+                continue;
+
+            glm::vec3 edge = m_positions[to] - m_positions[from];
+            glm::vec3 edgeNormal = glm::cross(edge, normal);
+            float edgeLength = glm::length(edgeNormal);
+            if (edgeLength <= 0)
+                continue;
+            edgeNormal /= edgeLength;
+
+            bool seam = m_kinds[from] == VertexKind::Seam || m_kinds[to] == VertexKind::Seam;
+            float weight = glm::dot(edge, edge) * (seam ? m_seamWeight : SIMPLIFY_BORDER_WEIGHT);
+            float distance = -glm::dot(edgeNormal, m_positions[from]);
+            AddPlane(m_quadrics[m_remap[from]], edgeNormal, distance, weight);
+            AddPlane(m_quadrics[m_remap[to]], edgeNormal, distance, weight);
+        }
+    }
+}
+
+int MeshSimplifier::FindTwinTarget(unsigned int vertex, unsigned int target)
+{
+    // Going forward along the seam on one side is going backward on the other.
+    unsigned int twin = m_wedge[vertex];
+    int twinTarget = -1;
+    if (m_openNext[vertex] == (int)target)
+        twinTarget = m_openPrevious[twin];
+    else if (m_openPrevious[vertex] == (int)target)
+        twinTarget = m_openNext[twin];
+
+    if (twinTarget < 0 || m_remap[twinTarget] != m_remap[target])
+        return -1;
+    return twinTarget;
+}
+
+bool MeshSimplifier::CanCollapse(unsigned int vertex, unsigned int target)
+{
+    if (m_remap[vertex] == m_remap[target])
+        return false;
+
+    switch (m_kinds[vertex])
+    {
+    case VertexKind::Manifold:
+        return true;
+    case VertexKind::Border:
+        return m_openNext[vertex] == (int)target || m_openPrevious[vertex] == (int)target;
+    case VertexKind::Seam:
+        return FindTwinTarget(vertex, target) >= 0;
+    default:
+        return false;
+    }
+}
+
+float MeshSimplifier::GetCollapseCost(unsigned int vertex, unsigned int target)
+{
+    const Quadric& quadric = m_quadrics[m_remap[vertex]];
+    double cost = EvaluateQuadric(quadric, m_positions[target]);
+
+    // The triangles around the vertex take on the target's texture coordinate and normal,
+    // so the difference is charged over their area.
+    glm::vec2 texCoord = m_vertices[vertex].m_texCoord - m_vertices[target].m_texCoord;
+    glm::vec3 normal = m_vertices[vertex].m_normal - m_vertices[target].m_normal;
+    double attributes = m_texCoordWeight * glm::dot(texCoord, texCoord) + m_normalWeight * glm::dot(normal, normal);
+
+    // A seam vertex takes its twin along, with its own texture coordinate and normal.
+    if (m_kinds[vertex] == VertexKind::Seam)
+    {
+        unsigned int twin = m_wedge[vertex];
+        unsigned int twinTarget = (unsigned int)FindTwinTarget(vertex, target);
+        texCoord = m_vertices[twin].m_texCoord - m_vertices[twinTarget].m_texCoord;
+        normal = m_vertices[twin].m_normal - m_vertices[twinTarget].m_normal;
+        attributes += m_texCoordWeight * glm::dot(texCoord, texCoord) + m_normalWeight * glm::dot(normal, normal);
+    }
+
+    return (float)(cost + attributes * quadric.m_weight);
+}
+
+bool MeshSimplifier::FlipsTriangles(const std::vector<unsigned int>& indices, unsigned int vertex, unsigned int target)
+{
+    for (unsigned int k = m_adjacencyOffsets[vertex]; k < m_adjacencyOffsets[vertex + 1]; k++)
+    {
+        const unsigned int* triangle = &indices[m_adjacency[k] * 3];
+
+        // Triangles on the collapsed edge disappear, so they can't flip.
+        bool removed = false;
+        for (int c = 0; c < 3; c++)
+        {
+            if (m_remap[triangle[c]] == m_remap[target])
+                removed = true;
+        }
+        if (removed)
+            continue;
+
+        glm::vec3 before[3], after[3];
+        for (int c = 0; c < 3; c++)
+        {
+            before[c] = m_positions[triangle[c]];
+            after[c] = triangle[c] == vertex ? m_positions[target] : before[c];
+        }
+
+        // Turning a triangle more than about 75 degrees counts as a flip, since it folds the surface.
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        if (glm::dot(normalBefore, normalAfter) < 0.25f * glm::length(normalBefore) * glm::length(normalAfter))
+            return true;
+    }
+    return false;
+}
+
+void MeshSimplifier::AddPlane(Quadric& quadric, glm::vec3 normal, float distance, float weight)
+{
+    quadric.m_a00 += weight * normal.x * normal.x;
+    quadric.m_a11 += weight * normal.y * normal.y;
+    quadric.m_a22 += weight * normal.z * normal.z;
+    quadric.m_a10 += weight * normal.y * normal.x;
+    quadric.m_a20 += weight * normal.z * normal.x;
+    quadric.m_a21 += weight * normal.z * normal.y;
+    quadric.m_b0 += weight * normal.x * distance;
+    quadric.m_b1 += weight * normal.y * distance;
+    quadric.m_b2 += weight * normal.z * distance;
+    quadric.m_c += weight * distance * distance;
+    quadric.m_weight += weight;
+}
+
+void MeshSimplifier::AddQuadric(Quadric& quadric, const Quadric& other)
+{
+    quadric.m_a00 += other.m_a00;
+    quadric.m_a11 += other.m_a11;
+    quadric.m_a22 += other.m_a22;
+    quadric.m_a10 += other.m_a10;
+    quadric.m_a20 += other.m_a20;
+    quadric.m_a21 += other.m_a21;
+    quadric.m_b0 += other.m_b0;
+    quadric.m_b1 += other.m_b1;
+    quadric.m_b2 += other.m_b2;
+    quadric.m_c += other.m_c;
+    quadric.m_weight += other.m_weight;
+}
+
+double MeshSimplifier::EvaluateQuadric(const Quadric& quadric, glm::vec3 position)
+{
+    double x = position.x, y = position.y, z = position.z;
+    double error = quadric.m_a00 * x * x + quadric.m_a11 * y * y + quadric.m_a22 * z * z
+        + 2 * (quadric.m_a10 * x * y + quadric.m_a20 * x * z + quadric.m_a21 * y * z)
+        + 2 * (quadric.m_b0 * x + quadric.m_b1 * y + quadric.m_b2 * z)
+        + quadric.m_c;
+
+    // Rounding can take a perfect fit slightly below zero.
+    return std::max(error, 0.0);
+}
+
+void MeshSimplifier::SetIndices(const unsigned int* indices, size_t indexCount)
+{
+    m_indices.assign(indices, indices + indexCount);
+    m_error = 0;
+
+    BuildAdjacency(m_indices);
+    ClassifyVertices();
+    BuildQuadrics(m_indices);
+}
+
+float MeshSimplifier::Simplify(size_t targetIndexCount, float maxError)
+{
+    std::vector<unsigned int>& result = m_indices;
+
+    // Errors are compared squared, in unit cube space.
+    double errorLimit = (double)maxError / m_scale;
+    errorLimit *= errorLimit;
+
+    std::vector<unsigned int> collapseTo(m_vertexCount);
+    std::vector<char> locked(m_vertexCount);
+    std::vector<int> bestTarget(m_vertexCount);
+    std::vector<float> bestCost(m_vertexCount);
+    std::vector<Collapse> candidates;
+
+    // Every pass finds the cheapest collapse of each vertex, and does as many of them as it can,
+    // cheapest first, as long as they don't touch the triangles of a collapse already done in the pass.
+    while (result.size() > targetIndexCount)
+    {
+        std::fill(bestTarget.begin(), bestTarget.end(), -1);
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            unsigned int edge[2] = { result[i], result[i % 3 == 2 ? i - 2 : i + 1] };
+
+            // Edges inside the surface show up once in each direction, so only one of them is needed.
+            int open = m_openNext[edge[0]];
+            if (edge[0] > edge[1] && (open == -1 || (open >= 0 && open != (int)edge[1])))
+                continue;
+
+            for (int e = 0; e < 2; e++)
+            {
+                unsigned int vertex = edge[e];
+                unsigned int target = edge[1 - e];
+                if (!CanCollapse(vertex, target))
+                    continue;
+
+                float cost = GetCollapseCost(vertex, target);
+                if (bestTarget[vertex] < 0 || cost < bestCost[vertex])
+                {
+                    bestTarget[vertex] = (int)target;
+                    bestCost[vertex] = cost;
+                }
+            }
+        }
+
+        candidates.clear();
+        for (unsigned int v = 0; v < m_vertexCount; v++)
+        {
+            if (bestTarget[v] >= 0)
+            {
+                Collapse collapse;
+                collapse.m_cost = bestCost[v];
+                collapse.m_vertex = v;
+                candidates.push_back(collapse);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b)
+        {
+            return a.m_cost < b.m_cost;
+        });
+
+        for (unsigned int v = 0; v < m_vertexCount; v++)
+            collapseTo[v] = v;
+        std::fill(locked.begin(), locked.end(), 0);
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t trianglesRemoved = 0;
+        unsigned int collapses = 0;
+
+        for (size_t c = 0; c < candidates.size() && trianglesRemoved < trianglesToRemove; c++)
+        {
+            unsigned int vertex = candidates[c].m_vertex;
+            unsigned int target = (unsigned int)bestTarget[vertex];
+            if (locked[vertex] || locked[target])
+                continue;
+
+            // The error of the collapse is the distance to the planes the vertex stands for, on average.
+            Quadric& quadric = m_quadrics[m_remap[vertex]];
+            double error = quadric.m_weight > 0 ? EvaluateQuadric(quadric, m_positions[target]) / quadric.m_weight : 0;
+            if (error > errorLimit)
+                continue;
+
+            // Seams collapse on both sides at once.
+            unsigned int moved[2] = { vertex, 0 };
+            unsigned int targets[2] = { target, 0 };
+            unsigned int movedCount = 1;
+            if (m_kinds[vertex] == VertexKind::Seam)
+            {
+                moved[1] = m_wedge[vertex];
+                targets[1] = (unsigned int)FindTwinTarget(vertex, target);
+                movedCount = 2;
+                if (locked[moved[1]] || locked[targets[1]])
+                    continue;
+            }
+
+            bool flips = false;
+            for (unsigned int m = 0; m < movedCount; m++)
+                flips = flips || FlipsTriangles(result, moved[m], targets[m]);
+            if (flips)
+                continue;
+
+            m_error = std::max(m_error, error);
+            AddQuadric(m_quadrics[m_remap[target]], quadric);
+
+            for (unsigned int m = 0; m < movedCount; m++)
+            {
+                collapseTo[moved[m]] = targets[m];
+
+                // Nothing around a collapsed vertex may change again this pass,
+                // or the flip test above would have looked at the wrong triangles.
+                for (unsigned int k = m_adjacencyOffsets[moved[m]]; k < m_adjacencyOffsets[moved[m] + 1]; k++)
+                {
+                    const unsigned int* triangle = &result[m_adjacency[k] * 3];
+                    bool removed = false;
+                    for (int corner = 0; corner < 3; corner++)
+                    {
+                        locked[triangle[corner]] = 1;
+                        if (triangle[corner] == targets[m])
+                            removed = true;
+                    }
+                    if (removed)
+                        trianglesRemoved++;
+                }
+            }
+            collapses++;
+        }
+
+        if (collapses == 0)
+            break;
+
+        // Move the collapsed vertices, and drop the triangles that lost an edge.
+        size_t count = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = collapseTo[result[i]];
+            unsigned int b = collapseTo[result[i + 1]];
+            unsigned int c = collapseTo[result[i + 2]];
+            if (m_remap[a] == m_remap[b] || m_remap[b] == m_remap[c] || m_remap[c] == m_remap[a])
+                continue;
+
+            result[count++] = a;
+            result[count++] = b;
+            result[count++] = c;
+        }
+        result.resize(count);
+
+        BuildAdjacency(result);
+    }
+
+    return GetError();
+}
+
+const std::vector<unsigned int>& MeshSimplifier::GetIndices()
+{
+    return m_indices;
+}
+
+float MeshSimplifier::GetError()
+{
+    return (float)sqrt(m_error) * m_scale;
+}
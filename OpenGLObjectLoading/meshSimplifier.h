@@ -0,0 +1,145 @@
+/*
+Title: Object Loading
+File Name: meshSimplifier.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "mesh.h"
+#include "glm/glm.hpp"
+#include <vector>
+
+// How much more collapsing along an open edge costs than collapsing inside the surface.
+// Open edges are the outline of a model, and moving them is easy to see.
+#define SIMPLIFY_BORDER_WEIGHT 10.0f
+
+// Makes lower detail versions of a triangle mesh with quadric error metrics.
+//
+// Each vertex keeps a quadric, the sum of the squared distances to the planes of its triangles.
+// Collapsing a vertex onto a neighbor costs the quadric evaluated at the neighbor's position,
+// plus a penalty for the texture coordinate and normal differences, and the cheapest collapses go first.
+// A vertex is always collapsed onto an existing vertex, never onto a new position,
+// so every level of detail can be drawn with the indices alone and share the original vertex buffer.
+//
+// Texture and normal seams split one position into several vertices, which shows up as open edges.
+// A seam vertex is only moved along its seam, together with its twin on the other side, so the seam never cracks.
+// Vertices where more than two seams or open edges meet are never moved.
+class MeshSimplifier
+{
+private:
+    // What a vertex may be collapsed along.
+    enum class VertexKind
+    {
+        Manifold,   // inside the surface, can go to any neighbor
+        Border,     // on an open edge of the model, can only go along it
+        Seam,       // on a texture or normal seam, goes along it together with its twin
+        Locked      // corner or complex vertex, never moves
+    };
+
+    // Sum of squared distances to a set of planes, weighted by area.
+    // Stored as the symmetric matrix A, the vector b and the constant c of p*A*p + 2*b*p + c.
+    struct Quadric
+    {
+        double m_a00, m_a11, m_a22, m_a10, m_a20, m_a21;
+        double m_b0, m_b1, m_b2;
+        double m_c;
+        double m_weight;    // total weight of the planes, used to turn errors into average distances
+    };
+
+    // The cheapest collapse of a vertex, for sorting.
+    struct Collapse
+    {
+        float m_cost;
+        unsigned int m_vertex;
+    };
+
+    const Vertex3dUVNormal* m_vertices;
+    unsigned int m_vertexCount;
+
+    // Positions scaled to fit in a unit cube, so errors and weights don't depend on the size of the model.
+    std::vector<glm::vec3> m_positions;
+    float m_scale;
+
+    // Vertices at the same position: the first of them, and the next one in a ring through all of them.
+    std::vector<unsigned int> m_remap;
+    std::vector<unsigned int> m_wedge;
+
+    std::vector<VertexKind> m_kinds;
+    // One quadric for every position, indexed by m_remap.
+    std::vector<Quadric> m_quadrics;
+
+    // The triangles being simplified, and the largest squared error of a collapse so far, in unit cube space.
+    std::vector<unsigned int> m_indices;
+    double m_error = 0;
+
+    // The triangles around each vertex, rebuilt before every pass.
+    std::vector<unsigned int> m_adjacencyOffsets;
+    std::vector<unsigned int> m_adjacency;
+    // The other end of each vertex's outgoing and incoming open edge.
+    // -1 if it has none, -2 if it has more than one.
+    std::vector<int> m_openNext;
+    std::vector<int> m_openPrevious;
+
+    float m_texCoordWeight = 1.0f;
+    float m_normalWeight = 0.25f;
+    float m_seamWeight = 1.0f;
+
+    // Joins vertices with the same position into rings.
+    void BuildRemap();
+    // Finds the triangles around each vertex and the open edges of the index buffer.
+    void BuildAdjacency(const std::vector<unsigned int>& indices);
+    // Works out the kind of every vertex from the open edges and rings.
+    void ClassifyVertices();
+    // Adds the planes of the triangles, and of the open edges, to the quadrics.
+    void BuildQuadrics(const std::vector<unsigned int>& indices);
+
+    // The twin of a seam vertex's neighbor along the seam, on the other side of the seam.
+    // Returns -1 if the seam doesn't continue to that neighbor on the other side.
+    int FindTwinTarget(unsigned int vertex, unsigned int target);
+    // Returns false if the collapse is not allowed for the vertex's kind.
+    bool CanCollapse(unsigned int vertex, unsigned int target);
+    // Cost of moving vertex onto target, including the attribute penalty.
+    float GetCollapseCost(unsigned int vertex, unsigned int target);
+    // Returns true if moving vertex onto target flips any of its triangles over.
+    bool FlipsTriangles(const std::vector<unsigned int>& indices, unsigned int vertex, unsigned int target);
+
+    static void AddPlane(Quadric& quadric, glm::vec3 normal, float distance, float weight);
+    static void AddQuadric(Quadric& quadric, const Quadric& other);
+    static double EvaluateQuadric(const Quadric& quadric, glm::vec3 position);
+
+public:
+    // The vertices must stay alive while the simplifier is used.
+    MeshSimplifier(const Vertex3dUVNormal* vertices, unsigned int vertexCount);
+
+    // How much the texture coordinate and normal differences add to the cost of a collapse,
+    // and how much collapses along seams cost on top of that, compared to collapses inside the surface.
+    // Set them before SetIndices.
+    void SetWeights(float texCoordWeight, float normalWeight, float seamWeight);
+
+    // Starts simplifying a triangle list, with indices into the vertices.
+    void SetIndices(const unsigned int* indices, size_t indexCount);
+
+    // Keeps simplifying the triangles until there are at most targetIndexCount indices,
+    // or nothing more can be collapsed without an error over maxError.
+    // Each call carries on from the last one, so a chain of levels of detail is made by asking for fewer and fewer indices.
+    // Returns the error of the result so far, as a distance in the units of the vertex positions.
+    float Simplify(size_t targetIndexCount, float maxError);
+
+    // The simplified triangles.
+    const std::vector<unsigned int>& GetIndices();
+    // Error of the simplified triangles compared to the ones given to SetIndices.
+    float GetError();
+};
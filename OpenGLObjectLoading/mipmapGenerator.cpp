@@ -0,0 +1,286 @@
+/*
+Title: Object Loading
+File Name: mipmapGenerator.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mipmapGenerator.h"
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+
+// Kaiser filter shape. The width is in destination pixels, on each side of the center.
+#define KAISER_WIDTH 3.0f
+#define KAISER_ALPHA 4.0f
+
+unsigned int MipmapGenerator::GetLevelCount(unsigned int width, unsigned int height)
+{
+    unsigned int size = width > height ? width : height;
+    unsigned int levels = 1;
+    while (size > 1)
+    {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+unsigned int MipmapGenerator::GetLevelWidth(unsigned int width, unsigned int level)
+{
+    width >>= level;
+    return width > 0 ? width : 1;
+}
+
+unsigned int MipmapGenerator::BuildChain(MipmapFilter filter, const unsigned char* pixels, unsigned int width, unsigned int height,
+    std::vector<unsigned char>& chain)
+{
+    unsigned int levelCount = GetLevelCount(width, height);
+
+    // Work out the size of the whole chain up front, so it's allocated once.
+    size_t size = 0;
+    for (unsigned int i = 0; i < levelCount; i++)
+    {
+        size += (size_t)GetLevelWidth(width, i) * GetLevelWidth(height, i) * 4;
+    }
+    chain.resize(size);
+
+    // Level 0 is the image itself, and each level after that is made from the one before it.
+    memcpy(chain.data(), pixels, (size_t)width * height * 4);
+
+    unsigned char* level = chain.data();
+    for (unsigned int i = 1; i < levelCount; i++)
+    {
+        unsigned int levelWidth = GetLevelWidth(width, i - 1);
+        unsigned int levelHeight = GetLevelWidth(height, i - 1);
+        unsigned char* next = level + (size_t)levelWidth * levelHeight * 4;
+
+        Downsample(filter, level, levelWidth, levelHeight, next);
+        level = next;
+    }
+
+    return levelCount;
+}
+
+void MipmapGenerator::Downsample(MipmapFilter filter, const unsigned char* src, unsigned int width, unsigned int height, unsigned char* dst)
+{
+    unsigned int dstWidth = GetLevelWidth(width, 1);
+    unsigned int dstHeight = GetLevelWidth(height, 1);
+
+    // The common case, an even sized level, has a fast path for the box filter.
+    if (filter != MipmapFilter::Kaiser && width % 2 == 0 && height % 2 == 0)
+        BoxHalve(src, width, height, dst);
+    else
+        Resample(filter, src, width, height, dst, dstWidth, dstHeight);
+}
+
+void MipmapGenerator::BoxHalve(const unsigned char* src, unsigned int srcWidth, unsigned int srcHeight, unsigned char* dst)
+{
+    unsigned int dstWidth = srcWidth / 2;
+    unsigned int dstHeight = srcHeight / 2;
+    size_t srcPitch = (size_t)srcWidth * 4;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i two = _mm_set1_epi16(2);
+
+    for (unsigned int y = 0; y < dstHeight; y++)
+    {
+        const unsigned char* row0 = src + srcPitch * (y * 2);
+        const unsigned char* row1 = row0 + srcPitch;
+        unsigned char* out = dst + (size_t)dstWidth * 4 * y;
+
+        unsigned int x = 0;
+
+        // 4 destination pixels at a time, from 8 pixels on each of the 2 source rows.
+        for (; x + 4 <= dstWidth; x += 4)
+        {
+            __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8));
+            __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 16));
+            __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8));
+            __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 16));
+
+            // Widen to 16 bits and add the rows together. Each register holds 2 pixels.
+            __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(b0, zero));
+            __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(b0, zero));
+            __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero), _mm_unpacklo_epi8(b1, zero));
+            __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero), _mm_unpackhi_epi8(b1, zero));
+
+            // Add each pixel to its right neighbour, by adding the low and high halves of each register.
+            __m128i p0 = _mm_add_epi16(_mm_unpacklo_epi64(s0, s1), _mm_unpackhi_epi64(s0, s1));
+            __m128i p1 = _mm_add_epi16(_mm_unpacklo_epi64(s2, s3), _mm_unpackhi_epi64(s2, s3));
+
+            // Divide by 4, rounding to nearest, and narrow back to bytes.
+            p0 = _mm_srli_epi16(_mm_add_epi16(p0, two), 2);
+            p1 = _mm_srli_epi16(_mm_add_epi16(p1, two), 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_packus_epi16(p0, p1));
+        }
+
+        // Whatever is left over at the end of the row.
+        for (; x < dstWidth; x++)
+        {
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                unsigned int sum = row0[x * 8 + c] + row0[x * 8 + 4 + c] + row1[x * 8 + c] + row1[x * 8 + 4 + c];
+                out[x * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Modified Bessel function of the first kind, used by the Kaiser window.
+static float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 20; k++)
+    {
+        float t = x / (2.0f * k);
+        term *= t * t;
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser windowed sinc, at a distance of x destination pixels from the center.
+static float KaiserWeight(float x)
+{
+    if (fabsf(x) >= KAISER_WIDTH)
+        return 0.0f;
+
+    float sinc = 1.0f;
+    if (x != 0.0f)
+    {
+        float px = 3.14159265f * x;
+        sinc = sinf(px) / px;
+    }
+
+    float t = x / KAISER_WIDTH;
+    float window = BesselI0(KAISER_ALPHA * sqrtf(1.0f - t * t)) / BesselI0(KAISER_ALPHA);
+    return sinc * window;
+}
+
+// The source pixels that make up one destination pixel, along one axis.
+struct FilterTaps
+{
+    int m_first;
+    std::vector<float> m_weights;
+};
+
+// Works out the taps for every destination pixel along one axis.
+// Source pixels past the edge are clamped to the edge.
+static void BuildTaps(MipmapFilter filter, unsigned int srcSize, unsigned int dstSize, std::vector<FilterTaps>& taps)
+{
+    float scale = (float)srcSize / dstSize;
+    float radius = filter == MipmapFilter::Kaiser ? KAISER_WIDTH * scale : scale * 0.5f;
+
+    taps.resize(dstSize);
+    for (unsigned int i = 0; i < dstSize; i++)
+    {
+        // Center of the destination pixel, in source pixels.
+        float center = (i + 0.5f) * scale;
+        int first = (int)floorf(center - radius);
+        int last = (int)ceilf(center + radius);
+
+        taps[i].m_first = first;
+        taps[i].m_weights.clear();
+
+        float total = 0.0f;
+        for (int j = first; j < last; j++)
+        {
+            float weight;
+            if (filter == MipmapFilter::Kaiser)
+            {
+                weight = KaiserWeight((j + 0.5f - center) / scale);
+            }
+            else
+            {
+                // How much of the source pixel is covered by the box.
+                float left = fmaxf((float)j, center - radius);
+                float right = fminf((float)j + 1.0f, center + radius);
+                weight = fmaxf(right - left, 0.0f);
+            }
+            taps[i].m_weights.push_back(weight);
+            total += weight;
+        }
+
+        // Weights should add up to 1, so the image keeps its brightness.
+        for (size_t j = 0; j < taps[i].m_weights.size(); j++)
+        {
+            taps[i].m_weights[j] /= total;
+        }
+    }
+}
+
+// Filters one pixel's worth of taps. Each pixel is 4 floats, so one SSE register handles a whole pixel.
+// The stride is the distance between neighbouring pixels, in pixels.
+static inline __m128 FilterPixel(const FilterTaps& taps, const float* pixels, int count, size_t stride)
+{
+    __m128 sum = _mm_setzero_ps();
+    for (size_t k = 0; k < taps.m_weights.size(); k++)
+    {
+        int j = taps.m_first + (int)k;
+        j = j < 0 ? 0 : (j >= count ? count - 1 : j);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(pixels + j * stride * 4), _mm_set1_ps(taps.m_weights[k])));
+    }
+    return sum;
+}
+
+void MipmapGenerator::Resample(MipmapFilter filter, const unsigned char* src, unsigned int srcWidth, unsigned int srcHeight,
+    unsigned char* dst, unsigned int dstWidth, unsigned int dstHeight)
+{
+    std::vector<FilterTaps> tapsX;
+    std::vector<FilterTaps> tapsY;
+    BuildTaps(filter, srcWidth, dstWidth, tapsX);
+    BuildTaps(filter, srcHeight, dstHeight, tapsY);
+
+    const __m128i zero = _mm_setzero_si128();
+
+    // Convert a row of the source to floats, then filter it horizontally.
+    // The filtered rows are kept, since the vertical pass reads several of them for each output row.
+    std::vector<float> row((size_t)srcWidth * 4);
+    std::vector<float> horizontal((size_t)dstWidth * srcHeight * 4);
+    for (unsigned int y = 0; y < srcHeight; y++)
+    {
+        const unsigned char* in = src + (size_t)srcWidth * 4 * y;
+        for (unsigned int x = 0; x < srcWidth; x++)
+        {
+            int pixel;
+            memcpy(&pixel, in + x * 4, 4);
+            __m128i bytes = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero);
+            _mm_storeu_ps(&row[(size_t)x * 4], _mm_cvtepi32_ps(_mm_unpacklo_epi16(bytes, zero)));
+        }
+
+        for (unsigned int x = 0; x < dstWidth; x++)
+        {
+            _mm_storeu_ps(&horizontal[((size_t)y * dstWidth + x) * 4], FilterPixel(tapsX[x], row.data(), srcWidth, 1));
+        }
+    }
+
+    // Filter vertically, and round back to bytes. The sinc lobes can overshoot, so clamp too.
+    for (unsigned int y = 0; y < dstHeight; y++)
+    {
+        unsigned char* out = dst + (size_t)dstWidth * 4 * y;
+        for (unsigned int x = 0; x < dstWidth; x++)
+        {
+            __m128 value = FilterPixel(tapsY[y], horizontal.data() + (size_t)x * 4, srcHeight, dstWidth);
+            __m128i ints = _mm_cvtps_epi32(value);
+            ints = _mm_packs_epi32(ints, ints);
+            ints = _mm_packus_epi16(ints, ints);
+
+            int pixel = _mm_cvtsi128_si32(ints);
+            memcpy(out + x * 4, &pixel, 4);
+        }
+    }
+}
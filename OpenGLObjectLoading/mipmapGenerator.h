@@ -0,0 +1,62 @@
+/*
+Title: Object Loading
+File Name: mipmapGenerator.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <vector>
+
+// How the smaller mip levels of a texture are made.
+enum class MipmapFilter
+{
+    // Only level 0, sampled without mipmaps.
+    None,
+    // glGenerateMipmap on the gpu, when the texture is uploaded.
+    Gpu,
+    // 2x2 average on the cpu. Fast, but a little blurry.
+    Box,
+    // Kaiser windowed sinc on the cpu. Slower, but keeps more detail.
+    Kaiser
+};
+
+// Builds mip chains for 32 bit images on the cpu.
+// Pixels are 4 bytes, and every channel is filtered the same way, so BGRA and RGBA both work.
+class MipmapGenerator
+{
+private:
+    // Resamples src down to dstWidth x dstHeight with a separable filter.
+    static void Resample(MipmapFilter filter, const unsigned char* src, unsigned int srcWidth, unsigned int srcHeight,
+        unsigned char* dst, unsigned int dstWidth, unsigned int dstHeight);
+
+    // SSE2 2x2 average, for levels with even sizes.
+    static void BoxHalve(const unsigned char* src, unsigned int srcWidth, unsigned int srcHeight, unsigned char* dst);
+
+public:
+    // Number of levels in a full chain, down to 1x1.
+    static unsigned int GetLevelCount(unsigned int width, unsigned int height);
+
+    // Size of one level. Every level is half the one before it, but never below 1.
+    static unsigned int GetLevelWidth(unsigned int width, unsigned int level);
+
+    // Makes the next level of src, which is max(width / 2, 1) x max(height / 2, 1) pixels.
+    static void Downsample(MipmapFilter filter, const unsigned char* src, unsigned int width, unsigned int height, unsigned char* dst);
+
+    // Builds a full chain, with every level packed one after the other, level 0 first.
+    // Returns the number of levels.
+    static unsigned int BuildChain(MipmapFilter filter, const unsigned char* pixels, unsigned int width, unsigned int height,
+        std::vector<unsigned char>& chain);
+};
@@ -0,0 +1,437 @@
+/*
+Title: Object Loading
+File Name: occlusionCuller.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "occlusionCuller.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// A cube from 0 to 1, with counter clockwise faces seen from outside.
+static const glm::vec3 c_cubePositions[8] =
+{
+    glm::vec3(0, 0, 0), glm::vec3(1, 0, 0), glm::vec3(1, 1, 0), glm::vec3(0, 1, 0),
+    glm::vec3(0, 0, 1), glm::vec3(1, 0, 1), glm::vec3(1, 1, 1), glm::vec3(0, 1, 1)
+};
+static const unsigned int c_cubeIndices[36] =
+{
+    0, 2, 1, 0, 3, 2,   // back (-z)
+    4, 5, 6, 4, 6, 7,   // front (+z)
+    0, 4, 7, 0, 7, 3,   // left (-x)
+    1, 2, 6, 1, 6, 5,   // right (+x)
+    0, 1, 5, 0, 5, 4,   // bottom (-y)
+    3, 7, 6, 3, 6, 2    // top (+y)
+};
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+{
+    m_tilesX = (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+    m_tilesY = (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+    m_width = m_tilesX * OCCLUSION_TILE_WIDTH;
+    m_height = m_tilesY * OCCLUSION_TILE_HEIGHT;
+    m_tileTriangles.resize(m_tilesX * m_tilesY);
+
+    // Each level is half the size of the one below, rounded up, down to a single texel.
+    unsigned int levelWidth = m_width;
+    unsigned int levelHeight = m_height;
+    while (true)
+    {
+        m_levels.push_back(std::vector<float>(levelWidth * levelHeight, 1.0f));
+        m_levelWidths.push_back(levelWidth);
+        m_levelHeights.push_back(levelHeight);
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+    m_viewProjection = glm::mat4();
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_occluders.clear();
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3* positions, const unsigned int* indices, unsigned int indexCount, const glm::mat4& worldMatrix)
+{
+    Occluder occluder;
+    occluder.m_positions = positions;
+    occluder.m_indices = indices;
+    occluder.m_indexCount = indexCount;
+    occluder.m_worldMatrix = worldMatrix;
+    m_occluders.push_back(occluder);
+
+    m_stats.m_occluderTriangles += indexCount / 3;
+}
+
+void OcclusionCuller::AddBoxOccluder(const glm::mat4& worldMatrix, glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    // Stretch the unit cube over the box.
+    glm::mat4 boxMatrix = glm::mat4();
+    boxMatrix[0][0] = boundsMax.x - boundsMin.x;
+    boxMatrix[1][1] = boundsMax.y - boundsMin.y;
+    boxMatrix[2][2] = boundsMax.z - boundsMin.z;
+    boxMatrix[3] = glm::vec4(boundsMin, 1);
+
+    AddOccluder(c_cubePositions, c_cubeIndices, 36, worldMatrix * boxMatrix);
+}
+
+void OcclusionCuller::Rasterize(JobSystem* jobs)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    m_triangles.clear();
+    for (size_t i = 0; i < m_tileTriangles.size(); i++)
+    {
+        m_tileTriangles[i].clear();
+    }
+
+    for (size_t i = 0; i < m_occluders.size(); i++)
+    {
+        SetupOccluder(m_occluders[i]);
+    }
+    m_stats.m_rasterizedTriangles = (unsigned int)m_triangles.size();
+
+    // Tiles don't share any pixels, so they can be filled in any order on any thread.
+    unsigned int tileCount = m_tilesX * m_tilesY;
+    if (jobs != nullptr)
+    {
+        jobs->ParallelFor(tileCount, 1, [this](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int tile = begin; tile < end; tile++)
+            {
+                RasterizeTile(tile);
+            }
+        });
+    }
+    else
+    {
+        for (unsigned int tile = 0; tile < tileCount; tile++)
+        {
+            RasterizeTile(tile);
+        }
+    }
+
+    for (unsigned int level = 1; level < m_levels.size(); level++)
+    {
+        BuildLevel(level);
+    }
+
+    m_stats.m_rasterizeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void OcclusionCuller::SetupOccluder(const Occluder& occluder)
+{
+    glm::mat4 matrix = m_viewProjection * occluder.m_worldMatrix;
+
+    for (unsigned int i = 0; i + 2 < occluder.m_indexCount; i += 3)
+    {
+        glm::vec4 clip[3];
+        bool crossesNear = false;
+        for (int v = 0; v < 3; v++)
+        {
+            clip[v] = matrix * glm::vec4(occluder.m_positions[occluder.m_indices[i + v]], 1);
+            if (clip[v].w <= 0 || clip[v].z < -clip[v].w)
+                crossesNear = true;
+        }
+
+        // Triangles through the near plane are skipped instead of clipped.
+        // Leaving out part of an occluder can only make fewer things hidden, never too many.
+        if (crossesNear)
+            continue;
+
+        // Skip triangles that are completely outside one side of the frustum.
+        if ((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+            (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+            (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+            (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w) ||
+            (clip[0].z > clip[0].w && clip[1].z > clip[1].w && clip[2].z > clip[2].w))
+            continue;
+
+        // To pixels, with the bottom row first like opengl.
+        glm::vec3 screen[3];
+        for (int v = 0; v < 3; v++)
+        {
+            glm::vec3 ndc = glm::vec3(clip[v]) / clip[v].w;
+            screen[v] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z);
+        }
+
+        // Twice the signed area. Back facing and zero area triangles are skipped.
+        float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+        if (area <= 0)
+            continue;
+
+        // Pixels whose centers can be inside the triangle, clamped to the screen.
+        glm::vec3 screenMin = glm::min(glm::min(screen[0], screen[1]), screen[2]);
+        glm::vec3 screenMax = glm::max(glm::max(screen[0], screen[1]), screen[2]);
+        ScreenTriangle triangle;
+        triangle.m_minX = std::max(0, (int)ceil(std::max(screenMin.x, -1.0f) - 0.5f));
+        triangle.m_minY = std::max(0, (int)ceil(std::max(screenMin.y, -1.0f) - 0.5f));
+        triangle.m_maxX = std::min((int)m_width - 1, (int)floor(std::min(screenMax.x, (float)m_width + 1) - 0.5f));
+        triangle.m_maxY = std::min((int)m_height - 1, (int)floor(std::min(screenMax.y, (float)m_height + 1) - 0.5f));
+        if (triangle.m_minX > triangle.m_maxX || triangle.m_minY > triangle.m_maxY)
+            continue;
+
+        // Edge k is the edge opposite vertex k. It is positive inside, and equal to area times
+        // that vertex's barycentric weight, which also gives the depth plane.
+        float edgeA[3], edgeB[3], edgeC[3];
+        for (int k = 0; k < 3; k++)
+        {
+            const glm::vec3& from = screen[(k + 1) % 3];
+            const glm::vec3& to = screen[(k + 2) % 3];
+            edgeA[k] = from.y - to.y;
+            edgeB[k] = to.x - from.x;
+            edgeC[k] = -(edgeA[k] * from.x + edgeB[k] * from.y);
+        }
+
+        triangle.m_edgeA = glm::vec3(edgeA[0], edgeA[1], edgeA[2]);
+        triangle.m_edgeB = glm::vec3(edgeB[0], edgeB[1], edgeB[2]);
+        triangle.m_edgeC = glm::vec3(edgeC[0], edgeC[1], edgeC[2]);
+
+        glm::vec3 depths = glm::vec3(screen[0].z, screen[1].z, screen[2].z) / area;
+        triangle.m_depth = glm::vec3(glm::dot(triangle.m_edgeA, depths), glm::dot(triangle.m_edgeB, depths), glm::dot(triangle.m_edgeC, depths));
+
+        // Pixels exactly on an edge shared by two triangles can round to outside of both, leaving
+        // cracks that the max pyramid spreads to every level above. Pushing each edge out by a
+        // tiny fraction of a pixel closes them.
+        for (int k = 0; k < 3; k++)
+            edgeC[k] += (fabs(edgeA[k]) + fabs(edgeB[k])) * OCCLUSION_EDGE_BIAS;
+        triangle.m_edgeC = glm::vec3(edgeC[0], edgeC[1], edgeC[2]);
+
+        // Add the triangle to every tile its pixel bounds touch.
+        unsigned int index = (unsigned int)m_triangles.size();
+        m_triangles.push_back(triangle);
+        for (int ty = triangle.m_minY / OCCLUSION_TILE_HEIGHT; ty <= triangle.m_maxY / OCCLUSION_TILE_HEIGHT; ty++)
+        {
+            for (int tx = triangle.m_minX / OCCLUSION_TILE_WIDTH; tx <= triangle.m_maxX / OCCLUSION_TILE_WIDTH; tx++)
+            {
+                m_tileTriangles[ty * m_tilesX + tx].push_back(index);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+    int tileX = (int)(tile % m_tilesX) * OCCLUSION_TILE_WIDTH;
+    int tileY = (int)(tile / m_tilesX) * OCCLUSION_TILE_HEIGHT;
+    float* depthBuffer = m_levels[0].data();
+
+    // Start the tile at the far plane.
+    for (int y = tileY; y < tileY + OCCLUSION_TILE_HEIGHT; y++)
+    {
+        std::fill(depthBuffer + y * m_width + tileX, depthBuffer + y * m_width + tileX + OCCLUSION_TILE_WIDTH, 1.0f);
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+    const std::vector<unsigned int>& triangles = m_tileTriangles[tile];
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        const ScreenTriangle& triangle = m_triangles[triangles[t]];
+
+        // The part of the triangle's bounds inside this tile, widened to whole groups of 4 pixels.
+        int minX = std::max(triangle.m_minX, tileX) & ~3;
+        int maxX = std::min(triangle.m_maxX, tileX + OCCLUSION_TILE_WIDTH - 1);
+        int minY = std::max(triangle.m_minY, tileY);
+        int maxY = std::min(triangle.m_maxY, tileY + OCCLUSION_TILE_HEIGHT - 1);
+
+        __m128 a0 = _mm_set1_ps(triangle.m_edgeA.x);
+        __m128 a1 = _mm_set1_ps(triangle.m_edgeA.y);
+        __m128 a2 = _mm_set1_ps(triangle.m_edgeA.z);
+        __m128 depthA = _mm_set1_ps(triangle.m_depth.x);
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            // Everything that only depends on the row is worked out once.
+            float pixelY = y + 0.5f;
+            __m128 row0 = _mm_set1_ps(triangle.m_edgeB.x * pixelY + triangle.m_edgeC.x);
+            __m128 row1 = _mm_set1_ps(triangle.m_edgeB.y * pixelY + triangle.m_edgeC.y);
+            __m128 row2 = _mm_set1_ps(triangle.m_edgeB.z * pixelY + triangle.m_edgeC.z);
+            __m128 rowDepth = _mm_set1_ps(triangle.m_depth.y * pixelY + triangle.m_depth.z);
+
+            float* depthRow = depthBuffer + y * m_width;
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+                // A pixel is covered if its center is on the inside of all 3 edges.
+                __m128 edge0 = _mm_add_ps(_mm_mul_ps(a0, pixelX), row0);
+                __m128 edge1 = _mm_add_ps(_mm_mul_ps(a1, pixelX), row1);
+                __m128 edge2 = _mm_add_ps(_mm_mul_ps(a2, pixelX), row2);
+                __m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+                if (_mm_movemask_ps(covered) == 0)
+                    continue;
+
+                // Keep the closest depth in the covered pixels.
+                __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth);
+                __m128 old = _mm_loadu_ps(depthRow + x);
+                __m128 closest = _mm_min_ps(old, depth);
+                _mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(covered, closest), _mm_andnot_ps(covered, old)));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::BuildLevel(unsigned int level)
+{
+    const std::vector<float>& below = m_levels[level - 1];
+    unsigned int belowWidth = m_levelWidths[level - 1];
+    unsigned int belowHeight = m_levelHeights[level - 1];
+    std::vector<float>& texels = m_levels[level];
+    unsigned int width = m_levelWidths[level];
+    unsigned int height = m_levelHeights[level];
+
+    // Each texel keeps the farthest of the 4 below it, so it never claims anything is closer than it is.
+    // On odd sizes the last row and column are used twice.
+    for (unsigned int y = 0; y < height; y++)
+    {
+        unsigned int y0 = y * 2;
+        unsigned int y1 = std::min(y0 + 1, belowHeight - 1);
+        for (unsigned int x = 0; x < width; x++)
+        {
+            unsigned int x0 = x * 2;
+            unsigned int x1 = std::min(x0 + 1, belowWidth - 1);
+            float farthest = std::max(std::max(below[y0 * belowWidth + x0], below[y0 * belowWidth + x1]),
+                std::max(below[y1 * belowWidth + x0], below[y1 * belowWidth + x1]));
+            texels[y * width + x] = farthest;
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(glm::vec3 boundsMin, glm::vec3 boundsMax)
+{
+    // Project the corners, and find the rectangle they cover and their closest depth.
+    glm::vec2 screenMin = glm::vec2(FLT_MAX);
+    glm::vec2 screenMax = glm::vec2(-FLT_MAX);
+    float closest = FLT_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner = glm::vec3(i & 1 ? boundsMax.x : boundsMin.x, i & 2 ? boundsMax.y : boundsMin.y, i & 4 ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1);
+
+        // A box through the near plane covers the camera, so it can't be hidden.
+        if (clip.w <= 0 || clip.z < -clip.w)
+            return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen = glm::vec2((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        closest = std::min(closest, ndc.z);
+    }
+
+    // Boxes off screen or past the far plane are the frustum culler's job.
+    if (screenMax.x < 0 || screenMax.y < 0 || screenMin.x >= m_width || screenMin.y >= m_height || closest > 1)
+        return true;
+
+    // Every pixel the rectangle touches.
+    int x0 = std::max(0, (int)floor(screenMin.x));
+    int y0 = std::max(0, (int)floor(screenMin.y));
+    int x1 = std::min((int)m_width - 1, (int)floor(screenMax.x));
+    int y1 = std::min((int)m_height - 1, (int)floor(screenMax.y));
+
+    // Go up the pyramid until the rectangle covers at most 4 by 4 texels.
+    unsigned int level = 0;
+    while (level + 1 < m_levels.size() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+    {
+        level++;
+    }
+
+    const std::vector<float>& texels = m_levels[level];
+    unsigned int width = m_levelWidths[level];
+    float farthest = -1;
+    for (int y = y0 >> level; y <= (y1 >> level); y++)
+    {
+        for (int x = x0 >> level; x <= (x1 >> level); x++)
+        {
+            farthest = std::max(farthest, texels[y * width + x]);
+        }
+    }
+
+    // Hidden if even the closest point of the box is behind everything over it.
+    return closest <= farthest;
+}
+
+void OcclusionCuller::Cull(const glm::vec3* boundsMin, const glm::vec3* boundsMax, unsigned int count, std::vector<unsigned int>& visible, JobSystem* jobs)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    m_results.resize(count);
+    if (jobs != nullptr && count > OCCLUSION_BOXES_PER_JOB)
+    {
+        jobs->ParallelFor(count, OCCLUSION_BOXES_PER_JOB, [this, boundsMin, boundsMax](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                m_results[i] = IsVisible(boundsMin[i], boundsMax[i]) ? 1 : 0;
+            }
+        });
+    }
+    else
+    {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            m_results[i] = IsVisible(boundsMin[i], boundsMax[i]) ? 1 : 0;
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (m_results[i])
+            visible.push_back(i);
+        else
+            m_stats.m_occludedBoxes++;
+    }
+    m_stats.m_testedBoxes += count;
+
+    m_stats.m_cullMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+const float* OcclusionCuller::GetDepthBuffer()
+{
+    return m_levels[0].data();
+}
+
+unsigned int OcclusionCuller::GetWidth()
+{
+    return m_width;
+}
+
+unsigned int OcclusionCuller::GetHeight()
+{
+    return m_height;
+}
+
+unsigned int OcclusionCuller::GetLevelCount()
+{
+    return (unsigned int)m_levels.size();
+}
+
+const OcclusionStats& OcclusionCuller::GetStats()
+{
+    return m_stats;
+}
@@ -0,0 +1,138 @@
+/*
+Title: Object Loading
+File Name: occlusionCuller.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "glm/glm.hpp"
+#include "jobSystem.h"
+#include <vector>
+
+// Size of the screen tiles the depth buffer is split into. Each tile is rasterized by one job.
+// The width must be a multiple of 4, since 4 pixels are rasterized at once.
+#define OCCLUSION_TILE_WIDTH 32
+#define OCCLUSION_TILE_HEIGHT 16
+
+// Boxes tested by each job in Cull.
+#define OCCLUSION_BOXES_PER_JOB 1024
+
+// How far, in pixels, edges are pushed out to keep shared edges watertight.
+#define OCCLUSION_EDGE_BIAS (1.0f / 64.0f)
+
+// Counters for the last frame, for judging whether occlusion culling pays for itself.
+struct OcclusionStats
+{
+    unsigned int m_occluderTriangles;   // triangles added as occluders
+    unsigned int m_rasterizedTriangles; // triangles left after clipping and back face culling
+    unsigned int m_testedBoxes;         // boxes tested by Cull
+    unsigned int m_occludedBoxes;       // boxes Cull found to be hidden
+    double m_rasterizeMilliseconds;     // time spent in Rasterize, including the depth pyramid
+    double m_cullMilliseconds;          // time spent in Cull
+};
+
+// Hides objects that are behind other objects, on the cpu, before they are drawn.
+// A few simple occluder meshes (like boxes inside buildings) are rasterized into a small depth buffer,
+// 4 pixels at a time with SSE, with the screen split into tiles that are filled in parallel.
+// The depth buffer is then reduced into a pyramid, where each texel holds the farthest depth of the 4 below it.
+// A box is hidden if its closest point is behind the farthest depth over the area it covers,
+// which takes a handful of texels from the pyramid level where the box is about one texel big.
+// Occluders have to be inside the objects they stand for, or they hide things that should be visible.
+// Everything here runs without opengl.
+class OcclusionCuller
+{
+private:
+    // A triangle in screen space, ready to rasterize.
+    struct ScreenTriangle
+    {
+        // Edge functions a * x + b * y + c, positive inside the triangle.
+        glm::vec3 m_edgeA;
+        glm::vec3 m_edgeB;
+        glm::vec3 m_edgeC;
+        // Depth plane, depth = a * x + b * y + c.
+        glm::vec3 m_depth;
+        // Pixel bounds, inclusive.
+        int m_minX, m_minY, m_maxX, m_maxY;
+    };
+
+    // Occluders added since Begin. The vertex and index data belongs to the caller.
+    struct Occluder
+    {
+        const glm::vec3* m_positions;
+        const unsigned int* m_indices;
+        unsigned int m_indexCount;
+        glm::mat4 m_worldMatrix;
+    };
+
+    unsigned int m_width;
+    unsigned int m_height;
+    unsigned int m_tilesX;
+    unsigned int m_tilesY;
+
+    glm::mat4 m_viewProjection;
+    std::vector<Occluder> m_occluders;
+    std::vector<ScreenTriangle> m_triangles;
+    // Indices of the triangles that touch each tile.
+    std::vector<std::vector<unsigned int>> m_tileTriangles;
+
+    // Depth pyramid. Level 0 is the depth buffer, depths are NDC z from -1 (near) to 1 (far).
+    std::vector<std::vector<float>> m_levels;
+    std::vector<unsigned int> m_levelWidths;
+    std::vector<unsigned int> m_levelHeights;
+
+    // Results of the last Cull, one flag per box.
+    std::vector<unsigned char> m_results;
+
+    OcclusionStats m_stats;
+
+    // Transforms, clips and culls the triangles of an occluder, and adds the rest to the tiles they touch.
+    void SetupOccluder(const Occluder& occluder);
+    // Rasterizes every triangle that touches a tile into the depth buffer.
+    void RasterizeTile(unsigned int tile);
+    // Fills a pyramid level from the one below it.
+    void BuildLevel(unsigned int level);
+
+public:
+    // width and height are rounded up to whole tiles.
+    OcclusionCuller(unsigned int width = 256, unsigned int height = 128);
+
+    // Starts a frame: clears the occluders and sets the camera.
+    void Begin(const glm::mat4& viewProjection);
+
+    // Adds an occluder mesh with a world matrix. Triangles are counter clockwise when seen from the front.
+    // The data isn't copied, it has to stay alive until Rasterize.
+    void AddOccluder(const glm::vec3* positions, const unsigned int* indices, unsigned int indexCount, const glm::mat4& worldMatrix);
+    // Adds a box occluder, moved by a matrix.
+    void AddBoxOccluder(const glm::mat4& worldMatrix, glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+    // Rasterizes the occluders and builds the depth pyramid. With a job system, the tiles are split across its threads.
+    void Rasterize(JobSystem* jobs = nullptr);
+
+    // Returns false if a world space box is completely hidden behind the occluders.
+    // Boxes that cross the near plane or go off screen are always visible.
+    bool IsVisible(glm::vec3 boundsMin, glm::vec3 boundsMax);
+
+    // Tests count boxes, and adds the indices of the visible ones to visible.
+    void Cull(const glm::vec3* boundsMin, const glm::vec3* boundsMax, unsigned int count, std::vector<unsigned int>& visible, JobSystem* jobs = nullptr);
+
+    // The depth buffer, m_width * m_height floats with the bottom row first.
+    const float* GetDepthBuffer();
+    unsigned int GetWidth();
+    unsigned int GetHeight();
+    unsigned int GetLevelCount();
+
+    const OcclusionStats& GetStats();
+};
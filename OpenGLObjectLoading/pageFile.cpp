@@ -0,0 +1,318 @@
+/*
+Title: Object Loading
+File Name: pageFile.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pageFile.h"
+#include "mipmapGenerator.h"
+#include "pixelConvert.h"
+#include "fileStamp.h"
+#include "FreeImage.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+// Bump this when the layout of the file changes, so old files are cooked again.
+#define PAGE_FILE_VERSION 1
+#define PAGE_FILE_MAGIC 0x46505456 // "VTPF"
+
+struct PageFileHeader
+{
+    unsigned int m_magic;
+    unsigned int m_version;
+    // Modified time, size and path hash of the source image, so edits to it are noticed.
+    unsigned int m_stamp[FILE_STAMP_WORDS];
+    unsigned int m_sourceWidth;
+    unsigned int m_sourceHeight;
+    unsigned int m_pageSize;
+    unsigned int m_border;
+    unsigned int m_pageCount;
+    unsigned int m_levelCount;
+};
+
+// Fills in the stamp for a source file. Returns false if the file doesn't exist.
+static bool MakeStamp(const std::string& sourcePath, unsigned int* stamp)
+{
+    FileStamp fileStamp;
+    if (!fileStamp.Make(sourcePath))
+    {
+        return false;
+    }
+
+    fileStamp.Pack(stamp);
+    return true;
+}
+
+// Total number of pages in every level, when level 0 has pageCount x pageCount pages.
+static unsigned int CountPages(unsigned int pageCount, unsigned int levelCount)
+{
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < levelCount; i++)
+    {
+        unsigned int levelPages = pageCount >> i;
+        total += levelPages * levelPages;
+    }
+    return total;
+}
+
+PageFile::PageFile()
+{
+}
+
+std::string PageFile::GetPagePath(std::string sourcePath)
+{
+    return sourcePath + ".vtpages";
+}
+
+bool PageFile::Cook(const std::string& sourcePath, unsigned int pageSize, unsigned int border)
+{
+    PageFileHeader header;
+    memset(&header, 0, sizeof(header));
+    if (!MakeStamp(sourcePath, header.m_stamp))
+    {
+        std::cout << "Can't find virtual texture source: " << sourcePath << std::endl;
+        return false;
+    }
+
+    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(sourcePath.c_str()), sourcePath.c_str());
+    if (bitmap == nullptr)
+    {
+        std::cout << "Can't load virtual texture source: " << sourcePath << std::endl;
+        return false;
+    }
+
+    // Convert the file to 32 bits so we can use it.
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    std::vector<unsigned char> source;
+    bool converted = PixelConvert::Convert(bitmap, source);
+    FreeImage_Unload(bitmap);
+    if (!converted)
+    {
+        std::cout << "Can't convert virtual texture source: " << sourcePath << std::endl;
+        return false;
+    }
+
+    // Round the page grid up to a square power of two, so every level halves the pages on both sides.
+    unsigned int pagesNeeded = (width > height ? width : height);
+    pagesNeeded = (pagesNeeded + pageSize - 1) / pageSize;
+    unsigned int pageCount = 1;
+    unsigned int levelCount = 1;
+    while (pageCount < pagesNeeded)
+    {
+        pageCount *= 2;
+        levelCount++;
+    }
+
+    // Level 0 is the source, with its last row and column repeated out to the padded size.
+    unsigned int levelSize = pageCount * pageSize;
+    std::vector<unsigned char> level((size_t)levelSize * levelSize * 4);
+    for (unsigned int y = 0; y < levelSize; y++)
+    {
+        const unsigned char* srcRow = source.data() + (size_t)(y < height ? y : height - 1) * width * 4;
+        unsigned char* dstRow = level.data() + (size_t)y * levelSize * 4;
+        memcpy(dstRow, srcRow, (size_t)width * 4);
+        for (unsigned int x = width; x < levelSize; x++)
+        {
+            memcpy(dstRow + x * 4, srcRow + (width - 1) * 4, 4);
+        }
+    }
+    source.clear();
+    source.shrink_to_fit();
+
+    std::ofstream file(GetPagePath(sourcePath), std::ios::binary | std::ios::trunc);
+    if (!file.good())
+    {
+        std::cout << "Can't write virtual texture pages: " << GetPagePath(sourcePath) << std::endl;
+        return false;
+    }
+
+    header.m_magic = PAGE_FILE_MAGIC;
+    header.m_version = PAGE_FILE_VERSION;
+    header.m_sourceWidth = width;
+    header.m_sourceHeight = height;
+    header.m_pageSize = pageSize;
+    header.m_border = border;
+    header.m_pageCount = pageCount;
+    header.m_levelCount = levelCount;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    unsigned int paddedSize = pageSize + border * 2;
+    std::vector<unsigned char> page((size_t)paddedSize * paddedSize * 4);
+    std::vector<unsigned char> nextLevel;
+
+    for (unsigned int i = 0; i < levelCount; i++)
+    {
+        unsigned int levelPages = pageCount >> i;
+
+        for (unsigned int pageY = 0; pageY < levelPages; pageY++)
+        {
+            for (unsigned int pageX = 0; pageX < levelPages; pageX++)
+            {
+                // Copy the page and its border. Texels past the edge of the level are clamped.
+                for (unsigned int y = 0; y < paddedSize; y++)
+                {
+                    int levelY = (int)(pageY * pageSize + y) - (int)border;
+                    levelY = levelY < 0 ? 0 : (levelY >= (int)levelSize ? levelSize - 1 : levelY);
+                    const unsigned char* srcRow = level.data() + (size_t)levelY * levelSize * 4;
+                    unsigned char* dstRow = page.data() + (size_t)y * paddedSize * 4;
+
+                    for (unsigned int x = 0; x < paddedSize; x++)
+                    {
+                        int levelX = (int)(pageX * pageSize + x) - (int)border;
+                        levelX = levelX < 0 ? 0 : (levelX >= (int)levelSize ? levelSize - 1 : levelX);
+                        memcpy(dstRow + x * 4, srcRow + levelX * 4, 4);
+                    }
+                }
+
+                file.write(reinterpret_cast<const char*>(page.data()), page.size());
+            }
+        }
+
+        // Make the next level. The sizes are powers of two times the page size, so they always halve evenly.
+        if (i + 1 < levelCount)
+        {
+            nextLevel.resize((size_t)(levelSize / 2) * (levelSize / 2) * 4);
+            MipmapGenerator::Downsample(MipmapFilter::Box, level.data(), levelSize, levelSize, nextLevel.data());
+            level.swap(nextLevel);
+            levelSize /= 2;
+        }
+    }
+
+    return file.good();
+}
+
+bool PageFile::Open(const std::string& sourcePath, unsigned int pageSize, unsigned int border)
+{
+    Close();
+
+    unsigned int stamp[FILE_STAMP_WORDS];
+    if (!MakeStamp(sourcePath, stamp))
+    {
+        std::cout << "Can't find virtual texture source: " << sourcePath << std::endl;
+        return false;
+    }
+
+    // Try the existing file first, and cook a new one if it doesn't match.
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (attempt == 1 && !Cook(sourcePath, pageSize, border))
+        {
+            return false;
+        }
+
+        if (!m_file.Open(GetPagePath(sourcePath)))
+            continue;
+
+        if (m_file.GetSize() < sizeof(PageFileHeader))
+        {
+            m_file.Close();
+            continue;
+        }
+
+        const PageFileHeader* header = reinterpret_cast<const PageFileHeader*>(m_file.GetData());
+        size_t pageBytes = (size_t)(pageSize + border * 2) * (pageSize + border * 2) * 4;
+        if (header->m_magic != PAGE_FILE_MAGIC ||
+            header->m_version != PAGE_FILE_VERSION ||
+            memcmp(header->m_stamp, stamp, sizeof(stamp)) != 0 ||
+            header->m_pageSize != pageSize ||
+            header->m_border != border ||
+            header->m_levelCount == 0 ||
+            header->m_pageCount != (1u << (header->m_levelCount - 1)) ||
+            m_file.GetSize() != sizeof(PageFileHeader) + CountPages(header->m_pageCount, header->m_levelCount) * pageBytes)
+        {
+            m_file.Close();
+            continue;
+        }
+
+        m_sourceWidth = header->m_sourceWidth;
+        m_sourceHeight = header->m_sourceHeight;
+        m_pageSize = pageSize;
+        m_border = border;
+        m_pageCount = header->m_pageCount;
+        m_levelCount = header->m_levelCount;
+
+        m_levelOffsets.resize(m_levelCount);
+        unsigned int offset = 0;
+        for (unsigned int i = 0; i < m_levelCount; i++)
+        {
+            m_levelOffsets[i] = offset;
+            offset += (m_pageCount >> i) * (m_pageCount >> i);
+        }
+        return true;
+    }
+
+    std::cout << "Can't open virtual texture pages: " << GetPagePath(sourcePath) << std::endl;
+    return false;
+}
+
+void PageFile::Close()
+{
+    m_file.Close();
+    m_pageCount = 0;
+    m_levelCount = 0;
+    m_levelOffsets.clear();
+}
+
+const unsigned char* PageFile::GetPage(unsigned int level, unsigned int x, unsigned int y)
+{
+    if (level >= m_levelCount || x >= (m_pageCount >> level) || y >= (m_pageCount >> level))
+        return nullptr;
+
+    size_t index = m_levelOffsets[level] + y * (m_pageCount >> level) + x;
+    return m_file.GetData() + sizeof(PageFileHeader) + index * GetPageBytes();
+}
+
+unsigned int PageFile::GetSourceWidth()
+{
+    return m_sourceWidth;
+}
+
+unsigned int PageFile::GetSourceHeight()
+{
+    return m_sourceHeight;
+}
+
+unsigned int PageFile::GetPageSize()
+{
+    return m_pageSize;
+}
+
+unsigned int PageFile::GetBorder()
+{
+    return m_border;
+}
+
+unsigned int PageFile::GetPaddedPageSize()
+{
+    return m_pageSize + m_border * 2;
+}
+
+size_t PageFile::GetPageBytes()
+{
+    return (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4;
+}
+
+unsigned int PageFile::GetPageCount()
+{
+    return m_pageCount;
+}
+
+unsigned int PageFile::GetLevelCount()
+{
+    return m_levelCount;
+}
@@ -0,0 +1,73 @@
+/*
+Title: Object Loading
+File Name: pageFile.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "mappedFile.h"
+#include <string>
+#include <vector>
+
+// Pages of a virtual texture, cooked into a file next to the source image.
+// The image is padded to a square power of two number of pages, and every mip level is cut into
+// pageSize x pageSize pages. Each page keeps a border of texels copied from its neighbours,
+// so bilinear filtering near its edges still reads the right colors.
+// Pages are stored level by level, rows bottom first, as 32 bit BGRA pixels.
+class PageFile
+{
+private:
+    MappedFile m_file;
+
+    unsigned int m_sourceWidth = 0;
+    unsigned int m_sourceHeight = 0;
+    unsigned int m_pageSize = 0;
+    unsigned int m_border = 0;
+    // Pages along each side of level 0.
+    unsigned int m_pageCount = 0;
+    unsigned int m_levelCount = 0;
+
+    // Index of the first page of every level.
+    std::vector<unsigned int> m_levelOffsets;
+
+public:
+    PageFile();
+
+    // Cooks the page file for a source image. Returns false if the image can't be loaded or the file can't be written.
+    // The whole image and its next level are held in memory while cooking.
+    static bool Cook(const std::string& sourcePath, unsigned int pageSize, unsigned int border);
+
+    // Opens the page file of a source image, cooking it first if it's missing, stale, or uses other page settings.
+    bool Open(const std::string& sourcePath, unsigned int pageSize, unsigned int border);
+    void Close();
+
+    // Pixels of a page, including its border. The pointer stays valid until the file is closed.
+    // Reading it may block on the disk, so copy pages out on a worker thread.
+    const unsigned char* GetPage(unsigned int level, unsigned int x, unsigned int y);
+
+    static std::string GetPagePath(std::string sourcePath);
+
+    unsigned int GetSourceWidth();
+    unsigned int GetSourceHeight();
+    unsigned int GetPageSize();
+    unsigned int GetBorder();
+    // Page size with the border on both sides.
+    unsigned int GetPaddedPageSize();
+    // Bytes in one page.
+    size_t GetPageBytes();
+    unsigned int GetPageCount();
+    unsigned int GetLevelCount();
+};
@@ -0,0 +1,367 @@
+/*
+Title: Object Loading
+File Name: pageTable.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pageTable.h"
+#include <algorithm>
+
+PageTable::PageTable(unsigned int pageCount, unsigned int slotsX, unsigned int slotsY)
+    : m_pageCount(pageCount), m_slotsX(slotsX), m_slotsY(slotsY)
+{
+    m_levelCount = 1;
+    while ((1u << (m_levelCount - 1)) < pageCount)
+        m_levelCount++;
+
+    m_entries.resize(m_levelCount);
+    m_dirty.resize(m_levelCount);
+    for (unsigned int i = 0; i < m_levelCount; i++)
+    {
+        unsigned int levelPages = pageCount >> i;
+        m_entries[i].assign(levelPages * levelPages, 0);
+    }
+
+    // Free slots are taken from the back, so push them in reverse to fill the cache from slot 0.
+    m_slots.resize(slotsX * slotsY);
+    for (unsigned int i = (unsigned int)m_slots.size(); i > 0; i--)
+    {
+        m_freeSlots.push_back(i - 1);
+    }
+}
+
+unsigned int PageTable::MakePage(unsigned int level, unsigned int x, unsigned int y)
+{
+    return (level << 24) | ((y & 0xFFF) << 12) | (x & 0xFFF);
+}
+
+unsigned int PageTable::GetPageLevel(unsigned int page)
+{
+    return page >> 24;
+}
+
+unsigned int PageTable::GetPageX(unsigned int page)
+{
+    return page & 0xFFF;
+}
+
+unsigned int PageTable::GetPageY(unsigned int page)
+{
+    return (page >> 12) & 0xFFF;
+}
+
+bool PageTable::DecodeFeedback(unsigned int pixel, unsigned int& page)
+{
+    // The feedback shader writes the low 8 bits of x and y to red and green, the high 4 bits
+    // of both to blue, and the level + 1 to alpha.
+    unsigned int alpha = pixel >> 24;
+    if (alpha == 0)
+        return false;
+
+    unsigned int blue = (pixel >> 16) & 0xFF;
+    unsigned int x = (pixel & 0xFF) | ((blue & 0xF) << 8);
+    unsigned int y = ((pixel >> 8) & 0xFF) | ((blue >> 4) << 8);
+    page = MakePage(alpha - 1, x, y);
+    return true;
+}
+
+void PageTable::AnalyzeFeedback(const unsigned int* pixels, size_t count, std::vector<PageRequest>& requests)
+{
+    m_frame++;
+    requests.clear();
+
+    // Sort the requested pages, so each distinct page is handled once with its pixel count.
+    m_feedbackPages.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned int page;
+        if (!DecodeFeedback(pixels[i], page))
+            continue;
+
+        unsigned int level = GetPageLevel(page);
+        if (level >= m_levelCount || GetPageX(page) >= (m_pageCount >> level) || GetPageY(page) >= (m_pageCount >> level))
+            continue;
+
+        m_feedbackPages.push_back(page);
+    }
+    std::sort(m_feedbackPages.begin(), m_feedbackPages.end());
+
+    // Index of each page in requests, so parents shared by many pages are only requested once.
+    std::unordered_map<unsigned int, size_t> requestIndices;
+
+    size_t i = 0;
+    while (i < m_feedbackPages.size())
+    {
+        unsigned int page = m_feedbackPages[i];
+        size_t runEnd = i + 1;
+        while (runEnd < m_feedbackPages.size() && m_feedbackPages[runEnd] == page)
+            runEnd++;
+        unsigned int pixelCount = (unsigned int)(runEnd - i);
+        i = runEnd;
+
+        // Walk up to the last level. Parents are touched after their children, so they stay
+        // more recently used, and the cache evicts fine pages before the pages they fall back to.
+        unsigned int level = GetPageLevel(page);
+        unsigned int x = GetPageX(page);
+        unsigned int y = GetPageY(page);
+        for (; level < m_levelCount; level++, x /= 2, y /= 2)
+        {
+            unsigned int current = MakePage(level, x, y);
+            auto found = m_pages.find(current);
+            if (found != m_pages.end())
+            {
+                if (found->second.m_state == PageState::Resident)
+                    Touch(found->second.m_slot);
+                continue;
+            }
+
+            // A page already requested had its parents handled then.
+            auto index = requestIndices.find(current);
+            if (index != requestIndices.end())
+            {
+                if (current == page)
+                    requests[index->second].m_pixelCount += pixelCount;
+                break;
+            }
+
+            requestIndices[current] = requests.size();
+            requests.push_back({ current, current == page ? pixelCount : 0 });
+        }
+    }
+
+    // Coarse pages first, since finer pages are useless until the pages under them have somewhere to fall back to.
+    std::sort(requests.begin(), requests.end(), [](const PageRequest& a, const PageRequest& b)
+    {
+        unsigned int levelA = GetPageLevel(a.m_page);
+        unsigned int levelB = GetPageLevel(b.m_page);
+        if (levelA != levelB)
+            return levelA > levelB;
+        if (a.m_pixelCount != b.m_pixelCount)
+            return a.m_pixelCount > b.m_pixelCount;
+        return a.m_page < b.m_page;
+    });
+}
+
+void PageTable::SetLoading(unsigned int page)
+{
+    if (m_pages.find(page) == m_pages.end())
+        m_pages[page] = { PageState::Loading, 0 };
+}
+
+void PageTable::CancelLoading(unsigned int page)
+{
+    auto found = m_pages.find(page);
+    if (found != m_pages.end() && found->second.m_state == PageState::Loading)
+        m_pages.erase(found);
+}
+
+void PageTable::Touch(unsigned int slot)
+{
+    m_slots[slot].m_lastFrame = m_frame;
+    m_leastRecent.splice(m_leastRecent.end(), m_leastRecent, m_slots[slot].m_order);
+}
+
+bool PageTable::Map(unsigned int page, unsigned int& slot, unsigned int& evictedPage)
+{
+    evictedPage = c_noPage;
+
+    auto found = m_pages.find(page);
+    if (found != m_pages.end() && found->second.m_state == PageState::Resident)
+    {
+        slot = found->second.m_slot;
+        return true;
+    }
+
+    if (m_freeSlots.empty())
+    {
+        // Find the least recently used page that isn't needed this frame. The last level is kept for good.
+        for (unsigned int candidate : m_leastRecent)
+        {
+            if (m_slots[candidate].m_lastFrame == m_frame)
+                break;
+            if (GetPageLevel(m_slots[candidate].m_page) == m_levelCount - 1)
+                continue;
+
+            evictedPage = m_slots[candidate].m_page;
+            break;
+        }
+
+        if (evictedPage == c_noPage)
+            return false;
+
+        Unmap(evictedPage);
+    }
+
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    m_slots[slot].m_page = page;
+    m_slots[slot].m_used = true;
+    m_slots[slot].m_lastFrame = m_frame;
+    m_slots[slot].m_order = m_leastRecent.insert(m_leastRecent.end(), slot);
+    m_pages[page] = { PageState::Resident, slot };
+
+    unsigned int level = GetPageLevel(page);
+    unsigned int entry = (slot % m_slotsX) | ((slot / m_slotsX) << 8) | (level << 16) | (255u << 24);
+    WriteEntries(level, GetPageX(page), GetPageY(page), level + 1, entry);
+    return true;
+}
+
+void PageTable::Unmap(unsigned int page)
+{
+    auto found = m_pages.find(page);
+    if (found == m_pages.end())
+        return;
+
+    if (found->second.m_state == PageState::Resident)
+    {
+        unsigned int slot = found->second.m_slot;
+        m_slots[slot].m_used = false;
+        m_leastRecent.erase(m_slots[slot].m_order);
+        m_freeSlots.push_back(slot);
+
+        // Entries that used this page now use whatever their parent uses.
+        unsigned int level = GetPageLevel(page);
+        unsigned int x = GetPageX(page);
+        unsigned int y = GetPageY(page);
+        unsigned int parentEntry = level + 1 < m_levelCount ? GetEntry(level + 1, x / 2, y / 2) : 0;
+        WriteEntries(level, x, y, level, parentEntry);
+    }
+
+    m_pages.erase(found);
+}
+
+void PageTable::WriteEntries(unsigned int level, unsigned int x, unsigned int y, unsigned int minLevel, unsigned int entry)
+{
+    for (int i = (int)level; i >= 0; i--)
+    {
+        unsigned int shift = level - i;
+        unsigned int levelPages = m_pageCount >> i;
+        unsigned int minX = x << shift;
+        unsigned int minY = y << shift;
+        unsigned int maxX = ((x + 1) << shift) - 1;
+        unsigned int maxY = ((y + 1) << shift) - 1;
+
+        for (unsigned int entryY = minY; entryY <= maxY; entryY++)
+        {
+            unsigned int* row = m_entries[i].data() + entryY * levelPages;
+            for (unsigned int entryX = minX; entryX <= maxX; entryX++)
+            {
+                unsigned int current = row[entryX];
+                if ((current >> 24) == 0 || ((current >> 16) & 0xFF) >= minLevel)
+                    row[entryX] = entry;
+            }
+        }
+
+        MarkDirty(i, minX, minY, maxX, maxY);
+    }
+}
+
+void PageTable::MarkDirty(unsigned int level, unsigned int minX, unsigned int minY, unsigned int maxX, unsigned int maxY)
+{
+    DirtyRect& rect = m_dirty[level];
+    if (!rect.m_dirty)
+    {
+        rect.m_minX = minX;
+        rect.m_minY = minY;
+        rect.m_maxX = maxX;
+        rect.m_maxY = maxY;
+        rect.m_dirty = true;
+        return;
+    }
+
+    rect.m_minX = std::min(rect.m_minX, minX);
+    rect.m_minY = std::min(rect.m_minY, minY);
+    rect.m_maxX = std::max(rect.m_maxX, maxX);
+    rect.m_maxY = std::max(rect.m_maxY, maxY);
+}
+
+bool PageTable::IsResident(unsigned int page)
+{
+    auto found = m_pages.find(page);
+    return found != m_pages.end() && found->second.m_state == PageState::Resident;
+}
+
+bool PageTable::IsLoading(unsigned int page)
+{
+    auto found = m_pages.find(page);
+    return found != m_pages.end() && found->second.m_state == PageState::Loading;
+}
+
+bool PageTable::GetSlotPage(unsigned int slot, unsigned int& page)
+{
+    if (slot >= m_slots.size() || !m_slots[slot].m_used)
+        return false;
+
+    page = m_slots[slot].m_page;
+    return true;
+}
+
+const unsigned int* PageTable::GetEntries(unsigned int level)
+{
+    return m_entries[level].data();
+}
+
+unsigned int PageTable::GetEntry(unsigned int level, unsigned int x, unsigned int y)
+{
+    return m_entries[level][y * (m_pageCount >> level) + x];
+}
+
+bool PageTable::GetDirtyRect(unsigned int level, unsigned int& x, unsigned int& y, unsigned int& width, unsigned int& height)
+{
+    const DirtyRect& rect = m_dirty[level];
+    if (!rect.m_dirty)
+        return false;
+
+    x = rect.m_minX;
+    y = rect.m_minY;
+    width = rect.m_maxX - rect.m_minX + 1;
+    height = rect.m_maxY - rect.m_minY + 1;
+    return true;
+}
+
+void PageTable::ClearDirty()
+{
+    for (DirtyRect& rect : m_dirty)
+    {
+        rect.m_dirty = false;
+    }
+}
+
+unsigned int PageTable::GetPageCount()
+{
+    return m_pageCount;
+}
+
+unsigned int PageTable::GetLevelCount()
+{
+    return m_levelCount;
+}
+
+unsigned int PageTable::GetSlotCount()
+{
+    return (unsigned int)m_slots.size();
+}
+
+unsigned int PageTable::GetResidentCount()
+{
+    return (unsigned int)(m_slots.size() - m_freeSlots.size());
+}
+
+unsigned int PageTable::GetFrame()
+{
+    return m_frame;
+}
@@ -0,0 +1,158 @@
+/*
+Title: Object Loading
+File Name: pageTable.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstddef>
+
+// A page that was seen in the feedback but isn't in the cache yet.
+struct PageRequest
+{
+    unsigned int m_page;
+    // Feedback pixels that asked for it. Pages only needed as a fallback for finer pages get 0.
+    unsigned int m_pixelCount;
+};
+
+// Cpu side bookkeeping for a virtual texture: which pages are in the physical cache, and where.
+// This doesn't touch opengl, so it can be used (and checked) without a gpu.
+//
+// The indirection table has one entry per page of every level. An entry points at the cache slot
+// of the finest resident page covering it, so a missing page falls back to a blurrier one.
+// Entries are RGBA8: slot x, slot y, level of the resident page, and 255 once anything is resident.
+class PageTable
+{
+private:
+    // A slot of the physical cache, and the page in it.
+    struct Slot
+    {
+        unsigned int m_page;
+        bool m_used = false;
+        // Frame the page was last seen in the feedback.
+        unsigned int m_lastFrame = 0;
+        // Position in m_leastRecent.
+        std::list<unsigned int>::iterator m_order;
+    };
+
+    enum class PageState
+    {
+        Loading,
+        Resident
+    };
+
+    struct PageEntry
+    {
+        PageState m_state;
+        unsigned int m_slot;
+    };
+
+    // Rectangle of entries changed since the last upload, per level.
+    struct DirtyRect
+    {
+        unsigned int m_minX;
+        unsigned int m_minY;
+        unsigned int m_maxX;
+        unsigned int m_maxY;
+        bool m_dirty = false;
+    };
+
+    unsigned int m_pageCount;
+    unsigned int m_levelCount;
+    unsigned int m_slotsX;
+    unsigned int m_slotsY;
+
+    std::vector<Slot> m_slots;
+    // Used slots, least recently used first.
+    std::list<unsigned int> m_leastRecent;
+    std::vector<unsigned int> m_freeSlots;
+
+    // Pages that are loading or resident. Missing pages aren't stored, there can be millions of them.
+    std::unordered_map<unsigned int, PageEntry> m_pages;
+
+    std::vector<std::vector<unsigned int>> m_entries;
+    std::vector<DirtyRect> m_dirty;
+
+    unsigned int m_frame = 0;
+
+    // Keeps the sorted feedback between frames, so it isn't reallocated.
+    std::vector<unsigned int> m_feedbackPages;
+
+    // Marks a resident page as used this frame.
+    void Touch(unsigned int slot);
+
+    // Sets every entry under a page (at its level and all finer levels) that is empty, or resolves to minLevel or coarser.
+    void WriteEntries(unsigned int level, unsigned int x, unsigned int y, unsigned int minLevel, unsigned int entry);
+    void MarkDirty(unsigned int level, unsigned int minX, unsigned int minY, unsigned int maxX, unsigned int maxY);
+
+public:
+    // Stands for no page, like a Map that didn't need to evict anything.
+    static const unsigned int c_noPage = 0xFFFFFFFF;
+
+    // pageCount is the number of pages along each side of level 0, a power of two.
+    // The physical cache holds slotsX x slotsY pages. Both must be 256 or less, so slots fit in a byte.
+    PageTable(unsigned int pageCount, unsigned int slotsX, unsigned int slotsY);
+
+    // Pages are packed into one number: the level in the top 8 bits, then 12 bits each of y and x.
+    static unsigned int MakePage(unsigned int level, unsigned int x, unsigned int y);
+    static unsigned int GetPageLevel(unsigned int page);
+    static unsigned int GetPageX(unsigned int page);
+    static unsigned int GetPageY(unsigned int page);
+
+    // Decodes a feedback pixel (read back as RGBA8 into a 32 bit integer) into a page.
+    // Returns false for background pixels, which have 0 in alpha.
+    static bool DecodeFeedback(unsigned int pixel, unsigned int& page);
+
+    // Starts a new frame, then reads a feedback buffer.
+    // Every requested page that is resident (and its coarser parents) is marked as used.
+    // Missing pages, and missing parents they would fall back to, are added to requests,
+    // coarsest level first, then by how many pixels asked for them. Pages already loading are skipped.
+    void AnalyzeFeedback(const unsigned int* pixels, size_t count, std::vector<PageRequest>& requests);
+
+    // Remembers that a page is being loaded, so the feedback doesn't request it again.
+    void SetLoading(unsigned int page);
+    // Forgets a load that was dropped.
+    void CancelLoading(unsigned int page);
+
+    // Puts a loaded page into a slot, evicting the least recently used page if the cache is full.
+    // Pages used in the current frame and the last level (the fallback for everything) are never evicted.
+    // Returns false if every slot is in use, then the page isn't mapped. evictedPage is c_noPage if nothing was evicted.
+    bool Map(unsigned int page, unsigned int& slot, unsigned int& evictedPage);
+    // Removes a page from the cache. Its entries fall back to the parent page.
+    void Unmap(unsigned int page);
+
+    bool IsResident(unsigned int page);
+    bool IsLoading(unsigned int page);
+    // The page in a slot, or false if the slot is free.
+    bool GetSlotPage(unsigned int slot, unsigned int& page);
+
+    // Entries of one level, (pageCount >> level) x (pageCount >> level), rows bottom first.
+    const unsigned int* GetEntries(unsigned int level);
+    unsigned int GetEntry(unsigned int level, unsigned int x, unsigned int y);
+
+    // Returns the rectangle of entries changed since ClearDirty, or false if the level didn't change.
+    bool GetDirtyRect(unsigned int level, unsigned int& x, unsigned int& y, unsigned int& width, unsigned int& height);
+    void ClearDirty();
+
+    unsigned int GetPageCount();
+    unsigned int GetLevelCount();
+    unsigned int GetSlotCount();
+    unsigned int GetResidentCount();
+    unsigned int GetFrame();
+};
@@ -0,0 +1,655 @@
+/*
+Title: Object Loading
+File Name: pixelConvert.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pixelConvert.h"
+#include "cpuFeatures.h"
+#include <cstring>
+#include <immintrin.h>
+
+// Visual Studio lets any function use any intrinsic. Gcc and clang need to be told which functions may.
+#ifdef _MSC_VER
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#else
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+SimdLevel PixelConvert::s_level = PixelConvert::GetSupportedLevel();
+
+// ----------------------------------------------------------------------------
+// Scalar kernels, also used for the pixels left over after the vector loops.
+// ----------------------------------------------------------------------------
+
+static void BGRToBGRAScalar(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, src += 3, dst += 4)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 255;
+    }
+}
+
+static void RGBToBGRAScalar(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, src += 3, dst += 4)
+    {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 255;
+    }
+}
+
+static void RGBAToBGRAScalar(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, src += 4, dst += 4)
+    {
+        unsigned char red = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = red;
+        dst[3] = src[3];
+    }
+}
+
+static void GrayToBGRAScalar(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, dst += 4)
+    {
+        dst[0] = dst[1] = dst[2] = src[i];
+        dst[3] = 255;
+    }
+}
+
+static void RGB16ToBGRAScalar(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, src += 3, dst += 4)
+    {
+        dst[0] = (unsigned char)(src[2] >> 8);
+        dst[1] = (unsigned char)(src[1] >> 8);
+        dst[2] = (unsigned char)(src[0] >> 8);
+        dst[3] = 255;
+    }
+}
+
+static void RGBA16ToBGRAScalar(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, src += 4, dst += 4)
+    {
+        dst[0] = (unsigned char)(src[2] >> 8);
+        dst[1] = (unsigned char)(src[1] >> 8);
+        dst[2] = (unsigned char)(src[0] >> 8);
+        dst[3] = (unsigned char)(src[3] >> 8);
+    }
+}
+
+static void Gray16ToBGRAScalar(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, dst += 4)
+    {
+        dst[0] = dst[1] = dst[2] = (unsigned char)(src[i] >> 8);
+        dst[3] = 255;
+    }
+}
+
+// Exact round(value * alpha / 255), without a divide.
+static inline unsigned char MultiplyAlpha(unsigned int value, unsigned int alpha)
+{
+    unsigned int product = value * alpha + 128;
+    return (unsigned char)((product + (product >> 8)) >> 8);
+}
+
+static void PremultiplyAlphaScalar(unsigned char* pixels, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, pixels += 4)
+    {
+        unsigned int alpha = pixels[3];
+        pixels[0] = MultiplyAlpha(pixels[0], alpha);
+        pixels[1] = MultiplyAlpha(pixels[1], alpha);
+        pixels[2] = MultiplyAlpha(pixels[2], alpha);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// SSSE3 kernels. pshufb does every swizzle in one instruction.
+// Loads that would read past the end of the row stop early, and the scalar kernel finishes up.
+// ----------------------------------------------------------------------------
+
+TARGET_SSSE3 static void BGRToBGRASSSE3(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+    // 4 pixels are 12 bytes, but the load reads 16.
+    unsigned int i = 0;
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    BGRToBGRAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void RGBToBGRASSSE3(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+    unsigned int i = 0;
+    for (; i + 6 <= count; i += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    RGBToBGRAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void RGBAToBGRASSSE3(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(pixels, shuffle));
+    }
+    RGBAToBGRAScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void GrayToBGRASSSE3(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m128i alpha = _mm_set1_epi8((char)255);
+
+    // Interleave gray with itself and with alpha, then interleave those pairs: g g g 255.
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i gray = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i grayGrayLow = _mm_unpacklo_epi8(gray, gray);
+        __m128i grayGrayHigh = _mm_unpackhi_epi8(gray, gray);
+        __m128i grayAlphaLow = _mm_unpacklo_epi8(gray, alpha);
+        __m128i grayAlphaHigh = _mm_unpackhi_epi8(gray, alpha);
+
+        __m128i* out = (__m128i*)(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(grayGrayLow, grayAlphaLow));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(grayGrayLow, grayAlphaLow));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(grayGrayHigh, grayAlphaHigh));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(grayGrayHigh, grayAlphaHigh));
+    }
+    GrayToBGRAScalar(src + i, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void RGB16ToBGRASSSE3(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    // Pick the high byte of each channel, 2 pixels (12 bytes) from each load.
+    const __m128i shuffleLow = _mm_setr_epi8(5, 3, 1, -1, 11, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i shuffleHigh = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 5, 3, 1, -1, 11, 9, 7, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+    // 4 pixels are 24 bytes, but the second load reads up to byte 28.
+    unsigned int i = 0;
+    for (; i + 5 <= count; i += 4)
+    {
+        const unsigned char* bytes = (const unsigned char*)(src + i * 3);
+        __m128i low = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)bytes), shuffleLow);
+        __m128i high = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(bytes + 12)), shuffleHigh);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_or_si128(low, high), alpha));
+    }
+    RGB16ToBGRAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void RGBA16ToBGRASSSE3(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    // Keep the high byte of every channel, pack them down to bytes, then swap red and blue.
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i first = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i * 4)), 8);
+        __m128i second = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i * 4 + 8)), 8);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_shuffle_epi8(_mm_packus_epi16(first, second), shuffle));
+    }
+    RGBA16ToBGRAScalar(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_SSSE3 static void Gray16ToBGRASSSE3(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    const __m128i alpha = _mm_set1_epi8((char)255);
+
+    unsigned int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i first = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i)), 8);
+        __m128i second = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i + 8)), 8);
+        __m128i gray = _mm_packus_epi16(first, second);
+
+        __m128i grayGrayLow = _mm_unpacklo_epi8(gray, gray);
+        __m128i grayGrayHigh = _mm_unpackhi_epi8(gray, gray);
+        __m128i grayAlphaLow = _mm_unpacklo_epi8(gray, alpha);
+        __m128i grayAlphaHigh = _mm_unpackhi_epi8(gray, alpha);
+
+        __m128i* out = (__m128i*)(dst + i * 4);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(grayGrayLow, grayAlphaLow));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(grayGrayLow, grayAlphaLow));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(grayGrayHigh, grayAlphaHigh));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(grayGrayHigh, grayAlphaHigh));
+    }
+    Gray16ToBGRAScalar(src + i, dst + i * 4, count - i);
+}
+
+// Premultiplies 2 pixels widened to 16 bits per channel.
+TARGET_SSSE3 static inline __m128i PremultiplyWide(__m128i pixels, __m128i alphaMask)
+{
+    // Copy each pixel's alpha into all 4 of its channels.
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128i product = _mm_add_epi16(_mm_mullo_epi16(pixels, alpha), _mm_set1_epi16(128));
+    __m128i result = _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+
+    // Alpha itself stays as it was.
+    return _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, pixels));
+}
+
+TARGET_SSSE3 static void PremultiplyAlphaSSSE3(unsigned char* pixels, unsigned int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i* address = (__m128i*)(pixels + i * 4);
+        __m128i packed = _mm_loadu_si128(address);
+        __m128i low = PremultiplyWide(_mm_unpacklo_epi8(packed, zero), alphaMask);
+        __m128i high = PremultiplyWide(_mm_unpackhi_epi8(packed, zero), alphaMask);
+        _mm_storeu_si128(address, _mm_packus_epi16(low, high));
+    }
+    PremultiplyAlphaScalar(pixels + i * 4, count - i);
+}
+
+// ----------------------------------------------------------------------------
+// AVX2 kernels. Shuffles only work within each 128 bit half, so each half gets its own load.
+// ----------------------------------------------------------------------------
+
+TARGET_AVX2 static inline __m256i LoadHalves(const unsigned char* low, const unsigned char* high)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)low)), _mm_loadu_si128((const __m128i*)high), 1);
+}
+
+TARGET_AVX2 static void BGRToBGRAAVX2(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    // 8 pixels are 24 bytes, but the second load reads up to byte 28.
+    unsigned int i = 0;
+    for (; i + 10 <= count; i += 8)
+    {
+        const unsigned char* bytes = src + i * 3;
+        __m256i pixels = _mm256_shuffle_epi8(LoadHalves(bytes, bytes + 12), shuffle);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(pixels, alpha));
+    }
+    BGRToBGRASSSE3(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void RGBToBGRAAVX2(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+        2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    unsigned int i = 0;
+    for (; i + 10 <= count; i += 8)
+    {
+        const unsigned char* bytes = src + i * 3;
+        __m256i pixels = _mm256_shuffle_epi8(LoadHalves(bytes, bytes + 12), shuffle);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(pixels, alpha));
+    }
+    RGBToBGRASSSE3(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void RGBAToBGRAAVX2(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(pixels, shuffle));
+    }
+    RGBAToBGRASSSE3(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void GrayToBGRAAVX2(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    // Widen each gray byte to 32 bits, and multiply by 0x010101 to copy it into blue, green and red.
+    const __m256i spread = _mm256_set1_epi32(0x00010101);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i gray = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + i)));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(_mm256_mullo_epi32(gray, spread), alpha));
+    }
+    GrayToBGRASSSE3(src + i, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void RGB16ToBGRAAVX2(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    const __m256i shuffleLow = _mm256_setr_epi8(5, 3, 1, -1, 11, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        5, 3, 1, -1, 11, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i shuffleHigh = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 5, 3, 1, -1, 11, 9, 7, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, 5, 3, 1, -1, 11, 9, 7, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    // Pixels 0-1 and 4-5 come from the first pair of loads, 2-3 and 6-7 from the second.
+    // 8 pixels are 48 bytes, but the last load reads up to byte 52.
+    unsigned int i = 0;
+    for (; i + 9 <= count; i += 8)
+    {
+        const unsigned char* bytes = (const unsigned char*)(src + i * 3);
+        __m256i low = _mm256_shuffle_epi8(LoadHalves(bytes, bytes + 24), shuffleLow);
+        __m256i high = _mm256_shuffle_epi8(LoadHalves(bytes + 12, bytes + 36), shuffleHigh);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(_mm256_or_si256(low, high), alpha));
+    }
+    RGB16ToBGRASSSE3(src + i * 3, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void RGBA16ToBGRAAVX2(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i first = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(src + i * 4)), 8);
+        __m256i second = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(src + i * 4 + 16)), 8);
+
+        // Packing works per half, which leaves the pixels in the order 0-1 4-5 2-3 6-7, so put them back in order.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(packed, shuffle));
+    }
+    RGBA16ToBGRASSSE3(src + i * 4, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static void Gray16ToBGRAAVX2(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    const __m256i spread = _mm256_set1_epi32(0x00010101);
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i gray = _mm256_srli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i))), 8);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_or_si256(_mm256_mullo_epi32(gray, spread), alpha));
+    }
+    Gray16ToBGRASSSE3(src + i, dst + i * 4, count - i);
+}
+
+TARGET_AVX2 static inline __m256i PremultiplyWideAVX2(__m256i pixels, __m256i alphaMask)
+{
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m256i product = _mm256_add_epi16(_mm256_mullo_epi16(pixels, alpha), _mm256_set1_epi16(128));
+    __m256i result = _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+
+    return _mm256_blendv_epi8(result, pixels, alphaMask);
+}
+
+TARGET_AVX2 static void PremultiplyAlphaAVX2(unsigned char* pixels, unsigned int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+
+    // Unpacking and packing both work per half, so the pixels come back out in the order they went in.
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i* address = (__m256i*)(pixels + i * 4);
+        __m256i packed = _mm256_loadu_si256(address);
+        __m256i low = PremultiplyWideAVX2(_mm256_unpacklo_epi8(packed, zero), alphaMask);
+        __m256i high = PremultiplyWideAVX2(_mm256_unpackhi_epi8(packed, zero), alphaMask);
+        _mm256_storeu_si256(address, _mm256_packus_epi16(low, high));
+    }
+    PremultiplyAlphaSSSE3(pixels + i * 4, count - i);
+}
+
+// ----------------------------------------------------------------------------
+// Dispatch
+// ----------------------------------------------------------------------------
+
+SimdLevel PixelConvert::GetSupportedLevel()
+{
+    if (CpuFeatures::HasAVX2())
+        return SimdLevel::AVX2;
+    if (CpuFeatures::HasSSSE3())
+        return SimdLevel::SSSE3;
+    return SimdLevel::Scalar;
+}
+
+SimdLevel PixelConvert::GetLevel()
+{
+    return s_level;
+}
+
+void PixelConvert::SetLevel(SimdLevel level)
+{
+    SimdLevel supported = GetSupportedLevel();
+    s_level = (int)level < (int)supported ? level : supported;
+}
+
+void PixelConvert::BGRToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: BGRToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: BGRToBGRASSSE3(src, dst, count); break;
+    default: BGRToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::RGBToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: RGBToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: RGBToBGRASSSE3(src, dst, count); break;
+    default: RGBToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::RGBAToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: RGBAToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: RGBAToBGRASSSE3(src, dst, count); break;
+    default: RGBAToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::GrayToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: GrayToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: GrayToBGRASSSE3(src, dst, count); break;
+    default: GrayToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::RGB16ToBGRA(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: RGB16ToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: RGB16ToBGRASSSE3(src, dst, count); break;
+    default: RGB16ToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::RGBA16ToBGRA(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: RGBA16ToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: RGBA16ToBGRASSSE3(src, dst, count); break;
+    default: RGBA16ToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::Gray16ToBGRA(const unsigned short* src, unsigned char* dst, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: Gray16ToBGRAAVX2(src, dst, count); break;
+    case SimdLevel::SSSE3: Gray16ToBGRASSSE3(src, dst, count); break;
+    default: Gray16ToBGRAScalar(src, dst, count); break;
+    }
+}
+
+void PixelConvert::PremultiplyAlpha(unsigned char* pixels, unsigned int count)
+{
+    switch (s_level)
+    {
+    case SimdLevel::AVX2: PremultiplyAlphaAVX2(pixels, count); break;
+    case SimdLevel::SSSE3: PremultiplyAlphaSSSE3(pixels, count); break;
+    default: PremultiplyAlphaScalar(pixels, count); break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Bitmaps
+// ----------------------------------------------------------------------------
+
+bool PixelConvert::Convert(FIBITMAP* bitmap, unsigned char* dst, bool premultiply)
+{
+    FREE_IMAGE_TYPE type = FreeImage_GetImageType(bitmap);
+    unsigned int bpp = FreeImage_GetBPP(bitmap);
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+
+    // Work out which kernel the rows need, before touching dst.
+    enum class Source { BGR, BGRA, Gray, Palette, RGB16, RGBA16, Gray16 };
+    Source source;
+    if (type == FIT_BITMAP && bpp == 24)
+        source = Source::BGR;
+    else if (type == FIT_BITMAP && bpp == 32)
+        source = Source::BGRA;
+    else if (type == FIT_BITMAP && bpp == 8)
+        source = FreeImage_GetColorType(bitmap) == FIC_MINISBLACK && !FreeImage_IsTransparent(bitmap) ? Source::Gray : Source::Palette;
+    else if (type == FIT_RGB16)
+        source = Source::RGB16;
+    else if (type == FIT_RGBA16)
+        source = Source::RGBA16;
+    else if (type == FIT_UINT16)
+        source = Source::Gray16;
+    else
+        return false;
+
+    // Paletted images look up each index. Indices past the transparency table are opaque.
+    RGBQUAD* palette = FreeImage_GetPalette(bitmap);
+    BYTE* transparency = FreeImage_GetTransparencyTable(bitmap);
+    unsigned int transparencyCount = FreeImage_IsTransparent(bitmap) ? FreeImage_GetTransparencyCount(bitmap) : 0;
+    if (source == Source::Palette && palette == nullptr)
+        return false;
+
+    // FreeImage stores rows bottom first too, each padded to 4 bytes, so convert row by row.
+    for (unsigned int y = 0; y < height; y++)
+    {
+        const BYTE* row = FreeImage_GetScanLine(bitmap, y);
+        unsigned char* out = dst + (size_t)y * width * 4;
+
+        switch (source)
+        {
+        case Source::BGR:
+            BGRToBGRA(row, out, width);
+            break;
+        case Source::BGRA:
+            memcpy(out, row, (size_t)width * 4);
+            break;
+        case Source::Gray:
+            GrayToBGRA(row, out, width);
+            break;
+        case Source::Palette:
+            for (unsigned int x = 0; x < width; x++)
+            {
+                const RGBQUAD& color = palette[row[x]];
+                out[x * 4 + 0] = color.rgbBlue;
+                out[x * 4 + 1] = color.rgbGreen;
+                out[x * 4 + 2] = color.rgbRed;
+                out[x * 4 + 3] = row[x] < transparencyCount ? transparency[row[x]] : 255;
+            }
+            break;
+        case Source::RGB16:
+            RGB16ToBGRA(reinterpret_cast<const unsigned short*>(row), out, width);
+            break;
+        case Source::RGBA16:
+            RGBA16ToBGRA(reinterpret_cast<const unsigned short*>(row), out, width);
+            break;
+        case Source::Gray16:
+            Gray16ToBGRA(reinterpret_cast<const unsigned short*>(row), out, width);
+            break;
+        }
+
+        if (premultiply)
+            PremultiplyAlpha(out, width);
+    }
+
+    return true;
+}
+
+bool PixelConvert::Convert(FIBITMAP* bitmap, std::vector<unsigned char>& pixels, bool premultiply)
+{
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    pixels.resize((size_t)width * height * 4);
+
+    if (Convert(bitmap, pixels.data(), premultiply))
+        return true;
+
+    // No kernel for this format, let FreeImage convert it.
+    FIBITMAP* bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
+    if (bitmap32 == nullptr)
+    {
+        pixels.clear();
+        return false;
+    }
+
+    for (unsigned int y = 0; y < height; y++)
+    {
+        unsigned char* out = pixels.data() + (size_t)y * width * 4;
+        memcpy(out, FreeImage_GetScanLine(bitmap32, y), (size_t)width * 4);
+        if (premultiply)
+            PremultiplyAlpha(out, width);
+    }
+
+    FreeImage_Unload(bitmap32);
+    return true;
+}
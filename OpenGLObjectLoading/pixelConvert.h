@@ -0,0 +1,71 @@
+/*
+Title: Object Loading
+File Name: pixelConvert.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "FreeImage.h"
+#include <vector>
+
+// Instruction sets the conversion kernels can use. The best one the cpu supports is picked at startup.
+enum class SimdLevel
+{
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+// Converts decoded images into the 32 bit BGRA pixels textures are uploaded as.
+// FreeImage_ConvertTo32Bits allocates a whole second bitmap to do this. These kernels instead
+// write straight into the buffer the pixels are uploaded from, a row at a time.
+// Row kernels take a pixel count, and read and write exactly that many pixels.
+class PixelConvert
+{
+private:
+    static SimdLevel s_level;
+
+public:
+    // 24 bit BGR (the order FreeImage uses) to BGRA, with opaque alpha.
+    static void BGRToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count);
+    // 24 bit RGB to BGRA, with opaque alpha.
+    static void RGBToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count);
+    // Swaps red and blue, so RGBA becomes BGRA and the other way around.
+    static void RGBAToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count);
+    // 8 bit grayscale to BGRA, with opaque alpha.
+    static void GrayToBGRA(const unsigned char* src, unsigned char* dst, unsigned int count);
+    // 16 bit per channel RGB, RGBA and grayscale to BGRA. Channels keep their top 8 bits, like FreeImage does.
+    static void RGB16ToBGRA(const unsigned short* src, unsigned char* dst, unsigned int count);
+    static void RGBA16ToBGRA(const unsigned short* src, unsigned char* dst, unsigned int count);
+    static void Gray16ToBGRA(const unsigned short* src, unsigned char* dst, unsigned int count);
+    // Multiplies color by alpha in place, rounded to the nearest value.
+    // Premultiplied textures don't get dark fringes where filtering blends opaque and clear texels.
+    static void PremultiplyAlpha(unsigned char* pixels, unsigned int count);
+
+    // Converts a bitmap to BGRA, rows packed with the bottom row first, like opengl expects.
+    // dst must hold width * height * 4 bytes. Returns false for formats without a kernel
+    // (like 1 and 4 bit, 16 bit 565 or floats), and leaves dst alone.
+    static bool Convert(FIBITMAP* bitmap, unsigned char* dst, bool premultiply = false);
+    // Same, but resizes pixels to fit, and falls back to FreeImage_ConvertTo32Bits for formats without a kernel.
+    // Returns false if even FreeImage can't convert it.
+    static bool Convert(FIBITMAP* bitmap, std::vector<unsigned char>& pixels, bool premultiply = false);
+
+    // The best instruction set this cpu supports.
+    static SimdLevel GetSupportedLevel();
+    // The instruction set in use. It can be lowered to compare kernels, but not raised past what's supported.
+    static SimdLevel GetLevel();
+    static void SetLevel(SimdLevel level);
+};
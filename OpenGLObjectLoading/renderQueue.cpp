@@ -0,0 +1,156 @@
+/*
+Title: Object Loading
+File Name: renderQueue.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "renderQueue.h"
+#include <cstring>
+
+RenderQueue::RenderQueue(const char* worldMatrixName)
+{
+    m_worldMatrixName = worldMatrixName;
+}
+
+void RenderQueue::Begin(glm::vec3 cameraPosition, float farPlane, float lodScale)
+{
+    m_items.clear();
+    m_entries.clear();
+    m_cameraPosition = cameraPosition;
+    m_farPlane = farPlane;
+    m_lodScale = lodScale;
+}
+
+unsigned long long RenderQueue::MakeKey(const RenderItem& item, unsigned int pass)
+{
+    unsigned long long program = item.m_material->GetShaderProgram()->GetGLShaderProgram() & 0xFFF;
+    unsigned long long textures = item.m_material->GetTextureSetKey() & 0xFFF;
+    unsigned long long mesh = item.m_mesh->GetId() & 0xFFF;
+
+    // Distance from the camera to the object's origin, scaled to 24 bits.
+    glm::vec3 position = glm::vec3(item.m_worldMatrix[3]);
+    float distance = glm::length(position - m_cameraPosition) / m_farPlane;
+    distance = glm::clamp(distance, 0.0f, 1.0f);
+    unsigned long long depth = (unsigned long long)(distance * 0xFFFFFF);
+
+    return ((unsigned long long)(pass & 0xF) << 60) | (program << 48) | (textures << 36) | (mesh << 24) | depth;
+}
+
+void RenderQueue::Submit(Mesh* mesh, Material* material, const glm::mat4& worldMatrix, unsigned int pass, int submesh)
+{
+    RenderItem item;
+    item.m_mesh = mesh;
+    item.m_material = material;
+    item.m_worldMatrix = worldMatrix;
+    item.m_submesh = submesh;
+    item.m_lod = mesh->SelectLod(worldMatrix, m_cameraPosition, m_lodScale, submesh);
+
+    SortEntry entry;
+    entry.m_key = MakeKey(item, pass);
+    entry.m_item = (unsigned int)m_items.size();
+
+    m_items.push_back(item);
+    m_entries.push_back(entry);
+}
+
+void RenderQueue::RadixSort()
+{
+    size_t count = m_entries.size();
+    m_sortBuffer.resize(count);
+
+    SortEntry* source = m_entries.data();
+    SortEntry* destination = m_sortBuffer.data();
+
+    // Sort one byte at a time, starting with the lowest byte.
+    // Each pass is stable, so the order from earlier passes is kept for equal bytes.
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t counts[256];
+        memset(counts, 0, sizeof(counts));
+
+        for (size_t i = 0; i < count; i++)
+            counts[(source[i].m_key >> shift) & 0xFF]++;
+
+        // If every key has the same byte here, this pass wouldn't move anything.
+        if (counts[(source[0].m_key >> shift) & 0xFF] == count)
+            continue;
+
+        // Turn the counts into the first output position of each byte value.
+        size_t offset = 0;
+        for (int i = 0; i < 256; i++)
+        {
+            size_t c = counts[i];
+            counts[i] = offset;
+            offset += c;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            destination[counts[(source[i].m_key >> shift) & 0xFF]++] = source[i];
+
+        SortEntry* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    // If the result ended up in the second buffer, copy it back.
+    if (source != m_entries.data())
+        memcpy(m_entries.data(), source, count * sizeof(SortEntry));
+}
+
+void RenderQueue::Execute()
+{
+    if (m_entries.empty())
+        return;
+
+    RadixSort();
+
+    Material* currentMaterial = nullptr;
+    ShaderProgram* currentProgram = nullptr;
+    int worldMatrixHandle = -1;
+
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        const RenderItem& item = m_items[m_entries[i].m_item];
+
+        // Only bind a material when it changes.
+        // Materials sharing a program or textures still skip those binds through GLState.
+        if (item.m_material != currentMaterial)
+        {
+            currentMaterial = item.m_material;
+            currentMaterial->Bind();
+
+            // Look the world matrix up once per program, not once per draw.
+            if (currentMaterial->GetShaderProgram() != currentProgram)
+            {
+                currentProgram = currentMaterial->GetShaderProgram();
+                worldMatrixHandle = currentProgram->GetUniformHandle(m_worldMatrixName.c_str());
+            }
+        }
+
+        if (worldMatrixHandle != -1)
+            currentProgram->SetMatrix(worldMatrixHandle, &item.m_worldMatrix[0][0]);
+
+        if (item.m_submesh < 0)
+            item.m_mesh->Draw(item.m_lod);
+        else
+            item.m_mesh->DrawSubmesh((unsigned int)item.m_submesh, item.m_lod);
+    }
+}
+
+unsigned int RenderQueue::GetItemCount()
+{
+    return (unsigned int)m_items.size();
+}
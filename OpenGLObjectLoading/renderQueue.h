@@ -0,0 +1,92 @@
+/*
+Title: Object Loading
+File Name: renderQueue.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "mesh.h"
+#include "material.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <string>
+
+// A draw that was submitted to the render queue.
+struct RenderItem
+{
+    Mesh* m_mesh;
+    Material* m_material;
+    glm::mat4 m_worldMatrix;
+    int m_submesh;      // submesh to draw, or -1 for the whole mesh
+    unsigned int m_lod; // level of detail, picked when the item is submitted
+};
+
+// Collects draws for a frame, then sorts them so draws that share state end up next to each other.
+//
+// Every item gets a 64 bit sort key, from the most to the least significant bits:
+//   pass (4 bits) | shader program (12 bits) | texture set (12 bits) | mesh (12 bits) | depth (24 bits)
+// Sorting by that key groups draws by program, then by textures, then by mesh,
+// and draws each group front to back so the depth test can reject hidden pixels early.
+class RenderQueue
+{
+private:
+    // A sort key and the item it belongs to.
+    struct SortEntry
+    {
+        unsigned long long m_key;
+        unsigned int m_item;
+    };
+
+    std::vector<RenderItem> m_items;
+    std::vector<SortEntry> m_entries;
+    // Second buffer for the radix sort to copy into.
+    std::vector<SortEntry> m_sortBuffer;
+
+    // Name of the world matrix uniform in the shader programs.
+    std::string m_worldMatrixName;
+
+    // Camera used for the depth part of the key.
+    glm::vec3 m_cameraPosition;
+    float m_farPlane = 1;
+    // Pixels one unit covers one unit in front of the camera, for picking levels of detail.
+    float m_lodScale = 0;
+
+    // Builds the sort key for an item.
+    unsigned long long MakeKey(const RenderItem& item, unsigned int pass);
+
+    // Sorts m_entries by key.
+    void RadixSort();
+
+public:
+    // worldMatrixName is the uniform each item's world matrix is written to.
+    RenderQueue(const char* worldMatrixName);
+
+    // Starts a new frame of draws.
+    // Items further from the camera than farPlane all get the same depth.
+    // With a lodScale (see FPSController::GetLodScale), each item is drawn at the coarsest level of detail
+    // that doesn't show on screen. Without one, everything is drawn at full detail.
+    void Begin(glm::vec3 cameraPosition, float farPlane, float lodScale = 0);
+
+    // Adds a draw to the queue. Lower passes are drawn first.
+    // Pass a submesh index to only draw that part of the mesh.
+    void Submit(Mesh* mesh, Material* material, const glm::mat4& worldMatrix, unsigned int pass = 0, int submesh = -1);
+
+    // Sorts and draws everything submitted since Begin.
+    void Execute();
+
+    // Number of items submitted since Begin.
+    unsigned int GetItemCount();
+};
@@ -0,0 +1,367 @@
+/*
+Title: Object Loading
+File Name: sceneGraph.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sceneGraph.h"
+#include <algorithm>
+
+unsigned int SceneGraph::AddNode(int parent, const glm::mat4& localMatrix, std::string name)
+{
+    unsigned int node = (unsigned int)m_parents.size();
+
+    // A node in the middle of the arrays would break up its parent's neighbours' subtrees.
+    if (parent >= 0 && m_subtreeEnds[parent] != node)
+    {
+        std::cout << "Can't add scene node " << name << ", its parent isn't on the last branch. Adding it as a root." << std::endl;
+        parent = -1;
+    }
+
+    m_parents.push_back(parent);
+    m_subtreeEnds.push_back(node + 1);
+    m_names.push_back(name);
+    m_localMatrices.push_back(localMatrix);
+    m_worldMatrices.push_back(localMatrix);
+    m_dirty.push_back(0);
+
+    // Every ancestor's subtree now ends after the new node.
+    for (int ancestor = parent; ancestor >= 0; ancestor = m_parents[ancestor])
+    {
+        m_subtreeEnds[ancestor] = node + 1;
+    }
+
+    MarkDirty(node);
+    return node;
+}
+
+unsigned int SceneGraph::AddModel(Mesh* mesh, Material* material, int parent)
+{
+    unsigned int first = (unsigned int)m_parents.size();
+
+    // The mesh's nodes are already depth first, so they can be copied in order.
+    for (unsigned int i = 0; i < mesh->GetNodeCount(); i++)
+    {
+        const MeshNode& meshNode = mesh->GetNode(i);
+        int nodeParent = meshNode.m_parent < 0 ? parent : (int)first + meshNode.m_parent;
+        unsigned int node = AddNode(nodeParent, meshNode.m_localMatrix, meshNode.m_name);
+
+        for (unsigned int s = 0; s < meshNode.m_submeshCount; s++)
+        {
+            AddDraw(node, mesh, mesh->GetNodeSubmesh(meshNode.m_firstSubmesh + s), material);
+        }
+    }
+
+    return first;
+}
+
+void SceneGraph::AddDraw(unsigned int node, Mesh* mesh, unsigned int submesh, Material* material)
+{
+    SceneDraw draw;
+    draw.m_node = node;
+    draw.m_mesh = mesh;
+    draw.m_submesh = submesh;
+    draw.m_material = material;
+    m_draws.push_back(draw);
+}
+
+void SceneGraph::Clear()
+{
+    m_parents.clear();
+    m_subtreeEnds.clear();
+    m_names.clear();
+    m_localMatrices.clear();
+    m_worldMatrices.clear();
+    m_dirty.clear();
+    m_dirtyNodes.clear();
+    m_draws.clear();
+}
+
+int SceneGraph::FindNode(std::string name, int root)
+{
+    unsigned int begin = root < 0 ? 0 : (unsigned int)root;
+    unsigned int end = root < 0 ? (unsigned int)m_names.size() : m_subtreeEnds[root];
+
+    for (unsigned int i = begin; i < end; i++)
+    {
+        if (m_names[i] == name)
+            return (int)i;
+    }
+    return -1;
+}
+
+void SceneGraph::MarkDirty(unsigned int node)
+{
+    if (!m_dirty[node])
+    {
+        m_dirty[node] = 1;
+        m_dirtyNodes.push_back(node);
+    }
+}
+
+unsigned int SceneGraph::SetParent(unsigned int node, int parent)
+{
+    unsigned int end = m_subtreeEnds[node];
+    if (parent >= (int)node && parent < (int)end)
+    {
+        std::cout << "Can't move scene node " << m_names[node] << " below " << m_names[parent] << ", it's in its own subtree." << std::endl;
+        return node;
+    }
+
+    // The new order, as old indices: everything else, with the subtree put back after the new parent's subtree.
+    std::vector<unsigned int> others;
+    for (unsigned int i = 0; i < (unsigned int)m_parents.size(); i++)
+    {
+        if (i < node || i >= end)
+            others.push_back(i);
+    }
+    size_t insert = others.size();
+    if (parent >= 0)
+    {
+        for (size_t i = 0; i < others.size(); i++)
+        {
+            if (others[i] >= (unsigned int)parent && others[i] < m_subtreeEnds[parent])
+                insert = i + 1;
+        }
+    }
+    std::vector<unsigned int> order(others.begin(), others.begin() + insert);
+    for (unsigned int i = node; i < end; i++)
+    {
+        order.push_back(i);
+    }
+    order.insert(order.end(), others.begin() + insert, others.end());
+
+    std::vector<unsigned int> newIndices(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        newIndices[order[i]] = (unsigned int)i;
+    }
+
+    // Rebuild the arrays in the new order. Subtree ends are found again from the back, since children come after parents.
+    std::vector<int> parents(order.size());
+    std::vector<unsigned int> subtreeEnds(order.size());
+    std::vector<std::string> names(order.size());
+    std::vector<glm::mat4> localMatrices(order.size());
+    std::vector<glm::mat4> worldMatrices(order.size());
+    std::vector<unsigned char> dirty(order.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        unsigned int old = order[i];
+        int oldParent = old == node ? parent : m_parents[old];
+        parents[i] = oldParent < 0 ? -1 : (int)newIndices[oldParent];
+        subtreeEnds[i] = (unsigned int)i + 1;
+        names[i] = m_names[old];
+        localMatrices[i] = m_localMatrices[old];
+        worldMatrices[i] = m_worldMatrices[old];
+        dirty[i] = m_dirty[old];
+    }
+    for (size_t i = order.size(); i-- > 0;)
+    {
+        if (parents[i] >= 0)
+            subtreeEnds[parents[i]] = std::max(subtreeEnds[parents[i]], subtreeEnds[i]);
+    }
+
+    m_parents.swap(parents);
+    m_subtreeEnds.swap(subtreeEnds);
+    m_names.swap(names);
+    m_localMatrices.swap(localMatrices);
+    m_worldMatrices.swap(worldMatrices);
+    m_dirty.swap(dirty);
+    for (size_t i = 0; i < m_dirtyNodes.size(); i++)
+    {
+        m_dirtyNodes[i] = newIndices[m_dirtyNodes[i]];
+    }
+    for (size_t i = 0; i < m_draws.size(); i++)
+    {
+        m_draws[i].m_node = newIndices[m_draws[i].m_node];
+    }
+
+    // The subtree has a new parent world matrix.
+    MarkDirty(newIndices[node]);
+    return newIndices[node];
+}
+
+void SceneGraph::SetLocalMatrix(unsigned int node, const glm::mat4& localMatrix)
+{
+    m_localMatrices[node] = localMatrix;
+    MarkDirty(node);
+}
+
+const glm::mat4& SceneGraph::GetLocalMatrix(unsigned int node)
+{
+    return m_localMatrices[node];
+}
+
+const glm::mat4& SceneGraph::GetWorldMatrix(unsigned int node)
+{
+    return m_worldMatrices[node];
+}
+
+int SceneGraph::GetParent(unsigned int node)
+{
+    return m_parents[node];
+}
+
+unsigned int SceneGraph::GetSubtreeEnd(unsigned int node)
+{
+    return m_subtreeEnds[node];
+}
+
+const std::string& SceneGraph::GetName(unsigned int node)
+{
+    return m_names[node];
+}
+
+unsigned int SceneGraph::GetNodeCount()
+{
+    return (unsigned int)m_parents.size();
+}
+
+void SceneGraph::Update(JobSystem* jobs)
+{
+    if (m_dirtyNodes.empty())
+        return;
+
+    // In depth first order a dirty node inside the subtree of an earlier dirty node is already covered by it,
+    // so only the dirty nodes that aren't below another one need updating.
+    std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end());
+
+    m_ranges.clear();
+    unsigned int coveredEnd = 0;
+    for (size_t i = 0; i < m_dirtyNodes.size(); i++)
+    {
+        unsigned int node = m_dirtyNodes[i];
+        m_dirty[node] = 0;
+
+        if (node < coveredEnd)
+            continue;
+
+        AddRanges(node, jobs != nullptr);
+        coveredEnd = m_subtreeEnds[node];
+    }
+    m_dirtyNodes.clear();
+
+    // Ranges don't depend on each other, so they can run in any order on any thread.
+    if (jobs != nullptr && m_ranges.size() > 1)
+    {
+        jobs->ParallelFor((unsigned int)m_ranges.size(), 1, [this](unsigned int begin, unsigned int end)
+        {
+            for (unsigned int r = begin; r < end; r++)
+            {
+                UpdateNodes(m_ranges[r].m_begin, m_ranges[r].m_end);
+            }
+        });
+    }
+    else
+    {
+        for (size_t r = 0; r < m_ranges.size(); r++)
+        {
+            UpdateNodes(m_ranges[r].m_begin, m_ranges[r].m_end);
+        }
+    }
+}
+
+void SceneGraph::AddRanges(unsigned int root, bool split)
+{
+    unsigned int end = m_subtreeEnds[root];
+    if (!split || end - root <= SCENE_NODES_PER_JOB)
+    {
+        AddRange(root, end);
+        return;
+    }
+
+    // Too big for one job. The root is updated now, then each child's subtree only depends on it.
+    UpdateNodes(root, root + 1);
+    for (unsigned int child = root + 1; child < end; child = m_subtreeEnds[child])
+    {
+        AddRanges(child, split);
+    }
+}
+
+void SceneGraph::AddRange(unsigned int begin, unsigned int end)
+{
+    // Small neighbouring subtrees are joined into one job.
+    // Their parents are outside the range or earlier in it, so a single pass still works.
+    if (!m_ranges.empty())
+    {
+        NodeRange& last = m_ranges.back();
+        if (last.m_end == begin && end - last.m_begin <= SCENE_NODES_PER_JOB)
+        {
+            last.m_end = end;
+            return;
+        }
+    }
+
+    NodeRange range;
+    range.m_begin = begin;
+    range.m_end = end;
+    m_ranges.push_back(range);
+}
+
+void SceneGraph::UpdateNodes(unsigned int begin, unsigned int end)
+{
+    // Parents come before children, so the parent's world matrix is always up to date here.
+    for (unsigned int i = begin; i < end; i++)
+    {
+        int parent = m_parents[i];
+        if (parent < 0)
+            m_worldMatrices[i] = m_localMatrices[i];
+        else
+            m_worldMatrices[i] = m_worldMatrices[parent] * m_localMatrices[i];
+    }
+}
+
+void SceneGraph::Submit(RenderQueue& queue, unsigned int pass, FrustumCuller* culler, JobSystem* jobs, OcclusionCuller* occlusion)
+{
+    if (culler == nullptr)
+    {
+        for (size_t i = 0; i < m_draws.size(); i++)
+        {
+            const SceneDraw& draw = m_draws[i];
+            if (occlusion == nullptr || IsUnoccluded(draw, occlusion))
+                queue.Submit(draw.m_mesh, draw.m_material, m_worldMatrices[draw.m_node], pass, draw.m_submesh);
+        }
+        return;
+    }
+
+    // The culler gets one box per draw, moved into world space by the draw's node.
+    culler->Clear();
+    culler->Reserve((unsigned int)m_draws.size());
+    for (size_t i = 0; i < m_draws.size(); i++)
+    {
+        const SceneDraw& draw = m_draws[i];
+        const Submesh& submesh = draw.m_mesh->GetSubmesh(draw.m_submesh);
+        culler->AddBox(m_worldMatrices[draw.m_node], submesh.m_boundsMin, submesh.m_boundsMax);
+    }
+    culler->Cull(jobs);
+
+    const std::vector<unsigned int>& visible = culler->GetVisible();
+    for (size_t i = 0; i < visible.size(); i++)
+    {
+        const SceneDraw& draw = m_draws[visible[i]];
+        if (occlusion == nullptr || IsUnoccluded(draw, occlusion))
+            queue.Submit(draw.m_mesh, draw.m_material, m_worldMatrices[draw.m_node], pass, draw.m_submesh);
+    }
+}
+
+bool SceneGraph::IsUnoccluded(const SceneDraw& draw, OcclusionCuller* occlusion)
+{
+    // The occlusion culler tests world space boxes, so the submesh bounds are moved by the draw's node first.
+    const Submesh& submesh = draw.m_mesh->GetSubmesh(draw.m_submesh);
+    glm::vec3 worldMin, worldMax;
+    FrustumCuller::TransformBounds(m_worldMatrices[draw.m_node], submesh.m_boundsMin, submesh.m_boundsMax, worldMin, worldMax);
+    return occlusion->IsVisible(worldMin, worldMax);
+}
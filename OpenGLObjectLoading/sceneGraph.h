@@ -0,0 +1,122 @@
+/*
+Title: Object Loading
+File Name: sceneGraph.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "glm/glm.hpp"
+#include "mesh.h"
+#include "material.h"
+#include "renderQueue.h"
+#include "jobSystem.h"
+#include "frustumCuller.h"
+#include "occlusionCuller.h"
+#include <vector>
+#include <string>
+
+// Nodes handed to each job by Update.
+#define SCENE_NODES_PER_JOB 512
+
+// A hierarchy of nodes, each with a transform relative to its parent.
+// Nodes are kept in flat arrays in depth first order, so a parent always comes before its children
+// and a node's whole subtree is the range [node, subtree end). Updating world matrices is then a
+// single pass over a range, with no pointers to chase.
+// Only subtrees with a changed local matrix are updated, split across a job system if they are big.
+class SceneGraph
+{
+private:
+    // A submesh drawn with a node's world matrix.
+    struct SceneDraw
+    {
+        unsigned int m_node;
+        Mesh* m_mesh;
+        unsigned int m_submesh;
+        Material* m_material;
+    };
+
+    // A range of nodes Update can run on its own, because every parent outside it is already up to date.
+    struct NodeRange
+    {
+        unsigned int m_begin;
+        unsigned int m_end;
+    };
+
+    // One entry per node, in depth first order.
+    std::vector<int> m_parents;
+    std::vector<unsigned int> m_subtreeEnds;
+    std::vector<std::string> m_names;
+    std::vector<glm::mat4> m_localMatrices;
+    std::vector<glm::mat4> m_worldMatrices;
+    std::vector<unsigned char> m_dirty;
+
+    // Nodes whose local matrix changed since the last Update.
+    std::vector<unsigned int> m_dirtyNodes;
+    std::vector<NodeRange> m_ranges;
+
+    std::vector<SceneDraw> m_draws;
+
+    void MarkDirty(unsigned int node);
+    // Adds ranges covering a dirty subtree. Subtrees too big for one job are split at their children.
+    void AddRanges(unsigned int root, bool split);
+    void AddRange(unsigned int begin, unsigned int end);
+    // Updates the world matrices of nodes [begin, end).
+    void UpdateNodes(unsigned int begin, unsigned int end);
+    // Tests a draw's world space bounds against the occlusion culler's depth pyramid.
+    bool IsUnoccluded(const SceneDraw& draw, OcclusionCuller* occlusion);
+
+public:
+    // Adds a node and returns its index. The parent must already be in the graph, -1 makes a new root.
+    // New children go to the end of the arrays, so only the last root can get new nodes.
+    unsigned int AddNode(int parent, const glm::mat4& localMatrix, std::string name = "");
+
+    // Adds the node hierarchy of a mesh below parent (or as a new root), drawing every submesh with the given material.
+    // Returns the index of the mesh's root node.
+    unsigned int AddModel(Mesh* mesh, Material* material, int parent = -1);
+
+    // Draws a submesh with a node's world matrix.
+    void AddDraw(unsigned int node, Mesh* mesh, unsigned int submesh, Material* material);
+
+    void Clear();
+
+    // Finds the first node with the given name, searching the subtree of root (every node by default).
+    // Returns -1 if there isn't one.
+    int FindNode(std::string name, int root = -1);
+
+    // Moves a node and its subtree below another parent (-1 makes it a root), keeping its local matrix.
+    // The subtree moves to the end of the new parent's subtree, so node indices change.
+    // Returns the node's new index. A parent inside the node's own subtree is refused, and nothing moves.
+    unsigned int SetParent(unsigned int node, int parent);
+
+    void SetLocalMatrix(unsigned int node, const glm::mat4& localMatrix);
+    const glm::mat4& GetLocalMatrix(unsigned int node);
+    // World matrix as of the last Update.
+    const glm::mat4& GetWorldMatrix(unsigned int node);
+    int GetParent(unsigned int node);
+    // One past the last node of the node's subtree.
+    unsigned int GetSubtreeEnd(unsigned int node);
+    const std::string& GetName(unsigned int node);
+    unsigned int GetNodeCount();
+
+    // Updates the world matrices of every subtree with a changed node.
+    // With a job system, big subtrees are split across its threads.
+    void Update(JobSystem* jobs = nullptr);
+
+    // Submits every draw to the render queue with its node's world matrix.
+    // With a culler, only draws whose submesh bounds are inside its frustum are submitted.
+    // With an occlusion culler that has already been rasterized, draws hidden behind its occluders are skipped too.
+    void Submit(RenderQueue& queue, unsigned int pass = 0, FrustumCuller* culler = nullptr, JobSystem* jobs = nullptr, OcclusionCuller* occlusion = nullptr);
+};
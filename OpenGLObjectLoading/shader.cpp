@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "shader.h"
+#include "shaderProgram.h"
 
 Shader::Shader(std::string filePath, GLenum shaderType)
 {
@@ -40,6 +41,8 @@ Shader::~Shader()
 
 GLuint Shader::GetGLShader()
 {
+    if (!m_compiled)
+        Compile();
     return m_shader;
 }
 
@@ -48,6 +51,11 @@ GLenum Shader::GetGLShaderType()
     return m_type;
 }
 
+const std::string& Shader::GetSource()
+{
+    return m_source;
+}
+
 bool Shader::InitFromFile(std::string filePath, GLenum shaderType)
 {
 
@@ -85,12 +93,33 @@ bool Shader::InitFromFile(std::string filePath, GLenum shaderType)
 
 bool Shader::InitFromString(std::string shaderCode, GLenum shaderType)
 {
+	// Throw away any shader compiled from earlier source.
+	if (m_shader != 0)
+	{
+		glDeleteShader(m_shader);
+		m_shader = 0;
+	}
+
+	// Keep the source. If programs are cached, compiling waits until the shader is used.
 	m_type = shaderType;
-	m_shader = glCreateShader(shaderType);
+	m_source = shaderCode;
+	m_compiled = false;
+	if (ShaderProgram::GetBinaryCacheDirectory().empty())
+		return Compile();
+	return true;
+}
+
+bool Shader::Compile()
+{
+	if (m_shader != 0)
+		glDeleteShader(m_shader);
+
+	m_compiled = true;
+	m_shader = glCreateShader(m_type);
 
 	// Get the char* and length
-	const char* shaderCodePointer = shaderCode.data();
-	int shaderCodeLength = shaderCode.size();
+	const char* shaderCodePointer = m_source.data();
+	int shaderCodeLength = m_source.size();
 
 	// Set the source code and compile.
 	glShaderSource(m_shader, 1, &shaderCodePointer, &shaderCodeLength);
@@ -22,6 +22,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#pragma once
 #include "GL/glew.h"
 #include "GLFW/glfw3.h"
 #include <string>
@@ -32,9 +33,14 @@ class Shader
 {
 
 private:
-	GLuint m_shader;
+	GLuint m_shader = 0;
 	GLenum m_type;
 
+	// Source code, kept so the shader can be compiled when it is first needed.
+	// Shader programs loaded from the binary cache never compile their shaders at all.
+	std::string m_source;
+	bool m_compiled = false;
+
     // Reference Counter
     unsigned int m_refCount = 0;
 
@@ -42,12 +48,22 @@ public:
 	Shader(std::string filePath, GLenum shaderType);
 	~Shader();
 
+    // Returns the gl shader, compiling it first if it hasn't been compiled yet.
+    // Returns 0 if it doesn't compile.
     GLuint GetGLShader();
     GLenum GetGLShaderType();
+    const std::string& GetSource();
 
+	// These load the source code. With a program binary cache (see ShaderProgram::SetBinaryCacheDirectory),
+	// compiling waits for GetGLShader, since a cached program doesn't need it. Then they only return false
+	// if the file can't be read, and a compile error shows up as GetGLShader returning 0.
+	// Without the cache the source is compiled right away, and they return false if it doesn't compile.
 	bool InitFromFile(std::string, GLenum shaderType);
 	bool InitFromString(std::string shaderCode, GLenum shaderType);
 
+	// Compiles the source code. Returns false and prints the error if it doesn't compile.
+	bool Compile();
+
     void IncRefCount();
     void DecRefCount();
 };
\ No newline at end of file
@@ -22,6 +22,26 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "shaderProgram.h"
+#include "loadReport.h"
+#include "fileStamp.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+std::string ShaderProgram::s_binaryCacheDirectory;
+
+// Identifies a program binary cache file.
+static const char c_programCacheMagic[4] = { 'P', 'R', 'G', 'C' };
+
+// Every cache file starts with this header, followed by the binary from the driver.
+struct ProgramCacheHeader
+{
+    char m_magic[4];
+    GLenum m_binaryFormat;
+    unsigned long long m_key;
+    unsigned int m_binaryLength;
+    unsigned int m_padding;
+};
 
 ShaderProgram::ShaderProgram()
 {
@@ -31,6 +51,7 @@ ShaderProgram::ShaderProgram()
 ShaderProgram::~ShaderProgram()
 {
     glDeleteProgram(m_shaderProgram);
+    GLState::ForgetProgram(m_shaderProgram);
 
     // Decrement ref counts on shaders if this object is deleted.
     if (m_vertexShader != nullptr)
@@ -70,10 +91,10 @@ void ShaderProgram::AttachShader(Shader* shader)
     // Replace it with the new shader
     *currentShader = shader;
 
-    // Attach the gl shader to the shader program.
-    if (shader->GetGLShader() != 0)
+    // The gl shader is attached when the program is linked.
+    // If the program comes from the binary cache, it's never compiled at all.
+    if (!shader->GetSource().empty())
     {
-        glAttachShader(m_shaderProgram, shader->GetGLShader());
         // ShaderProgram must be rebuilt
         m_programBuilt = false;
     }
@@ -84,21 +105,252 @@ void ShaderProgram::AttachShader(Shader* shader)
     }
 }
 
+void ShaderProgram::SetBinaryCacheDirectory(std::string directory)
+{
+    s_binaryCacheDirectory = directory;
+}
+
+const std::string& ShaderProgram::GetBinaryCacheDirectory()
+{
+    return s_binaryCacheDirectory;
+}
+
+unsigned long long ShaderProgram::GetBinaryCacheKey()
+{
+    if (s_binaryCacheDirectory.empty() || m_vertexShader == nullptr || m_fragmentShader == nullptr)
+        return 0;
+
+    // Program binaries need opengl 4.1 or the extension, and at least one binary format.
+    if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1)
+        return 0;
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0)
+        return 0;
+
+    // A binary only works with the same sources, on the same driver.
+    unsigned long long hash = FILE_STAMP_HASH_START;
+    FileStamp::HashString(hash, m_vertexShader->GetSource().c_str());
+    FileStamp::HashString(hash, m_fragmentShader->GetSource().c_str());
+    FileStamp::HashString(hash, (const char*)glGetString(GL_VENDOR));
+    FileStamp::HashString(hash, (const char*)glGetString(GL_RENDERER));
+    FileStamp::HashString(hash, (const char*)glGetString(GL_VERSION));
+
+    // 0 means "no key", so make sure a real key is never 0.
+    return hash != 0 ? hash : 1;
+}
+
+std::string ShaderProgram::GetBinaryCachePath(unsigned long long key)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "program_%016llx.programcache", key);
+    return s_binaryCacheDirectory + name;
+}
+
+bool ShaderProgram::LoadBinary(unsigned long long key)
+{
+    std::ifstream file(GetBinaryCachePath(key), std::ios::binary);
+    if (!file.good())
+        return false;
+
+    ProgramCacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file.good() || memcmp(header.m_magic, c_programCacheMagic, sizeof(c_programCacheMagic)) != 0 || header.m_key != key)
+        return false;
+
+    std::vector<char> binary(header.m_binaryLength);
+    file.read(binary.data(), binary.size());
+    if (!file.good())
+        return false;
+
+    // The driver can still refuse the binary, for example after an update that kept the version string.
+    // Then the program just isn't linked, and we build it from source instead.
+    glProgramBinary(m_shaderProgram, header.m_binaryFormat, binary.data(), (GLsizei)binary.size());
+
+    GLint isLinked;
+    glGetProgramiv(m_shaderProgram, GL_LINK_STATUS, &isLinked);
+    return isLinked != 0;
+}
+
+bool ShaderProgram::SaveBinary(unsigned long long key)
+{
+    GLint length = 0;
+    glGetProgramiv(m_shaderProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    ProgramCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_magic, c_programCacheMagic, sizeof(c_programCacheMagic));
+    header.m_key = key;
+
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    glGetProgramBinary(m_shaderProgram, length, &written, &header.m_binaryFormat, binary.data());
+    header.m_binaryLength = (unsigned int)written;
+
+    std::ofstream file(GetBinaryCachePath(key), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), written);
+    return file.good();
+}
+
+void ShaderProgram::Link()
+{
+    m_programBuilt = true;
+
+#if LOAD_TIME_REPORT
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+#endif
+
+    // Try the binary cache first, it skips compiling and linking completely.
+    unsigned long long key = GetBinaryCacheKey();
+    bool fromCache = key != 0 && LoadBinary(key);
+
+    if (!fromCache)
+    {
+        // Compile the shaders and attach them for linking.
+        Shader* shaders[] = { m_vertexShader, m_fragmentShader };
+        for (int i = 0; i < 2; i++)
+        {
+            if (shaders[i] != nullptr && shaders[i]->GetGLShader() != 0)
+                glAttachShader(m_shaderProgram, shaders[i]->GetGLShader());
+        }
+
+        // Tell the driver we want to read the binary back.
+        if (key != 0)
+            glProgramParameteri(m_shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        glLinkProgram(m_shaderProgram);
+
+        // The linked program doesn't need the shaders anymore.
+        for (int i = 0; i < 2; i++)
+        {
+            if (shaders[i] != nullptr && shaders[i]->GetGLShader() != 0)
+                glDetachShader(m_shaderProgram, shaders[i]->GetGLShader());
+        }
+
+        GLint isLinked;
+        glGetProgramiv(m_shaderProgram, GL_LINK_STATUS, &isLinked);
+        if (!isLinked)
+        {
+            char infolog[1024];
+            glGetProgramInfoLog(m_shaderProgram, 1024, NULL, infolog);
+            std::cout << "Shader program link failed with error: " << std::endl << infolog << std::endl;
+        }
+        else if (key != 0 && !SaveBinary(key))
+        {
+            std::cout << "Can't write program cache: " << GetBinaryCachePath(key) << std::endl;
+        }
+    }
+
+#if LOAD_TIME_REPORT
+    // Report how long building the program took, to compare a cold and a warm cache.
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    std::cout << "Shader program " << (fromCache ? "loaded from binary cache" : "built from source") << " in " << elapsed.count() << "ms" << std::endl;
+#endif
+
+    // Ask the program for all of its active uniforms.
+    // After this, nothing has to look a uniform up by name every frame.
+    m_uniforms.clear();
+
+    GLint uniformCount = 0;
+    GLint maxNameLength = 0;
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(m_shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> name(maxNameLength + 1);
+    for (GLint i = 0; i < uniformCount; i++)
+    {
+        ShaderUniform uniform;
+        GLsizei nameLength = 0;
+        glGetActiveUniform(m_shaderProgram, i, (GLsizei)name.size(), &nameLength, &uniform.m_size, &uniform.m_type, name.data());
+        uniform.m_name.assign(name.data(), nameLength);
+        uniform.m_intValue = 0;
+
+        // Arrays are reported as "name[0]", but we want to find them by "name".
+        size_t bracket = uniform.m_name.find('[');
+        if (bracket != std::string::npos)
+            uniform.m_name.resize(bracket);
+
+        // Uniforms inside uniform blocks don't have a location, they are set through buffers.
+        uniform.m_location = glGetUniformLocation(m_shaderProgram, uniform.m_name.c_str());
+        if (uniform.m_location == -1)
+            continue;
+
+        m_uniforms.push_back(uniform);
+    }
+}
+
 void ShaderProgram::Bind()
 {
     if (!m_programBuilt)
     {
         // if the program hasn't been built, build it and get uniform data
-        glLinkProgram(m_shaderProgram);
-        m_programBuilt = true;
+        Link();
+    }
+
+    GLState::UseProgram(m_shaderProgram);
+}
+
+int ShaderProgram::GetUniformHandle(const char* name)
+{
+    // The uniform list only exists once the program has been built.
+    if (!m_programBuilt)
+        Link();
+
+    for (size_t i = 0; i < m_uniforms.size(); i++)
+    {
+        if (m_uniforms[i].m_name == name)
+            return (int)i;
     }
+    return -1;
+}
+
+int ShaderProgram::GetUniformCount()
+{
+    return (int)m_uniforms.size();
+}
+
+GLint ShaderProgram::GetUniformLocation(int handle)
+{
+    return m_uniforms[handle].m_location;
+}
+
+const std::string& ShaderProgram::GetUniformName(int handle)
+{
+    return m_uniforms[handle].m_name;
+}
 
-    glUseProgram(m_shaderProgram);
+GLenum ShaderProgram::GetUniformType(int handle)
+{
+    return m_uniforms[handle].m_type;
+}
+
+void ShaderProgram::SetInt(int handle, GLint value)
+{
+    // Uniform values belong to the program, so they don't change when another program is used.
+    ShaderUniform& uniform = m_uniforms[handle];
+    if (uniform.m_intValue == value)
+    {
+        GLState::CountElided();
+        return;
+    }
+
+    glUniform1i(uniform.m_location, value);
+    uniform.m_intValue = value;
+    GLState::CountIssued();
+}
+
+void ShaderProgram::SetMatrix(int handle, const float* matrix)
+{
+    glUniformMatrix4fv(m_uniforms[handle].m_location, 1, GL_FALSE, matrix);
 }
 
 void ShaderProgram::Unbind()
 {
-    glUseProgram(0);
+    GLState::UseProgram(0);
 }
 
 void ShaderProgram::IncRefCount()
@@ -23,7 +23,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #pragma once
 #include "shader.h"
+#include "glState.h"
 #include <iostream>
+#include <vector>
+#include <string>
+
+// An active uniform found in a linked shader program
+struct ShaderUniform
+{
+    std::string m_name;
+    GLint m_location;
+    GLenum m_type;
+    GLint m_size;
+
+    // Last value set through SetInt. Uniforms start at zero after linking.
+    GLint m_intValue;
+};
 
 // Wraps opengl shader program functionality
 class ShaderProgram
@@ -40,6 +55,26 @@ private:
     // Keep track of if the program has been built and only build when needed
     bool m_programBuilt = false;
 
+    // Every active uniform in the program, read once when it is linked.
+    // A uniform handle is an index into this list.
+    std::vector<ShaderUniform> m_uniforms;
+
+    // Folder the linked program binaries are saved to. Empty turns the binary cache off.
+    static std::string s_binaryCacheDirectory;
+
+    // Links the program and reads its active uniforms.
+    // The linked binary is loaded from the cache if possible, and saved to it if not.
+    void Link();
+
+    // Returns a hash of the shader sources and the driver, used to name the cache file.
+    // Returns 0 if the program can't be cached.
+    unsigned long long GetBinaryCacheKey();
+    std::string GetBinaryCachePath(unsigned long long key);
+
+    // Loads or saves the linked program in the binary cache. Returns false on failure.
+    bool LoadBinary(unsigned long long key);
+    bool SaveBinary(unsigned long long key);
+
     // Reference Counter
     unsigned int m_refCount = 0;
 
@@ -48,6 +83,29 @@ public:
     ~ShaderProgram();
     GLuint GetGLShaderProgram();
     void AttachShader(Shader* shader);
+
+    // Sets the folder for the binary cache, ending in a slash. Pass an empty string to turn it off.
+    static void SetBinaryCacheDirectory(std::string directory);
+    static const std::string& GetBinaryCacheDirectory();
+
+    // Returns the handle of a uniform, or -1 if the program doesn't have it.
+    // Look handles up once and keep them, they stay valid until another shader is attached.
+    int GetUniformHandle(const char* name);
+    // Number of uniform handles in the program.
+    int GetUniformCount();
+    // Returns the gl location of a uniform handle.
+    GLint GetUniformLocation(int handle);
+    // Returns the name of a uniform handle.
+    const std::string& GetUniformName(int handle);
+    // Returns the type of a uniform handle, as glGetActiveUniform reports it, like GL_FLOAT_MAT4 or GL_SAMPLER_2D.
+    GLenum GetUniformType(int handle);
+
+    // Sets an int (or sampler) uniform, skipping the call if it already has that value.
+    // The program must be bound.
+    void SetInt(int handle, GLint value);
+
+    // Sets a matrix uniform right away. The program must be bound.
+    void SetMatrix(int handle, const float* matrix);
     void Bind();
     void Unbind();
     void IncRefCount();
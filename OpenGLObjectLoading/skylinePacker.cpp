@@ -0,0 +1,120 @@
+/*
+Title: Object Loading
+File Name: skylinePacker.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "skylinePacker.h"
+
+SkylinePacker::SkylinePacker(unsigned int width, unsigned int height) : m_width(width), m_height(height)
+{
+    // It starts out as one segment along the bottom.
+    Segment bottom = { 0, 0, width };
+    m_skyline.push_back(bottom);
+}
+
+bool SkylinePacker::Fit(size_t segment, unsigned int width, unsigned int height, unsigned int& y)
+{
+    if (m_skyline[segment].m_x + width > m_width)
+        return false;
+
+    // The rectangle rests on the highest segment under it.
+    y = 0;
+    unsigned int remaining = width;
+    for (size_t i = segment; remaining > 0; i++)
+    {
+        if (m_skyline[i].m_y > y)
+            y = m_skyline[i].m_y;
+
+        if (m_skyline[i].m_width >= remaining)
+            break;
+        remaining -= m_skyline[i].m_width;
+    }
+
+    return y + height <= m_height;
+}
+
+bool SkylinePacker::Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y)
+{
+    if (width == 0 || height == 0)
+        return false;
+
+    // Bottom left: pick the lowest spot, and the narrowest segment on a tie, so wide gaps stay open.
+    size_t best = m_skyline.size();
+    unsigned int bestY = 0;
+    for (size_t i = 0; i < m_skyline.size(); i++)
+    {
+        unsigned int fitY;
+        if (!Fit(i, width, height, fitY))
+            continue;
+
+        if (best == m_skyline.size() || fitY < bestY || (fitY == bestY && m_skyline[i].m_width < m_skyline[best].m_width))
+        {
+            best = i;
+            bestY = fitY;
+        }
+    }
+
+    if (best == m_skyline.size())
+        return false;
+
+    x = m_skyline[best].m_x;
+    y = bestY;
+
+    // The top of the rectangle becomes a new segment.
+    Segment top = { x, y + height, width };
+    m_skyline.insert(m_skyline.begin() + best, top);
+
+    // Cut away the segments it now covers.
+    unsigned int right = x + width;
+    size_t i = best + 1;
+    while (i < m_skyline.size() && m_skyline[i].m_x < right)
+    {
+        unsigned int segmentRight = m_skyline[i].m_x + m_skyline[i].m_width;
+        if (segmentRight <= right)
+        {
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+        else
+        {
+            m_skyline[i].m_width = segmentRight - right;
+            m_skyline[i].m_x = right;
+            break;
+        }
+    }
+
+    // Merge neighbours at the same height, so the list stays short.
+    for (size_t j = 0; j + 1 < m_skyline.size();)
+    {
+        if (m_skyline[j].m_y == m_skyline[j + 1].m_y)
+        {
+            m_skyline[j].m_width += m_skyline[j + 1].m_width;
+            m_skyline.erase(m_skyline.begin() + j + 1);
+        }
+        else
+        {
+            j++;
+        }
+    }
+
+    m_usedArea += (unsigned long long)width * height;
+    return true;
+}
+
+float SkylinePacker::GetOccupancy()
+{
+    return (float)((double)m_usedArea / ((double)m_width * m_height));
+}
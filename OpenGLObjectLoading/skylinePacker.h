@@ -0,0 +1,55 @@
+/*
+Title: Object Loading
+File Name: skylinePacker.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Packs rectangles into a fixed size area with the skyline method.
+// It keeps track of the top edge of everything placed so far, as a list of flat segments,
+// and puts each new rectangle as low as it can go on that edge.
+class SkylinePacker
+{
+private:
+    // A flat piece of the skyline, starting at x, at height y.
+    struct Segment
+    {
+        unsigned int m_x;
+        unsigned int m_y;
+        unsigned int m_width;
+    };
+
+    unsigned int m_width;
+    unsigned int m_height;
+    std::vector<Segment> m_skyline;
+    unsigned long long m_usedArea = 0;
+
+    // Returns the height a rectangle would sit at if placed at the start of a segment,
+    // or false if it doesn't fit there.
+    bool Fit(size_t segment, unsigned int width, unsigned int height, unsigned int& y);
+
+public:
+    SkylinePacker(unsigned int width, unsigned int height);
+
+    // Finds a spot for a rectangle. Returns false if there is no room left for it.
+    bool Insert(unsigned int width, unsigned int height, unsigned int& x, unsigned int& y);
+
+    // Fraction of the area covered by rectangles.
+    float GetOccupancy();
+};
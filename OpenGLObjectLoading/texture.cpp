@@ -22,44 +22,238 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "texture.h"
+#include "glState.h"
+#include "pixelConvert.h"
 
+float Texture::s_anisotropy = 1.0f;
 
-Texture::Texture(char* filePath)
+Texture::Texture(char* filePath, MipmapFilter filter, TextureCompression compression)
 {
+    glGenTextures(1, &m_texture);
+
+    // Fall back to plain pixels if the driver can't sample the format.
+    if (!TextureCompressor::IsSupported(compression))
+        compression = TextureCompression::None;
+
+    // A fresh cache is uploaded as is, without going through FreeImage at all.
+    CompressedImage image;
+    if (compression != TextureCompression::None && TextureCompressor::LoadCache(filePath, compression, filter, image))
+    {
+        SetCompressedImage(image);
+        return;
+    }
+
     // Load the file.
     FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(filePath), filePath);
+    if (bitmap == nullptr)
+    {
+        std::cout << "Can't load texture: " << filePath << std::endl;
+        SetPixels(1, 1, "\xFF\xFF\xFF\xFF", MipmapFilter::None);
+        return;
+    }
+
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+
     // Convert the file to 32 bits so we can use it.
-    FIBITMAP* bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
+    // The bitmap isn't needed after that, so unload it before the upload rather than after.
+    std::vector<unsigned char> pixels;
+    bool converted = PixelConvert::Convert(bitmap, pixels);
+    FreeImage_Unload(bitmap);
+    if (!converted)
+    {
+        std::cout << "Can't convert texture: " << filePath << std::endl;
+        SetPixels(1, 1, "\xFF\xFF\xFF\xFF", MipmapFilter::None);
+        return;
+    }
 
+    // Fill the texture with the image, compressing it and saving the cache first if needed.
+    if (compression != TextureCompression::None)
+    {
+        TextureCompressor::Compress(compression, filter, pixels.data(), width, height, image);
+        TextureCompressor::SaveCache(filePath, filter, image);
+        SetCompressedImage(image);
+    }
+    else
+    {
+        SetPixels(width, height, pixels.data(), filter);
+    }
+}
+
+Texture::Texture()
+{
+    // A single white pixel stands in until the real image is ready.
+    unsigned char white[4] = { 255, 255, 255, 255 };
 
-    // Create an OpenGL texture.
     glGenTextures(1, &m_texture);
+    SetPixels(1, 1, white, MipmapFilter::None);
+}
+
+void Texture::AllocateStorage(unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression)
+{
+    if (m_width == width && m_height == height && m_levelCount == levelCount && m_compression == compression)
+        return;
 
-    // Bind our texture.
-    glBindTexture(GL_TEXTURE_2D, m_texture);
+    // Immutable storage can't change size, so a new size needs a new texture object.
+    if (m_levelCount > 0)
+    {
+        ReleaseBindlessHandle();
+        glDeleteTextures(1, &m_texture);
+        GLState::ForgetTexture(m_texture);
+        glGenTextures(1, &m_texture);
+    }
 
-    // Fill our openGL side texture object.
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, FreeImage_GetWidth(bitmap32), FreeImage_GetHeight(bitmap32),
-        0, GL_BGRA, GL_UNSIGNED_BYTE, static_cast<void*>(FreeImage_GetBits(bitmap32)));
+    m_width = width;
+    m_height = height;
+    m_levelCount = levelCount;
+    m_compression = compression;
 
+    SetupStorage(m_texture, width, height, levelCount, compression);
+}
 
-    // Set texture sampling parameters
+GLuint Texture::CreateStagingStorage(unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    SetupStorage(texture, width, height, levelCount, compression);
+    return texture;
+}
+
+void Texture::AdoptStorage(GLuint texture, unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression)
+{
+    ReleaseBindlessHandle();
+    glDeleteTextures(1, &m_texture);
+    GLState::ForgetTexture(m_texture);
+
+    m_texture = texture;
+    m_width = width;
+    m_height = height;
+    m_levelCount = levelCount;
+    m_compression = compression;
+}
+
+void Texture::SetupStorage(GLuint texture, unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression)
+{
+    GLenum internalFormat = TextureCompressor::GetGLFormat(compression);
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, texture);
+
+    // Allocate every level at once. Older drivers without texture storage get each level allocated by hand.
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, levelCount, internalFormat, width, height);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < levelCount; i++)
+        {
+            unsigned int levelWidth = MipmapGenerator::GetLevelWidth(width, i);
+            unsigned int levelHeight = MipmapGenerator::GetLevelWidth(height, i);
+
+            if (compression == TextureCompression::None)
+                glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, levelWidth, levelHeight, 0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+            else
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, levelWidth, levelHeight, 0,
+                    (GLsizei)TextureCompressor::GetLevelSize(compression, levelWidth, levelHeight), NULL);
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    // Set texture sampling parameters.
+    // With mipmaps, blend between the two nearest levels (trilinear), and sharpen surfaces seen at an angle with anisotropy.
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    if (GLEW_EXT_texture_filter_anisotropic && levelCount > 1)
+    {
+        float maxAnisotropy = 1.0f;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, s_anisotropy < maxAnisotropy ? s_anisotropy : maxAnisotropy);
+    }
+}
+
+void Texture::SetPixels(unsigned int width, unsigned int height, const void* pixels, MipmapFilter filter)
+{
+    // Cpu filters build the whole chain here, then upload it.
+    if (filter == MipmapFilter::Box || filter == MipmapFilter::Kaiser)
+    {
+        std::vector<unsigned char> chain;
+        unsigned int levelCount = MipmapGenerator::BuildChain(filter, static_cast<const unsigned char*>(pixels), width, height, chain);
+        SetMipChain(width, height, levelCount, chain.data());
+        return;
+    }
+
+    unsigned int levelCount = filter == MipmapFilter::None ? 1 : MipmapGenerator::GetLevelCount(width, height);
+    AllocateStorage(width, height, levelCount, TextureCompression::None);
+
+    // Fill our openGL side texture object.
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
+
+    // Let the gpu fill in the rest of the levels.
+    if (levelCount > 1)
+        glGenerateMipmap(GL_TEXTURE_2D);
+
     // Unbind the texture.
-    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
 
-    // We can unload the images now that the texture data has been buffered with opengl
-    FreeImage_Unload(bitmap);
-    FreeImage_Unload(bitmap32);
+void Texture::SetMipChain(unsigned int width, unsigned int height, unsigned int levelCount, const void* chain)
+{
+    AllocateStorage(width, height, levelCount, TextureCompression::None);
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_texture);
+
+    // Levels are packed one after the other, so step through them in order.
+    const unsigned char* level = static_cast<const unsigned char*>(chain);
+    for (unsigned int i = 0; i < levelCount; i++)
+    {
+        unsigned int levelWidth = MipmapGenerator::GetLevelWidth(width, i);
+        unsigned int levelHeight = MipmapGenerator::GetLevelWidth(height, i);
+
+        glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight, GL_BGRA, GL_UNSIGNED_BYTE, level);
+        level += (size_t)levelWidth * levelHeight * 4;
+    }
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+void Texture::SetCompressedImage(const CompressedImage& image)
+{
+    GLenum format = TextureCompressor::GetGLFormat(image.m_format);
+    AllocateStorage(image.m_width, image.m_height, image.m_levelCount, image.m_format);
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_texture);
+
+    // Upload the blocks as they are, the gpu decodes them while sampling.
+    const unsigned char* level = image.m_data.data();
+    for (unsigned int i = 0; i < image.m_levelCount; i++)
+    {
+        unsigned int levelWidth = MipmapGenerator::GetLevelWidth(image.m_width, i);
+        unsigned int levelHeight = MipmapGenerator::GetLevelWidth(image.m_height, i);
+        GLsizei size = (GLsizei)TextureCompressor::GetLevelSize(image.m_format, levelWidth, levelHeight);
+
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levelWidth, levelHeight, format, size, level);
+
+        level += size;
+    }
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+void Texture::SetAnisotropy(float anisotropy)
+{
+    s_anisotropy = anisotropy;
 }
 
 Texture::~Texture()
 {
+    ReleaseBindlessHandle();
     glDeleteTextures(1, &m_texture);
+    GLState::ForgetTexture(m_texture);
 }
 
 void Texture::IncRefCount()
@@ -76,7 +270,78 @@ void Texture::DecRefCount()
     }
 }
 
+unsigned int Texture::GetRefCount()
+{
+    return m_refCount;
+}
+
 GLuint Texture::GetGLTexture()
 {
     return m_texture;
 }
+
+unsigned int Texture::GetWidth()
+{
+    return m_width;
+}
+
+unsigned int Texture::GetHeight()
+{
+    return m_height;
+}
+
+unsigned int Texture::GetLevelCount()
+{
+    return m_levelCount;
+}
+
+TextureCompression Texture::GetCompression()
+{
+    return m_compression;
+}
+
+size_t Texture::GetByteSize()
+{
+    size_t size = 0;
+    for (unsigned int i = 0; i < m_levelCount; i++)
+    {
+        unsigned int levelWidth = MipmapGenerator::GetLevelWidth(m_width, i);
+        unsigned int levelHeight = MipmapGenerator::GetLevelWidth(m_height, i);
+
+        if (m_compression == TextureCompression::None)
+            size += (size_t)levelWidth * levelHeight * 4;
+        else
+            size += TextureCompressor::GetLevelSize(m_compression, levelWidth, levelHeight);
+    }
+    return size;
+}
+
+GLuint64 Texture::GetBindlessHandle()
+{
+    if (m_bindlessTexture != m_texture)
+    {
+        ReleaseBindlessHandle();
+
+        // A texture can't change its sampling parameters once it has a handle,
+        // which is fine, since they are only set when storage is allocated.
+        m_bindlessHandle = glGetTextureHandleARB(m_texture);
+        glMakeTextureHandleResidentARB(m_bindlessHandle);
+        m_bindlessTexture = m_texture;
+    }
+    return m_bindlessHandle;
+}
+
+void Texture::ReleaseBindlessHandle()
+{
+    if (m_bindlessHandle != 0)
+    {
+        glMakeTextureHandleNonResidentARB(m_bindlessHandle);
+        m_bindlessHandle = 0;
+        m_bindlessTexture = 0;
+    }
+}
+
+bool Texture::IsBindlessSupported()
+{
+    return GLEW_ARB_bindless_texture != 0;
+}
@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "GLFW/glfw3.h"
 #include "FreeImage.h"
 #include <iostream>
+#include "mipmapGenerator.h"
+#include "textureCompressor.h"
 
 class Texture
 {
@@ -33,11 +35,72 @@ private:
     GLuint m_texture;
     unsigned int m_refCount = 0;
 
+    // Size of the texture's storage. Storage can't be resized, so 0 means it hasn't been allocated yet.
+    unsigned int m_width = 0;
+    unsigned int m_height = 0;
+    unsigned int m_levelCount = 0;
+
+    // Bindless handle, and the texture object it was made for. 0 until GetBindlessHandle is called.
+    GLuint64 m_bindlessHandle = 0;
+    GLuint m_bindlessTexture = 0;
+
+    // Makes the bindless handle non resident, before the texture object is deleted.
+    void ReleaseBindlessHandle();
+
+    // Allocates immutable storage for a texture object that has none yet, and sets up sampling.
+    static void SetupStorage(GLuint texture, unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression);
+
+    // Anisotropy used by every texture, clamped to what the driver supports.
+    static float s_anisotropy;
+
+    // Format of the storage, so a compressed upload knows when it needs new storage.
+    TextureCompression m_compression = TextureCompression::None;
+
 public:
-    Texture(char* filePath);
+    // With compression, the texture is loaded from its cooked cache, and the cache is made first if it's missing or stale.
+    Texture(char* filePath, MipmapFilter filter = MipmapFilter::Gpu, TextureCompression compression = TextureCompression::None);
+    // Creates a 1x1 white texture, to be filled in later with SetPixels.
+    Texture();
     ~Texture();
+
+    // Allocates immutable storage for the mip chain, and sets up sampling. The contents are left undefined.
+    // If the storage already has this size and format, it's kept. Otherwise the GL texture is replaced.
+    void AllocateStorage(unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression);
+
+    // Makes a separate texture object with storage for the mip chain, to be filled in and then given to AdoptStorage.
+    // The texture keeps showing its old contents while the new ones are written, instead of undefined texels.
+    static GLuint CreateStagingStorage(unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression);
+    // Replaces the GL texture with one made by CreateStagingStorage, which the texture takes ownership of.
+    void AdoptStorage(GLuint texture, unsigned int width, unsigned int height, unsigned int levelCount, TextureCompression compression);
+
+    // Replaces the contents of the texture with 32 bit BGRA pixels.
+    // The other mip levels are made with the given filter.
+    void SetPixels(unsigned int width, unsigned int height, const void* pixels, MipmapFilter filter = MipmapFilter::Gpu);
+
+    // Replaces the contents of the texture with a mip chain built by MipmapGenerator::BuildChain.
+    void SetMipChain(unsigned int width, unsigned int height, unsigned int levelCount, const void* chain);
+
+    // Replaces the contents of the texture with a block compressed mip chain.
+    void SetCompressedImage(const CompressedImage& image);
+
+    // Sets the anisotropy for textures filled in from now on. 1 is plain trilinear filtering.
+    static void SetAnisotropy(float anisotropy);
+
     void IncRefCount();
     void DecRefCount();
+    unsigned int GetRefCount();
     GLuint GetGLTexture();
+    unsigned int GetWidth();
+    unsigned int GetHeight();
+    unsigned int GetLevelCount();
+    TextureCompression GetCompression();
+
+    // Estimated gpu memory used by the whole mip chain.
+    size_t GetByteSize();
+
+    // Returns a resident ARB_bindless_texture handle, which shaders can sample without the texture being bound.
+    // The handle changes when the texture gets new storage, so ask for it again rather than keeping it.
+    GLuint64 GetBindlessHandle();
+    static bool IsBindlessSupported();
 
 };
\ No newline at end of file
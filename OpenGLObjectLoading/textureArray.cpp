@@ -0,0 +1,137 @@
+/*
+Title: Object Loading
+File Name: textureArray.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureArray.h"
+#include "mipmapGenerator.h"
+#include "glState.h"
+#include "pixelConvert.h"
+
+TextureArray::TextureArray(unsigned int width, unsigned int height, unsigned int layerCount)
+    : m_width(width), m_height(height), m_layerCount(layerCount)
+{
+    m_levelCount = MipmapGenerator::GetLevelCount(width, height);
+
+    glGenTextures(1, &m_texture);
+    GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, m_texture);
+
+    // Allocate every level of every layer at once, like Texture does.
+    if (GLEW_VERSION_4_2 || GLEW_ARB_texture_storage)
+    {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, m_levelCount, GL_RGBA8, width, height, layerCount);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < m_levelCount; i++)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, i, GL_RGBA8, MipmapGenerator::GetLevelWidth(width, i), MipmapGenerator::GetLevelWidth(height, i),
+                layerCount, 0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levelCount - 1);
+
+    // Set texture sampling parameters
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+TextureArray::~TextureArray()
+{
+    glDeleteTextures(1, &m_texture);
+    GLState::ForgetTexture(m_texture);
+}
+
+bool TextureArray::SetLayer(unsigned int layer, unsigned int width, unsigned int height, const void* pixels)
+{
+    if (layer >= m_layerCount || width != m_width || height != m_height)
+        return false;
+
+    GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
+    GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+    return true;
+}
+
+bool TextureArray::LoadLayer(unsigned int layer, const char* filePath)
+{
+    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(filePath), filePath);
+    if (bitmap == nullptr)
+    {
+        std::cout << "Can't load texture: " << filePath << std::endl;
+        return false;
+    }
+
+    // Convert the file to 32 bits so we can use it.
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    std::vector<unsigned char> pixels;
+    bool converted = PixelConvert::Convert(bitmap, pixels);
+    FreeImage_Unload(bitmap);
+
+    bool set = converted && SetLayer(layer, width, height, pixels.data());
+    if (converted && !set)
+    {
+        std::cout << "Texture " << filePath << " doesn't match the size of the texture array." << std::endl;
+    }
+    return set;
+}
+
+void TextureArray::GenerateMipmaps()
+{
+    GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, m_texture);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    GLState::BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureArray::IncRefCount()
+{
+    m_refCount++;
+}
+
+void TextureArray::DecRefCount()
+{
+    m_refCount--;
+    if (m_refCount == 0)
+    {
+        delete this;
+    }
+}
+
+GLuint TextureArray::GetGLTexture()
+{
+    return m_texture;
+}
+
+unsigned int TextureArray::GetWidth()
+{
+    return m_width;
+}
+
+unsigned int TextureArray::GetHeight()
+{
+    return m_height;
+}
+
+unsigned int TextureArray::GetLayerCount()
+{
+    return m_layerCount;
+}
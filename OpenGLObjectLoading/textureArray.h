@@ -0,0 +1,59 @@
+/*
+Title: Object Loading
+File Name: textureArray.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+#include "FreeImage.h"
+#include <iostream>
+
+// A GL_TEXTURE_2D_ARRAY: a stack of same sized images (layers) in one texture object.
+// Shaders pick the layer with the third texture coordinate, so draws using different layers
+// don't need a texture bind in between.
+class TextureArray
+{
+private:
+    GLuint m_texture;
+    unsigned int m_refCount = 0;
+
+    unsigned int m_width;
+    unsigned int m_height;
+    unsigned int m_layerCount;
+    unsigned int m_levelCount;
+
+public:
+    // Allocates immutable storage for every layer, with a full mip chain.
+    TextureArray(unsigned int width, unsigned int height, unsigned int layerCount);
+    ~TextureArray();
+
+    // Fills level 0 of a layer with 32 bit BGRA pixels. Returns false if the size doesn't match the array.
+    // Call GenerateMipmaps once all the layers are filled.
+    bool SetLayer(unsigned int layer, unsigned int width, unsigned int height, const void* pixels);
+    // Loads a file into a layer. Returns false if it can't be loaded, or is the wrong size.
+    bool LoadLayer(unsigned int layer, const char* filePath);
+
+    // Makes the other mip levels of every layer from level 0.
+    void GenerateMipmaps();
+
+    void IncRefCount();
+    void DecRefCount();
+    GLuint GetGLTexture();
+    unsigned int GetWidth();
+    unsigned int GetHeight();
+    unsigned int GetLayerCount();
+};
@@ -0,0 +1,205 @@
+/*
+Title: Object Loading
+File Name: textureAtlas.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureAtlas.h"
+#include "skylinePacker.h"
+#include "pixelConvert.h"
+#include <algorithm>
+#include <cstring>
+
+TextureAtlas::TextureAtlas(unsigned int pageSize, unsigned int sizeThreshold, unsigned int gutter)
+    : m_pageSize(pageSize), m_sizeThreshold(sizeThreshold), m_gutter(1)
+{
+    // The grid has to line up with every mip level, so the gutter is a power of two.
+    while (m_gutter < gutter)
+    {
+        m_gutter *= 2;
+    }
+}
+
+TextureAtlas::~TextureAtlas()
+{
+    for (size_t i = 0; i < m_pages.size(); i++)
+    {
+        m_pages[i]->DecRefCount();
+    }
+}
+
+bool TextureAtlas::Add(const char* filePath)
+{
+    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(filePath), filePath);
+    if (bitmap == nullptr)
+    {
+        std::cout << "Can't load atlas image: " << filePath << std::endl;
+        return false;
+    }
+
+    // Convert the file to 32 bits so we can use it.
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    std::vector<unsigned char> pixels;
+    bool converted = PixelConvert::Convert(bitmap, pixels);
+    FreeImage_Unload(bitmap);
+
+    return converted && Add(filePath, width, height, pixels.data());
+}
+
+bool TextureAtlas::Add(const std::string& name, unsigned int width, unsigned int height, const void* pixels)
+{
+    if (width == 0 || height == 0 || width > m_sizeThreshold || height > m_sizeThreshold)
+        return false;
+
+    // With its gutter, it has to fit on a page too.
+    if (width + m_gutter * 2 > m_pageSize || height + m_gutter * 2 > m_pageSize)
+        return false;
+
+    Image image;
+    image.m_name = name;
+    image.m_width = width;
+    image.m_height = height;
+    image.m_pixels.assign(static_cast<const unsigned char*>(pixels), static_cast<const unsigned char*>(pixels) + (size_t)width * height * 4);
+    m_images.push_back(image);
+    return true;
+}
+
+void TextureAtlas::Build()
+{
+    // Tall images first packs tighter.
+    std::vector<size_t> order(m_images.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return m_images[a].m_height > m_images[b].m_height;
+    });
+
+    // The packer works in grid cells, one gutter wide, so every image starts on a cell boundary.
+    // At mip level n, a cell is gutter / 2^n pixels, so up to log2(gutter) levels down every image
+    // still covers whole pixels, and the box filter never mixes two images.
+    unsigned int cellCount = m_pageSize / m_gutter;
+    unsigned int levelCount = 1;
+    for (unsigned int cell = m_gutter; cell > 1; cell /= 2)
+    {
+        levelCount++;
+    }
+
+    std::vector<SkylinePacker> packers;
+    std::vector<std::vector<unsigned char>> pagePixels;
+    // The page each image went to, since the page textures are only made at the end.
+    std::vector<size_t> imagePages(m_images.size());
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const Image& image = m_images[order[i]];
+
+        // Size with the gutter on every side, in cells.
+        unsigned int cellsWide = (image.m_width + m_gutter * 2 + m_gutter - 1) / m_gutter;
+        unsigned int cellsHigh = (image.m_height + m_gutter * 2 + m_gutter - 1) / m_gutter;
+
+        // Try every open page, then start a new one.
+        size_t page = 0;
+        unsigned int cellX = 0;
+        unsigned int cellY = 0;
+        for (; page < packers.size(); page++)
+        {
+            if (packers[page].Insert(cellsWide, cellsHigh, cellX, cellY))
+                break;
+        }
+        if (page == packers.size())
+        {
+            packers.push_back(SkylinePacker(cellCount, cellCount));
+            pagePixels.push_back(std::vector<unsigned char>((size_t)m_pageSize * m_pageSize * 4, 0));
+            packers[page].Insert(cellsWide, cellsHigh, cellX, cellY);
+        }
+
+        // Copy the image into the page. Pixels in the gutter repeat the nearest edge pixel of the image.
+        unsigned int x0 = cellX * m_gutter;
+        unsigned int y0 = cellY * m_gutter;
+        unsigned int paddedWidth = cellsWide * m_gutter;
+        unsigned int paddedHeight = cellsHigh * m_gutter;
+        unsigned char* pixels = pagePixels[page].data();
+        for (unsigned int y = 0; y < paddedHeight; y++)
+        {
+            int sourceY = (int)y - (int)m_gutter;
+            sourceY = sourceY < 0 ? 0 : (sourceY >= (int)image.m_height ? image.m_height - 1 : sourceY);
+            for (unsigned int x = 0; x < paddedWidth; x++)
+            {
+                int sourceX = (int)x - (int)m_gutter;
+                sourceX = sourceX < 0 ? 0 : (sourceX >= (int)image.m_width ? image.m_width - 1 : sourceX);
+                memcpy(pixels + ((size_t)(y0 + y) * m_pageSize + x0 + x) * 4,
+                    &image.m_pixels[((size_t)sourceY * image.m_width + sourceX) * 4], 4);
+            }
+        }
+
+        // The region's uvs cover the image, but not its gutter.
+        AtlasRegion region;
+        region.m_uvScaleOffset = glm::vec4(
+            (float)image.m_width / m_pageSize,
+            (float)image.m_height / m_pageSize,
+            (float)(x0 + m_gutter) / m_pageSize,
+            (float)(y0 + m_gutter) / m_pageSize);
+        m_regions[image.m_name] = region;
+        imagePages[order[i]] = page;
+    }
+
+    // Upload the pages, with the box filter so the gutters line up in every level.
+    size_t firstPage = m_pages.size();
+    for (size_t page = 0; page < pagePixels.size(); page++)
+    {
+        std::vector<unsigned char> chain;
+        MipmapGenerator::BuildChain(MipmapFilter::Box, pagePixels[page].data(), m_pageSize, m_pageSize, chain);
+
+        Texture* texture = new Texture();
+        texture->IncRefCount();
+        texture->SetMipChain(m_pageSize, m_pageSize, levelCount, chain.data());
+        m_pages.push_back(texture);
+
+        std::cout << "Atlas page " << firstPage + page << ": " << (int)(packers[page].GetOccupancy() * 100) << "% full" << std::endl;
+    }
+
+    for (size_t i = 0; i < m_images.size(); i++)
+    {
+        m_regions[m_images[i].m_name].m_page = m_pages[firstPage + imagePages[i]];
+    }
+
+    // The pixels live in the pages now.
+    m_images.clear();
+}
+
+bool TextureAtlas::GetRegion(const std::string& name, AtlasRegion& region)
+{
+    std::unordered_map<std::string, AtlasRegion>::iterator found = m_regions.find(name);
+    if (found == m_regions.end())
+        return false;
+
+    region = found->second;
+    return true;
+}
+
+unsigned int TextureAtlas::GetPageCount()
+{
+    return (unsigned int)m_pages.size();
+}
+
+Texture* TextureAtlas::GetPage(unsigned int index)
+{
+    return m_pages[index];
+}
@@ -0,0 +1,84 @@
+/*
+Title: Object Loading
+File Name: textureAtlas.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "texture.h"
+#include "glm/glm.hpp"
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+// Where a packed image ended up.
+struct AtlasRegion
+{
+    // The atlas page holding the image.
+    Texture* m_page = nullptr;
+    // Scale in xy and offset in zw, to turn the image's uvs into page uvs.
+    // Give it to the "uvScaleOffset" uniform with Material::SetVector.
+    glm::vec4 m_uvScaleOffset = glm::vec4(1, 1, 0, 0);
+};
+
+// Packs small images into a few big textures (pages), so materials using them share a texture.
+// Draws with the same page don't need a texture bind in between, and the render queue sorts them together.
+//
+// Each image gets a border of repeated edge pixels (the gutter), so filtering doesn't pick up its neighbours.
+// Images are placed on a grid the size of the gutter, and the page only gets as many mip levels
+// as it takes to shrink the gutter down to 1 pixel. That keeps images apart in every level.
+// Only use it for images whose uvs stay inside 0 to 1, since wrapping would sample the rest of the page.
+class TextureAtlas
+{
+private:
+    // An image waiting for Build.
+    struct Image
+    {
+        std::string m_name;
+        unsigned int m_width;
+        unsigned int m_height;
+        std::vector<unsigned char> m_pixels;
+    };
+
+    unsigned int m_pageSize;
+    unsigned int m_sizeThreshold;
+    unsigned int m_gutter;
+
+    std::vector<Image> m_images;
+    std::vector<Texture*> m_pages;
+    std::unordered_map<std::string, AtlasRegion> m_regions;
+
+public:
+    // pageSize is the width and height of every page.
+    // Images bigger than sizeThreshold on either side are left out, they're better off as their own texture.
+    // gutter is rounded up to a power of two.
+    TextureAtlas(unsigned int pageSize = 2048, unsigned int sizeThreshold = 256, unsigned int gutter = 8);
+    ~TextureAtlas();
+
+    // Loads a file to be packed, named by its path. Returns false if it can't be loaded, or is too big.
+    bool Add(const char* filePath);
+    // Adds 32 bit BGRA pixels to be packed. Returns false if the image is too big.
+    bool Add(const std::string& name, unsigned int width, unsigned int height, const void* pixels);
+
+    // Packs every added image into pages, and uploads them.
+    void Build();
+
+    // Finds where an image ended up. Returns false if it wasn't packed.
+    bool GetRegion(const std::string& name, AtlasRegion& region);
+
+    unsigned int GetPageCount();
+    Texture* GetPage(unsigned int index);
+};
@@ -0,0 +1,118 @@
+/*
+Title: Object Loading
+File Name: textureCache.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <climits>
+
+TextureCache::TextureCache(TextureLoader* loader, size_t budget) : m_loader(loader), m_budget(budget)
+{
+}
+
+TextureCache::~TextureCache()
+{
+    for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        it->m_texture->DecRefCount();
+    }
+}
+
+std::string TextureCache::GetCanonicalPath(const char* filePath)
+{
+#ifdef _WIN32
+    char fullPath[_MAX_PATH];
+    std::string path = _fullpath(fullPath, filePath, _MAX_PATH) ? fullPath : filePath;
+
+    // Windows paths aren't case sensitive, so neither is the key.
+    std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+    std::replace(path.begin(), path.end(), '/', '\\');
+    return path;
+#else
+    char fullPath[PATH_MAX];
+    return realpath(filePath, fullPath) ? std::string(fullPath) : std::string(filePath);
+#endif
+}
+
+Texture* TextureCache::Get(const char* filePath, MipmapFilter filter, TextureCompression compression)
+{
+    // The same file with different settings is a different texture.
+    std::string key = GetCanonicalPath(filePath) + "|" + std::to_string((int)filter) + "|" + std::to_string((int)compression);
+
+    std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found = m_lookup.find(key);
+    if (found != m_lookup.end())
+    {
+        // Move it to the front, since it was just used.
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        return found->second->m_texture;
+    }
+
+    Entry entry;
+    entry.m_key = key;
+    entry.m_texture = m_loader->Load(filePath, filter, compression);
+    entry.m_texture->IncRefCount();
+
+    m_entries.push_front(entry);
+    m_lookup[key] = m_entries.begin();
+    return entry.m_texture;
+}
+
+unsigned int TextureCache::Update()
+{
+    // Sizes change as loads finish, so add them up fresh.
+    size_t size = GetByteSize();
+    unsigned int evicted = 0;
+
+    // Walk from the least recently used end. Only the cache's own reference means nothing else uses it.
+    std::list<Entry>::iterator it = m_entries.end();
+    while (size > m_budget && it != m_entries.begin())
+    {
+        --it;
+        if (it->m_texture->GetRefCount() != 1)
+            continue;
+
+        size -= it->m_texture->GetByteSize();
+        it->m_texture->DecRefCount();
+        m_lookup.erase(it->m_key);
+        it = m_entries.erase(it);
+        evicted++;
+    }
+
+    return evicted;
+}
+
+void TextureCache::SetBudget(size_t budget)
+{
+    m_budget = budget;
+}
+
+size_t TextureCache::GetByteSize()
+{
+    size_t size = 0;
+    for (std::list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        size += it->m_texture->GetByteSize();
+    }
+    return size;
+}
+
+unsigned int TextureCache::GetTextureCount()
+{
+    return (unsigned int)m_entries.size();
+}
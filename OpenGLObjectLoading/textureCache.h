@@ -0,0 +1,67 @@
+/*
+Title: Object Loading
+File Name: textureCache.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "textureLoader.h"
+#include <list>
+#include <unordered_map>
+#include <string>
+
+// Shares textures between everything that loads the same file with the same settings.
+// Loads go through a TextureLoader, so a texture is only decoded and uploaded once.
+// The cache holds a reference to every texture it hands out. When the textures use more memory than the budget,
+// the least recently used ones that nothing else references are released.
+class TextureCache
+{
+private:
+    struct Entry
+    {
+        std::string m_key;
+        Texture* m_texture;
+    };
+
+    TextureLoader* m_loader;
+    size_t m_budget;
+
+    // Most recently used at the front.
+    std::list<Entry> m_entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_lookup;
+
+    // Turns a path into one that is the same for every way of writing it, like "a/../b.png" and "b.png".
+    static std::string GetCanonicalPath(const char* filePath);
+
+public:
+    // budget is in bytes of estimated gpu memory.
+    TextureCache(TextureLoader* loader, size_t budget = 256 * 1024 * 1024);
+    // Releases the cache's references. Textures still used elsewhere stay alive.
+    ~TextureCache();
+
+    // Returns the shared texture for a file and settings, starting a load if it isn't cached yet.
+    // Like new Texture, the returned texture isn't referenced for the caller, so add a reference to keep it.
+    Texture* Get(const char* filePath, MipmapFilter filter = MipmapFilter::Gpu, TextureCompression compression = TextureCompression::None);
+
+    // Evicts textures until the cache fits in the budget, or nothing left can be evicted.
+    // Call it once a frame. Returns the number of textures evicted.
+    unsigned int Update();
+
+    void SetBudget(size_t budget);
+    // Estimated gpu memory used by every cached texture.
+    size_t GetByteSize();
+    unsigned int GetTextureCount();
+};
@@ -0,0 +1,1051 @@
+/*
+Title: Object Loading
+File Name: textureCompressor.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureCompressor.h"
+#include "mappedFile.h"
+#include "pixelConvert.h"
+#include "fileStamp.h"
+#include "FreeImage.h"
+#include <emmintrin.h>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+// Bump this whenever the encoders change, so old caches get rebuilt.
+#define TEXTURE_CACHE_VERSION 2
+
+// DDS is the container the cache is written in. Only the parts we need are filled in.
+struct DdsPixelFormat
+{
+    unsigned int m_size;
+    unsigned int m_flags;
+    unsigned int m_fourCC;
+    unsigned int m_rgbBitCount;
+    unsigned int m_rBitMask;
+    unsigned int m_gBitMask;
+    unsigned int m_bBitMask;
+    unsigned int m_aBitMask;
+};
+
+struct DdsHeader
+{
+    unsigned int m_size;
+    unsigned int m_flags;
+    unsigned int m_height;
+    unsigned int m_width;
+    unsigned int m_pitchOrLinearSize;
+    unsigned int m_depth;
+    unsigned int m_mipMapCount;
+    // Unused by DDS readers. We keep a stamp of the source file here, to tell when the cache is stale.
+    unsigned int m_reserved1[11];
+    DdsPixelFormat m_pixelFormat;
+    unsigned int m_caps;
+    unsigned int m_caps2;
+    unsigned int m_caps3;
+    unsigned int m_caps4;
+    unsigned int m_reserved2;
+};
+
+// Extra header for formats newer than DXT, like BC7.
+struct DdsHeaderDX10
+{
+    unsigned int m_dxgiFormat;
+    unsigned int m_resourceDimension;
+    unsigned int m_miscFlag;
+    unsigned int m_arraySize;
+    unsigned int m_miscFlags2;
+};
+
+#define DDS_FOURCC(a, b, c, d) ((unsigned int)(a) | ((unsigned int)(b) << 8) | ((unsigned int)(c) << 16) | ((unsigned int)(d) << 24))
+
+// Header flags: caps, height, width, pixel format, mipmap count, linear size.
+#define DDS_HEADER_FLAGS 0x000A1007
+// Caps: complex, texture, mipmap.
+#define DDS_CAPS 0x00401008
+#define DDS_PIXEL_FORMAT_FOURCC 0x4
+#define DDS_DXGI_FORMAT_BC7_UNORM 98
+#define DDS_DIMENSION_TEXTURE2D 3
+
+// Identifies our stamp in the reserved part of the header.
+#define TEXTURE_CACHE_STAMP DDS_FOURCC('T', 'X', 'C', 'H')
+
+// Fills in the stamp for a source file. Returns false if the file doesn't exist.
+static bool MakeStamp(const std::string& sourcePath, TextureCompression format, MipmapFilter filter, unsigned int* stamp)
+{
+    FileStamp fileStamp;
+    if (!fileStamp.Make(sourcePath))
+    {
+        return false;
+    }
+
+    memset(stamp, 0, sizeof(unsigned int) * 11);
+    stamp[0] = TEXTURE_CACHE_STAMP;
+    stamp[1] = TEXTURE_CACHE_VERSION;
+    fileStamp.Pack(stamp + 2);
+    stamp[2 + FILE_STAMP_WORDS] = (unsigned int)filter;
+    stamp[3 + FILE_STAMP_WORDS] = (unsigned int)format;
+    return true;
+}
+
+unsigned int TextureCompressor::GetBlockSize(TextureCompression format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1:
+        return 8;
+    case TextureCompression::BC3:
+    case TextureCompression::BC7:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t TextureCompressor::GetLevelSize(TextureCompression format, unsigned int width, unsigned int height)
+{
+    // Partial blocks at the edges still take a whole block.
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+GLenum TextureCompressor::GetGLFormat(TextureCompression format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureCompression::BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureCompression::BC7:
+        return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default:
+        return GL_RGBA8;
+    }
+}
+
+bool TextureCompressor::IsSupported(TextureCompression format)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1:
+    case TextureCompression::BC3:
+        return GLEW_EXT_texture_compression_s3tc != 0;
+    case TextureCompression::BC7:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    default:
+        return true;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Encoders
+//
+// Every block is turned into floats, one array per channel (red, green, blue, alpha),
+// so SSE can work on 4 pixels at a time.
+// ----------------------------------------------------------------------------
+
+// Picks the closest palette entry for each of the 16 pixels, and returns the total squared error.
+static float FindIndices(const float (*channels)[16], unsigned int channelCount, const float (*palette)[4], unsigned int paletteSize,
+    unsigned char* indices)
+{
+    float total = 0.0f;
+
+    for (unsigned int group = 0; group < 16; group += 4)
+    {
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128 bestIndex = _mm_setzero_ps();
+
+        for (unsigned int k = 0; k < paletteSize; k++)
+        {
+            __m128 distance = _mm_setzero_ps();
+            for (unsigned int c = 0; c < channelCount; c++)
+            {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(channels[c] + group), _mm_set1_ps(palette[k][c]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+            }
+
+            // SSE2 has no blend, so select the closer index with masks.
+            __m128 closer = _mm_cmplt_ps(distance, best);
+            best = _mm_min_ps(distance, best);
+            bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)k)), _mm_andnot_ps(closer, bestIndex));
+        }
+
+        float errors[4];
+        float found[4];
+        _mm_storeu_ps(errors, best);
+        _mm_storeu_ps(found, bestIndex);
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            indices[group + i] = (unsigned char)found[i];
+            total += errors[i];
+        }
+    }
+
+    return total;
+}
+
+// Finds the line through the colors that fits them best (their principal axis),
+// and returns the two ends of it that cover every pixel.
+static void FindEndpoints(const float (*channels)[16], unsigned int channelCount, float* endpoint0, float* endpoint1)
+{
+    float mean[4] = { 0, 0, 0, 0 };
+    float minimum[4] = { 255, 255, 255, 255 };
+    float maximum[4] = { 0, 0, 0, 0 };
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            mean[c] += channels[c][i];
+            minimum[c] = fminf(minimum[c], channels[c][i]);
+            maximum[c] = fmaxf(maximum[c], channels[c][i]);
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        for (unsigned int a = 0; a < channelCount; a++)
+        {
+            for (unsigned int b = 0; b < channelCount; b++)
+            {
+                covariance[a][b] += (channels[a][i] - mean[a]) * (channels[b][i] - mean[b]);
+            }
+        }
+    }
+
+    // Power iteration, starting from the diagonal of the bounding box.
+    float axis[4] = { 0, 0, 0, 0 };
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        axis[c] = maximum[c] - minimum[c];
+    }
+    for (unsigned int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = { 0, 0, 0, 0 };
+        float length = 0.0f;
+        for (unsigned int a = 0; a < channelCount; a++)
+        {
+            for (unsigned int b = 0; b < channelCount; b++)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+
+        if (length < 1e-12f)
+            break;
+
+        length = 1.0f / sqrtf(length);
+        for (unsigned int c = 0; c < channelCount; c++)
+        {
+            axis[c] = next[c] * length;
+        }
+    }
+
+    float axisLength = 0.0f;
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        axisLength += axis[c] * axis[c];
+    }
+
+    // A flat colored block.
+    if (axisLength < 1e-12f)
+    {
+        for (unsigned int c = 0; c < channelCount; c++)
+        {
+            endpoint0[c] = endpoint1[c] = mean[c];
+        }
+        return;
+    }
+
+    axisLength = 1.0f / sqrtf(axisLength);
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        axis[c] *= axisLength;
+    }
+
+    // Project every pixel onto the axis to find how far it reaches in each direction.
+    float low = FLT_MAX;
+    float high = -FLT_MAX;
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (unsigned int c = 0; c < channelCount; c++)
+        {
+            t += (channels[c][i] - mean[c]) * axis[c];
+        }
+        low = fminf(low, t);
+        high = fmaxf(high, t);
+    }
+
+    for (unsigned int c = 0; c < channelCount; c++)
+    {
+        endpoint0[c] = fminf(fmaxf(mean[c] + axis[c] * high, 0.0f), 255.0f);
+        endpoint1[c] = fminf(fmaxf(mean[c] + axis[c] * low, 0.0f), 255.0f);
+    }
+}
+
+static unsigned short PackColor565(const float* color)
+{
+    unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+    unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+    unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+// Expands a 565 color to 8 bits a channel, the same way the gpu does.
+static void UnpackColor565(unsigned short packed, int* color)
+{
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// The 4 colors a BC1 block can pick from, in the 4 color mode.
+static void BuildColorPalette(unsigned short color0, unsigned short color1, float (*palette)[4])
+{
+    int a[3];
+    int b[3];
+    UnpackColor565(color0, a);
+    UnpackColor565(color1, b);
+    for (unsigned int c = 0; c < 3; c++)
+    {
+        palette[0][c] = (float)a[c];
+        palette[1][c] = (float)b[c];
+        palette[2][c] = (float)((2 * a[c] + b[c]) / 3);
+        palette[3][c] = (float)((a[c] + 2 * b[c]) / 3);
+    }
+}
+
+// How much of endpoint 0 each BC1 palette entry uses.
+static const float c_colorWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+// Moves the endpoints to the least squares fit of the chosen indices.
+// Returns false if the indices don't pin the endpoints down, like when every pixel picked the same entry.
+static bool RefineColorEndpoints(const float (*channels)[16], const unsigned char* indices, float* endpoint0, float* endpoint1)
+{
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[3] = { 0, 0, 0 };
+    float bx[3] = { 0, 0, 0 };
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        float a = c_colorWeights[indices[i]];
+        float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (unsigned int c = 0; c < 3; c++)
+        {
+            ax[c] += a * channels[c][i];
+            bx[c] += b * channels[c][i];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f)
+        return false;
+
+    determinant = 1.0f / determinant;
+    for (unsigned int c = 0; c < 3; c++)
+    {
+        endpoint0[c] = fminf(fmaxf((ax[c] * bb - bx[c] * ab) * determinant, 0.0f), 255.0f);
+        endpoint1[c] = fminf(fmaxf((bx[c] * aa - ax[c] * ab) * determinant, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+// Writes the 8 byte color part of a BC1 or BC3 block.
+static void EncodeColorBlock(const float (*channels)[16], unsigned char* block)
+{
+    float endpoint0[4];
+    float endpoint1[4];
+    FindEndpoints(channels, 3, endpoint0, endpoint1);
+
+    unsigned short color0 = PackColor565(endpoint0);
+    unsigned short color1 = PackColor565(endpoint1);
+    float palette[4][4];
+    unsigned char indices[16];
+    BuildColorPalette(color0, color1, palette);
+    float error = FindIndices(channels, 3, palette, 4, indices);
+
+    // One round of least squares usually lowers the error a fair bit.
+    if (RefineColorEndpoints(channels, indices, endpoint0, endpoint1))
+    {
+        unsigned short refined0 = PackColor565(endpoint0);
+        unsigned short refined1 = PackColor565(endpoint1);
+        unsigned char refinedIndices[16];
+        BuildColorPalette(refined0, refined1, palette);
+        float refinedError = FindIndices(channels, 3, palette, 4, refinedIndices);
+
+        if (refinedError < error)
+        {
+            color0 = refined0;
+            color1 = refined1;
+            memcpy(indices, refinedIndices, sizeof(indices));
+        }
+    }
+
+    // The 4 color mode needs color0 > color1, so swap the ends if needed.
+    // Swapping the ends swaps palette entries 0 with 1, and 2 with 3.
+    if (color0 < color1)
+    {
+        unsigned short swap = color0;
+        color0 = color1;
+        color1 = swap;
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            indices[i] ^= 1;
+        }
+    }
+    else if (color0 == color1)
+    {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    unsigned int bits = 0;
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        bits |= (unsigned int)indices[i] << (i * 2);
+    }
+
+    block[0] = (unsigned char)color0;
+    block[1] = (unsigned char)(color0 >> 8);
+    block[2] = (unsigned char)color1;
+    block[3] = (unsigned char)(color1 >> 8);
+    memcpy(block + 4, &bits, 4);
+}
+
+// The 8 alphas a BC3 alpha block can pick from.
+static void BuildAlphaPalette(int alpha0, int alpha1, float (*palette)[4])
+{
+    palette[0][0] = (float)alpha0;
+    palette[1][0] = (float)alpha1;
+    for (int i = 1; i < 7; i++)
+    {
+        palette[i + 1][0] = (float)(((7 - i) * alpha0 + i * alpha1) / 7);
+    }
+}
+
+// Writes the 8 byte alpha part of a BC3 block.
+static void EncodeAlphaBlock(const float* alpha, unsigned char* block)
+{
+    float low = 255.0f;
+    float high = 0.0f;
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        low = fminf(low, alpha[i]);
+        high = fmaxf(high, alpha[i]);
+    }
+
+    // With alpha0 > alpha1, the block uses 8 evenly spaced alphas between them.
+    int alpha0 = (int)(high + 0.5f);
+    int alpha1 = (int)(low + 0.5f);
+    unsigned char indices[16] = {};
+    if (alpha0 > alpha1)
+    {
+        float palette[8][4];
+        BuildAlphaPalette(alpha0, alpha1, palette);
+        FindIndices(reinterpret_cast<const float (*)[16]>(alpha), 1, palette, 8, indices);
+    }
+
+    unsigned long long bits = 0;
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        bits |= (unsigned long long)indices[i] << (i * 3);
+    }
+
+    block[0] = (unsigned char)alpha0;
+    block[1] = (unsigned char)alpha1;
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        block[2 + i] = (unsigned char)(bits >> (i * 8));
+    }
+}
+
+// BC7 interpolation weights for 4 bit indices, out of 64.
+static const int c_bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Appends bits to a block, lowest bit first.
+static void WriteBits(unsigned char* block, unsigned int& offset, unsigned int value, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; i++, offset++)
+    {
+        if (value & (1u << i))
+            block[offset / 8] |= (unsigned char)(1u << (offset % 8));
+    }
+}
+
+static unsigned int ReadBits(const unsigned char* block, unsigned int& offset, unsigned int count)
+{
+    unsigned int value = 0;
+    for (unsigned int i = 0; i < count; i++, offset++)
+    {
+        value |= (unsigned int)((block[offset / 8] >> (offset % 8)) & 1) << i;
+    }
+    return value;
+}
+
+// Writes a BC7 block in mode 6: one pair of 7 bit RGBA endpoints, each with a shared low bit (p bit), and 4 bit indices.
+// It's the simplest mode, and handles smooth color and alpha well.
+static void EncodeBC7Block(const float (*channels)[16], unsigned char* block)
+{
+    float endpoint0[4];
+    float endpoint1[4];
+    FindEndpoints(channels, 4, endpoint0, endpoint1);
+
+    // Try every combination of p bits, and keep the one with the least error.
+    int bestQuantized[2][4] = {};
+    int bestPBits[2] = { 0, 0 };
+    unsigned char bestIndices[16] = {};
+    float bestError = FLT_MAX;
+    for (int pBits = 0; pBits < 4; pBits++)
+    {
+        int p[2] = { pBits & 1, pBits >> 1 };
+        int quantized[2][4];
+        int decoded[2][4];
+        for (unsigned int c = 0; c < 4; c++)
+        {
+            const float ends[2] = { endpoint0[c], endpoint1[c] };
+            for (unsigned int e = 0; e < 2; e++)
+            {
+                int q = (int)floorf((ends[e] - p[e]) * 0.5f + 0.5f);
+                quantized[e][c] = q < 0 ? 0 : (q > 127 ? 127 : q);
+                decoded[e][c] = (quantized[e][c] << 1) | p[e];
+            }
+        }
+
+        float palette[16][4];
+        for (unsigned int k = 0; k < 16; k++)
+        {
+            for (unsigned int c = 0; c < 4; c++)
+            {
+                palette[k][c] = (float)(((64 - c_bc7Weights[k]) * decoded[0][c] + c_bc7Weights[k] * decoded[1][c] + 32) >> 6);
+            }
+        }
+
+        unsigned char indices[16];
+        float error = FindIndices(channels, 4, palette, 16, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            memcpy(bestQuantized, quantized, sizeof(quantized));
+            bestPBits[0] = p[0];
+            bestPBits[1] = p[1];
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    // The first index only has room for 3 bits, so its top bit must be 0.
+    // If it isn't, swap the endpoints, which flips every index.
+    if (bestIndices[0] & 8)
+    {
+        for (unsigned int c = 0; c < 4; c++)
+        {
+            int swap = bestQuantized[0][c];
+            bestQuantized[0][c] = bestQuantized[1][c];
+            bestQuantized[1][c] = swap;
+        }
+        int swap = bestPBits[0];
+        bestPBits[0] = bestPBits[1];
+        bestPBits[1] = swap;
+        for (unsigned int i = 0; i < 16; i++)
+        {
+            bestIndices[i] = 15 - bestIndices[i];
+        }
+    }
+
+    memset(block, 0, 16);
+    unsigned int offset = 0;
+
+    // Mode 6 is a 1 bit after 6 zeros.
+    WriteBits(block, offset, 1 << 6, 7);
+    for (unsigned int c = 0; c < 4; c++)
+    {
+        WriteBits(block, offset, bestQuantized[0][c], 7);
+        WriteBits(block, offset, bestQuantized[1][c], 7);
+    }
+    WriteBits(block, offset, bestPBits[0], 1);
+    WriteBits(block, offset, bestPBits[1], 1);
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        WriteBits(block, offset, bestIndices[i], i == 0 ? 3 : 4);
+    }
+}
+
+void TextureCompressor::EncodeBlock(TextureCompression format, const unsigned char* pixels, unsigned char* block)
+{
+    // Split the BGRA pixels into red, green, blue and alpha arrays.
+    float channels[4][16];
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        channels[0][i] = pixels[i * 4 + 2];
+        channels[1][i] = pixels[i * 4 + 1];
+        channels[2][i] = pixels[i * 4 + 0];
+        channels[3][i] = pixels[i * 4 + 3];
+    }
+
+    switch (format)
+    {
+    case TextureCompression::BC1:
+        EncodeColorBlock(channels, block);
+        break;
+    case TextureCompression::BC3:
+        EncodeAlphaBlock(channels[3], block);
+        EncodeColorBlock(channels, block + 8);
+        break;
+    case TextureCompression::BC7:
+        EncodeBC7Block(channels, block);
+        break;
+    default:
+        break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Decoders, used to measure quality.
+// ----------------------------------------------------------------------------
+
+static void DecodeColorBlock(const unsigned char* block, unsigned char* pixels, bool allowThreeColors)
+{
+    unsigned short color0 = (unsigned short)(block[0] | (block[1] << 8));
+    unsigned short color1 = (unsigned short)(block[2] | (block[3] << 8));
+    unsigned int bits;
+    memcpy(&bits, block + 4, 4);
+
+    int a[3];
+    int b[3];
+    UnpackColor565(color0, a);
+    UnpackColor565(color1, b);
+
+    // BC1 switches to 3 colors and transparent black when color0 <= color1. BC3 always uses 4 colors.
+    bool threeColors = allowThreeColors && color0 <= color1;
+
+    int palette[4][4];
+    for (unsigned int c = 0; c < 3; c++)
+    {
+        palette[0][c] = a[c];
+        palette[1][c] = b[c];
+        palette[2][c] = threeColors ? (a[c] + b[c]) / 2 : (2 * a[c] + b[c]) / 3;
+        palette[3][c] = threeColors ? 0 : (a[c] + 2 * b[c]) / 3;
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = threeColors ? 0 : 255;
+
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        const int* color = palette[(bits >> (i * 2)) & 3];
+        pixels[i * 4 + 0] = (unsigned char)color[2];
+        pixels[i * 4 + 1] = (unsigned char)color[1];
+        pixels[i * 4 + 2] = (unsigned char)color[0];
+        pixels[i * 4 + 3] = (unsigned char)color[3];
+    }
+}
+
+static void DecodeAlphaBlock(const unsigned char* block, unsigned char* pixels)
+{
+    int alpha0 = block[0];
+    int alpha1 = block[1];
+
+    int palette[8];
+    palette[0] = alpha0;
+    palette[1] = alpha1;
+    for (int i = 1; i < 7; i++)
+    {
+        // The encoder only writes the 8 alpha mode, but decode the 6 alpha mode too.
+        if (alpha0 > alpha1)
+            palette[i + 1] = ((7 - i) * alpha0 + i * alpha1) / 7;
+        else if (i < 5)
+            palette[i + 1] = ((5 - i) * alpha0 + i * alpha1) / 5;
+        else
+            palette[i + 1] = i == 5 ? 0 : 255;
+    }
+
+    unsigned long long bits = 0;
+    for (unsigned int i = 0; i < 6; i++)
+    {
+        bits |= (unsigned long long)block[2 + i] << (i * 8);
+    }
+
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        pixels[i * 4 + 3] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+    }
+}
+
+static void DecodeBC7Block(const unsigned char* block, unsigned char* pixels)
+{
+    // Only mode 6 is decoded, since it's the only mode the encoder writes.
+    if ((block[0] & 0x7F) != 0x40)
+    {
+        memset(pixels, 0, 64);
+        return;
+    }
+
+    unsigned int offset = 7;
+    int decoded[2][4];
+    for (unsigned int c = 0; c < 4; c++)
+    {
+        decoded[0][c] = ReadBits(block, offset, 7) << 1;
+        decoded[1][c] = ReadBits(block, offset, 7) << 1;
+    }
+    unsigned int p0 = ReadBits(block, offset, 1);
+    unsigned int p1 = ReadBits(block, offset, 1);
+    for (unsigned int c = 0; c < 4; c++)
+    {
+        decoded[0][c] |= p0;
+        decoded[1][c] |= p1;
+    }
+
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        int weight = c_bc7Weights[ReadBits(block, offset, i == 0 ? 3 : 4)];
+        int rgba[4];
+        for (unsigned int c = 0; c < 4; c++)
+        {
+            rgba[c] = ((64 - weight) * decoded[0][c] + weight * decoded[1][c] + 32) >> 6;
+        }
+        pixels[i * 4 + 0] = (unsigned char)rgba[2];
+        pixels[i * 4 + 1] = (unsigned char)rgba[1];
+        pixels[i * 4 + 2] = (unsigned char)rgba[0];
+        pixels[i * 4 + 3] = (unsigned char)rgba[3];
+    }
+}
+
+void TextureCompressor::DecodeBlock(TextureCompression format, const unsigned char* block, unsigned char* pixels)
+{
+    switch (format)
+    {
+    case TextureCompression::BC1:
+        DecodeColorBlock(block, pixels, true);
+        break;
+    case TextureCompression::BC3:
+        DecodeColorBlock(block + 8, pixels, false);
+        DecodeAlphaBlock(block, pixels);
+        break;
+    case TextureCompression::BC7:
+        DecodeBC7Block(block, pixels);
+        break;
+    default:
+        break;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Whole images
+// ----------------------------------------------------------------------------
+
+void TextureCompressor::Encode(TextureCompression format, const unsigned char* pixels, unsigned int width, unsigned int height,
+    unsigned char* output, JobSystem* jobs)
+{
+    unsigned int blocksWide = (width + 3) / 4;
+    unsigned int blocksHigh = (height + 3) / 4;
+    unsigned int blockSize = GetBlockSize(format);
+
+    auto encodeRows = [=](unsigned int begin, unsigned int end)
+    {
+        unsigned char blockPixels[64];
+        for (unsigned int by = begin; by < end; by++)
+        {
+            for (unsigned int bx = 0; bx < blocksWide; bx++)
+            {
+                // Gather the block. Blocks hanging off the edge repeat the last row and column.
+                for (unsigned int y = 0; y < 4; y++)
+                {
+                    unsigned int py = by * 4 + y < height ? by * 4 + y : height - 1;
+                    for (unsigned int x = 0; x < 4; x++)
+                    {
+                        unsigned int px = bx * 4 + x < width ? bx * 4 + x : width - 1;
+                        memcpy(blockPixels + (y * 4 + x) * 4, pixels + ((size_t)py * width + px) * 4, 4);
+                    }
+                }
+
+                EncodeBlock(format, blockPixels, output + ((size_t)by * blocksWide + bx) * blockSize);
+            }
+        }
+    };
+
+    if (jobs)
+        jobs->ParallelFor(blocksHigh, 4, encodeRows);
+    else
+        encodeRows(0, blocksHigh);
+}
+
+void TextureCompressor::Decode(TextureCompression format, const unsigned char* input, unsigned int width, unsigned int height, unsigned char* pixels)
+{
+    unsigned int blocksWide = (width + 3) / 4;
+    unsigned int blocksHigh = (height + 3) / 4;
+    unsigned int blockSize = GetBlockSize(format);
+
+    unsigned char blockPixels[64];
+    for (unsigned int by = 0; by < blocksHigh; by++)
+    {
+        for (unsigned int bx = 0; bx < blocksWide; bx++)
+        {
+            DecodeBlock(format, input + ((size_t)by * blocksWide + bx) * blockSize, blockPixels);
+
+            // Scatter the block, dropping the parts past the edge.
+            for (unsigned int y = 0; y < 4 && by * 4 + y < height; y++)
+            {
+                for (unsigned int x = 0; x < 4 && bx * 4 + x < width; x++)
+                {
+                    memcpy(pixels + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, blockPixels + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+}
+
+void TextureCompressor::Compress(TextureCompression format, MipmapFilter filter, const unsigned char* pixels, unsigned int width, unsigned int height,
+    CompressedImage& image, JobSystem* jobs)
+{
+    if (filter == MipmapFilter::Gpu)
+        filter = MipmapFilter::Box;
+
+    // Build the mip chain first, then encode each level of it.
+    std::vector<unsigned char> chain;
+    unsigned int levelCount = 1;
+    if (filter == MipmapFilter::None)
+        chain.assign(pixels, pixels + (size_t)width * height * 4);
+    else
+        levelCount = MipmapGenerator::BuildChain(filter, pixels, width, height, chain);
+
+    size_t size = 0;
+    for (unsigned int i = 0; i < levelCount; i++)
+    {
+        size += GetLevelSize(format, MipmapGenerator::GetLevelWidth(width, i), MipmapGenerator::GetLevelWidth(height, i));
+    }
+
+    image.m_format = format;
+    image.m_width = width;
+    image.m_height = height;
+    image.m_levelCount = levelCount;
+    image.m_data.resize(size);
+
+    const unsigned char* level = chain.data();
+    unsigned char* output = image.m_data.data();
+    for (unsigned int i = 0; i < levelCount; i++)
+    {
+        unsigned int levelWidth = MipmapGenerator::GetLevelWidth(width, i);
+        unsigned int levelHeight = MipmapGenerator::GetLevelWidth(height, i);
+
+        Encode(format, level, levelWidth, levelHeight, output, jobs);
+        level += (size_t)levelWidth * levelHeight * 4;
+        output += GetLevelSize(format, levelWidth, levelHeight);
+    }
+}
+
+double TextureCompressor::MeasurePSNR(const unsigned char* pixels, const CompressedImage& image)
+{
+    std::vector<unsigned char> decoded((size_t)image.m_width * image.m_height * 4);
+    Decode(image.m_format, image.m_data.data(), image.m_width, image.m_height, decoded.data());
+
+    unsigned int channelCount = image.m_format == TextureCompression::BC1 ? 3 : 4;
+    double squaredError = 0.0;
+    for (size_t i = 0; i < decoded.size(); i += 4)
+    {
+        for (unsigned int c = 0; c < channelCount; c++)
+        {
+            double d = (double)pixels[i + c] - decoded[i + c];
+            squaredError += d * d;
+        }
+    }
+
+    double meanSquaredError = squaredError / ((double)image.m_width * image.m_height * channelCount);
+    if (meanSquaredError <= 0.0)
+        return 100.0;
+
+    return 10.0 * log10(255.0 * 255.0 / meanSquaredError);
+}
+
+// ----------------------------------------------------------------------------
+// Cache
+// ----------------------------------------------------------------------------
+
+std::string TextureCompressor::GetCachePath(std::string sourcePath, TextureCompression format, MipmapFilter filter)
+{
+    static const char* formatNames[] = { "rgba8", "bc1", "bc3", "bc7" };
+    static const char* filterNames[] = { "none", "box", "box", "kaiser" };
+    return sourcePath + "." + formatNames[(int)format] + "." + filterNames[(int)filter] + ".dds";
+}
+
+bool TextureCompressor::SaveCache(std::string sourcePath, MipmapFilter filter, const CompressedImage& image)
+{
+    if (filter == MipmapFilter::Gpu)
+        filter = MipmapFilter::Box;
+
+    DdsHeader header;
+    memset(&header, 0, sizeof(header));
+
+    if (!MakeStamp(sourcePath, image.m_format, filter, header.m_reserved1))
+    {
+        return false;
+    }
+
+    header.m_size = sizeof(DdsHeader);
+    header.m_flags = DDS_HEADER_FLAGS;
+    header.m_height = image.m_height;
+    header.m_width = image.m_width;
+    header.m_pitchOrLinearSize = (unsigned int)GetLevelSize(image.m_format, image.m_width, image.m_height);
+    header.m_mipMapCount = image.m_levelCount;
+    header.m_pixelFormat.m_size = sizeof(DdsPixelFormat);
+    header.m_pixelFormat.m_flags = DDS_PIXEL_FORMAT_FOURCC;
+    header.m_caps = DDS_CAPS;
+
+    // BC1 and BC3 have their own four character codes. BC7 needs the DX10 header.
+    switch (image.m_format)
+    {
+    case TextureCompression::BC1:
+        header.m_pixelFormat.m_fourCC = DDS_FOURCC('D', 'X', 'T', '1');
+        break;
+    case TextureCompression::BC3:
+        header.m_pixelFormat.m_fourCC = DDS_FOURCC('D', 'X', 'T', '5');
+        break;
+    case TextureCompression::BC7:
+        header.m_pixelFormat.m_fourCC = DDS_FOURCC('D', 'X', '1', '0');
+        break;
+    default:
+        return false;
+    }
+
+    std::ofstream file(GetCachePath(sourcePath, image.m_format, filter), std::ios::binary | std::ios::trunc);
+    if (!file.good())
+    {
+        return false;
+    }
+
+    file.write("DDS ", 4);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (image.m_format == TextureCompression::BC7)
+    {
+        DdsHeaderDX10 dx10;
+        memset(&dx10, 0, sizeof(dx10));
+        dx10.m_dxgiFormat = DDS_DXGI_FORMAT_BC7_UNORM;
+        dx10.m_resourceDimension = DDS_DIMENSION_TEXTURE2D;
+        dx10.m_arraySize = 1;
+        file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+    }
+    file.write(reinterpret_cast<const char*>(image.m_data.data()), image.m_data.size());
+
+    return file.good();
+}
+
+bool TextureCompressor::LoadCache(std::string sourcePath, TextureCompression format, MipmapFilter filter, CompressedImage& image)
+{
+    if (filter == MipmapFilter::Gpu)
+        filter = MipmapFilter::Box;
+
+    MappedFile file;
+    if (!file.Open(GetCachePath(sourcePath, format, filter)))
+    {
+        return false;
+    }
+
+    size_t headerSize = 4 + sizeof(DdsHeader) + (format == TextureCompression::BC7 ? sizeof(DdsHeaderDX10) : 0);
+    if (file.GetSize() < headerSize || memcmp(file.GetData(), "DDS ", 4) != 0)
+    {
+        return false;
+    }
+
+    const DdsHeader* header = reinterpret_cast<const DdsHeader*>(file.GetData() + 4);
+
+    // Compare the stamp against the source file, reject the cache on any mismatch.
+    // The stamp has the format and filter in it too, so a cache renamed or copied over another one is rejected as well.
+    unsigned int stamp[11];
+    if (header->m_size != sizeof(DdsHeader) ||
+        !MakeStamp(sourcePath, format, filter, stamp) ||
+        memcmp(stamp, header->m_reserved1, sizeof(stamp)) != 0)
+    {
+        return false;
+    }
+
+    TextureCompression fileFormat = TextureCompression::None;
+    if (header->m_pixelFormat.m_fourCC == DDS_FOURCC('D', 'X', 'T', '1'))
+    {
+        fileFormat = TextureCompression::BC1;
+    }
+    else if (header->m_pixelFormat.m_fourCC == DDS_FOURCC('D', 'X', 'T', '5'))
+    {
+        fileFormat = TextureCompression::BC3;
+    }
+    else if (header->m_pixelFormat.m_fourCC == DDS_FOURCC('D', 'X', '1', '0') && format == TextureCompression::BC7)
+    {
+        const DdsHeaderDX10* dx10 = reinterpret_cast<const DdsHeaderDX10*>(header + 1);
+        if (dx10->m_dxgiFormat == DDS_DXGI_FORMAT_BC7_UNORM)
+            fileFormat = TextureCompression::BC7;
+    }
+
+    // The header itself has to agree with the format asked for.
+    if (fileFormat != format || header->m_width == 0 || header->m_height == 0 || header->m_mipMapCount == 0 ||
+        header->m_mipMapCount > MipmapGenerator::GetLevelCount(header->m_width, header->m_height))
+    {
+        return false;
+    }
+
+    // The file has to be exactly the size the header says.
+    size_t size = 0;
+    for (unsigned int i = 0; i < header->m_mipMapCount; i++)
+    {
+        size += GetLevelSize(format, MipmapGenerator::GetLevelWidth(header->m_width, i), MipmapGenerator::GetLevelWidth(header->m_height, i));
+    }
+    if (file.GetSize() != headerSize + size)
+    {
+        return false;
+    }
+
+    image.m_format = format;
+    image.m_width = header->m_width;
+    image.m_height = header->m_height;
+    image.m_levelCount = header->m_mipMapCount;
+    image.m_data.assign(file.GetData() + headerSize, file.GetData() + headerSize + size);
+    return true;
+}
+
+bool TextureCompressor::Cook(const char* sourcePath, TextureCompression format, MipmapFilter filter, JobSystem* jobs)
+{
+    // Load the file, and convert it to 32 bits the same way Texture and TextureLoader do.
+    FIBITMAP* bitmap = FreeImage_Load(FreeImage_GetFileType(sourcePath), sourcePath);
+    if (bitmap == nullptr)
+    {
+        std::cout << "Can't cook texture: " << sourcePath << std::endl;
+        return false;
+    }
+
+    unsigned int width = FreeImage_GetWidth(bitmap);
+    unsigned int height = FreeImage_GetHeight(bitmap);
+    std::vector<unsigned char> pixels;
+    bool converted = PixelConvert::Convert(bitmap, pixels);
+    FreeImage_Unload(bitmap);
+    if (!converted)
+    {
+        std::cout << "Can't convert texture: " << sourcePath << std::endl;
+        return false;
+    }
+
+    CompressedImage image;
+    Compress(format, filter, pixels.data(), width, height, image, jobs);
+
+    return SaveCache(sourcePath, filter, image);
+}
@@ -0,0 +1,96 @@
+/*
+Title: Object Loading
+File Name: textureCompressor.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+#include "mipmapGenerator.h"
+#include "jobSystem.h"
+#include <vector>
+#include <string>
+
+// Block compressed formats a texture can be cooked into.
+// Each 4x4 block of pixels is stored in a fixed number of bytes, and the gpu decodes it while sampling.
+enum class TextureCompression
+{
+    // Plain 32 bit pixels.
+    None,
+    // 8 bytes a block, colors only. Good for opaque textures.
+    BC1,
+    // 16 bytes a block, BC1 colors with a separate alpha block.
+    BC3,
+    // 16 bytes a block, much better color quality than BC1 for the same memory as BC3.
+    BC7
+};
+
+// A block compressed mip chain, with every level packed one after the other, level 0 first.
+// Rows of blocks are stored bottom row first, the same way opengl reads pixels.
+struct CompressedImage
+{
+    TextureCompression m_format = TextureCompression::None;
+    unsigned int m_width = 0;
+    unsigned int m_height = 0;
+    unsigned int m_levelCount = 0;
+    std::vector<unsigned char> m_data;
+};
+
+// Encodes 32 bit BGRA images into block compressed formats, and caches the result next to the source file.
+class TextureCompressor
+{
+private:
+    // Encodes or decodes a single 4x4 block of BGRA pixels.
+    static void EncodeBlock(TextureCompression format, const unsigned char* pixels, unsigned char* block);
+    static void DecodeBlock(TextureCompression format, const unsigned char* block, unsigned char* pixels);
+
+public:
+    // Bytes used by one 4x4 block.
+    static unsigned int GetBlockSize(TextureCompression format);
+    // Bytes used by a whole level.
+    static size_t GetLevelSize(TextureCompression format, unsigned int width, unsigned int height);
+    // The internal format to give glCompressedTexImage2D.
+    static GLenum GetGLFormat(TextureCompression format);
+    // True if the driver can sample the format.
+    static bool IsSupported(TextureCompression format);
+
+    // Encodes one level. With a job system, rows of blocks are split across its threads.
+    // Don't pass a job system from inside one of its own jobs.
+    static void Encode(TextureCompression format, const unsigned char* pixels, unsigned int width, unsigned int height,
+        unsigned char* output, JobSystem* jobs = nullptr);
+    // Decodes one level back to BGRA pixels.
+    static void Decode(TextureCompression format, const unsigned char* input, unsigned int width, unsigned int height, unsigned char* pixels);
+
+    // Builds a mip chain with the given filter, and encodes every level of it.
+    // Mipmaps can't be made on the gpu once the texture is compressed, so MipmapFilter::Gpu uses the box filter.
+    static void Compress(TextureCompression format, MipmapFilter filter, const unsigned char* pixels, unsigned int width, unsigned int height,
+        CompressedImage& image, JobSystem* jobs = nullptr);
+
+    // Peak signal to noise ratio between an image and its compressed level 0, in decibels. Higher is better.
+    // BC1 has no alpha, so it's only measured on color.
+    static double MeasurePSNR(const unsigned char* pixels, const CompressedImage& image);
+
+    // The cache lives next to the source, as "<source>.<format>.<filter>.dds", for example "brick.png.bc7.kaiser.dds".
+    // Each format and filter has its own file, so cooking one doesn't overwrite another.
+    static std::string GetCachePath(std::string sourcePath, TextureCompression format, MipmapFilter filter);
+    // Loads the cache if it was made from the current source file, with the same format and filter.
+    static bool LoadCache(std::string sourcePath, TextureCompression format, MipmapFilter filter, CompressedImage& image);
+    // Writes the cache for a source file.
+    static bool SaveCache(std::string sourcePath, MipmapFilter filter, const CompressedImage& image);
+
+    // The offline cooking step. Loads the source with FreeImage, compresses it, and writes the cache.
+    static bool Cook(const char* sourcePath, TextureCompression format, MipmapFilter filter, JobSystem* jobs = nullptr);
+};
@@ -0,0 +1,169 @@
+/*
+Title: Object Loading
+File Name: textureLoader.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureLoader.h"
+#include "pixelConvert.h"
+#include <fstream>
+#include <cstring>
+
+TextureLoader::TextureLoader(unsigned int threadCount, size_t frameUploadBudget) : m_jobs(threadCount), m_uploader(frameUploadBudget)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+    // Let the workers finish, then throw away whatever is left.
+    m_jobs.Wait();
+
+    for (size_t i = 0; i < m_decoded.size(); i++)
+    {
+        m_decoded[i]->m_texture->DecRefCount();
+        delete m_decoded[i];
+    }
+}
+
+void TextureLoader::Decode(DecodedImage* image)
+{
+    image->m_failed = true;
+
+    // A fresh cache can be uploaded as is.
+    if (image->m_compression != TextureCompression::None &&
+        TextureCompressor::LoadCache(image->m_filePath, image->m_compression, image->m_filter, image->m_compressed))
+    {
+        image->m_failed = false;
+        return;
+    }
+
+    // Read the whole file into memory first.
+    // Then FreeImage only decodes, and doesn't do any file io of its own.
+    std::ifstream file(image->m_filePath, std::ios::binary);
+    if (!file.good())
+        return;
+
+    file.seekg(0, std::ios::end);
+    std::vector<BYTE> data((size_t)file.tellg());
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    file.close();
+
+    if (data.empty())
+        return;
+
+    // Decode from memory, like the FIIO_Mem example.
+    FIMEMORY* memory = FreeImage_OpenMemory(data.data(), (DWORD)data.size());
+    FREE_IMAGE_FORMAT format = FreeImage_GetFileTypeFromMemory(memory, 0);
+    FIBITMAP* bitmap = format != FIF_UNKNOWN ? FreeImage_LoadFromMemory(format, memory, 0) : nullptr;
+    FreeImage_CloseMemory(memory);
+
+    if (bitmap == nullptr)
+        return;
+
+    // Convert straight into the pixels the uploader reads from, without a second FreeImage bitmap.
+    image->m_width = FreeImage_GetWidth(bitmap);
+    image->m_height = FreeImage_GetHeight(bitmap);
+    bool converted = PixelConvert::Convert(bitmap, image->m_pixels);
+    FreeImage_Unload(bitmap);
+
+    if (!converted)
+        return;
+
+    // Cook the cache, so the next run can skip all of this.
+    if (image->m_compression != TextureCompression::None)
+    {
+        TextureCompressor::Compress(image->m_compression, image->m_filter, image->m_pixels.data(), image->m_width, image->m_height, image->m_compressed);
+        TextureCompressor::SaveCache(image->m_filePath, image->m_filter, image->m_compressed);
+        image->m_pixels.clear();
+    }
+    // Build the mip chain here too, if it's made on the cpu.
+    else if (image->m_filter == MipmapFilter::Box || image->m_filter == MipmapFilter::Kaiser)
+    {
+        std::vector<unsigned char> chain;
+        image->m_levelCount = MipmapGenerator::BuildChain(image->m_filter, image->m_pixels.data(), image->m_width, image->m_height, chain);
+        image->m_pixels.swap(chain);
+    }
+
+    image->m_failed = false;
+}
+
+Texture* TextureLoader::Load(const char* filePath, MipmapFilter filter, TextureCompression compression)
+{
+    // Hand out the placeholder right away.
+    // The loader keeps a reference, so the texture can't be deleted before its upload.
+    Texture* texture = new Texture();
+    texture->IncRefCount();
+
+    DecodedImage* image = new DecodedImage();
+    image->m_texture = texture;
+    image->m_filePath = filePath;
+    image->m_filter = filter;
+    image->m_levelCount = 1;
+
+    // Fall back to plain pixels if the driver can't sample the format.
+    image->m_compression = TextureCompressor::IsSupported(compression) ? compression : TextureCompression::None;
+    m_pending++;
+
+    m_jobs.Submit([this, image]()
+    {
+        Decode(image);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_decoded.push_back(image);
+    });
+
+    return texture;
+}
+
+unsigned int TextureLoader::Update(unsigned int maxUploads)
+{
+    // Take the finished images, holding the lock as short as possible.
+    std::vector<DecodedImage*> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        unsigned int count = m_decoded.size() < maxUploads ? (unsigned int)m_decoded.size() : maxUploads;
+        ready.assign(m_decoded.begin(), m_decoded.begin() + count);
+        m_decoded.erase(m_decoded.begin(), m_decoded.begin() + count);
+    }
+
+    for (size_t i = 0; i < ready.size(); i++)
+    {
+        DecodedImage* image = ready[i];
+
+        if (image->m_failed)
+            std::cout << "Can't load texture: " << image->m_filePath << std::endl;
+        else if (image->m_compressed.m_levelCount > 0)
+            m_uploader.Queue(image->m_texture, image->m_compressed);
+        else
+            m_uploader.Queue(image->m_texture, image->m_pixels, image->m_width, image->m_height, image->m_levelCount, image->m_filter);
+
+        // Drop the loader's reference. The uploader holds its own until the upload is done.
+        // If nothing else uses the texture anymore, it's deleted here.
+        image->m_texture->DecRefCount();
+        delete image;
+        m_pending--;
+    }
+
+    m_uploader.Update();
+
+    return (unsigned int)ready.size();
+}
+
+unsigned int TextureLoader::GetPendingCount()
+{
+    return m_pending + m_uploader.GetPendingCount();
+}
@@ -0,0 +1,84 @@
+/*
+Title: Object Loading
+File Name: textureLoader.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "texture.h"
+#include "jobSystem.h"
+#include "textureUploader.h"
+#include <vector>
+#include <string>
+#include <mutex>
+
+// Loads textures in the background.
+// Files are read and decoded by worker threads, then streamed to the gpu on the main thread by Update.
+// Until then, the texture is a 1x1 placeholder, so it can be used right away.
+class TextureLoader
+{
+private:
+    // An image decoded by a worker, waiting to be uploaded.
+    struct DecodedImage
+    {
+        Texture* m_texture;
+        std::string m_filePath;
+        unsigned int m_width;
+        unsigned int m_height;
+        MipmapFilter m_filter;
+        // 32 bit BGRA pixels, bottom row first like opengl expects.
+        // With a cpu mipmap filter, this holds the whole mip chain.
+        std::vector<unsigned char> m_pixels;
+        unsigned int m_levelCount;
+        // With compression, the blocks end up here instead of in m_pixels.
+        TextureCompression m_compression;
+        CompressedImage m_compressed;
+        bool m_failed;
+    };
+
+    JobSystem m_jobs;
+    TextureUploader m_uploader;
+
+    // Images finished by the workers. Guarded by m_mutex.
+    std::mutex m_mutex;
+    std::vector<DecodedImage*> m_decoded;
+
+    // Loads that haven't been uploaded yet. Only used on the main thread.
+    unsigned int m_pending = 0;
+
+    // Reads and decodes a file. Runs on a worker thread.
+    static void Decode(DecodedImage* image);
+
+public:
+    // Starts the worker threads. 0 starts one per core.
+    // frameUploadBudget is the most bytes of texture data sent to the gpu in one Update.
+    TextureLoader(unsigned int threadCount = 0, size_t frameUploadBudget = 8 * 1024 * 1024);
+    // Waits for the workers, and drops anything that wasn't uploaded.
+    // Must be deleted while the opengl context still exists.
+    ~TextureLoader();
+
+    // Starts loading a file and returns its texture, which is a placeholder until the image is uploaded.
+    // Cpu mipmap filters run on the worker too, so they don't stall the main thread.
+    // With compression, a fresh cache skips decoding entirely. Otherwise the worker cooks the cache first.
+    Texture* Load(const char* filePath, MipmapFilter filter = MipmapFilter::Gpu, TextureCompression compression = TextureCompression::None);
+
+    // Queues up to maxUploads decoded images for upload, then streams as much as the budget allows.
+    // Call it once a frame on the main thread. Returns the number of images queued.
+    unsigned int Update(unsigned int maxUploads = 0xFFFFFFFF);
+
+    // Number of loads that haven't finished uploading yet.
+    unsigned int GetPendingCount();
+};
@@ -0,0 +1,144 @@
+/*
+Title: Object Loading
+File Name: textureTable.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureTable.h"
+#include "glState.h"
+
+TextureTable::TextureTable(unsigned int width, unsigned int height, unsigned int capacity, bool allowBindless)
+{
+    if (allowBindless && Texture::IsBindlessSupported() && (GLEW_VERSION_4_3 || GLEW_ARB_shader_storage_buffer_object))
+    {
+        glGenBuffers(1, &m_handleBuffer);
+    }
+    else
+    {
+        m_array = new TextureArray(width, height, capacity);
+        m_array->IncRefCount();
+    }
+}
+
+TextureTable::~TextureTable()
+{
+    if (m_array != nullptr)
+        m_array->DecRefCount();
+
+    for (size_t i = 0; i < m_textures.size(); i++)
+    {
+        m_textures[i]->DecRefCount();
+    }
+
+    if (m_handleBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_handleBuffer);
+        GLState::ForgetBuffer(m_handleBuffer);
+    }
+}
+
+int TextureTable::Add(const char* filePath)
+{
+    if (m_array != nullptr)
+    {
+        // Copy the file into the next free layer.
+        if (m_count >= m_array->GetLayerCount() || !m_array->LoadLayer(m_count, filePath))
+            return -1;
+    }
+    else
+    {
+        Texture* texture = new Texture(const_cast<char*>(filePath));
+        texture->IncRefCount();
+        m_textures.push_back(texture);
+        m_handles.push_back(0);
+    }
+
+    m_dirty = true;
+    return (int)m_count++;
+}
+
+void TextureTable::Bind(GLuint unit)
+{
+    if (m_array != nullptr)
+    {
+        // Layers were added since the last bind, so their mipmaps need making.
+        if (m_dirty)
+        {
+            m_array->GenerateMipmaps();
+            m_dirty = false;
+        }
+
+        GLState::BindTexture(unit, GL_TEXTURE_2D_ARRAY, m_array->GetGLTexture());
+        return;
+    }
+
+    // Handles change when a texture gets new storage, so check them all.
+    for (size_t i = 0; i < m_textures.size(); i++)
+    {
+        GLuint64 handle = m_textures[i]->GetBindlessHandle();
+        if (handle != m_handles[i])
+        {
+            m_handles[i] = handle;
+            m_dirty = true;
+        }
+    }
+
+    // Shader storage isn't tracked by GLState, so bind it straight to the indexed binding.
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TEXTURE_TABLE_BINDING, m_handleBuffer);
+    if (m_dirty)
+    {
+        size_t size = m_handles.size() * sizeof(GLuint64);
+        if (size > m_handleBufferSize)
+        {
+            m_handleBufferSize = size;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, size, m_handles.data(), GL_DYNAMIC_DRAW);
+        }
+        else
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, m_handles.data());
+        }
+        m_dirty = false;
+    }
+}
+
+bool TextureTable::IsBindless()
+{
+    return m_array == nullptr;
+}
+
+unsigned int TextureTable::GetCount()
+{
+    return m_count;
+}
+
+GLuint TextureTable::GetKey()
+{
+    return m_array != nullptr ? m_array->GetGLTexture() : m_handleBuffer;
+}
+
+void TextureTable::IncRefCount()
+{
+    m_refCount++;
+}
+
+void TextureTable::DecRefCount()
+{
+    m_refCount--;
+    if (m_refCount == 0)
+    {
+        delete this;
+    }
+}
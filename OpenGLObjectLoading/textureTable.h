@@ -0,0 +1,68 @@
+/*
+Title: Object Loading
+File Name: textureTable.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "texture.h"
+#include "textureArray.h"
+#include <vector>
+
+// Shader storage binding the bindless handle table is bound to (see fragmentBindless.glsl).
+#define TEXTURE_TABLE_BINDING 0
+
+// A set of textures that a shader picks from by index, so draws with different textures can be merged.
+// With ARB_bindless_texture, each texture keeps its own texture object, and the shader reads its handle from a buffer.
+// Without it, every texture is copied into a layer of one texture array, so they all have to be the same size.
+// Use fragmentBindless.glsl or fragmentTextureArray.glsl to match IsBindless.
+class TextureTable
+{
+private:
+    unsigned int m_refCount = 0;
+    unsigned int m_count = 0;
+    bool m_dirty = false;
+
+    // Texture array mode.
+    TextureArray* m_array = nullptr;
+
+    // Bindless mode. The handles are kept so the buffer is only rewritten when one changes.
+    std::vector<Texture*> m_textures;
+    std::vector<GLuint64> m_handles;
+    GLuint m_handleBuffer = 0;
+    size_t m_handleBufferSize = 0;
+
+public:
+    // In texture array mode, every texture has to be width x height, and there's room for capacity of them.
+    // allowBindless picks bindless mode whenever the driver supports it.
+    TextureTable(unsigned int width, unsigned int height, unsigned int capacity, bool allowBindless = true);
+    ~TextureTable();
+
+    // Loads a file into the table, and returns its index, or -1 if it can't be added.
+    int Add(const char* filePath);
+
+    // Binds the table for drawing. A texture array goes to the given unit,
+    // and a handle buffer goes to shader storage binding TEXTURE_TABLE_BINDING.
+    void Bind(GLuint unit);
+
+    bool IsBindless();
+    unsigned int GetCount();
+    // The same for tables that bind the same objects, for sorting draws.
+    GLuint GetKey();
+
+    void IncRefCount();
+    void DecRefCount();
+};
@@ -0,0 +1,238 @@
+/*
+Title: Object Loading
+File Name: textureUploader.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textureUploader.h"
+#include "glState.h"
+#include <cstring>
+
+TextureUploader::TextureUploader(size_t frameBudget, unsigned int slotCount, size_t slotSize) : m_frameBudget(frameBudget)
+{
+    m_slots.resize(slotCount);
+    for (unsigned int i = 0; i < slotCount; i++)
+    {
+        glGenBuffers(1, &m_slots[i].m_buffer);
+        m_slots[i].m_size = slotSize;
+        m_slots[i].m_fence = nullptr;
+
+        // GL_STREAM_DRAW, since each buffer is written once by us, and read once by the gpu.
+        GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_slots[i].m_buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, slotSize, NULL, GL_STREAM_DRAW);
+    }
+
+    // A bound unpack buffer changes where every glTexImage call reads from, so never leave one bound.
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureUploader::~TextureUploader()
+{
+    for (size_t i = 0; i < m_uploads.size(); i++)
+    {
+        glDeleteTextures(1, &m_uploads[i]->m_staging);
+        GLState::ForgetTexture(m_uploads[i]->m_staging);
+        m_uploads[i]->m_texture->DecRefCount();
+        delete m_uploads[i];
+    }
+
+    for (size_t i = 0; i < m_slots.size(); i++)
+    {
+        if (m_slots[i].m_fence)
+            glDeleteSync(m_slots[i].m_fence);
+
+        glDeleteBuffers(1, &m_slots[i].m_buffer);
+        GLState::ForgetBuffer(m_slots[i].m_buffer);
+    }
+}
+
+void TextureUploader::Queue(Texture* texture, std::vector<unsigned char>& pixels, unsigned int width, unsigned int height,
+    unsigned int levelCount, MipmapFilter filter)
+{
+    bool generateMipmaps = filter == MipmapFilter::Gpu;
+    unsigned int storageLevels = generateMipmaps ? MipmapGenerator::GetLevelCount(width, height) : levelCount;
+
+    // Keep the texture alive until its upload is done.
+    texture->IncRefCount();
+
+    Upload* upload = new Upload();
+    upload->m_texture = texture;
+    upload->m_staging = Texture::CreateStagingStorage(width, height, storageLevels, TextureCompression::None);
+    upload->m_storageLevelCount = storageLevels;
+    upload->m_data.swap(pixels);
+    upload->m_compression = TextureCompression::None;
+    upload->m_width = width;
+    upload->m_height = height;
+    upload->m_levelCount = generateMipmaps ? 1 : levelCount;
+    upload->m_generateMipmaps = generateMipmaps && storageLevels > 1;
+    upload->m_level = 0;
+    upload->m_row = 0;
+    upload->m_offset = 0;
+
+    m_pendingBytes += upload->m_data.size();
+    m_uploads.push_back(upload);
+}
+
+void TextureUploader::Queue(Texture* texture, CompressedImage& image)
+{
+    texture->IncRefCount();
+
+    Upload* upload = new Upload();
+    upload->m_texture = texture;
+    upload->m_staging = Texture::CreateStagingStorage(image.m_width, image.m_height, image.m_levelCount, image.m_format);
+    upload->m_storageLevelCount = image.m_levelCount;
+    upload->m_data.swap(image.m_data);
+    upload->m_compression = image.m_format;
+    upload->m_width = image.m_width;
+    upload->m_height = image.m_height;
+    upload->m_levelCount = image.m_levelCount;
+    upload->m_generateMipmaps = false;
+    upload->m_level = 0;
+    upload->m_row = 0;
+    upload->m_offset = 0;
+
+    m_pendingBytes += upload->m_data.size();
+    m_uploads.push_back(upload);
+}
+
+size_t TextureUploader::UploadChunk(Upload* upload, size_t maxBytes)
+{
+    Slot& slot = m_slots[m_nextSlot];
+
+    // If the gpu hasn't finished reading this buffer yet, come back next frame instead of waiting.
+    if (slot.m_fence)
+    {
+        GLenum result = glClientWaitSync(slot.m_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED || result == GL_WAIT_FAILED)
+            return 0;
+
+        glDeleteSync(slot.m_fence);
+        slot.m_fence = nullptr;
+    }
+
+    // Work out how many rows of the current level fit in the chunk.
+    unsigned int levelWidth = MipmapGenerator::GetLevelWidth(upload->m_width, upload->m_level);
+    unsigned int levelHeight = MipmapGenerator::GetLevelWidth(upload->m_height, upload->m_level);
+    bool compressed = upload->m_compression != TextureCompression::None;
+    unsigned int rowHeight = compressed ? 4 : 1;
+    unsigned int rowCount = (levelHeight + rowHeight - 1) / rowHeight;
+    size_t rowSize = compressed ? TextureCompressor::GetLevelSize(upload->m_compression, levelWidth, 1) : (size_t)levelWidth * 4;
+
+    size_t limit = maxBytes < slot.m_size ? maxBytes : slot.m_size;
+    unsigned int rows = (unsigned int)(limit / rowSize);
+    if (rows == 0)
+        rows = 1;
+    if (rows > rowCount - upload->m_row)
+        rows = rowCount - upload->m_row;
+    size_t size = rows * rowSize;
+
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.m_buffer);
+
+    // A single row that doesn't fit gets a bigger buffer.
+    if (size > slot.m_size)
+    {
+        slot.m_size = size;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    }
+
+    // The fence says the gpu is done with the old contents, so the driver doesn't need to sync here.
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped == nullptr)
+        return 0;
+    memcpy(mapped, upload->m_data.data() + upload->m_offset, size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // With an unpack buffer bound, the data pointer is an offset into the buffer.
+    unsigned int y = upload->m_row * rowHeight;
+    unsigned int height = rows * rowHeight < levelHeight - y ? rows * rowHeight : levelHeight - y;
+    GLState::BindTexture(0, GL_TEXTURE_2D, upload->m_staging);
+    if (compressed)
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, upload->m_level, 0, y, levelWidth, height,
+            TextureCompressor::GetGLFormat(upload->m_compression), (GLsizei)size, NULL);
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, upload->m_level, 0, y, levelWidth, height, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    slot.m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+
+    // Move on, to the next level if this one is done.
+    upload->m_offset += size;
+    upload->m_row += rows;
+    if (upload->m_row == rowCount)
+    {
+        upload->m_row = 0;
+        upload->m_level++;
+    }
+
+    return size;
+}
+
+size_t TextureUploader::Update()
+{
+    size_t uploaded = 0;
+
+    while (!m_uploads.empty())
+    {
+        // Always make some progress, even if a single row is bigger than the budget.
+        size_t remaining = uploaded < m_frameBudget ? m_frameBudget - uploaded : 0;
+        if (remaining == 0 && uploaded > 0)
+            break;
+
+        Upload* upload = m_uploads.front();
+        size_t size = UploadChunk(upload, remaining);
+        if (size == 0)
+            break;
+
+        uploaded += size;
+        m_pendingBytes -= size;
+
+        if (upload->m_level == upload->m_levelCount)
+        {
+            // The texture is complete. The rest of the levels can be made now.
+            if (upload->m_generateMipmaps)
+            {
+                GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                GLState::BindTexture(0, GL_TEXTURE_2D, upload->m_staging);
+                glGenerateMipmap(GL_TEXTURE_2D);
+            }
+
+            // Every level is defined now, so the texture can start sampling it.
+            upload->m_texture->AdoptStorage(upload->m_staging, upload->m_width, upload->m_height, upload->m_storageLevelCount, upload->m_compression);
+            upload->m_texture->DecRefCount();
+            delete upload;
+            m_uploads.pop_front();
+        }
+    }
+
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+
+    return uploaded;
+}
+
+unsigned int TextureUploader::GetPendingCount()
+{
+    return (unsigned int)m_uploads.size();
+}
+
+size_t TextureUploader::GetPendingBytes()
+{
+    return m_pendingBytes;
+}
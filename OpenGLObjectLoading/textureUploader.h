@@ -0,0 +1,100 @@
+/*
+Title: Object Loading
+File Name: textureUploader.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "texture.h"
+#include <vector>
+#include <deque>
+
+// Streams texture data to the gpu through a ring of pixel unpack buffers.
+// Data is copied into a buffer, and glTexSubImage2D reads from the buffer instead of our memory,
+// so the driver can return right away and finish the copy in the background.
+// A fence per buffer tells us when the gpu is done with it, so it can be filled again.
+// Each upload goes into a staging texture object, which replaces the texture's own once every level is in,
+// so the texture keeps its old contents, like the loader's placeholder, until then.
+class TextureUploader
+{
+private:
+    // One texture waiting to be uploaded, and how far along it is.
+    struct Upload
+    {
+        Texture* m_texture;
+        // Texture object the levels are written to, handed to m_texture when they are done.
+        GLuint m_staging;
+        unsigned int m_storageLevelCount;
+        // Every level to upload, packed one after the other.
+        std::vector<unsigned char> m_data;
+        TextureCompression m_compression;
+        unsigned int m_width;
+        unsigned int m_height;
+        unsigned int m_levelCount;
+        // Fill in the rest of the levels with glGenerateMipmap once level 0 is uploaded.
+        bool m_generateMipmaps;
+
+        // Progress: the level, the row within it, and the offset into m_data.
+        // For compressed textures, a row is a row of 4x4 blocks.
+        unsigned int m_level;
+        unsigned int m_row;
+        size_t m_offset;
+    };
+
+    // A buffer in the ring, and the fence of the last upload that read from it.
+    struct Slot
+    {
+        GLuint m_buffer;
+        size_t m_size;
+        GLsync m_fence;
+    };
+
+    std::deque<Upload*> m_uploads;
+    std::vector<Slot> m_slots;
+    unsigned int m_nextSlot = 0;
+
+    size_t m_frameBudget;
+    size_t m_pendingBytes = 0;
+
+    // Copies the next chunk of an upload into a free buffer and starts the upload.
+    // Returns the number of bytes, or 0 if no buffer is free yet.
+    size_t UploadChunk(Upload* upload, size_t maxBytes);
+
+public:
+    // frameBudget is the most bytes to upload in one Update. Each Update makes at least one chunk of progress.
+    // Chunks are at most slotSize bytes, and up to slotCount of them can be in flight at once.
+    TextureUploader(size_t frameBudget = 8 * 1024 * 1024, unsigned int slotCount = 4, size_t slotSize = 4 * 1024 * 1024);
+    // Drops any uploads that haven't finished.
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    // Allocates the staging storage now, and queues the pixels.
+    // The vector is taken over by the uploader, and left empty.
+    // pixels holds levelCount levels of 32 bit BGRA. With MipmapFilter::Gpu, it only holds level 0.
+    void Queue(Texture* texture, std::vector<unsigned char>& pixels, unsigned int width, unsigned int height,
+        unsigned int levelCount, MipmapFilter filter);
+    // Same, for a block compressed image.
+    void Queue(Texture* texture, CompressedImage& image);
+
+    // Uploads as much as the budget allows. Call it once a frame on the main thread.
+    // Returns the number of bytes uploaded.
+    size_t Update();
+
+    unsigned int GetPendingCount();
+    size_t GetPendingBytes();
+};
@@ -28,8 +28,11 @@ Transform3D::Transform3D()
 {
     m_scale = 1;
     m_rotation = glm::vec3();
+    m_orientation = glm::quat(1, 0, 0, 0);
     m_position = glm::vec3();
     m_matrix = m_inverseMatrix = glm::mat4();
+    m_orientationDirty = m_rotationDirty = false;
+    m_matrixDirty = m_inverseDirty = false;
 }
 
 float Transform3D::Scale()
@@ -39,9 +42,43 @@ float Transform3D::Scale()
 
 glm::vec3 Transform3D::Rotation()
 {
+    // If the rotation was last set as a quaternion, work the angles back out of it.
+    // These come from the entries of the rotation matrix R = Ry(-yaw) * Rx(pitch) * Rz(roll).
+    if (m_rotationDirty)
+    {
+        const glm::quat& q = m_orientation;
+
+        // The cosine of the pitch comes from the roll entries, which keeps it accurate close to straight up or down.
+        float sinPitch = 2 * (q.w * q.x - q.y * q.z);
+        float sinRollCosPitch = 2 * (q.x * q.y + q.w * q.z);
+        float cosRollCosPitch = 1 - 2 * (q.x * q.x + q.z * q.z);
+        float cosPitch = sqrt(sinRollCosPitch * sinRollCosPitch + cosRollCosPitch * cosRollCosPitch);
+        m_rotation.x = atan2(sinPitch, cosPitch);
+
+        if (cosPitch > 1e-3f)
+        {
+            m_rotation.y = atan2(-2 * (q.x * q.z + q.w * q.y), 1 - 2 * (q.x * q.x + q.y * q.y));
+            m_rotation.z = atan2(sinRollCosPitch, cosRollCosPitch);
+        }
+        else
+        {
+            // Looking straight up or down, yaw and roll turn around the same axis, so it all goes into yaw.
+            m_rotation.y = atan2(2 * (q.x * q.z - q.w * q.y), 1 - 2 * (q.y * q.y + q.z * q.z));
+            m_rotation.z = 0;
+        }
+
+        m_rotationDirty = false;
+    }
+
     return m_rotation;
 }
 
+glm::quat Transform3D::Orientation()
+{
+    UpdateOrientation();
+    return m_orientation;
+}
+
 glm::vec3 Transform3D::Position()
 {
     return m_position;
@@ -56,7 +93,13 @@ void Transform3D::SetScale(float s)
 void Transform3D::SetRotation(glm::vec3 r)
 {
     m_rotation = r;
-    m_matrixDirty = m_inverseDirty = true;
+    m_rotationDirty = false;
+    m_orientationDirty = m_matrixDirty = m_inverseDirty = true;
+}
+
+void Transform3D::SetOrientation(glm::quat q)
+{
+    ChangeOrientation(q);
 }
 
 void Transform3D::SetPosition(glm::vec3 v)
@@ -67,20 +110,39 @@ void Transform3D::SetPosition(glm::vec3 v)
 
 void Transform3D::RotateX(float r)
 {
-    m_rotation.x += r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotation(Rotation() + glm::vec3(r, 0, 0));
 }
 
 void Transform3D::RotateY(float r)
 {
-    m_rotation.y += r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotation(Rotation() + glm::vec3(0, r, 0));
 }
 
 void Transform3D::RotateZ(float r)
 {
-    m_rotation.z += r;
-    m_matrixDirty = m_inverseDirty = true;
+    SetRotation(Rotation() + glm::vec3(0, 0, r));
+}
+
+void Transform3D::Rotate(glm::quat q)
+{
+    UpdateOrientation();
+    ChangeOrientation(q * m_orientation);
+}
+
+void Transform3D::Rotate(glm::vec3 axis, float angle)
+{
+    Rotate(glm::angleAxis(angle, glm::normalize(axis)));
+}
+
+void Transform3D::RotateLocal(glm::quat q)
+{
+    UpdateOrientation();
+    ChangeOrientation(m_orientation * q);
+}
+
+void Transform3D::RotateLocal(glm::vec3 axis, float angle)
+{
+    RotateLocal(glm::angleAxis(angle, glm::normalize(axis)));
 }
 
 
@@ -90,57 +152,58 @@ void Transform3D::Translate(glm::vec3 v)
     m_matrixDirty = m_inverseDirty = true;
 }
 
+void Transform3D::UpdateOrientation()
+{
+    if (!m_orientationDirty)
+        return;
+
+    // One rotation per axis, from the sine and cosine of the half angles.
+    // roll, then pitch, then yaw (multiply in reverse order)
+    glm::vec3 half = m_rotation * 0.5f;
+    glm::quat rx = glm::quat(cos(half.x), sin(half.x), 0, 0);
+    glm::quat ry = glm::quat(cos(half.y), 0, -sin(half.y), 0);
+    glm::quat rz = glm::quat(cos(half.z), 0, 0, sin(half.z));
+    m_orientation = ry * rx * rz;
+
+    m_orientationDirty = false;
+}
+
+void Transform3D::ChangeOrientation(const glm::quat& q)
+{
+    // Renormalize, so rounding errors from many small rotations don't build up into a scale.
+    m_orientation = glm::normalize(q);
+    m_orientationDirty = false;
+    m_rotationDirty = m_matrixDirty = m_inverseDirty = true;
+}
+
+// Rotation matrix of a unit quaternion, in the upper 3x3 of a mat4.
+static glm::mat4 QuaternionMatrix(const glm::quat& q)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    return glm::mat4(
+        1 - 2 * (yy + zz), 2 * (xy + wz), 2 * (xz - wy), 0,
+        2 * (xy - wz), 1 - 2 * (xx + zz), 2 * (yz + wx), 0,
+        2 * (xz + wy), 2 * (yz - wx), 1 - 2 * (xx + yy), 0,
+        0, 0, 0, 1
+        );
+}
+
 glm::mat4 Transform3D::GetMatrix()
 {
     // If anything has changed, recalculate the matrix
     if (m_matrixDirty) {
-        // scale
-        glm::mat4 s = glm::mat4(
-            m_scale, 0, 0, 0,
-            0, m_scale, 0, 0,
-            0, 0, m_scale, 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the x axis
-        glm::mat4 rx = glm::mat4(
-            1, 0, 0, 0,
-            0, cos(m_rotation.x), sin(m_rotation.x), 0,
-            0, -sin(m_rotation.x), cos(m_rotation.x), 0,
-            0, 0, 0, 1
-            );
-        
-        // rotation on the y axis
-        glm::mat4 ry = glm::mat4(
-            cos(m_rotation.y), 0, sin(m_rotation.y), 0,
-            0, 1, 0, 0,
-            -sin(m_rotation.y), 0, cos(m_rotation.y), 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the z axis
-        glm::mat4 rz = glm::mat4(
-            cos(m_rotation.z), sin(m_rotation.z), 0, 0,
-            -sin(m_rotation.z), cos(m_rotation.z), 0, 0,
-            0, 0, 1, 0,
-            0, 0, 0, 1
-            );
-
-        // translation
-        glm::mat4 t = glm::mat4(
-            1, 0, 0, 0,
-            0, 1, 0, 0,
-            0, 0, 1, 0,
-            m_position.x, m_position.y, m_position.z, 1
-            );
-
-        // compose rotation matrix
-        // roll, then yaw, then pitch
-        // (multiply in reverse order)
-        m_rotationMatrix = ry * rx * rz;
-
-        // calculate world matrix
-        m_matrix = t * m_rotationMatrix * s;
+        UpdateOrientation();
+
+        // The columns of the rotation, scaled, then the translation.
+        // Same as t * r * s, without multiplying whole matrices.
+        m_matrix = QuaternionMatrix(m_orientation);
+        m_matrix[0] *= m_scale;
+        m_matrix[1] *= m_scale;
+        m_matrix[2] *= m_scale;
+        m_matrix[3] = glm::vec4(m_position, 1);
 
         m_matrixDirty = false;
     }
@@ -153,54 +216,19 @@ glm::mat4 Transform3D::GetInverseMatrix()
 {
     // If anything has changed, recalculate the matrix
     if (m_inverseDirty) {
+        UpdateOrientation();
+
+        // The inverse of a rotation is its transpose, and the inverse scale just divides by scale.
+        // Same as s^-1 * r^T * t^-1.
+        glm::mat4 r = glm::transpose(QuaternionMatrix(m_orientation));
+        float inverseScale = 1.f / m_scale;
+        glm::vec3 position = glm::vec3(r * glm::vec4(m_position, 0));
 
-        // inverse scale just divides by scale
-        glm::mat4 s = glm::mat4(
-            1.f/m_scale, 0, 0, 0,
-            0, 1.f/m_scale, 0, 0,
-            0, 0, 1.f/m_scale, 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the x axis
-        glm::mat4 rx = glm::mat4(
-            1, 0, 0, 0,
-            0, cos(m_rotation.x), -sin(m_rotation.x), 0,
-            0, sin(m_rotation.x), cos(m_rotation.x), 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the y axis
-        glm::mat4 ry = glm::mat4(
-            cos(m_rotation.y), 0, -sin(m_rotation.y), 0,
-            0, 1, 0, 0,
-            sin(m_rotation.y), 0, cos(m_rotation.y), 0,
-            0, 0, 0, 1
-            );
-
-        // rotation on the z axis
-        glm::mat4 rz = glm::mat4(
-            cos(m_rotation.z), -sin(m_rotation.z), 0, 0,
-            sin(m_rotation.z), cos(m_rotation.z), 0, 0,
-            0, 0, 1, 0,
-            0, 0, 0, 1
-            );
-
-        // translation
-        glm::mat4 t = glm::mat4(
-            1, 0, 0, 0,
-            0, 1, 0, 0,
-            0, 0, 1, 0,
-            -m_position.x, -m_position.y, -m_position.z, 1
-            );
-
-        // compose rotation matrix
-        // pitch, then yaw, then roll
-        // (multiply in reverse order)
-        glm::mat4 r = rz * rx * ry;
-
-        // calculate world matrix inverse
-        m_inverseMatrix = s * r * t;
+        m_inverseMatrix = r;
+        m_inverseMatrix[0] *= inverseScale;
+        m_inverseMatrix[1] *= inverseScale;
+        m_inverseMatrix[2] *= inverseScale;
+        m_inverseMatrix[3] = glm::vec4(-position * inverseScale, 1);
 
         m_inverseDirty = false;
     }
@@ -209,41 +237,26 @@ glm::mat4 Transform3D::GetInverseMatrix()
     return m_inverseMatrix;
 }
 
+// The basis vectors are columns of the rotation matrix, read straight from the quaternion.
+
 glm::vec3 Transform3D::GetUp()
 {
-    // Force the transform to recalculate rotation if it's dirty
-    if (m_matrixDirty)
-    {
-        GetMatrix();
-    }
-    // Multiplying an up vector by rotation will give this transforms up vector
-    glm::vec4 up = m_rotationMatrix * glm::vec4(0, 1, 0, 1);
-
-    return glm::vec3(up);
+    UpdateOrientation();
+    const glm::quat& q = m_orientation;
+    return glm::vec3(2 * (q.x * q.y - q.w * q.z), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z + q.w * q.x));
 }
 
 glm::vec3 Transform3D::GetForward()
 {
-    // Force the transform to recalculate rotation if it's dirty
-    if (m_matrixDirty)
-    {
-        GetMatrix();
-    }
-
-    glm::vec4 forward = m_rotationMatrix * glm::vec4(0, 0, -1, 1);
-
-    return glm::vec3(forward);
+    // Forward is down the negative z axis
+    UpdateOrientation();
+    const glm::quat& q = m_orientation;
+    return -glm::vec3(2 * (q.x * q.z + q.w * q.y), 2 * (q.y * q.z - q.w * q.x), 1 - 2 * (q.x * q.x + q.y * q.y));
 }
 
 glm::vec3 Transform3D::GetRight()
 {
-    // Force the transform to recalculate rotation if it's dirty
-    if (m_matrixDirty)
-    {
-        GetMatrix();
-    }
-
-    glm::vec4 right = m_rotationMatrix * glm::vec4(1, 0, 0, 1);
-
-    return glm::vec3(right);
+    UpdateOrientation();
+    const glm::quat& q = m_orientation;
+    return glm::vec3(1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y + q.w * q.z), 2 * (q.x * q.z - q.w * q.y));
 }
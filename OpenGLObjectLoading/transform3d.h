@@ -24,22 +24,36 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #pragma once
 #include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
 
+// The rotation can be set either as euler angles or as a unit quaternion.
+// Internally it is always a quaternion, so the matrices and basis vectors are built without any trig.
+// Euler angles are applied roll (z), then pitch (x), then yaw (y), with positive yaw turning left.
 class Transform3D {
 
 private:
     float m_scale;
     glm::vec3 m_rotation;
+    glm::quat m_orientation;
     glm::vec3 m_position;
 
+    // m_orientation is only calculated from the euler angles if orientationDirty is true,
+    // and the euler angles from the quaternion if rotationDirty is true.
+    bool m_orientationDirty;
+    bool m_rotationDirty;
+
     // m_matrix is only calculated if matrixDirty is true.
     bool m_matrixDirty;
     bool m_inverseDirty;
 
-    glm::mat4 m_rotationMatrix;
     glm::mat4 m_matrix;
     glm::mat4 m_inverseMatrix;
 
+    // Brings the quaternion up to date with the euler angles.
+    void UpdateOrientation();
+    // Sets the quaternion, and marks everything built from it as dirty.
+    void ChangeOrientation(const glm::quat& q);
+
 public:
     Transform3D();
 
@@ -47,6 +61,8 @@ public:
     float Scale();
     // returns the rotation in radians
     glm::vec3 Rotation();
+    // returns the rotation as a unit quaternion
+    glm::quat Orientation();
     // returns the position as a vec2
     glm::vec3 Position();
 
@@ -54,6 +70,8 @@ public:
     void SetScale(float s);
     // sets the rotation (radians)
     void SetRotation(glm::vec3 r);
+    // sets the rotation from a quaternion
+    void SetOrientation(glm::quat q);
     // sets the position vector
     void SetPosition(glm::vec3 v);
 
@@ -62,6 +80,13 @@ public:
     void RotateY(float r);
     void RotateZ(float r);
 
+    // rotates around an axis in world space, after the current rotation
+    void Rotate(glm::quat q);
+    void Rotate(glm::vec3 axis, float angle);
+    // rotates around an axis of the transform itself, before the current rotation
+    void RotateLocal(glm::quat q);
+    void RotateLocal(glm::vec3 axis, float angle);
+
     // increments the position vector
     void Translate(glm::vec3 v);
 
@@ -0,0 +1,314 @@
+/*
+Title: Object Loading
+File Name: transformSystem.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transformSystem.h"
+#include <emmintrin.h>
+
+// Objects per SSE register.
+#define TRANSFORM_GROUP_SIZE 4
+// Groups handed to each job by Update.
+#define TRANSFORM_GROUPS_PER_JOB 256
+
+// Sine and cosine of 4 angles at once, with the Cephes single precision polynomials.
+// The angle is reduced to [-pi/4, pi/4] around the nearest multiple of pi/2, and the octant picks
+// which polynomial gives the sine and which the cosine, and their signs.
+static inline void SinCos(__m128 x, __m128& sine, __m128& cosine)
+{
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+    __m128 signSin = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+
+    // Octant, rounded up to even: j = (int(x * 4 / pi) + 1) & ~1
+    __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+    octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(octant);
+
+    __m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+    __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+    __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+    signSin = _mm_xor_ps(signSin, swapSignSin);
+
+    // x - y * pi / 4, with pi / 4 split in 3 parts to keep the precision.
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+    x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+
+    __m128 z = _mm_mul_ps(x, x);
+
+    // Cosine polynomial.
+    __m128 polyCos = _mm_set1_ps(2.443315711809948e-5f);
+    polyCos = _mm_add_ps(_mm_mul_ps(polyCos, z), _mm_set1_ps(-1.388731625493765e-3f));
+    polyCos = _mm_add_ps(_mm_mul_ps(polyCos, z), _mm_set1_ps(4.166664568298827e-2f));
+    polyCos = _mm_mul_ps(_mm_mul_ps(polyCos, z), z);
+    polyCos = _mm_add_ps(_mm_sub_ps(polyCos, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1));
+
+    // Sine polynomial.
+    __m128 polySin = _mm_set1_ps(-1.9515295891e-4f);
+    polySin = _mm_add_ps(_mm_mul_ps(polySin, z), _mm_set1_ps(8.3321608736e-3f));
+    polySin = _mm_add_ps(_mm_mul_ps(polySin, z), _mm_set1_ps(-1.6666654611e-1f));
+    polySin = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(polySin, z), x), x);
+
+    sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(polyMask, polySin), _mm_andnot_ps(polyMask, polyCos)), signSin);
+    cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(polyMask, polyCos), _mm_andnot_ps(polyMask, polySin)), signCos);
+}
+
+// Writes one column of 4 matrices. Each argument holds one row of that column, for all 4 objects.
+static inline void StoreColumn(glm::mat4* matrices, int column, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&matrices[0][column][0], x);
+    _mm_storeu_ps(&matrices[1][column][0], y);
+    _mm_storeu_ps(&matrices[2][column][0], z);
+    _mm_storeu_ps(&matrices[3][column][0], w);
+}
+
+TransformSystem::TransformSystem()
+{
+}
+
+void TransformSystem::Reserve(unsigned int count)
+{
+    unsigned int padded = (count + TRANSFORM_GROUP_SIZE - 1) / TRANSFORM_GROUP_SIZE * TRANSFORM_GROUP_SIZE;
+    m_positionX.reserve(padded);
+    m_positionY.reserve(padded);
+    m_positionZ.reserve(padded);
+    m_rotationX.reserve(padded);
+    m_rotationY.reserve(padded);
+    m_rotationZ.reserve(padded);
+    m_scale.reserve(padded);
+    m_matrices.reserve(padded);
+    m_inverseMatrices.reserve(padded);
+    m_dirtyGroups.reserve(padded / TRANSFORM_GROUP_SIZE);
+}
+
+unsigned int TransformSystem::Add(glm::vec3 position, glm::vec3 rotation, float scale)
+{
+    // Start a new group, filled with identity transforms, when the last one is full.
+    if (m_count % TRANSFORM_GROUP_SIZE == 0)
+    {
+        unsigned int padded = m_count + TRANSFORM_GROUP_SIZE;
+        m_positionX.resize(padded, 0);
+        m_positionY.resize(padded, 0);
+        m_positionZ.resize(padded, 0);
+        m_rotationX.resize(padded, 0);
+        m_rotationY.resize(padded, 0);
+        m_rotationZ.resize(padded, 0);
+        m_scale.resize(padded, 1);
+        m_matrices.resize(padded, glm::mat4());
+        m_inverseMatrices.resize(padded, glm::mat4());
+        m_dirtyGroups.push_back(0);
+    }
+
+    unsigned int index = m_count++;
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_positionZ[index] = position.z;
+    m_rotationX[index] = rotation.x;
+    m_rotationY[index] = rotation.y;
+    m_rotationZ[index] = rotation.z;
+    m_scale[index] = scale;
+    MarkDirty(index);
+    return index;
+}
+
+void TransformSystem::Clear()
+{
+    m_count = 0;
+    m_positionX.clear();
+    m_positionY.clear();
+    m_positionZ.clear();
+    m_rotationX.clear();
+    m_rotationY.clear();
+    m_rotationZ.clear();
+    m_scale.clear();
+    m_matrices.clear();
+    m_inverseMatrices.clear();
+    m_dirtyGroups.clear();
+    m_anyDirty = false;
+}
+
+void TransformSystem::MarkDirty(unsigned int index)
+{
+    m_dirtyGroups[index / TRANSFORM_GROUP_SIZE] = 1;
+    m_anyDirty = true;
+}
+
+float TransformSystem::GetScale(unsigned int index)
+{
+    return m_scale[index];
+}
+
+glm::vec3 TransformSystem::GetRotation(unsigned int index)
+{
+    return glm::vec3(m_rotationX[index], m_rotationY[index], m_rotationZ[index]);
+}
+
+glm::vec3 TransformSystem::GetPosition(unsigned int index)
+{
+    return glm::vec3(m_positionX[index], m_positionY[index], m_positionZ[index]);
+}
+
+void TransformSystem::SetScale(unsigned int index, float scale)
+{
+    m_scale[index] = scale;
+    MarkDirty(index);
+}
+
+void TransformSystem::SetRotation(unsigned int index, glm::vec3 rotation)
+{
+    m_rotationX[index] = rotation.x;
+    m_rotationY[index] = rotation.y;
+    m_rotationZ[index] = rotation.z;
+    MarkDirty(index);
+}
+
+void TransformSystem::SetPosition(unsigned int index, glm::vec3 position)
+{
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_positionZ[index] = position.z;
+    MarkDirty(index);
+}
+
+void TransformSystem::Rotate(unsigned int index, glm::vec3 rotation)
+{
+    m_rotationX[index] += rotation.x;
+    m_rotationY[index] += rotation.y;
+    m_rotationZ[index] += rotation.z;
+    MarkDirty(index);
+}
+
+void TransformSystem::Translate(unsigned int index, glm::vec3 offset)
+{
+    m_positionX[index] += offset.x;
+    m_positionY[index] += offset.y;
+    m_positionZ[index] += offset.z;
+    MarkDirty(index);
+}
+
+void TransformSystem::Update(JobSystem* jobs)
+{
+    if (!m_anyDirty)
+        return;
+
+    unsigned int groupCount = (unsigned int)m_dirtyGroups.size();
+    if (jobs != nullptr && groupCount > TRANSFORM_GROUPS_PER_JOB)
+    {
+        jobs->ParallelFor(groupCount, TRANSFORM_GROUPS_PER_JOB, [this](unsigned int begin, unsigned int end)
+        {
+            UpdateGroups(begin, end);
+        });
+    }
+    else
+    {
+        UpdateGroups(0, groupCount);
+    }
+
+    m_anyDirty = false;
+}
+
+void TransformSystem::UpdateGroups(unsigned int begin, unsigned int end)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1);
+
+    for (unsigned int group = begin; group < end; group++)
+    {
+        if (!m_dirtyGroups[group])
+            continue;
+        m_dirtyGroups[group] = 0;
+
+        unsigned int first = group * TRANSFORM_GROUP_SIZE;
+
+        __m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+        SinCos(_mm_loadu_ps(&m_rotationX[first]), sinX, cosX);
+        SinCos(_mm_loadu_ps(&m_rotationY[first]), sinY, cosY);
+        SinCos(_mm_loadu_ps(&m_rotationZ[first]), sinZ, cosZ);
+
+        // Ry * Rx * Rz multiplied out, with rows r0, r1, r2 (the same rotation Transform3D builds):
+        // r0 = [ cy cz - sy sx sz, -cy sz - sy sx cz, -sy cx ]
+        // r1 = [ cx sz,             cx cz,            -sx    ]
+        // r2 = [ sy cz + cy sx sz, -sy sz + cy sx cz,  cy cx ]
+        __m128 sinYsinX = _mm_mul_ps(sinY, sinX);
+        __m128 cosYsinX = _mm_mul_ps(cosY, sinX);
+
+        __m128 r00 = _mm_sub_ps(_mm_mul_ps(cosY, cosZ), _mm_mul_ps(sinYsinX, sinZ));
+        __m128 r01 = _mm_sub_ps(zero, _mm_add_ps(_mm_mul_ps(cosY, sinZ), _mm_mul_ps(sinYsinX, cosZ)));
+        __m128 r02 = _mm_sub_ps(zero, _mm_mul_ps(sinY, cosX));
+        __m128 r10 = _mm_mul_ps(cosX, sinZ);
+        __m128 r11 = _mm_mul_ps(cosX, cosZ);
+        __m128 r12 = _mm_sub_ps(zero, sinX);
+        __m128 r20 = _mm_add_ps(_mm_mul_ps(sinY, cosZ), _mm_mul_ps(cosYsinX, sinZ));
+        __m128 r21 = _mm_sub_ps(_mm_mul_ps(cosYsinX, cosZ), _mm_mul_ps(sinY, sinZ));
+        __m128 r22 = _mm_mul_ps(cosY, cosX);
+
+        __m128 scale = _mm_loadu_ps(&m_scale[first]);
+        __m128 inverseScale = _mm_div_ps(one, scale);
+        __m128 positionX = _mm_loadu_ps(&m_positionX[first]);
+        __m128 positionY = _mm_loadu_ps(&m_positionY[first]);
+        __m128 positionZ = _mm_loadu_ps(&m_positionZ[first]);
+
+        // World = T * R * S. Column j is column j of R times the scale, and the last column is the position.
+        glm::mat4* matrices = &m_matrices[first];
+        StoreColumn(matrices, 0, _mm_mul_ps(r00, scale), _mm_mul_ps(r10, scale), _mm_mul_ps(r20, scale), zero);
+        StoreColumn(matrices, 1, _mm_mul_ps(r01, scale), _mm_mul_ps(r11, scale), _mm_mul_ps(r21, scale), zero);
+        StoreColumn(matrices, 2, _mm_mul_ps(r02, scale), _mm_mul_ps(r12, scale), _mm_mul_ps(r22, scale), zero);
+        StoreColumn(matrices, 3, positionX, positionY, positionZ, one);
+
+        // Inverse = S^-1 * R^T * T^-1. Column j is row j of R over the scale,
+        // and the translation is -(R^T * position) / scale.
+        __m128 translationX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, positionX), _mm_mul_ps(r10, positionY)), _mm_mul_ps(r20, positionZ));
+        __m128 translationY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r01, positionX), _mm_mul_ps(r11, positionY)), _mm_mul_ps(r21, positionZ));
+        __m128 translationZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r02, positionX), _mm_mul_ps(r12, positionY)), _mm_mul_ps(r22, positionZ));
+        __m128 negativeInverseScale = _mm_sub_ps(zero, inverseScale);
+
+        glm::mat4* inverses = &m_inverseMatrices[first];
+        StoreColumn(inverses, 0, _mm_mul_ps(r00, inverseScale), _mm_mul_ps(r01, inverseScale), _mm_mul_ps(r02, inverseScale), zero);
+        StoreColumn(inverses, 1, _mm_mul_ps(r10, inverseScale), _mm_mul_ps(r11, inverseScale), _mm_mul_ps(r12, inverseScale), zero);
+        StoreColumn(inverses, 2, _mm_mul_ps(r20, inverseScale), _mm_mul_ps(r21, inverseScale), _mm_mul_ps(r22, inverseScale), zero);
+        StoreColumn(inverses, 3, _mm_mul_ps(translationX, negativeInverseScale), _mm_mul_ps(translationY, negativeInverseScale),
+            _mm_mul_ps(translationZ, negativeInverseScale), one);
+    }
+}
+
+const glm::mat4& TransformSystem::GetMatrix(unsigned int index)
+{
+    return m_matrices[index];
+}
+
+const glm::mat4& TransformSystem::GetInverseMatrix(unsigned int index)
+{
+    return m_inverseMatrices[index];
+}
+
+const glm::mat4* TransformSystem::GetMatrices()
+{
+    return m_matrices.data();
+}
+
+const glm::mat4* TransformSystem::GetInverseMatrices()
+{
+    return m_inverseMatrices.data();
+}
+
+unsigned int TransformSystem::GetCount()
+{
+    return m_count;
+}
@@ -0,0 +1,88 @@
+/*
+Title: Object Loading
+File Name: transformSystem.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "glm/gtc/matrix_transform.hpp"
+#include "jobSystem.h"
+#include <vector>
+
+// Positions, rotations and scales of many objects, and their world and inverse matrices.
+// Same conventions as Transform3D, but each component lives in its own array (structure of arrays),
+// so Update can build the matrices of 4 objects at once with SSE, straight from the closed form
+// of T * Ry * Rx * Rz * S instead of multiplying 4x4 matrices together.
+// Matrices are only rebuilt for groups of 4 that changed since the last Update.
+class TransformSystem
+{
+private:
+    unsigned int m_count = 0;
+
+    // One float per object, padded to a multiple of 4 with identity transforms.
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_rotationX;
+    std::vector<float> m_rotationY;
+    std::vector<float> m_rotationZ;
+    std::vector<float> m_scale;
+
+    std::vector<glm::mat4> m_matrices;
+    std::vector<glm::mat4> m_inverseMatrices;
+
+    // One flag per group of 4 objects that needs its matrices rebuilt.
+    std::vector<unsigned char> m_dirtyGroups;
+    bool m_anyDirty = false;
+
+    void MarkDirty(unsigned int index);
+    // Builds the matrices of groups [begin, end).
+    void UpdateGroups(unsigned int begin, unsigned int end);
+
+public:
+    TransformSystem();
+
+    // Adds an object and returns its index. Indices stay the same until Clear.
+    unsigned int Add(glm::vec3 position = glm::vec3(), glm::vec3 rotation = glm::vec3(), float scale = 1);
+    void Clear();
+    // Makes room for this many objects, so adding them doesn't reallocate.
+    void Reserve(unsigned int count);
+
+    float GetScale(unsigned int index);
+    // Rotation in radians.
+    glm::vec3 GetRotation(unsigned int index);
+    glm::vec3 GetPosition(unsigned int index);
+
+    void SetScale(unsigned int index, float scale);
+    void SetRotation(unsigned int index, glm::vec3 rotation);
+    void SetPosition(unsigned int index, glm::vec3 position);
+
+    // Increments the rotation (radians) or position.
+    void Rotate(unsigned int index, glm::vec3 rotation);
+    void Translate(unsigned int index, glm::vec3 offset);
+
+    // Rebuilds the matrices of every object that changed. With a job system, the groups are split across its threads.
+    void Update(JobSystem* jobs = nullptr);
+
+    // Matrices as of the last Update.
+    const glm::mat4& GetMatrix(unsigned int index);
+    const glm::mat4& GetInverseMatrix(unsigned int index);
+    // All the world matrices, in index order, ready for Mesh::DrawInstanced.
+    const glm::mat4* GetMatrices();
+    const glm::mat4* GetInverseMatrices();
+
+    unsigned int GetCount();
+};
@@ -0,0 +1,354 @@
+/*
+Title: Object Loading
+File Name: virtualTexture.cpp
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "virtualTexture.h"
+#include "glState.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+VirtualTexture::VirtualTexture(const char* filePath, unsigned int slotsX, unsigned int slotsY, unsigned int pageSize, unsigned int border,
+    unsigned int feedbackScale, unsigned int maxInFlight, unsigned int uploadsPerFrame)
+    : m_slotsX(slotsX), m_slotsY(slotsY), m_jobs(2), m_maxInFlight(maxInFlight), m_uploadsPerFrame(uploadsPerFrame), m_feedbackScale(feedbackScale)
+{
+    for (int i = 0; i < c_readbackCount; i++)
+    {
+        m_readbackBuffers[i] = 0;
+        m_readbackFences[i] = 0;
+        m_readbackSizes[i] = 0;
+    }
+
+    if (!m_pageFile.Open(filePath, pageSize, border))
+        return;
+
+    m_pageTable = new PageTable(m_pageFile.GetPageCount(), slotsX, slotsY);
+
+    // The cache has a single level. Pages bring their own borders, so bilinear filtering doesn't bleed between slots.
+    m_physicalTexture = new Texture();
+    m_physicalTexture->IncRefCount();
+    m_physicalTexture->AllocateStorage(slotsX * m_pageFile.GetPaddedPageSize(), slotsY * m_pageFile.GetPaddedPageSize(), 1, TextureCompression::None);
+
+    // One texel per page, with a level for every level of the virtual texture.
+    // The shader reads it with texelFetch, so it's never filtered.
+    m_pageTableTexture = new Texture();
+    m_pageTableTexture->IncRefCount();
+    m_pageTableTexture->AllocateStorage(m_pageFile.GetPageCount(), m_pageFile.GetPageCount(), m_pageFile.GetLevelCount(), TextureCompression::None);
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_pageTableTexture->GetGLTexture());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+
+    // Load the last level now. It covers the whole image, and is never evicted.
+    unsigned int lastLevel = m_pageFile.GetLevelCount() - 1;
+    unsigned int slot;
+    unsigned int evictedPage;
+    m_pageTable->Map(PageTable::MakePage(lastLevel, 0, 0), slot, evictedPage);
+    UploadPage(slot, m_pageFile.GetPage(lastLevel, 0, 0));
+    UploadPageTable();
+
+    glGenBuffers(c_readbackCount, m_readbackBuffers);
+}
+
+VirtualTexture::~VirtualTexture()
+{
+    m_jobs.Wait();
+    for (LoadedPage* page : m_loaded)
+    {
+        delete page;
+    }
+
+    for (int i = 0; i < c_readbackCount; i++)
+    {
+        if (m_readbackFences[i] != 0)
+            glDeleteSync(m_readbackFences[i]);
+        if (m_readbackBuffers[i] != 0)
+        {
+            glDeleteBuffers(1, &m_readbackBuffers[i]);
+            GLState::ForgetBuffer(m_readbackBuffers[i]);
+        }
+    }
+
+    if (m_feedbackFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &m_feedbackFramebuffer);
+        glDeleteTextures(1, &m_feedbackColor);
+        GLState::ForgetTexture(m_feedbackColor);
+        glDeleteRenderbuffers(1, &m_feedbackDepth);
+    }
+
+    if (m_physicalTexture != nullptr)
+        m_physicalTexture->DecRefCount();
+    if (m_pageTableTexture != nullptr)
+        m_pageTableTexture->DecRefCount();
+    delete m_pageTable;
+}
+
+bool VirtualTexture::IsValid()
+{
+    return m_pageTable != nullptr;
+}
+
+void VirtualTexture::ResizeFeedback(unsigned int width, unsigned int height)
+{
+    if (m_feedbackFramebuffer != 0 && width == m_feedbackWidth && height == m_feedbackHeight)
+        return;
+
+    if (m_feedbackFramebuffer == 0)
+    {
+        glGenFramebuffers(1, &m_feedbackFramebuffer);
+        glGenTextures(1, &m_feedbackColor);
+        glGenRenderbuffers(1, &m_feedbackDepth);
+    }
+
+    m_feedbackWidth = width;
+    m_feedbackHeight = height;
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_feedbackColor);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_feedbackColor, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_feedbackDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Virtual texture feedback framebuffer is incomplete." << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void VirtualTexture::BeginFeedback(unsigned int screenWidth, unsigned int screenHeight)
+{
+    if (!IsValid())
+        return;
+
+    unsigned int width = std::max(screenWidth / m_feedbackScale, 1u);
+    unsigned int height = std::max(screenHeight / m_feedbackScale, 1u);
+    ResizeFeedback(width, height);
+
+    glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, m_savedClearColor);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer);
+    glViewport(0, 0, width, height);
+
+    // Alpha 0 marks pixels that didn't draw anything with the virtual texture.
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::EndFeedback()
+{
+    if (!IsValid())
+        return;
+
+    // Copy the feedback into a free pixel buffer. If the gpu still hasn't finished the older ones, skip this frame.
+    unsigned int index = m_nextReadback;
+    if (m_readbackFences[index] == 0)
+    {
+        unsigned int size = m_feedbackWidth * m_feedbackHeight * 4;
+
+        GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[index]);
+        if (m_readbackSizes[index] != size)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            m_readbackSizes[index] = size;
+        }
+        glReadPixels(0, 0, m_feedbackWidth, m_feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        m_readbackFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_nextReadback = (index + 1) % c_readbackCount;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+    glClearColor(m_savedClearColor[0], m_savedClearColor[1], m_savedClearColor[2], m_savedClearColor[3]);
+}
+
+bool VirtualTexture::ReadFeedback()
+{
+    // The oldest readback is the one after the next one to be written.
+    for (int i = 0; i < c_readbackCount; i++)
+    {
+        unsigned int index = (m_nextReadback + i) % c_readbackCount;
+        if (m_readbackFences[index] == 0)
+            continue;
+
+        GLenum result = glClientWaitSync(m_readbackFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            return false;
+
+        glDeleteSync(m_readbackFences[index]);
+        m_readbackFences[index] = 0;
+
+        GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[index]);
+        const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_readbackSizes[index], GL_MAP_READ_BIT);
+        if (mapped != nullptr)
+        {
+            m_feedback.resize(m_readbackSizes[index] / 4);
+            memcpy(m_feedback.data(), mapped, m_readbackSizes[index]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return mapped != nullptr;
+    }
+
+    return false;
+}
+
+void VirtualTexture::Update()
+{
+    if (!IsValid())
+        return;
+
+    // Work out what's missing from the newest feedback that's ready, and start loading the most important pages.
+    if (ReadFeedback())
+    {
+        m_pageTable->AnalyzeFeedback(m_feedback.data(), m_feedback.size(), m_requests);
+
+        for (const PageRequest& request : m_requests)
+        {
+            if (m_inFlight >= m_maxInFlight)
+                break;
+
+            unsigned int page = request.m_page;
+            m_pageTable->SetLoading(page);
+            m_inFlight++;
+
+            m_jobs.Submit([this, page]()
+            {
+                // Touching the mapped file is what actually reads the disk, so do it here rather than on the main thread.
+                LoadedPage* loaded = new LoadedPage();
+                loaded->m_page = page;
+                const unsigned char* pixels = m_pageFile.GetPage(PageTable::GetPageLevel(page), PageTable::GetPageX(page), PageTable::GetPageY(page));
+                loaded->m_pixels.assign(pixels, pixels + m_pageFile.GetPageBytes());
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_loaded.push_back(loaded);
+            });
+        }
+    }
+
+    // Take the finished pages, coarse levels first, since finer pages fall back to them.
+    std::vector<LoadedPage*> uploads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::sort(m_loaded.begin(), m_loaded.end(), [](const LoadedPage* a, const LoadedPage* b)
+        {
+            return PageTable::GetPageLevel(a->m_page) > PageTable::GetPageLevel(b->m_page);
+        });
+
+        size_t count = std::min(m_loaded.size(), (size_t)m_uploadsPerFrame);
+        uploads.assign(m_loaded.begin(), m_loaded.begin() + count);
+        m_loaded.erase(m_loaded.begin(), m_loaded.begin() + count);
+    }
+
+    for (LoadedPage* loaded : uploads)
+    {
+        // If every slot is needed this frame, drop the page. The feedback will ask for it again.
+        unsigned int slot;
+        unsigned int evictedPage;
+        if (m_pageTable->Map(loaded->m_page, slot, evictedPage))
+            UploadPage(slot, loaded->m_pixels.data());
+        else
+            m_pageTable->CancelLoading(loaded->m_page);
+
+        m_inFlight--;
+        delete loaded;
+    }
+
+    UploadPageTable();
+}
+
+void VirtualTexture::UploadPage(unsigned int slot, const unsigned char* pixels)
+{
+    unsigned int size = m_pageFile.GetPaddedPageSize();
+
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_physicalTexture->GetGLTexture());
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % m_slotsX) * size, (slot / m_slotsX) * size, size, size, GL_BGRA, GL_UNSIGNED_BYTE, pixels);
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+void VirtualTexture::UploadPageTable()
+{
+    GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GLState::BindTexture(0, GL_TEXTURE_2D, m_pageTableTexture->GetGLTexture());
+
+    // Upload the changed rectangle of each level, reading its rows straight out of the full table.
+    for (unsigned int i = 0; i < m_pageTable->GetLevelCount(); i++)
+    {
+        unsigned int x, y, width, height;
+        if (!m_pageTable->GetDirtyRect(i, x, y, width, height))
+            continue;
+
+        unsigned int levelPages = m_pageTable->GetPageCount() >> i;
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, levelPages);
+        glTexSubImage2D(GL_TEXTURE_2D, i, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, m_pageTable->GetEntries(i) + y * levelPages + x);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    m_pageTable->ClearDirty();
+
+    GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+Texture* VirtualTexture::GetPhysicalTexture()
+{
+    return m_physicalTexture;
+}
+
+Texture* VirtualTexture::GetPageTableTexture()
+{
+    return m_pageTableTexture;
+}
+
+glm::vec4 VirtualTexture::GetPageTableParameters()
+{
+    float virtualSize = (float)(m_pageFile.GetPageCount() * m_pageFile.GetPageSize());
+    return glm::vec4((float)m_pageFile.GetPageCount(), (float)m_pageFile.GetLevelCount(),
+        m_pageFile.GetSourceWidth() / virtualSize, m_pageFile.GetSourceHeight() / virtualSize);
+}
+
+glm::vec4 VirtualTexture::GetPageParameters()
+{
+    return glm::vec4((float)m_pageFile.GetPageSize(), (float)m_pageFile.GetBorder(), 0, 0);
+}
+
+glm::vec4 VirtualTexture::GetFeedbackPageParameters()
+{
+    // Pixels of the feedback buffer cover m_feedbackScale screen pixels, so the uvs change that much faster across them.
+    return glm::vec4((float)m_pageFile.GetPageSize(), (float)m_pageFile.GetBorder(), -std::log2((float)m_feedbackScale), 0);
+}
+
+unsigned int VirtualTexture::GetResidentCount()
+{
+    return IsValid() ? m_pageTable->GetResidentCount() : 0;
+}
+
+unsigned int VirtualTexture::GetPendingCount()
+{
+    return m_inFlight;
+}
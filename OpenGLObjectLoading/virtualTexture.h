@@ -0,0 +1,131 @@
+/*
+Title: Object Loading
+File Name: virtualTexture.h
+Copyright ? 2019
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "GL/glew.h"
+#include "glm/glm.hpp"
+#include "texture.h"
+#include "pageFile.h"
+#include "pageTable.h"
+#include "jobSystem.h"
+#include <vector>
+#include <mutex>
+
+// Sparse virtual texturing, for images far bigger than the gpu memory we want to spend on them.
+// The image is cooked into pages (see PageFile), and only the pages the camera needs are kept
+// in a cache texture. A page table texture tells the shader where each page is.
+//
+// Every frame:
+//  - BeginFeedback, draw the scene with fragmentFeedback.glsl, then EndFeedback.
+//    This renders which page every pixel wants into a small buffer, and starts reading it back.
+//  - Update reads the feedback from an earlier frame, streams missing pages in on a worker thread,
+//    and uploads the finished ones to the cache, most important first.
+//  - Draw the scene with fragmentVirtual.glsl, using the textures and parameters from the getters.
+class VirtualTexture
+{
+private:
+    // A page copied out of the page file by a worker, waiting to be uploaded.
+    struct LoadedPage
+    {
+        unsigned int m_page;
+        std::vector<unsigned char> m_pixels;
+    };
+
+    PageFile m_pageFile;
+    PageTable* m_pageTable = nullptr;
+
+    // The cache of resident pages, and the page table with one level per level of the virtual texture.
+    Texture* m_physicalTexture = nullptr;
+    Texture* m_pageTableTexture = nullptr;
+    unsigned int m_slotsX;
+    unsigned int m_slotsY;
+
+    JobSystem m_jobs;
+    // Pages finished by the workers. Guarded by m_mutex.
+    std::mutex m_mutex;
+    std::vector<LoadedPage*> m_loaded;
+    // Pages submitted to the workers that haven't been uploaded or dropped yet.
+    unsigned int m_inFlight = 0;
+    unsigned int m_maxInFlight;
+    unsigned int m_uploadsPerFrame;
+
+    // Feedback is rendered at 1 / m_feedbackScale of the screen size.
+    unsigned int m_feedbackScale;
+    unsigned int m_feedbackWidth = 0;
+    unsigned int m_feedbackHeight = 0;
+    GLuint m_feedbackFramebuffer = 0;
+    GLuint m_feedbackColor = 0;
+    GLuint m_feedbackDepth = 0;
+
+    // Feedback is read back into pixel buffers, and only mapped once their fence says the copy is done,
+    // so the cpu never waits on the gpu.
+    static const int c_readbackCount = 2;
+    GLuint m_readbackBuffers[c_readbackCount];
+    GLsync m_readbackFences[c_readbackCount];
+    unsigned int m_readbackSizes[c_readbackCount];
+    unsigned int m_nextReadback = 0;
+
+    // State saved by BeginFeedback and put back by EndFeedback.
+    GLint m_savedViewport[4];
+    GLfloat m_savedClearColor[4];
+
+    std::vector<unsigned int> m_feedback;
+    std::vector<PageRequest> m_requests;
+
+    // Makes the feedback framebuffer the right size for the screen.
+    void ResizeFeedback(unsigned int width, unsigned int height);
+    // Reads the oldest finished readback, if there is one. Returns false if none were ready.
+    bool ReadFeedback();
+    // Copies a page into its cache slot.
+    void UploadPage(unsigned int slot, const unsigned char* pixels);
+    // Sends the changed parts of the page table to its texture.
+    void UploadPageTable();
+
+public:
+    // Opens (or cooks) the page file of an image, and allocates a cache of slotsX x slotsY pages.
+    // The last level is loaded right away, so there is always something to draw.
+    // maxInFlight limits the pages loading at once, and uploadsPerFrame the pages sent to the gpu in one Update.
+    VirtualTexture(const char* filePath, unsigned int slotsX = 16, unsigned int slotsY = 16, unsigned int pageSize = 128, unsigned int border = 4,
+        unsigned int feedbackScale = 8, unsigned int maxInFlight = 32, unsigned int uploadsPerFrame = 8);
+    // Must be deleted while the opengl context still exists.
+    ~VirtualTexture();
+
+    // False if the page file couldn't be opened or cooked. Nothing else works then.
+    bool IsValid();
+
+    // Binds and clears the feedback framebuffer, sized for a screen of this size.
+    void BeginFeedback(unsigned int screenWidth, unsigned int screenHeight);
+    // Starts reading the feedback back, and binds the default framebuffer again.
+    void EndFeedback();
+
+    // Handles feedback, streaming and uploads. Call it once a frame on the main thread.
+    void Update();
+
+    // Set these on the material, as physicalPages and pageTable.
+    Texture* GetPhysicalTexture();
+    Texture* GetPageTableTexture();
+    // vtPageTable, for both shaders.
+    glm::vec4 GetPageTableParameters();
+    // vtPage for fragmentVirtual.glsl, and for fragmentFeedback.glsl, which has a level bias to make up for the smaller buffer.
+    glm::vec4 GetPageParameters();
+    glm::vec4 GetFeedbackPageParameters();
+
+    unsigned int GetResidentCount();
+    unsigned int GetPendingCount();
+};